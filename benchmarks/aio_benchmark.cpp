@@ -0,0 +1,101 @@
+#include <libdariadb/utils/async/aio.h>
+#include <libdariadb/utils/fs.h>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#ifdef UNIX_OS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace po = boost::program_options;
+using namespace dariadb::utils::async;
+
+size_t file_size = 256 * 1024 * 1024;
+size_t read_size = 4096;
+size_t batch_size = 256;
+size_t batches = 200;
+size_t queue_depth = 64;
+std::string file_name = "aio_benchmark.bin";
+
+int main(int argc, char *argv[]) {
+#ifdef UNIX_OS
+  po::options_description desc("Allowed options");
+  auto aos = desc.add_options();
+  aos("help", "produce help message");
+  aos("file-size", po::value<size_t>(&file_size)->default_value(file_size),
+      "size of test file in bytes.");
+  aos("batch-size", po::value<size_t>(&batch_size)->default_value(batch_size),
+      "reads in one batch.");
+  aos("batches", po::value<size_t>(&batches)->default_value(batches), "batches count.");
+  aos("queue-depth", po::value<size_t>(&queue_depth)->default_value(queue_depth),
+      "max requests in flight.");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+  } catch (std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    std::exit(1);
+  }
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    std::exit(0);
+  }
+
+  {
+    std::cout << "write " << file_size / (1024 * 1024) << " mb..." << std::endl;
+    auto f = std::fopen(file_name.c_str(), "wb");
+    std::vector<uint8_t> buffer(1024 * 1024);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+      buffer[i] = uint8_t(i);
+    }
+    for (size_t written = 0; written < file_size; written += buffer.size()) {
+      std::fwrite(buffer.data(), 1, buffer.size(), f);
+    }
+    std::fclose(f);
+  }
+
+  std::cout << std::setw(10) << "backend" << std::setw(14) << "reads/sec"
+            << std::setw(14) << "mb/sec" << std::endl;
+  for (auto backend : {AIO_BACKEND::SYNC, AIO_BACKEND::THREADS, AIO_BACKEND::URING}) {
+    auto aio = AsyncIO::create(backend, queue_depth);
+    int fd = open(file_name.c_str(), O_RDONLY);
+    // same offsets for all backends.
+    std::mt19937_64 rnd(42);
+    std::uniform_int_distribution<size_t> dist(0, file_size / read_size - 1);
+    std::vector<uint8_t> buffer(batch_size * read_size);
+    std::vector<IORequest> requests(batch_size);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t b = 0; b < batches; ++b) {
+      for (size_t i = 0; i < batch_size; ++i) {
+        auto target = buffer.data() + i * read_size;
+        requests[i] = IORequest{fd, false, dist(rnd) * read_size, target, read_size, 0};
+      }
+      aio->submit(requests)->wait();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                       .count();
+    close(fd);
+
+    auto reads = double(batches * batch_size);
+    std::cout << std::setw(10) << to_string(aio->backend()) << std::setw(14)
+              << size_t(reads / elapsed) << std::setw(14)
+              << (reads * read_size) / (1024 * 1024) / elapsed << std::endl;
+  }
+  std::remove(file_name.c_str());
+#else
+  (void)argc;
+  (void)argv;
+  std::cout << "aio is not supported." << std::endl;
+#endif
+}
@@ -0,0 +1,49 @@
+#include <libdariadb/meas.h>
+#include <libdariadb/storage/bloom_filter.h>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+int main(int argc, char *argv[]) {
+  (void)argc;
+  (void)argv;
+
+  const size_t checks = 100000;
+  std::mt19937_64 rnd(42);
+  std::uniform_int_distribution<dariadb::Id> id_dist(0, 1000000);
+
+  std::cout << std::setw(12) << "ids in page" << std::setw(14) << "64bit fp%"
+            << std::setw(14) << "k-hash fp%" << std::setw(14) << "k-hash bytes"
+            << std::endl;
+
+  for (size_t ids_count : {1, 4, 16, 64, 256, 1024, 4096, 16384}) {
+    uint64_t old_bloom = dariadb::storage::bloom_empty<dariadb::Id>();
+    dariadb::storage::BloomFilter bloom(ids_count);
+    dariadb::IdSet ids;
+    while (ids.size() < ids_count) {
+      auto id = id_dist(rnd);
+      if (ids.insert(id).second) {
+        old_bloom = dariadb::storage::bloom_add(old_bloom, id);
+        bloom.add(id);
+      }
+    }
+
+    size_t old_fp = 0;
+    size_t new_fp = 0;
+    size_t tested = 0;
+    while (tested < checks) {
+      auto id = id_dist(rnd) + 1000001; // never in page.
+      if (dariadb::storage::bloom_check(old_bloom, id)) {
+        old_fp++;
+      }
+      if (bloom.check(id)) {
+        new_fp++;
+      }
+      tested++;
+    }
+    std::cout << std::setw(12) << ids_count << std::setw(14)
+              << (old_fp * 100.0) / checks << std::setw(14) << (new_fp * 100.0) / checks
+              << std::setw(14) << bloom.bits().size() * sizeof(uint64_t) << std::endl;
+  }
+}
@@ -12,6 +12,7 @@
 #include <cmath>
 #include <ctime>
 #include <limits>
+#include <vector>
 
 int main(int argc, char *argv[]) {
   (void)argc;
@@ -179,5 +180,118 @@ int main(int argc, char *argv[]) {
 
     delete[] buf_begin;
   }
+  // decode throughput: value by value vs batch.
+  std::fill(buffer, buffer + test_buffer_size, 0);
+  {
+    auto bw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+    dariadb::compression::CopmressedWriter cwr{bw};
+    auto first = dariadb::Meas();
+    first.time = static_cast<dariadb::Time>(dariadb::timeutil::current_time());
+    size_t count = 0;
+    auto m = first;
+    for (size_t i = 0; i < 5000000; i++) {
+      m.time += 1000 + (i % 7);
+      m.flag = dariadb::Flag(i % 4 == 0 ? 1 : 0);
+      m.value += (i % 3) * 0.25;
+      if (!cwr.append(m)) {
+        break;
+      }
+      ++count;
+    }
+    auto values_count = count - 1;
+    auto values_per_second = [values_count](std::chrono::steady_clock::duration d) {
+      auto secs = std::chrono::duration<double>(d).count();
+      return secs == 0 ? 0.0 : values_count / secs;
+    };
+
+    {
+      auto rbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+      dariadb::compression::CopmressedReader crr{rbw, first};
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < values_count; i++) {
+        crr.read();
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << "\nscalar decode : " << values_per_second(elapsed) << " values/s"
+                << std::endl;
+    }
+    {
+      const size_t batch_size = 1024;
+      std::vector<dariadb::Time> times(batch_size);
+      std::vector<dariadb::Value> values(batch_size);
+      std::vector<dariadb::Flag> flags(batch_size);
+
+      auto rbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+      dariadb::compression::CopmressedReader crr{rbw, first};
+      auto start = std::chrono::steady_clock::now();
+      for (size_t readed = 0; readed < values_count;) {
+        auto n = std::min(batch_size, values_count - readed);
+        crr.readBatch(n, times.data(), values.data(), flags.data());
+        readed += n;
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << "batch decode : " << values_per_second(elapsed) << " values/s"
+                << std::endl;
+    }
+  }
+  // codecs on a regular series: period with jitter, slowly changing gauge.
+  {
+    const size_t count = 1000000;
+    dariadb::MeasArray series(count);
+    auto m = dariadb::Meas();
+    m.time = static_cast<dariadb::Time>(dariadb::timeutil::current_time());
+    for (size_t i = 0; i < count; i++) {
+      m.time += 1000 + (i % 5 == 0 ? (i % 3) : 0);
+      if (i % 10 == 0) {
+        m.value = std::round((m.value + (i % 7) * 0.01 - 0.03) * 100) / 100;
+      }
+      m.flag = dariadb::Flag(i % 1000 == 0 ? 1 : 0);
+      series[i] = m;
+    }
+
+    dariadb::compression::CODEC codecs[2] = {dariadb::compression::CODEC::DELTA_XOR,
+                                             dariadb::compression::CODEC::GORILLA};
+    for (auto codec : codecs) {
+      std::fill(buffer, buffer + test_buffer_size, 0);
+      auto bw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+      dariadb::compression::CopmressedWriter cwr{bw, codec};
+      auto start = std::chrono::steady_clock::now();
+      for (auto &v : series) {
+        cwr.append(v);
+      }
+      auto write_elapsed =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+      auto rbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+      dariadb::compression::CopmressedReader crr{rbw, series.front(), codec};
+      start = std::chrono::steady_clock::now();
+      for (size_t i = 1; i < count; i++) {
+        crr.read();
+      }
+      auto read_elapsed =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+      std::cout << "\ncodec " << dariadb::compression::to_string(codec) << std::endl;
+      std::cout << "bytes per value: " << double(cwr.usedSpace()) / count << std::endl;
+      std::cout << "write : " << count / write_elapsed.count() << " values/s"
+                << std::endl;
+      std::cout << "read : " << count / read_elapsed.count() << " values/s"
+                << std::endl;
+    }
+
+    // sealed chunks of 256 values.
+    const size_t sealed_chunk = 256;
+    size_t sealed_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i += sealed_chunk) {
+      auto n = std::min(sealed_chunk, count - i);
+      sealed_bytes += dariadb::compression::sealed_size(series.data() + i, n).bytes;
+    }
+    auto elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    std::cout << "\nsealed chunks" << std::endl;
+    std::cout << "bytes per value: " << double(sealed_bytes) / count << std::endl;
+    std::cout << "select : " << count / elapsed.count() << " values/s" << std::endl;
+  }
   delete[] buffer;
 }
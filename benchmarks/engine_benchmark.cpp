@@ -26,6 +26,7 @@ bool use_shard = false;
 size_t read_benchmark_runs = 10;
 STRATEGY strategy = STRATEGY::COMPRESSED;
 size_t memory_limit = 0;
+std::string page_compression = "NONE";
 std::unique_ptr<dariadb_bench::BenchmarkSummaryInfo> summary_info;
 
 class BenchCallback : public IReadCallback {
@@ -59,6 +60,9 @@ void parse_cmdline(int argc, char *argv[]) {
   aos("memory-limit", po::value<size_t>(&memory_limit)->default_value(memory_limit),
       "allocation area limit  in megabytes when strategy=MEMORY");
   aos("use-shard", "shard some id per shards");
+  aos("page-compression",
+      po::value<std::string>(&page_compression)->default_value(page_compression),
+      "block compression of pages by level: NONE,FAST,HIGH");
   po::variables_map vm;
   try {
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -367,6 +371,7 @@ int main(int argc, char *argv[]) {
 
     auto settings = dariadb::storage::Settings::create(storage_path);
     settings->strategy.setValue(strategy);
+    settings->page_compression.setValue(page_compression);
     settings->save();
 
     if ((strategy == STRATEGY::MEMORY || strategy == STRATEGY::CACHE) &&
@@ -479,6 +484,17 @@ int main(int argc, char *argv[]) {
       }
     }
 
+    if (!use_shard) {
+      // cpu cost of block compression is in write, repack and read times.
+      size_t pages_bytes = 0;
+      for (auto &p : utils::fs::ls(settings->raw_path.value(), ".page")) {
+        pages_bytes += utils::fs::file_size(p);
+      }
+      std::cout << "pages size (" << page_compression << "): " << pages_bytes
+                << " bytes, " << double(pages_bytes) / append_count << " bytes/value"
+                << std::endl;
+    }
+
     auto queue_sizes = raw_ptr->description();
     std::cout << "\r"
               << " storage: (p:" << queue_sizes.pages_count
@@ -31,6 +31,34 @@ dariadb::Time write_time = 0;
 bool stop_info = false;
 dariadb::storage::MemStorage_ptr mstore;
 size_t memory_limit = 0;
+size_t scaling_writes = 4000000;
+
+/// writes per second of 'threads' writers to new storage, each writer has own ids.
+double write_speed(const dariadb::storage::EngineEnvironment_ptr &env, size_t threads) {
+  const size_t ids_per_thread = 10;
+  auto storage = dariadb::storage::MemStorage::create(env, threads * ids_per_thread);
+  auto writes_per_thread = scaling_writes / threads;
+  std::vector<std::thread> writers;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; ++t) {
+    writers.emplace_back([&storage, t, writes_per_thread]() {
+      dariadb::Meas m;
+      for (size_t i = 0; i < writes_per_thread; ++i) {
+        m.id = dariadb::Id(t * ids_per_thread + i % ids_per_thread);
+        m.time = dariadb::Time(i);
+        m.value = dariadb::Value(i);
+        storage->append(m);
+      }
+    });
+  }
+  for (auto &w : writers) {
+    w.join();
+  }
+  auto elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  storage->stop();
+  return (writes_per_thread * threads) / elapsed;
+}
 
 void show_info() {
   clock_t t0 = clock();
@@ -60,6 +88,8 @@ int main(int argc, char **argv) {
   auto aos = desc.add_options()("help", "produce help message");
   aos("memory-limit", po::value<size_t>(&memory_limit)->default_value(memory_limit),
       "allocation area limit  in megabytes when strategy=MEMORY");
+  aos("scaling-writes", po::value<size_t>(&scaling_writes)->default_value(scaling_writes),
+      "values written by all threads in each step of scaling test.");
 
   po::variables_map vm;
   try {
@@ -125,6 +155,12 @@ int main(int argc, char **argv) {
                                  false);
 
     mstore = nullptr;
+
+    std::cout << "scaling of writes:" << std::endl;
+    for (size_t threads : {1, 2, 4, 8, 16, 32}) {
+      auto speed = write_speed(_engine_env, threads);
+      std::cout << " threads: " << threads << " speed: " << speed << "/sec" << std::endl;
+    }
     dariadb::utils::async::ThreadManager::stop();
   }
 }
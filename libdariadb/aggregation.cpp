@@ -0,0 +1,166 @@
+#include <libdariadb/aggregation.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/strings.h>
+#include <libdariadb/utils/utils.h>
+#include <sstream>
+
+using namespace dariadb;
+
+std::istream &dariadb::operator>>(std::istream &in, Aggregation &a) {
+  std::string token;
+  in >> token;
+
+  token = utils::strings::to_upper(token);
+
+  if (token == "NONE") {
+    a = Aggregation::NONE;
+    return in;
+  }
+  if (token == "MIN") {
+    a = Aggregation::MIN;
+    return in;
+  }
+  if (token == "MAX") {
+    a = Aggregation::MAX;
+    return in;
+  }
+  if (token == "AVG") {
+    a = Aggregation::AVG;
+    return in;
+  }
+  if (token == "SUM") {
+    a = Aggregation::SUM;
+    return in;
+  }
+  if (token == "COUNT") {
+    a = Aggregation::COUNT;
+    return in;
+  }
+  if (token == "FIRST") {
+    a = Aggregation::FIRST;
+    return in;
+  }
+  if (token == "LAST") {
+    a = Aggregation::LAST;
+    return in;
+  }
+  THROW_EXCEPTION("query: bad aggregation - ", token);
+}
+
+std::ostream &dariadb::operator<<(std::ostream &stream, const Aggregation &a) {
+  switch (a) {
+  case Aggregation::NONE:
+    stream << "NONE";
+    break;
+  case Aggregation::MIN:
+    stream << "MIN";
+    break;
+  case Aggregation::MAX:
+    stream << "MAX";
+    break;
+  case Aggregation::AVG:
+    stream << "AVG";
+    break;
+  case Aggregation::SUM:
+    stream << "SUM";
+    break;
+  case Aggregation::COUNT:
+    stream << "COUNT";
+    break;
+  case Aggregation::FIRST:
+    stream << "FIRST";
+    break;
+  case Aggregation::LAST:
+    stream << "LAST";
+    break;
+  default:
+    THROW_EXCEPTION("query: bad aggregation - ", (uint16_t)a);
+    break;
+  };
+  return stream;
+}
+
+std::string dariadb::to_string(const Aggregation &a) {
+  std::stringstream ss;
+  ss << a;
+  return ss.str();
+}
+
+Aggregator::Aggregator(Aggregation kind) : _kind(kind) {
+  clear();
+}
+
+void Aggregator::clear() {
+  _first = Meas();
+  _last = Meas();
+  _min = MAX_VALUE;
+  _max = -MAX_VALUE;
+  _sum = Value(0);
+  _count = uint64_t(0);
+}
+
+void Aggregator::add(const Meas &m) {
+  if (_count == 0) {
+    _first = m;
+  }
+  _last = m;
+  _min = std::min(_min, m.value);
+  _max = std::max(_max, m.value);
+  _sum += m.value;
+  _count++;
+}
+
+void Aggregator::add(const Statistic &st) {
+  ENSURE(is_from_stat(_kind));
+  if (st.count == 0) {
+    return;
+  }
+  _min = std::min(_min, st.minValue);
+  _max = std::max(_max, st.maxValue);
+  _sum += st.sum;
+  _count += st.count;
+}
+
+bool Aggregator::is_from_stat(Aggregation kind) {
+  switch (kind) {
+  case Aggregation::MIN:
+  case Aggregation::MAX:
+  case Aggregation::AVG:
+  case Aggregation::SUM:
+  case Aggregation::COUNT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+Meas Aggregator::result() const {
+  ENSURE(_count != 0);
+  Meas result = _first;
+  switch (_kind) {
+  case Aggregation::NONE:
+  case Aggregation::FIRST:
+    break;
+  case Aggregation::LAST:
+    result.value = _last.value;
+    break;
+  case Aggregation::MIN:
+    result.value = _min;
+    break;
+  case Aggregation::MAX:
+    result.value = _max;
+    break;
+  case Aggregation::AVG:
+    result.value = _sum / _count;
+    break;
+  case Aggregation::SUM:
+    result.value = _sum;
+    break;
+  case Aggregation::COUNT:
+    result.value = Value(_count);
+    break;
+  default:
+    THROW_EXCEPTION("query: bad aggregation - ", (uint16_t)_kind);
+  }
+  return result;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <libdariadb/meas.h>
+#include <libdariadb/st_exports.h>
+#include <libdariadb/stat.h>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace dariadb {
+/**
+how values in one 'step' interval are reduced to one value:
+NONE - no reduction, all values are returned.
+FIRST, LAST - value with minimal (maximal) time in interval.
+COUNT - count of values in interval.
+*/
+enum class Aggregation : uint8_t { NONE = 0, MIN, MAX, AVG, SUM, COUNT, FIRST, LAST };
+
+EXPORT std::istream &operator>>(std::istream &in, Aggregation &a);
+EXPORT std::ostream &operator<<(std::ostream &stream, const Aggregation &a);
+
+EXPORT std::string to_string(const Aggregation &a);
+
+/// reduce sequence of values (in increasing time order) to one value.
+class Aggregator {
+public:
+  EXPORT Aggregator(Aggregation kind);
+  EXPORT void add(const Meas &m);
+  /// add precomputed statistic. only for kinds where is_from_stat is true.
+  EXPORT void add(const Statistic &st);
+  /// true - if result can be computed from Statistic (without first/last values).
+  EXPORT static bool is_from_stat(Aggregation kind);
+  /// id, time and flag - from first value.
+  EXPORT Meas result() const;
+  EXPORT void clear();
+  bool empty() const { return _count == 0; }
+  uint64_t count() const { return _count; }
+
+protected:
+  Aggregation _kind;
+  Meas _first;
+  Meas _last;
+  Value _min;
+  Value _max;
+  Value _sum;
+  uint64_t _count;
+};
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <libdariadb/compression/bytebuffer.h>
+#include <libdariadb/utils/utils.h>
+#include <algorithm>
+
+namespace dariadb {
+namespace compression {
+namespace inner {
+inline uint64_t zigzag(int64_t v) {
+  return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+  return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+/// bit stream over ByteBuffer. bytes are taken like in ByteBuffer (from end),
+/// bits in byte - from the high.
+struct BitWriter {
+  BitWriter(const ByteBuffer_Ptr &bw_) : bw(bw_), _cur_byte(nullptr), _free_bits(0) {}
+
+  void write(uint64_t value, uint8_t bits) {
+    while (bits != 0) {
+      if (_free_bits == 0) {
+        _cur_byte = bw->offset_off<uint8_t>();
+        *_cur_byte = 0;
+        _free_bits = 8;
+      }
+      auto take = std::min(_free_bits, bits);
+      auto part = (value >> (bits - take)) & ((uint64_t(1) << take) - 1);
+      *_cur_byte |= static_cast<uint8_t>(part << (_free_bits - take));
+      _free_bits -= take;
+      bits -= take;
+    }
+  }
+
+  size_t free_bits() const { return _free_bits + size_t(8) * bw->free_size(); }
+
+  ByteBuffer_Ptr bw;
+  uint8_t *_cur_byte;
+  uint8_t _free_bits;
+};
+
+/// count bits instead of writing. used to select encoding.
+struct BitCounter {
+  BitCounter() : bits(0) {}
+  void write(uint64_t, uint8_t b) { bits += b; }
+
+  size_t bits;
+};
+
+struct BitReader {
+  BitReader(const ByteBuffer_Ptr &bw_) : bw(bw_), _cur_byte(0), _avail_bits(0) {}
+
+  uint64_t read(uint8_t bits) {
+    uint64_t result = 0;
+    while (bits != 0) {
+      if (_avail_bits == 0) {
+        _cur_byte = bw->read<uint8_t>();
+        _avail_bits = 8;
+      }
+      auto take = std::min(_avail_bits, bits);
+      auto part = (_cur_byte >> (_avail_bits - take)) & ((1U << take) - 1);
+      result = (result << take) | part;
+      _avail_bits -= take;
+      bits -= take;
+    }
+    return result;
+  }
+
+  /// count of '1' before '0', but no more than max_ones.
+  uint8_t read_ones(uint8_t max_ones) {
+    uint8_t result = 0;
+    while (result < max_ones && read(1) == 1) {
+      ++result;
+    }
+    return result;
+  }
+
+  ByteBuffer_Ptr bw;
+  uint8_t _cur_byte;
+  uint8_t _avail_bits;
+};
+
+/// bits of one value, collected before writing. needed to check free space.
+struct BitsList {
+  static const uint8_t MAX_PARTS = 8;
+  struct Part {
+    uint64_t value;
+    uint8_t bits;
+  };
+
+  BitsList() : count(0), bits(0) {}
+
+  void write(uint64_t value, uint8_t b) {
+    ENSURE(count < MAX_PARTS);
+    parts[count++] = Part{value, b};
+    bits += b;
+  }
+
+  template <class Writer> void write_to(Writer &w) const {
+    for (uint8_t i = 0; i < count; ++i) {
+      w.write(parts[i].value, parts[i].bits);
+    }
+  }
+
+  Part parts[MAX_PARTS];
+  uint8_t count;
+  size_t bits;
+};
+}
+}
+}
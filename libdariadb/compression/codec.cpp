@@ -0,0 +1,57 @@
+#include <libdariadb/compression/codec.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/strings.h>
+#include <sstream>
+
+std::istream &dariadb::compression::operator>>(std::istream &in, CODEC &codec) {
+  std::string token;
+  in >> token;
+
+  token = utils::strings::to_upper(token);
+
+  if (token == "DELTA_XOR") {
+    codec = CODEC::DELTA_XOR;
+    return in;
+  }
+  if (token == "GORILLA") {
+    codec = CODEC::GORILLA;
+    return in;
+  }
+  if (token == "CONSTANT") {
+    codec = CODEC::CONSTANT;
+    return in;
+  }
+  if (token == "COLUMNS") {
+    codec = CODEC::COLUMNS;
+    return in;
+  }
+  THROW_EXCEPTION("engine: bad chunk codec - ", token);
+}
+
+std::ostream &dariadb::compression::operator<<(std::ostream &stream,
+                                              const CODEC &codec) {
+  switch (codec) {
+  case CODEC::DELTA_XOR:
+    stream << "DELTA_XOR";
+    break;
+  case CODEC::GORILLA:
+    stream << "GORILLA";
+    break;
+  case CODEC::CONSTANT:
+    stream << "CONSTANT";
+    break;
+  case CODEC::COLUMNS:
+    stream << "COLUMNS";
+    break;
+  default:
+    THROW_EXCEPTION("engine: bad chunk codec - ", (uint16_t)codec);
+    break;
+  };
+  return stream;
+}
+
+std::string dariadb::compression::to_string(const CODEC &codec) {
+  std::stringstream ss;
+  ss << codec;
+  return ss.str();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace dariadb {
+namespace compression {
+/**
+encoding of values in chunk:
+DELTA_XOR - byte aligned delta of delta for time, xor for value, leb128 for flag.
+GORILLA - bit packed delta of delta for time, xor with leading/trailing zeros for value.
+CONSTANT - sealed chunk with equal values, flags and time step. payload is empty.
+COLUMNS - sealed chunk, every column is encoded by the smallest encoding (columns.h).
+CONSTANT and COLUMNS are selected when chunk is written to page, not for appending.
+*/
+enum class CODEC : uint8_t { DELTA_XOR = 0, GORILLA, CONSTANT, COLUMNS };
+
+EXPORT std::istream &operator>>(std::istream &in, CODEC &codec);
+EXPORT std::ostream &operator<<(std::ostream &stream, const CODEC &codec);
+
+EXPORT std::string to_string(const CODEC &codec);
+}
+}
@@ -0,0 +1,426 @@
+#include <libdariadb/compression/columns.h>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
+
+using namespace dariadb;
+using namespace dariadb::compression;
+using namespace dariadb::compression::inner;
+
+namespace {
+const uint8_t KINDS_BITS = 1 + 3 + 1;
+const size_t MAX_DICTIONARY_SIZE = 256;
+const double MAX_INTEGER = 9007199254740992.0; // 2^53
+
+struct Kinds {
+  TimeKind time;
+  ValueKind value;
+  FlagKind flag;
+  /// bits of each column.
+  size_t time_bits;
+  size_t value_bits;
+  size_t flag_bits;
+};
+
+/// length of column in bits: '0'+16 bits | '1'+40 bits.
+template <class Writer> void write_length(Writer &w, size_t bits) {
+  if (bits < (size_t(1) << 16)) {
+    w.write(bits, 1 + 16);
+  } else {
+    w.write((uint64_t(1) << 40) | bits, 1 + 40);
+  }
+}
+
+size_t read_length(BitReader &r) {
+  return size_t(r.read(r.read(1) == 0 ? 16 : 40));
+}
+
+/// lengths of columns are written, when next columns are not empty.
+/// reader starts each column from own position.
+bool has_time_length(const Kinds &k) {
+  return k.time == TimeKind::GORILLA &&
+         (k.value != ValueKind::CONSTANT || k.flag == FlagKind::GORILLA);
+}
+
+bool has_value_length(const Kinds &k) {
+  return k.value != ValueKind::CONSTANT && k.flag == FlagKind::GORILLA;
+}
+
+/// bits of kinds, lengths and columns.
+size_t total_bits(const Kinds &k) {
+  BitCounter c;
+  if (has_time_length(k)) {
+    write_length(c, k.time_bits);
+  }
+  if (has_value_length(k)) {
+    write_length(c, k.value_bits);
+  }
+  return KINDS_BITS + c.bits + k.time_bits + k.value_bits + k.flag_bits;
+}
+
+inline uint64_t flat(const Meas &m) {
+  return uint64_t(flat_double_to_int(m.value));
+}
+
+inline uint8_t bits_for(uint64_t v) {
+  return v == 0 ? uint8_t(0) : uint8_t(64 - utils::clz(v));
+}
+
+// time
+
+bool is_constant_step(const Meas *values, size_t count) {
+  if (count < 2) {
+    return true;
+  }
+  if (values[count - 1].time < values[0].time) {
+    return false;
+  }
+  auto step = values[1].time - values[0].time;
+  for (size_t i = 2; i < count; ++i) {
+    if (values[i].time - values[i - 1].time != step) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Writer>
+void write_times(Writer &w, TimeKind kind, const Meas *values, size_t count) {
+  if (kind == TimeKind::GORILLA) {
+    GorillaState st(values[0]);
+    for (size_t i = 1; i < count; ++i) {
+      gorilla_write_time(w, st, values[i].time);
+    }
+  }
+}
+
+// value
+
+bool is_integers(const Meas *values, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    auto v = values[i].value;
+    if (!(std::fabs(v) <= MAX_INTEGER) || v != std::trunc(v)) {
+      return false;
+    }
+    auto restored = Value(int64_t(v));
+    if (flat_double_to_int(restored) != flat_double_to_int(v)) { // -0.0
+      return false;
+    }
+  }
+  return true;
+}
+
+/// run length - 1: '0'+3 bits | '10'+8 bits | '11'+32 bits
+template <class Writer> void write_run_length(Writer &w, size_t length) {
+  auto l = uint64_t(length - 1);
+  if (l < (uint64_t(1) << 3)) {
+    w.write(l, 1 + 3);
+  } else if (l < (uint64_t(1) << 8)) {
+    w.write((uint64_t(0x2) << 8) | l, 2 + 8);
+  } else {
+    w.write((uint64_t(0x3) << 32) | l, 2 + 32);
+  }
+}
+
+/// dictionary of values[1..count). empty if too many different values.
+std::map<uint64_t, uint64_t> dictionary(const Meas *values, size_t count) {
+  std::map<uint64_t, uint64_t> result;
+  for (size_t i = 1; i < count; ++i) {
+    if (result.emplace(flat(values[i]), 0).second &&
+        result.size() > MAX_DICTIONARY_SIZE) {
+      return std::map<uint64_t, uint64_t>{};
+    }
+  }
+  uint64_t index = 0;
+  for (auto &kv : result) {
+    kv.second = index++;
+  }
+  return result;
+}
+
+template <class Writer>
+void write_values(Writer &w, ValueKind kind, const Meas *values, size_t count,
+                  const std::map<uint64_t, uint64_t> &dict) {
+  switch (kind) {
+  case ValueKind::CONSTANT:
+    break;
+  case ValueKind::XOR: {
+    GorillaState st(values[0]);
+    for (size_t i = 1; i < count; ++i) {
+      gorilla_write_value(w, st, flat(values[i]));
+    }
+    break;
+  }
+  case ValueKind::RUNS: {
+    GorillaState st(values[0]);
+    for (size_t i = 1; i < count;) {
+      auto run_end = i + 1;
+      while (run_end < count && flat(values[run_end]) == flat(values[i])) {
+        ++run_end;
+      }
+      write_run_length(w, run_end - i);
+      gorilla_write_value(w, st, flat(values[i]));
+      i = run_end;
+    }
+    break;
+  }
+  case ValueKind::INTEGERS: {
+    uint64_t max_zz = 0;
+    for (size_t i = 1; i < count; ++i) {
+      auto delta = int64_t(values[i].value) - int64_t(values[i - 1].value);
+      max_zz = std::max(max_zz, zigzag(delta));
+    }
+    auto width = bits_for(max_zz);
+    w.write(width, 7);
+    for (size_t i = 1; i < count; ++i) {
+      auto delta = int64_t(values[i].value) - int64_t(values[i - 1].value);
+      w.write(zigzag(delta), width);
+    }
+    break;
+  }
+  case ValueKind::DICTIONARY: {
+    w.write(dict.size() - 1, 8);
+    for (auto &kv : dict) {
+      w.write(kv.first, 64);
+    }
+    auto width = bits_for(dict.size() - 1);
+    for (size_t i = 1; i < count; ++i) {
+      w.write(dict.find(flat(values[i]))->second, width);
+    }
+    break;
+  }
+  }
+}
+
+// flag
+
+template <class Writer>
+void write_flags(Writer &w, FlagKind kind, const Meas *values, size_t count) {
+  if (kind == FlagKind::GORILLA) {
+    GorillaState st(values[0]);
+    for (size_t i = 1; i < count; ++i) {
+      gorilla_write_flag(w, st, values[i].flag);
+    }
+  }
+}
+
+Kinds select_kinds(const Meas *values, size_t count,
+                   std::map<uint64_t, uint64_t> *dict) {
+  Kinds result;
+  result.time_bits = result.value_bits = result.flag_bits = 0;
+
+  result.time = TimeKind::GORILLA;
+  if (is_constant_step(values, count)) {
+    result.time = TimeKind::STEP;
+  } else {
+    BitCounter c;
+    write_times(c, TimeKind::GORILLA, values, count);
+    result.time_bits = c.bits;
+  }
+
+  bool is_constant = true;
+  for (size_t i = 1; i < count && is_constant; ++i) {
+    is_constant = flat(values[i]) == flat(values[0]);
+  }
+  result.value = ValueKind::CONSTANT;
+  if (!is_constant) {
+    *dict = dictionary(values, count);
+    std::vector<ValueKind> candidates{ValueKind::XOR, ValueKind::RUNS};
+    if (is_integers(values, count)) {
+      candidates.push_back(ValueKind::INTEGERS);
+    }
+    if (!dict->empty()) {
+      candidates.push_back(ValueKind::DICTIONARY);
+    }
+    size_t min_bits = std::numeric_limits<size_t>::max();
+    for (auto kind : candidates) {
+      BitCounter c;
+      write_values(c, kind, values, count, *dict);
+      if (c.bits < min_bits) {
+        min_bits = c.bits;
+        result.value = kind;
+      }
+    }
+    result.value_bits = min_bits;
+  }
+
+  result.flag = FlagKind::CONSTANT;
+  for (size_t i = 1; i < count; ++i) {
+    if (values[i].flag != values[0].flag) {
+      result.flag = FlagKind::GORILLA;
+      BitCounter c;
+      write_flags(c, FlagKind::GORILLA, values, count);
+      result.flag_bits = c.bits;
+      break;
+    }
+  }
+  return result;
+}
+
+bool is_constant(const Kinds &k) {
+  return k.time == TimeKind::STEP && k.value == ValueKind::CONSTANT &&
+         k.flag == FlagKind::CONSTANT;
+}
+}
+
+SealedSize dariadb::compression::sealed_size(const Meas *values, size_t count) {
+  std::map<uint64_t, uint64_t> dict;
+  auto kinds = select_kinds(values, count, &dict);
+  if (is_constant(kinds)) {
+    return SealedSize{CODEC::CONSTANT, size_t(0)};
+  }
+  return SealedSize{CODEC::COLUMNS, (total_bits(kinds) + 7) / 8};
+}
+
+void dariadb::compression::sealed_encode(const Meas *values, size_t count, CODEC codec,
+                                         const ByteBuffer_Ptr &bw) {
+  std::map<uint64_t, uint64_t> dict;
+  auto kinds = select_kinds(values, count, &dict);
+  if (codec == CODEC::CONSTANT) {
+    ENSURE(is_constant(kinds));
+    return;
+  }
+  ENSURE(codec == CODEC::COLUMNS);
+  BitWriter w(bw);
+  w.write(uint64_t(kinds.time), 1);
+  w.write(uint64_t(kinds.value), 3);
+  w.write(uint64_t(kinds.flag), 1);
+  if (has_time_length(kinds)) {
+    write_length(w, kinds.time_bits);
+  }
+  if (has_value_length(kinds)) {
+    write_length(w, kinds.value_bits);
+  }
+  write_times(w, kinds.time, values, count);
+  write_values(w, kinds.value, values, count, dict);
+  write_flags(w, kinds.flag, values, count);
+}
+
+namespace {
+/// reader of column, which starts 'bits' after next bit of 'r'.
+BitReader column_reader(const BitReader &r, size_t bits) {
+  // bytes are read from end: current byte of 'r' is at pos, next - before it.
+  auto pos = size_t(r.bw->pos());
+  if (r._avail_bits != 0) {
+    bits += 8 - r._avail_bits;
+    pos += 1;
+  }
+  auto bw = std::make_shared<ByteBuffer>(r.bw->get_range());
+  bw->set_pos(static_cast<uint32_t>(pos - bits / 8));
+  BitReader result(bw);
+  result.read(uint8_t(bits % 8));
+  return result;
+}
+}
+
+SealedReader::SealedReader(const ByteBuffer_Ptr &bw, CODEC codec, const Meas &first,
+                           const Meas &last, size_t count)
+    : _first(first), _count(count), _readed(0), _times(bw), _values(bw), _flags(bw),
+      _time_state(first), _value_state(first), _flag_state(first), _run_length(0),
+      _prev_integer(int64_t(first.value)), _width(0) {
+  _time_kind = TimeKind::STEP;
+  _value_kind = ValueKind::CONSTANT;
+  _flag_kind = FlagKind::CONSTANT;
+  _step = count < 2 ? Time(0) : (last.time - first.time) / (count - 1);
+  if (count < 2 || codec != CODEC::COLUMNS) {
+    return;
+  }
+  _time_kind = static_cast<TimeKind>(_times.read(1));
+  _value_kind = static_cast<ValueKind>(_times.read(3));
+  _flag_kind = static_cast<FlagKind>(_times.read(1));
+  Kinds kinds{_time_kind, _value_kind, _flag_kind, 0, 0, 0};
+  size_t time_bits = has_time_length(kinds) ? read_length(_times) : 0;
+  size_t value_bits = has_value_length(kinds) ? read_length(_times) : 0;
+  if (_value_kind != ValueKind::CONSTANT) {
+    _values = column_reader(_times, time_bits);
+  }
+  if (_flag_kind == FlagKind::GORILLA) {
+    _flags = column_reader(_times, time_bits + value_bits);
+  }
+
+  if (_value_kind == ValueKind::INTEGERS) {
+    _width = static_cast<uint8_t>(_values.read(7));
+  } else if (_value_kind == ValueKind::DICTIONARY) {
+    _dictionary.resize(size_t(_values.read(8)) + 1);
+    for (auto &v : _dictionary) {
+      v = _values.read(64);
+    }
+    _width = bits_for(_dictionary.size() - 1);
+  }
+}
+
+void SealedReader::read(Meas *out, size_t n) {
+  ENSURE(n == 0 || _readed + n < _count);
+  for (size_t i = 0; i < n; ++i) {
+    out[i].id = _first.id;
+  }
+  if (_time_kind == TimeKind::STEP) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i].time = _first.time + _step * (_readed + i + 1);
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i].time = gorilla_read_time(_times, _time_state);
+    }
+  }
+  read_values(out, n);
+  if (_flag_kind == FlagKind::CONSTANT) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i].flag = _first.flag;
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i].flag = gorilla_read_flag(_flags, _flag_state);
+    }
+  }
+  _readed += n;
+}
+
+void SealedReader::read_values(Meas *out, size_t n) {
+  switch (_value_kind) {
+  case ValueKind::CONSTANT:
+    for (size_t i = 0; i < n; ++i) {
+      out[i].value = _first.value;
+    }
+    break;
+  case ValueKind::XOR:
+    for (size_t i = 0; i < n; ++i) {
+      out[i].value =
+          flat_int_to_double(int64_t(gorilla_read_value(_values, _value_state)));
+    }
+    break;
+  case ValueKind::RUNS:
+    for (size_t i = 0; i < n; ++i) {
+      if (_run_length == 0) {
+        static const uint8_t bits[] = {3, 8, 32};
+        _run_length = size_t(_values.read(bits[_values.read_ones(2)])) + 1;
+        gorilla_read_value(_values, _value_state);
+      }
+      --_run_length;
+      out[i].value = flat_int_to_double(int64_t(_value_state.value));
+    }
+    break;
+  case ValueKind::INTEGERS:
+    for (size_t i = 0; i < n; ++i) {
+      _prev_integer += unzigzag(_values.read(_width));
+      out[i].value = Value(_prev_integer);
+    }
+    break;
+  case ValueKind::DICTIONARY:
+    for (size_t i = 0; i < n; ++i) {
+      out[i].value = flat_int_to_double(int64_t(_dictionary[_values.read(_width)]));
+    }
+    break;
+  }
+}
+
+void dariadb::compression::sealed_decode(const ByteBuffer_Ptr &bw, CODEC codec,
+                                         const Meas &first, const Meas &last,
+                                         size_t count, Meas *out) {
+  if (count < 2) {
+    return;
+  }
+  SealedReader r(bw, codec, first, last, count);
+  r.read(out, count - 1);
+}
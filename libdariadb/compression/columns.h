@@ -0,0 +1,74 @@
+#pragma once
+
+#include <libdariadb/compression/bytebuffer.h>
+#include <libdariadb/compression/codec.h>
+#include <libdariadb/compression/gorilla.h>
+#include <libdariadb/meas.h>
+#include <libdariadb/st_exports.h>
+#include <vector>
+
+namespace dariadb {
+namespace compression {
+/**
+encodings of sealed chunk, when all values are known. columns are written one
+after another, each by its smallest encoding:
+time - constant step | gorilla delta of delta.
+value - constant | gorilla xor | runs of equal values | delta of integers | dictionary.
+flag - constant | gorilla.
+'values[0]' is the first value of chunk (stored in chunk header) and is not written.
+lengths of time and value columns are written before them, if next columns are not
+empty, so columns are read in parallel.
+*/
+struct SealedSize {
+  CODEC codec;
+  size_t bytes;
+};
+
+/// smallest of CONSTANT and COLUMNS encodings of values.
+EXPORT SealedSize sealed_size(const Meas *values, size_t count);
+/// write values to 'bw' by codec from sealed_size.
+EXPORT void sealed_encode(const Meas *values, size_t count, CODEC codec,
+                          const ByteBuffer_Ptr &bw);
+/// read values[1..count). 'last' - last of values, needed for constant step.
+EXPORT void sealed_decode(const ByteBuffer_Ptr &bw, CODEC codec, const Meas &first,
+                          const Meas &last, size_t count, Meas *out);
+
+namespace inner {
+enum class TimeKind : uint8_t { STEP = 0, GORILLA };
+enum class ValueKind : uint8_t { CONSTANT = 0, XOR, RUNS, INTEGERS, DICTIONARY };
+enum class FlagKind : uint8_t { CONSTANT = 0, GORILLA };
+}
+
+/// incremental reader of values[1..count), each column has own bit reader.
+class SealedReader {
+public:
+  EXPORT SealedReader(const ByteBuffer_Ptr &bw, CODEC codec, const Meas &first,
+                      const Meas &last, size_t count);
+  /// read next n values.
+  EXPORT void read(Meas *out, size_t n);
+
+protected:
+  void read_values(Meas *out, size_t n);
+
+  Meas _first;
+  size_t _count;
+  size_t _readed;
+  inner::TimeKind _time_kind;
+  inner::ValueKind _value_kind;
+  inner::FlagKind _flag_kind;
+  inner::BitReader _times;
+  inner::BitReader _values;
+  inner::BitReader _flags;
+  inner::GorillaState _time_state;
+  inner::GorillaState _value_state;
+  inner::GorillaState _flag_state;
+  Time _step;
+  /// values left in current run.
+  size_t _run_length;
+  int64_t _prev_integer;
+  /// bits of delta or dictionary index.
+  uint8_t _width;
+  std::vector<uint64_t> _dictionary;
+};
+}
+}
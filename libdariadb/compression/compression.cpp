@@ -1,10 +1,13 @@
 #include <libdariadb/compression/compression.h>
+#include <libdariadb/utils/cz.h>
+#include <cstring>
 
 using namespace dariadb;
 using namespace dariadb::compression;
 
-CopmressedWriter::CopmressedWriter(const ByteBuffer_Ptr &bw)
-    : _bb(bw), time_comp(bw), value_comp(bw), flag_comp(bw) {
+CopmressedWriter::CopmressedWriter(const ByteBuffer_Ptr &bw, CODEC codec)
+    : _bb(bw), _codec(codec), time_comp(bw), value_comp(bw), flag_comp(bw),
+      gorilla_comp(bw) {
   _is_first = true;
   _is_full = false;
 }
@@ -17,6 +20,14 @@ bool CopmressedWriter::append(const Meas &m) {
     _is_first = false;
   }
 
+  if (_codec == CODEC::GORILLA) {
+    if (!gorilla_comp.append(m)) {
+      _is_full = true;
+      return false;
+    }
+    return true;
+  }
+
   auto t_f = time_comp.append(m.time);
   auto f_f = value_comp.append(m.value);
   auto v_f = flag_comp.append(m.flag);
@@ -29,10 +40,157 @@ bool CopmressedWriter::append(const Meas &m) {
   }
 }
 
-CopmressedReader::CopmressedReader(const ByteBuffer_Ptr &bw, const Meas &first)
-    : time_dcomp(bw, first.time), value_dcomp(bw, first.value),
-      flag_dcomp(bw, first.flag) {
+CopmressedReader::CopmressedReader(const ByteBuffer_Ptr &bw, const Meas &first,
+                                   CODEC codec)
+    : _codec(codec), time_dcomp(bw, first.time), value_dcomp(bw, first.value),
+      flag_dcomp(bw, first.flag), gorilla_dcomp(bw, first) {
   _first = first;
 }
 
+CopmressedReader::CopmressedReader(const ByteBuffer_Ptr &bw, const Meas &first,
+                                   const Meas &last, size_t count, CODEC codec)
+    : CopmressedReader(bw, first, codec) {
+  if (codec == CODEC::CONSTANT || codec == CODEC::COLUMNS) {
+    _sealed = std::make_shared<SealedReader>(bw, codec, first, last, count);
+  }
+}
+
 CopmressedReader::~CopmressedReader() {}
+
+namespace {
+/// batch decoding works with raw pointer to the buffer instead of ByteBuffer::read,
+/// format is the same: values are written from the end of buffer to the begin.
+template <typename T> inline T read_back(const uint8_t *&p) {
+  p -= sizeof(T);
+  T result;
+  std::memcpy(&result, p, sizeof(T));
+  return result;
+}
+
+inline int64_t read_delta(const uint8_t *&p) {
+  auto first_byte = read_back<uint8_t>(p);
+  int64_t result = 0;
+  if ((first_byte & 0xC0) == 0x80) {
+    result = first_byte & 0x3F;
+    if (result > 32) { // negative
+      result = (-64) | result;
+    }
+  } else if ((first_byte & 0xE0) == 0xC0) {
+    auto second = read_back<uint8_t>(p);
+    result = ((uint16_t)(first_byte & 0x1F) << 8) | (uint16_t)second;
+    if (result > 4096) { // negative
+      result = (-4096) | result;
+    }
+  } else if ((first_byte & 0xE0) == 0xE0) {
+    auto second = read_back<uint16_t>(p);
+    result = ((uint32_t)(first_byte & 0x0F) << 16) | (uint32_t)second;
+    if (result > 524287) { // negative
+      result = (-524287) | result;
+    }
+  } else {
+    ENSURE(first_byte == 0);
+    result = read_back<uint64_t>(p);
+  }
+  return result;
+}
+
+inline uint64_t read_xor(const uint8_t *&p, const uint8_t *begin, uint64_t prev) {
+  auto byte_count = read_back<uint8_t>(p);
+  if (byte_count == 0) { // prev==current
+    return prev;
+  }
+  auto move_count = read_back<uint8_t>(p);
+  ENSURE(byte_count <= sizeof(uint64_t));
+  uint64_t raw_value = 0;
+  if (p - begin >= (ptrdiff_t)sizeof(uint64_t)) {
+    // bytes are stored in reverse order: one load and swap instead of byte loop.
+    uint64_t word;
+    std::memcpy(&word, p - sizeof(uint64_t), sizeof(uint64_t));
+    raw_value = utils::bswap64(word);
+    if (byte_count < sizeof(uint64_t)) {
+      raw_value &= (uint64_t(1) << (byte_count * 8)) - 1;
+    }
+    p -= byte_count;
+  } else {
+    for (size_t i = 0; i < byte_count; ++i) {
+      raw_value |= uint64_t(read_back<uint8_t>(p)) << (i * 8);
+    }
+  }
+  return (raw_value << move_count) ^ prev;
+}
+
+inline Flag read_flag(const uint8_t *&p) {
+  auto readed = read_back<uint8_t>(p);
+  if (!(readed & 0x80U)) {
+    return readed;
+  }
+  Flag result = readed & 0x7fU;
+  size_t bytes = 1;
+  do {
+    readed = read_back<uint8_t>(p);
+    result |= (readed & 0x7fULL) << (7 * bytes++);
+  } while (readed & 0x80U);
+  return result;
+}
+}
+
+template <class Callback>
+void CopmressedReader::decode_batch(size_t n, Callback clbk) {
+  auto bw = time_dcomp.bw;
+  const uint8_t *begin = bw->get_range().begin;
+  const uint8_t *p = begin + bw->pos();
+
+  auto prev_time = time_dcomp.prev_time;
+  auto prev_delta = time_dcomp.prev_delta;
+  auto prev_value = value_dcomp._prev_value;
+  for (size_t i = 0; i < n; ++i) {
+    auto delta = read_delta(p);
+    Time t = prev_time + delta + prev_delta;
+    prev_delta = delta;
+    prev_time = t;
+    prev_value = read_xor(p, begin, prev_value);
+    auto f = read_flag(p);
+    clbk(i, t, inner::flat_int_to_double(prev_value), f);
+  }
+  time_dcomp.prev_time = prev_time;
+  time_dcomp.prev_delta = prev_delta;
+  value_dcomp._prev_value = prev_value;
+  bw->set_pos(static_cast<uint32_t>(p - begin));
+}
+
+void CopmressedReader::readBatch(size_t n, Time *times, Value *values, Flag *flags) {
+  if (_codec != CODEC::DELTA_XOR) {
+    for (size_t i = 0; i < n; ++i) {
+      auto m = read();
+      times[i] = m.time;
+      values[i] = m.value;
+      flags[i] = m.flag;
+    }
+    return;
+  }
+  decode_batch(n, [times, values, flags](size_t i, Time t, Value v, Flag f) {
+    times[i] = t;
+    values[i] = v;
+    flags[i] = f;
+  });
+}
+
+void CopmressedReader::readBatch(Meas *out, size_t n) {
+  if (_sealed != nullptr) {
+    _sealed->read(out, n);
+    return;
+  }
+  if (_codec != CODEC::DELTA_XOR) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = read();
+    }
+    return;
+  }
+  auto id = _first.id;
+  decode_batch(n, [out, id](size_t i, Time t, Value v, Flag f) {
+    out[i].id = id;
+    out[i].time = t;
+    out[i].value = v;
+    out[i].flag = f;
+  });
+}
@@ -3,8 +3,11 @@
 #include <memory>
 
 #include <libdariadb/compression/bytebuffer.h>
+#include <libdariadb/compression/codec.h>
+#include <libdariadb/compression/columns.h>
 #include <libdariadb/compression/delta.h>
 #include <libdariadb/compression/flag.h>
+#include <libdariadb/compression/gorilla.h>
 #include <libdariadb/compression/xor.h>
 #include <libdariadb/meas.h>
 #include <libdariadb/st_exports.h>
@@ -13,7 +16,8 @@ namespace dariadb {
 namespace compression {
 class CopmressedWriter {
 public:
-  EXPORT CopmressedWriter(const ByteBuffer_Ptr &bw_time);
+  EXPORT CopmressedWriter(const ByteBuffer_Ptr &bw_time,
+                          CODEC codec = CODEC::DELTA_XOR);
   EXPORT ~CopmressedWriter();
 
   EXPORT bool append(const Meas &m);
@@ -22,37 +26,68 @@ public:
   size_t usedSpace() const { return time_comp.used_space(); }
 
   ByteBuffer_Ptr getBinaryBuffer() const { return _bb; }
+  CODEC codec() const { return _codec; }
 
 protected:
   ByteBuffer_Ptr _bb;
+  CODEC _codec;
   Meas _first;
   bool _is_first;
   bool _is_full;
   DeltaCompressor time_comp;
   XorCompressor value_comp;
   FlagCompressor flag_comp;
+  GorillaCompressor gorilla_comp;
 };
 
 class CopmressedReader {
 public:
   CopmressedReader() = default;
-  EXPORT CopmressedReader(const ByteBuffer_Ptr &bw_time, const Meas &first);
+  EXPORT CopmressedReader(const ByteBuffer_Ptr &bw_time, const Meas &first,
+                          CODEC codec = CODEC::DELTA_XOR);
+  /// reader of sealed chunk (CONSTANT, COLUMNS). values are decoded on read.
+  EXPORT CopmressedReader(const ByteBuffer_Ptr &bw_time, const Meas &first,
+                          const Meas &last, size_t count, CODEC codec);
   EXPORT ~CopmressedReader();
 
   dariadb::Meas read() {
-    Meas result{};
-    result.id = _first.id;
-    result.time = time_dcomp.read();
-    result.value = value_dcomp.read();
-    result.flag = flag_dcomp.read();
-    return result;
+    switch (_codec) {
+    case CODEC::DELTA_XOR: {
+      Meas result{};
+      result.id = _first.id;
+      result.time = time_dcomp.read();
+      result.value = value_dcomp.read();
+      result.flag = flag_dcomp.read();
+      return result;
+    }
+    case CODEC::GORILLA: {
+      auto result = gorilla_dcomp.read();
+      result.id = _first.id;
+      return result;
+    }
+    default: {
+      Meas result;
+      _sealed->read(&result, 1);
+      return result;
+    }
+    }
   }
 
+  /// decode n values to columns. same as n calls of read().
+  EXPORT void readBatch(size_t n, Time *times, Value *values, Flag *flags);
+  /// decode n values.
+  EXPORT void readBatch(Meas *out, size_t n);
+
 protected:
+  template <class Callback> void decode_batch(size_t n, Callback clbk);
+
+  CODEC _codec;
   dariadb::Meas _first;
   DeltaDeCompressor time_dcomp;
   XorDeCompressor value_dcomp;
   FlagDeCompressor flag_dcomp;
+  GorillaDeCompressor gorilla_dcomp;
+  std::shared_ptr<SealedReader> _sealed;
 };
 }
 }
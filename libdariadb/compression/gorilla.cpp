@@ -0,0 +1,41 @@
+#include <libdariadb/compression/gorilla.h>
+
+using namespace dariadb;
+using namespace dariadb::compression;
+
+GorillaCompressor::GorillaCompressor(const ByteBuffer_Ptr &bw_)
+    : BaseCompressor(bw_), _is_first(true), _writer(bw_) {}
+
+bool GorillaCompressor::append(const Meas &m) {
+  static_assert(sizeof(Value) == 8, "Value no x64 value");
+  if (_is_first) {
+    _is_first = false;
+    _state = inner::GorillaState(m);
+    return true;
+  }
+
+  inner::BitsList bits;
+  auto st = _state;
+  inner::gorilla_write_time(bits, st, m.time);
+  inner::gorilla_write_value(bits, st, uint64_t(inner::flat_double_to_int(m.value)));
+  inner::gorilla_write_flag(bits, st, m.flag);
+
+  if (bits.bits > _writer.free_bits()) {
+    return false;
+  }
+  bits.write_to(_writer);
+  _state = st;
+  return true;
+}
+
+GorillaDeCompressor::GorillaDeCompressor(const ByteBuffer_Ptr &bw_, const Meas &first)
+    : BaseCompressor(bw_), _state(first), _reader(bw_) {}
+
+Meas GorillaDeCompressor::read() {
+  Meas result;
+  result.time = inner::gorilla_read_time(_reader, _state);
+  auto flat = inner::gorilla_read_value(_reader, _state);
+  result.value = inner::flat_int_to_double(int64_t(flat));
+  result.flag = inner::gorilla_read_flag(_reader, _state);
+  return result;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <libdariadb/compression/base_compressor.h>
+#include <libdariadb/compression/bits.h>
+#include <libdariadb/compression/xor.h>
+#include <libdariadb/st_exports.h>
+#include <libdariadb/utils/cz.h>
+
+namespace dariadb {
+namespace compression {
+namespace inner {
+const uint8_t NO_WINDOW = 64;
+
+/// previous values of gorilla streams.
+struct GorillaState {
+  GorillaState()
+      : time(0), delta(0), value(0), lead(NO_WINDOW), tail(NO_WINDOW), flag(0) {}
+  explicit GorillaState(const Meas &first)
+      : time(first.time), delta(0), value(uint64_t(flat_double_to_int(first.value))),
+        lead(NO_WINDOW), tail(NO_WINDOW), flag(first.flag) {}
+
+  Time time;
+  int64_t delta;
+  uint64_t value;
+  uint8_t lead;
+  uint8_t tail;
+  Flag flag;
+};
+
+/// zigzag delta of delta: '0' | '10'+7 | '110'+9 | '1110'+12 | '11110'+32 | '11111'+64
+template <class Writer> void gorilla_write_time(Writer &w, GorillaState &st, Time t) {
+  auto delta = int64_t(t - st.time);
+  auto zz = zigzag(int64_t(uint64_t(delta) - uint64_t(st.delta)));
+  if (zz == 0) {
+    w.write(0, 1);
+  } else if (zz < (uint64_t(1) << 7)) {
+    w.write((uint64_t(0x2) << 7) | zz, 2 + 7);
+  } else if (zz < (uint64_t(1) << 9)) {
+    w.write((uint64_t(0x6) << 9) | zz, 3 + 9);
+  } else if (zz < (uint64_t(1) << 12)) {
+    w.write((uint64_t(0xE) << 12) | zz, 4 + 12);
+  } else if (zz < (uint64_t(1) << 32)) {
+    w.write((uint64_t(0x1E) << 32) | zz, 5 + 32);
+  } else {
+    w.write(0x1F, 5);
+    w.write(zz, 64);
+  }
+  st.delta = delta;
+  st.time = t;
+}
+
+inline Time gorilla_read_time(BitReader &r, GorillaState &st) {
+  static const uint8_t bits[] = {0, 7, 9, 12, 32, 64};
+  auto zz = r.read(bits[r.read_ones(5)]);
+  auto delta = int64_t(uint64_t(unzigzag(zz)) + uint64_t(st.delta));
+  st.delta = delta;
+  st.time += delta;
+  return st.time;
+}
+
+/// xor with previous: '0' - equal, '10' - meaningful bits in previous window,
+/// '11'+6 bits leading zeros+6 bits length-1 - new window.
+template <class Writer>
+void gorilla_write_value(Writer &w, GorillaState &st, uint64_t flat) {
+  auto xor_val = st.value ^ flat;
+  st.value = flat;
+  if (xor_val == 0) {
+    w.write(0, 1);
+    return;
+  }
+  auto lead = utils::clz(xor_val);
+  auto tail = utils::ctz(xor_val);
+  if (st.lead != NO_WINDOW && lead >= st.lead && tail >= st.tail) {
+    w.write(0x2, 2);
+    w.write(xor_val >> st.tail, uint8_t(64 - st.lead - st.tail));
+  } else {
+    uint8_t len = 64 - lead - tail;
+    w.write((uint64_t(0x3) << 12) | (uint64_t(lead) << 6) | uint64_t(len - 1), 2 + 6 + 6);
+    w.write(xor_val >> tail, len);
+    st.lead = lead;
+    st.tail = tail;
+  }
+}
+
+inline uint64_t gorilla_read_value(BitReader &r, GorillaState &st) {
+  switch (r.read_ones(2)) {
+  case 0:
+    break;
+  case 1:
+    st.value ^= r.read(uint8_t(64 - st.lead - st.tail)) << st.tail;
+    break;
+  default: {
+    st.lead = static_cast<uint8_t>(r.read(6));
+    uint8_t len = static_cast<uint8_t>(r.read(6)) + 1;
+    st.tail = 64 - st.lead - len;
+    st.value ^= r.read(len) << st.tail;
+    break;
+  }
+  }
+  return st.value;
+}
+
+/// '0' - equal to previous, '10'+8 bits, '11'+32 bits.
+template <class Writer> void gorilla_write_flag(Writer &w, GorillaState &st, Flag f) {
+  if (f == st.flag) {
+    w.write(0, 1);
+  } else if (f < (Flag(1) << 8)) {
+    w.write((uint64_t(0x2) << 8) | f, 2 + 8);
+  } else {
+    w.write((uint64_t(0x3) << 32) | f, 2 + 32);
+  }
+  st.flag = f;
+}
+
+inline Flag gorilla_read_flag(BitReader &r, GorillaState &st) {
+  switch (r.read_ones(2)) {
+  case 0:
+    break;
+  case 1:
+    st.flag = static_cast<Flag>(r.read(8));
+    break;
+  default:
+    st.flag = static_cast<Flag>(r.read(32));
+    break;
+  }
+  return st.flag;
+}
+}
+
+/**
+bit packed codec (Facebook Gorilla). time - delta of delta, value - xor with
+leading/trailing zeros, flag - bit if equal to previous. see inner::gorilla_write_*.
+*/
+struct GorillaCompressor : public BaseCompressor {
+  EXPORT GorillaCompressor(const ByteBuffer_Ptr &bw);
+
+  /// write all fields of 'm' or nothing, if buffer is full.
+  EXPORT bool append(const Meas &m);
+
+  bool _is_first;
+  inner::GorillaState _state;
+  inner::BitWriter _writer;
+};
+
+struct GorillaDeCompressor : public BaseCompressor {
+  EXPORT GorillaDeCompressor(const ByteBuffer_Ptr &bw, const Meas &first);
+
+  /// result.id is not set.
+  EXPORT Meas read();
+
+  inner::GorillaState _state;
+  inner::BitReader _reader;
+};
+}
+}
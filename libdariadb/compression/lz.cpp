@@ -0,0 +1,89 @@
+#include <libdariadb/compression/lz.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/strings.h>
+#include <zstd.h>
+#include <algorithm>
+#include <sstream>
+
+using namespace dariadb::compression;
+
+namespace {
+/// zstd levels of BLOCK_COMPRESSION.
+const int FAST_LEVEL = 1;
+const int HIGH_LEVEL = 9;
+}
+
+std::istream &dariadb::compression::operator>>(std::istream &in, BLOCK_COMPRESSION &bc) {
+  std::string token;
+  in >> token;
+
+  token = utils::strings::to_upper(token);
+
+  if (token == "NONE") {
+    bc = BLOCK_COMPRESSION::NONE;
+    return in;
+  }
+  if (token == "FAST") {
+    bc = BLOCK_COMPRESSION::FAST;
+    return in;
+  }
+  if (token == "HIGH") {
+    bc = BLOCK_COMPRESSION::HIGH;
+    return in;
+  }
+  THROW_EXCEPTION("engine: bad block compression - ", token);
+}
+
+std::ostream &dariadb::compression::operator<<(std::ostream &stream,
+                                              const BLOCK_COMPRESSION &bc) {
+  switch (bc) {
+  case BLOCK_COMPRESSION::NONE:
+    stream << "NONE";
+    break;
+  case BLOCK_COMPRESSION::FAST:
+    stream << "FAST";
+    break;
+  case BLOCK_COMPRESSION::HIGH:
+    stream << "HIGH";
+    break;
+  default:
+    THROW_EXCEPTION("engine: bad block compression - ", (uint16_t)bc);
+    break;
+  };
+  return stream;
+}
+
+std::string dariadb::compression::to_string(const BLOCK_COMPRESSION &bc) {
+  std::stringstream ss;
+  ss << bc;
+  return ss.str();
+}
+
+BLOCK_COMPRESSION dariadb::compression::block_compression_for(const std::string &levels,
+                                                             uint16_t level) {
+  auto values = utils::strings::split(levels, ',');
+  if (values.empty()) {
+    return BLOCK_COMPRESSION::NONE;
+  }
+  std::istringstream iss(values[std::min(size_t(level), values.size() - 1)]);
+  BLOCK_COMPRESSION result;
+  iss >> result;
+  return result;
+}
+
+size_t dariadb::compression::lz_bound(size_t size) {
+  return ZSTD_compressBound(size);
+}
+
+size_t dariadb::compression::lz_compress(const uint8_t *src, size_t size, uint8_t *dst,
+                                         size_t dst_cap, BLOCK_COMPRESSION level) {
+  auto zlevel = level == BLOCK_COMPRESSION::HIGH ? HIGH_LEVEL : FAST_LEVEL;
+  auto result = ZSTD_compress(dst, dst_cap, src, size, zlevel);
+  return ZSTD_isError(result) ? 0 : result;
+}
+
+bool dariadb::compression::lz_decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                                         size_t raw_size) {
+  auto result = ZSTD_decompress(dst, raw_size, src, size);
+  return !ZSTD_isError(result) && result == raw_size;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace dariadb {
+namespace compression {
+/**
+general purpose compression of page blocks (extern/zstd):
+NONE - blocks are not used, chunks are written one after another.
+FAST - zstd fast level.
+HIGH - zstd high level, slower writing, better ratio.
+reading speed is equal for FAST and HIGH.
+*/
+enum class BLOCK_COMPRESSION : uint8_t { NONE = 0, FAST, HIGH };
+
+EXPORT std::istream &operator>>(std::istream &in, BLOCK_COMPRESSION &bc);
+EXPORT std::ostream &operator<<(std::ostream &stream, const BLOCK_COMPRESSION &bc);
+
+EXPORT std::string to_string(const BLOCK_COMPRESSION &bc);
+
+/// 'levels' - "NONE,FAST,HIGH": compression by page level, last is used for upper levels.
+EXPORT BLOCK_COMPRESSION block_compression_for(const std::string &levels,
+                                               uint16_t level);
+
+/// max size of compressed 'size' bytes.
+EXPORT size_t lz_bound(size_t size);
+/// return size of compressed data. 0 if result is greater than 'dst_cap'.
+EXPORT size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_cap,
+                          BLOCK_COMPRESSION level);
+/// return false if 'src' is broken or is not unpacked to exactly 'raw_size' bytes.
+EXPORT bool lz_decompress(const uint8_t *src, size_t size, uint8_t *dst,
+                          size_t raw_size);
+}
+}
@@ -32,7 +32,7 @@ bool XorCompressor::append(Value v) {
   auto tail = dariadb::utils::ctz(xor_val);
   const size_t total_bits = sizeof(Value) * 8;
 
-  uint8_t count_of_bytes = (total_bits - lead - tail) / 8 + 1;
+  uint8_t count_of_bytes = (total_bits - lead - tail + 7) / 8;
   flag_byte = count_of_bytes;
   ENSURE(count_of_bytes <= u64_buffer_size);
 
@@ -0,0 +1,10 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define PROJECT "dariadb"
+#define PROJECT_VERSION "0.3.0"
+#define PROJECT_VERSION_MAJOR 0
+#define PROJECT_VERSION_MINOR 3
+#define PROJECT_VERSION_PATCH 0
+
+#endif
@@ -7,6 +7,8 @@
 #include <libdariadb/storage/manifest.h>
 #include <libdariadb/storage/memstorage/memstorage.h>
 #include <libdariadb/storage/pages/page_manager.h>
+#include <libdariadb/storage/rollup.h>
+#include <libdariadb/storage/snapshot.h>
 #include <libdariadb/storage/subscribe.h>
 #include <libdariadb/timeutil.h>
 #include <libdariadb/utils/async/locker.h>
@@ -28,6 +30,9 @@ using namespace dariadb;
 using namespace dariadb::storage;
 using namespace dariadb::utils::async;
 
+/// max count of buckets in aggregated query, which is answered by stat().
+const Time MAX_BUCKETS_FROM_STAT = 64;
+
 class Engine::Private {
 public:
   Private(Settings_ptr settings, bool init_threadpool, bool ignore_lock_file) {
@@ -60,20 +65,33 @@ public:
     _subscribe_notify.start();
     if (init_threadpool) {
       ThreadManager::Params tpm_params(_settings->thread_pools_params());
+      tpm_params.aio = _settings->aio_backend.value();
+      tpm_params.aio_queue_depth = _settings->aio_queue_depth.value();
       ThreadManager::start(tpm_params);
     }
 
     _manifest = Manifest::create(_settings);
     _engine_env->addResource(EngineEnvironment::Resource::MANIFEST, _manifest.get());
 
+    _snapshots = std::make_unique<SnapshotManager>();
+    _engine_env->addResource(EngineEnvironment::Resource::SNAPSHOTS, _snapshots.get());
+
     if (is_new_storage) { // init new;
       _manifest->set_format(std::to_string(format()));
     } else { // open exists
       check_storage_version();
-      Dropper::cleanStorage(_settings->raw_path.value());
+      Dropper::cleanStorage(_settings->raw_path.value(), _manifest.get());
+    }
+
+    _rollups = RollupManager::create(_engine_env);
+    if (_rollups->tiers().empty()) {
+      _rollups = nullptr;
+    } else {
+      _engine_env->addResource(EngineEnvironment::Resource::ROLLUP, _rollups.get());
     }
 
     init_managers();
+    _page_manager->startCompaction();
 
     if (_strategy == STRATEGY::WAL) {
       if (_settings->load_min_max) {
@@ -117,6 +135,7 @@ public:
   void init_storages() {}
   void stop() {
     if (!_stoped) {
+      _page_manager->stopCompaction();
       _top_level_storage = nullptr;
       _subscribe_notify.stop();
 
@@ -126,8 +145,10 @@ public:
       }
       _wal_manager = nullptr;
       _page_manager = nullptr;
+      _rollups = nullptr;
       _manifest = nullptr;
       _dropper = nullptr;
+      _snapshots = nullptr;
       _stoped = true;
 
       if (_thread_pool_owner) {
@@ -175,100 +196,50 @@ public:
     if (storage_version != current_version) {
       logger_info("engine", _settings->alias, ": openning storage with version - ",
                   storage_version);
-      THROW_EXCEPTION("engine", _settings->alias,
-                      ": openning storage with greater version.");
-    }
-  }
-
-  bool try_lock_storage() {
-    std::lock_guard<std::mutex> lock(_lock_locker);
-    if (_dropper != nullptr && _memstorage != nullptr) {
-      auto dl = _dropper->getLocker();
-      auto lp = _memstorage->getLockers();
-      return std::try_lock(*dl, *lp) == -1;
-    }
-
-    if (_dropper == nullptr && _memstorage != nullptr) {
-      auto lp = _memstorage->getLockers();
-      return lp->try_lock();
-    }
-
-    if (_dropper != nullptr && _memstorage == nullptr) {
-      auto dl = _dropper->getLocker();
-      return dl->try_lock();
-    }
-    THROW_EXCEPTION("engine", _settings->alias, ": try_lock - bad engine configuration.");
-  }
-
-  void lock_storage() {
-    std::lock_guard<std::mutex> lock(_lock_locker);
-    if (_dropper != nullptr && _memstorage != nullptr) {
-      auto dl = _dropper->getLocker();
-      auto lp = _memstorage->getLockers();
-      std::lock(*dl, *lp);
-      return;
-    }
-
-    if (_dropper == nullptr && _memstorage != nullptr) {
-      auto lp = _memstorage->getLockers();
-      lp->lock();
-      return;
-    }
-
-    if (_dropper != nullptr && _memstorage == nullptr) {
-      auto dl = _dropper->getLocker();
-      dl->lock();
-      return;
+      if (storage_version > current_version) {
+        THROW_EXCEPTION("engine", _settings->alias,
+                        ": openning storage with greater version.");
+      }
+      upgrade_storage(storage_version);
     }
   }
 
-  void unlock_storage() {
-    if (_dropper != nullptr && _memstorage != nullptr) {
-      auto dl = _dropper->getLocker();
-      auto lp = _memstorage->getLockers();
-      dl->unlock();
-      lp->unlock();
-      return;
-    }
-
-    if (_dropper == nullptr && _memstorage != nullptr) {
-      auto lp = _memstorage->getLockers();
-      lp->unlock();
-      return;
-    }
-
-    if (_dropper != nullptr && _memstorage == nullptr) {
-      auto dl = _dropper->getLocker();
-      dl->unlock();
-      return;
+  void upgrade_storage(int storage_version) {
+    // 3 - index file layout was changed.
+    // 4 - statistic in index of pages written from wal was doubled.
+    if (storage_version < 4) {
+      for (auto &page : _manifest->page_list()) {
+        logger_info("engine", _settings->alias, ": upgrade index of ", page);
+        PageManager::rebuildIndex(_settings->raw_path.value(), page);
+      }
     }
+    _manifest->set_format(std::to_string(format()));
   }
 
+  /// readers pin one snapshot of all levels: value moved from upper level to lower one
+  /// is published in one version, so reader sees it exactly once. files and chunks are
+  /// freed after readers of their versions.
   Time minTime() {
-    lock_storage();
+    PinnedSnapshot pin(_snapshots.get());
 
-    auto pmin = _page_manager->minTime();
+    Time amin = _top_level_storage->minTime();
     if (_strategy == STRATEGY::CACHE) {
-      auto amin = this->_wal_manager->minTime();
-      pmin = std::min(pmin, amin);
+      amin = std::min(amin, this->_wal_manager->minTime());
     }
-    Time amin = _top_level_storage->minTime();
+    auto pmin = _page_manager->minTime();
 
-    unlock_storage();
     return std::min(pmin, amin);
   }
 
   Time maxTime() {
-    lock_storage();
+    PinnedSnapshot pin(_snapshots.get());
 
-    auto pmax = _page_manager->maxTime();
+    Time amax = _top_level_storage->maxTime();
     if (_strategy == STRATEGY::CACHE) {
-      auto amax = this->_wal_manager->maxTime();
-      pmax = std::max(pmax, amax);
+      amax = std::max(amax, this->_wal_manager->maxTime());
     }
-    Time amax = _top_level_storage->maxTime();
+    auto pmax = _page_manager->maxTime();
 
-    unlock_storage();
     return std::max(pmax, amax);
   }
 
@@ -277,28 +248,29 @@ public:
     dariadb::Time subMin3 = dariadb::MAX_TIME, subMax3 = dariadb::MIN_TIME;
     bool pr, ar;
     pr = ar = false;
+    auto snapshots = _snapshots.get();
+    auto snapshot = snapshots->pin();
     auto pm = _page_manager.get();
-    AsyncTask pm_at = [&pr, &subMin1, &subMax1, id, pm](const ThreadInfo &ti) {
+    AsyncTask pm_at = [&pr, &subMin1, &subMax1, id, pm, snapshots,
+                       snapshot](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::COMMON, ti.kind);
+      PinnedSnapshot pin(snapshots, snapshot);
       pr = pm->minMaxTime(id, &subMin1, &subMax1);
       return false;
     };
     auto am = _top_level_storage.get();
-    AsyncTask am_at = [&ar, &subMin3, &subMax3, id, am](const ThreadInfo &ti) {
+    AsyncTask am_at = [&ar, &subMin3, &subMax3, id, am, snapshots,
+                       snapshot](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::COMMON, ti.kind);
+      PinnedSnapshot pin(snapshots, snapshot);
       ar = am->minMaxTime(id, &subMin3, &subMax3);
       return false;
     };
 
-    lock_storage();
-
-    auto pm_async = ThreadManager::instance()->post(THREAD_KINDS::COMMON, AT(pm_at));
     auto am_async = ThreadManager::instance()->post(THREAD_KINDS::COMMON, AT(am_at));
-
-    pm_async->wait();
+    auto pm_async = ThreadManager::instance()->post(THREAD_KINDS::COMMON, AT(pm_at));
     am_async->wait();
-
-    unlock_storage();
+    pm_async->wait();
 
     *minResult = dariadb::MAX_TIME;
     *maxResult = dariadb::MIN_TIME;
@@ -309,21 +281,18 @@ public:
   }
 
   Id2MinMax loadMinMax() {
-    this->lock_storage();
+    PinnedSnapshot pin(_snapshots.get());
 
-    auto p_mm = this->_page_manager->loadMinMax();
+    auto t_mm = this->_top_level_storage->loadMinMax();
     if (_strategy == STRATEGY::CACHE) {
       auto a_mm = this->_wal_manager->loadMinMax();
-      minmax_append(p_mm, a_mm);
+      minmax_append(t_mm, a_mm);
     }
-    auto t_mm = this->_top_level_storage->loadMinMax();
-
-    this->unlock_storage();
+    auto p_mm = this->_page_manager->loadMinMax();
 
     minmax_append(p_mm, t_mm);
     return p_mm;
   }
-
   Status append(const Meas &value) {
     Status result{};
 
@@ -344,13 +313,49 @@ public:
     return result;
   }
 
+  Status append(const MeasArray::const_iterator &begin,
+                const MeasArray::const_iterator &end) {
+    Status result = _top_level_storage->append(begin, end);
+
+    // values are written from begin of batch, while level can store them.
+    auto writed_end =
+        begin + std::min(std::distance(begin, end), std::ptrdiff_t(result.writed));
+    if (writed_end != begin) {
+      _subscribe_notify.on_append(begin, writed_end);
+
+      // max of batch by id, then one update of _min_max_map.
+      thread_local Id2Meas batch_max;
+      batch_max.clear();
+      for (auto it = begin; it != writed_end; ++it) {
+        auto fres = batch_max.find(it->id);
+        if (fres == batch_max.end()) {
+          batch_max.emplace(it->id, *it);
+        } else if (fres->second.time < it->time) {
+          fres->second = *it;
+        }
+      }
+
+      std::lock_guard<std::shared_mutex> lg(_min_max_locker);
+      for (auto &kv : batch_max) {
+        auto insert_fres = _min_max_map.find(kv.first);
+        if (insert_fres == _min_max_map.end()) {
+          _min_max_map[kv.first].max = kv.second;
+        } else {
+          insert_fres->second.updateMax(kv.second);
+        }
+      }
+    }
+
+    return result;
+  }
+
   void subscribe(const IdArray &ids, const Flag &flag, const ReaderCallback_ptr &clbk) {
     auto new_s = std::make_shared<SubscribeInfo>(ids, flag, clbk);
     _subscribe_notify.add(new_s);
   }
 
   Id2Meas currentValue(const IdArray &ids, const Flag &flag) {
-    lock_storage();
+    std::shared_lock<std::shared_mutex> lg(_min_max_locker);
 
     Id2Meas a_result;
     for (auto kv : _min_max_map) {
@@ -369,7 +374,6 @@ public:
       }
     }
 
-    unlock_storage();
     return a_result;
   }
 
@@ -395,6 +399,7 @@ public:
     memset(&result, 0, sizeof(Description));
     result.wal_count = _wal_manager == nullptr ? 0 : _wal_manager->filesCount();
     result.pages_count = _page_manager->files_count();
+    result.pages = _page_manager->description();
     result.active_works = ThreadManager::instance()->active_works();
 
     if (_dropper != nullptr) {
@@ -498,8 +503,8 @@ public:
   /// when strategy!=CACHEs
   Id2Cursor internal_readers_two_level(const QueryInterval &q, PageManager_ptr pm,
                                        IMeasSource_ptr tm) {
-    auto pm_readers = pm->intervalReader(q);
     auto tm_readers = tm->intervalReader(q);
+    auto pm_readers = pm->intervalReader(q);
 
     Id2CursorsList all_readers;
     for (auto kv : tm_readers) {
@@ -516,13 +521,178 @@ public:
     return internal_readers_two_level(q, _page_manager, _top_level_storage);
   }
 
+  /// aggregated query with few buckets is answered by stat(), which uses statistics
+  /// from index and decompress only chunks on bucket boundaries.
+  bool is_aggregate_from_stat(const QueryInterval &q) const {
+    return q.is_aggregated() && q.flag == Flag(0) &&
+           Aggregator::is_from_stat(q.aggregation) &&
+           (q.to - q.from) / q.step < MAX_BUCKETS_FROM_STAT;
+  }
+
+  /// stat() sums values of all levels and pages, cursors drop values with the same
+  /// time. so stat is used only if values of id in [from, to] are stored in pages,
+  /// which do not overlap.
+  bool is_stat_exact(Id id, Time from, Time to) {
+    auto in_level = [id, from, to](IMeasSource *level) {
+      Time min_time, max_time;
+      return level != nullptr && level->minMaxTime(id, &min_time, &max_time) &&
+             min_time <= to && max_time >= from;
+    };
+    if (in_level(_memstorage.get()) || in_level(_wal_manager.get())) {
+      return false;
+    }
+    return !_page_manager->isOverlapped(id, from, to);
+  }
+
+  Id2Cursor aggregate_from_stat(const QueryInterval &q) {
+    Id2Cursor result;
+    IdArray cursor_ids;
+    auto buckets = (q.to - q.from) / q.step + 1;
+    for (auto id : q.ids) {
+      if (!is_stat_exact(id, q.from, q.to)) {
+        cursor_ids.push_back(id);
+        continue;
+      }
+      MeasArray ma;
+      for (Time i = 0; i < buckets; ++i) {
+        auto bucket_from = q.from + i * q.step;
+        auto bucket_to = (q.to - bucket_from) < q.step ? q.to : bucket_from + q.step - 1;
+        auto st = stat(id, bucket_from, bucket_to);
+        if (st.count == 0) {
+          continue;
+        }
+        Aggregator aggregator(q.aggregation);
+        aggregator.add(st);
+        auto m = aggregator.result();
+        m.id = id;
+        m.time = bucket_from;
+        m.flag = q.flag;
+        ma.push_back(m);
+      }
+      if (!ma.empty()) {
+        result[id] = std::make_shared<FullCursor>(ma);
+      }
+    }
+    if (!cursor_ids.empty()) {
+      auto local_q = q;
+      local_q.ids = cursor_ids;
+      for (auto &kv : cursors_reader(local_q)) {
+        result[kv.first] = kv.second;
+      }
+    }
+    return result;
+  }
+
+  /// aggregated query with step of some rollup tier is answered by rollups (values in
+  /// pages) and values from upper level.
+  bool is_aggregate_from_rollup(const QueryInterval &q, RollupTier *tier) const {
+    return _rollups != nullptr && q.is_aggregated() && q.flag == Flag(0) &&
+           Aggregator::is_from_stat(q.aggregation) && strategy() != STRATEGY::CACHE &&
+           _rollups->tier_for(q.from, q.step, tier);
+  }
+
+  /// rollups and statistic of pages are summed with values of upper level, so they are
+  /// used only if no time of id in [from, to] is stored twice.
+  bool is_rollup_exact(Id id, Time from, Time to, Time tail_from) {
+    if (!_rollups->is_exact(id, from, to) ||
+        (tail_from <= to && _page_manager->isOverlapped(id, tail_from, to))) {
+      return false;
+    }
+    Time top_min, top_max, page_min, page_max;
+    if (!_top_level_storage->minMaxTime(id, &top_min, &top_max) || top_min > to ||
+        top_max < from) {
+      return true;
+    }
+    return !_page_manager->minMaxTime(id, &page_min, &page_max) || page_max < top_min;
+  }
+
+  Id2Cursor aggregate_from_rollup(const QueryInterval &q, const RollupTier &tier) {
+    Id2Cursor result;
+    IdArray cursor_ids;
+    AsyncTask pm_at = [&q, &tier, this, &result, &cursor_ids](const ThreadInfo &ti) {
+      TKIND_CHECK(THREAD_KINDS::COMMON, ti.kind);
+      PinnedSnapshot pin(_snapshots.get());
+      auto bucket_of = [&q](Time t) { return q.from + (t - q.from) / q.step * q.step; };
+      // last bucket of tier may be cut by q.to, it is read from pages.
+      bool has_tail = (q.to - q.from) % tier.step != tier.step - 1;
+      auto tail_from = q.from + (q.to - q.from) / tier.step * tier.step;
+
+      for (auto id : q.ids) {
+        if (!is_rollup_exact(id, q.from, q.to, has_tail ? tail_from : MAX_TIME)) {
+          cursor_ids.push_back(id);
+          continue;
+        }
+        std::map<Time, Statistic> buckets;
+        if (!has_tail || tail_from != q.from) {
+          auto rollup_to = has_tail ? tail_from - 1 : q.to;
+          for (auto &kv : _rollups->read(tier, id, q.from, rollup_to)) {
+            buckets[bucket_of(kv.first)].update(kv.second);
+          }
+        }
+        if (has_tail) {
+          auto st = _page_manager->stat(id, tail_from, q.to);
+          if (st.count != 0) {
+            buckets[bucket_of(tail_from)].update(st);
+          }
+        }
+
+        QueryInterval local_q = q;
+        local_q.ids = IdArray{id};
+        for (auto &kv : _top_level_storage->intervalReader(local_q)) {
+          auto c = kv.second;
+          while (!c->is_end()) {
+            auto v = c->readNext();
+            if (v.inQuery(local_q.ids, q.flag, q.from, q.to)) {
+              buckets[bucket_of(v.time)].update(v);
+            }
+          }
+        }
+
+        MeasArray ma;
+        for (auto &kv : buckets) {
+          Aggregator aggregator(q.aggregation);
+          aggregator.add(kv.second);
+          auto m = aggregator.result();
+          m.id = id;
+          m.time = kv.first;
+          m.flag = q.flag;
+          ma.push_back(m);
+        }
+        if (!ma.empty()) {
+          result[id] = std::make_shared<FullCursor>(ma);
+        }
+      }
+      return false;
+    };
+    auto at = ThreadManager::instance()->post(THREAD_KINDS::COMMON, AT(pm_at));
+    at->wait();
+    if (!cursor_ids.empty()) {
+      auto local_q = q;
+      local_q.ids = cursor_ids;
+      for (auto &kv : cursors_reader(local_q)) {
+        result[kv.first] = kv.second;
+      }
+    }
+    return result;
+  }
+
   Id2Cursor intervalReader(const QueryInterval &q) {
+    RollupTier tier;
+    if (is_aggregate_from_rollup(q, &tier)) {
+      return aggregate_from_rollup(q, tier);
+    }
+    if (is_aggregate_from_stat(q)) {
+      return aggregate_from_stat(q);
+    }
+    return cursors_reader(q);
+  }
+
+  /// values of levels are merged by cursors. aggregated query wraps them.
+  Id2Cursor cursors_reader(const QueryInterval &q) {
     Id2Cursor result;
     AsyncTask pm_at = [q, this, &result](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::COMMON, ti.kind);
-      if (!try_lock_storage()) {
-        return true;
-      }
+      PinnedSnapshot pin(_snapshots.get());
 
       Id2Cursor r;
       if (this->strategy() == STRATEGY::CACHE) {
@@ -531,10 +701,12 @@ public:
         r = internal_readers_two_level(q);
       }
 
-      this->unlock_storage();
-
       for (auto kv : r) {
-        result[kv.first] = kv.second;
+        if (q.is_aggregated()) {
+          result[kv.first] = std::make_shared<AggregatingCursor>(kv.second, q);
+        } else {
+          result[kv.first] = kv.second;
+        }
       }
       return false;
     };
@@ -568,13 +740,12 @@ public:
   }
   Statistic stat_from_disk(const Id id, Time from, Time to) {
     Statistic result;
-    if (_page_manager != nullptr) {
-      result.update(_page_manager->stat(id, from, to));
-    }
-
     if (_wal_manager != nullptr) {
       result.update(_wal_manager->stat(id, from, to));
     }
+    if (_page_manager != nullptr) {
+      result.update(_page_manager->stat(id, from, to));
+    }
     return result;
   }
 
@@ -583,21 +754,15 @@ public:
 
     AsyncTask pm_at = [id, from, to, this, &result](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::COMMON, ti.kind);
-      if (!try_lock_storage()) {
-        return true;
-      }
+      PinnedSnapshot pin(_snapshots.get());
       if (strategy() != STRATEGY::CACHE) {
-        result.update(stat_from_disk(id, from, to));
-
         if (_memstorage != nullptr) {
           result.update(_memstorage->stat(id, from, to));
         }
+        result.update(stat_from_disk(id, from, to));
       } else {
         result.update(stat_from_cache(id, from, to));
       }
-
-      this->unlock_storage();
-
       return false;
     };
     auto at = ThreadManager::instance()->post(THREAD_KINDS::COMMON, AT(pm_at));
@@ -646,9 +811,7 @@ public:
     auto am = _wal_manager.get();
     AsyncTask pm_at = [&result, &q, this, pm, mm, am](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::COMMON, ti.kind);
-      if (!try_lock_storage()) {
-        return true;
-      }
+      PinnedSnapshot pin(_snapshots.get());
       for (auto id : q.ids) {
 
         QueryTimePoint local_q = q;
@@ -657,25 +820,25 @@ public:
 
         dariadb::Time minT, maxT;
 
+        bool in_upper_level = false;
         if (mm->minMaxTime(id, &minT, &maxT) &&
             (minT < q.time_point || maxT < q.time_point)) {
           auto subres = mm->readTimePoint(local_q);
           result[id] = subres[id];
-        } else {
-          bool in_wal_level = false;
-          if (this->strategy() == STRATEGY::CACHE) {
-            auto subres = am->readTimePoint(local_q);
-            auto value = subres[id];
-            result[id] = value;
-            in_wal_level = value.flag != FLAGS::_NO_DATA;
-          }
-          if (!in_wal_level) {
-            auto subres = _page_manager->valuesBeforeTimePoint(local_q);
-            result[id] = subres[id];
-          }
+          // values may be dropped to pages after minMaxTime.
+          in_upper_level = result[id].flag != FLAGS::_NO_DATA;
+        }
+        if (!in_upper_level && this->strategy() == STRATEGY::CACHE) {
+          auto subres = am->readTimePoint(local_q);
+          auto value = subres[id];
+          result[id] = value;
+          in_upper_level = value.flag != FLAGS::_NO_DATA;
+        }
+        if (!in_upper_level) {
+          auto subres = _page_manager->valuesBeforeTimePoint(local_q);
+          result[id] = subres[id];
         }
       }
-      unlock_storage();
       return false;
     };
 
@@ -705,10 +868,10 @@ public:
 
   void eraseOld(const Time &t) {
     logger_info("engine", _settings->alias, ": eraseOld to ", timeutil::to_string(t));
-    this->lock_storage();
     _page_manager->eraseOld(t);
-
-    this->unlock_storage();
+    if (_rollups != nullptr) {
+      _rollups->eraseOld(t);
+    }
   }
 
   STRATEGY strategy() const {
@@ -717,20 +880,21 @@ public:
   }
 
   void repack() {
-    this->lock_storage();
     logger_info("engine", _settings->alias, ": repack...");
     _page_manager->repack();
-    this->unlock_storage();
   }
 
   storage::Settings_ptr settings() { return _settings; }
 
 protected:
-  std::mutex _flush_locker, _lock_locker;
+  std::mutex _flush_locker;
   SubscribeNotificator _subscribe_notify;
 
+  /// versions of all levels, pinned by readers. destroyed after managers.
+  std::unique_ptr<SnapshotManager> _snapshots;
   std::unique_ptr<Dropper> _dropper;
   PageManager_ptr _page_manager;
+  RollupManager_ptr _rollups; /// nullptr - if rollup tiers are not configured.
   WALManager_ptr _wal_manager;
   MemStorage_ptr _memstorage;
 
@@ -770,6 +934,15 @@ Status Engine::append(const Meas &value) {
   return _impl->append(value);
 }
 
+Status Engine::append(const MeasArray::const_iterator &begin,
+                      const MeasArray::const_iterator &end) {
+  return _impl->append(begin, end);
+}
+
+Status Engine::append(const MeasArray &values) {
+  return _impl->append(values.cbegin(), values.cend());
+}
+
 void Engine::subscribe(const IdArray &ids, const Flag &flag,
                        const ReaderCallback_ptr &clbk) {
   _impl->subscribe(ids, flag, clbk);
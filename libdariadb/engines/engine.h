@@ -14,7 +14,9 @@
 
 namespace dariadb {
 
-const uint16_t STORAGE_FORMAT = 1;
+/// 2 - index reccords sorted by (meas_id, minTime) with id directory.
+/// 3 - BloomFilter of ids in index file.
+const uint16_t STORAGE_FORMAT = 4;
 
 class Engine : public IEngine {
 public:
@@ -27,6 +29,10 @@ public:
 
   using IMeasStorage::append;
   EXPORT Status append(const Meas &value) override;
+  /// batch is written to storage, min/max and subscribers at once.
+  EXPORT Status append(const MeasArray::const_iterator &begin,
+                       const MeasArray::const_iterator &end) override;
+  EXPORT Status append(const MeasArray &values);
 
   EXPORT void flush() override;
   EXPORT void stop() override;
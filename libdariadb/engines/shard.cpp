@@ -6,7 +6,9 @@
 #include <libdariadb/utils/fs.h>
 #include <shared_mutex>
 
+#include <algorithm>
 #include <fstream>
+#include <unordered_map>
 
 const std::string SHARD_KEY_NAME = "shards";
 const std::string SHARD_KEY_PATH = "path";
@@ -31,6 +33,8 @@ public:
     _stoped = false;
     _settings = Settings::create(path);
     ThreadManager::Params tpm_params(_settings->thread_pools_params());
+    tpm_params.aio = _settings->aio_backend.value();
+    tpm_params.aio_queue_depth = _settings->aio_queue_depth.value();
     ThreadManager::start(tpm_params);
 
     loadShardFile();
@@ -184,6 +188,35 @@ public:
     }
   }
 
+  Status append(const MeasArray::const_iterator &begin,
+                const MeasArray::const_iterator &end) override {
+    Status result;
+    std::vector<std::pair<IEngine_Ptr, MeasArray>> batches;
+    std::unordered_map<Id, size_t> id2batch;
+    for (auto it = begin; it != end; ++it) {
+      auto fres = id2batch.find(it->id);
+      if (fres == id2batch.end()) {
+        auto target_shard = get_shard_for_id(it->id);
+        if (target_shard == nullptr) {
+          result.ignored++;
+          continue;
+        }
+        auto pos = std::find_if(
+            batches.begin(), batches.end(),
+            [&target_shard](const auto &b) { return b.first == target_shard; });
+        if (pos == batches.end()) {
+          pos = batches.emplace(batches.end(), target_shard, MeasArray());
+        }
+        fres = id2batch.emplace(it->id, std::distance(batches.begin(), pos)).first;
+      }
+      batches[fres->second].second.push_back(*it);
+    }
+    for (auto &b : batches) {
+      result = result + b.first->append(b.second.cbegin(), b.second.cend());
+    }
+    return result;
+  }
+
   Time minTime() override {
     std::shared_lock<std::shared_mutex> lg(_locker);
     Time result = MAX_TIME;
@@ -404,6 +437,11 @@ Status ShardEngine::append(const Meas &value) {
   return _impl->append(value);
 }
 
+Status ShardEngine::append(const MeasArray::const_iterator &begin,
+                           const MeasArray::const_iterator &end) {
+  return _impl->append(begin, end);
+}
+
 Time ShardEngine::minTime() {
   return _impl->minTime();
 }
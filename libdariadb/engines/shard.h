@@ -23,7 +23,11 @@ public:
   EXPORT void shardAdd(const Shard &d);
   EXPORT std::list<Shard> shardList();
 
+  using IMeasStorage::append;
   EXPORT Status append(const Meas &value) override;
+  /// values are grouped by shard, each shard gets one batch.
+  EXPORT Status append(const MeasArray::const_iterator &begin,
+                       const MeasArray::const_iterator &end) override;
   EXPORT Time minTime() override;
   EXPORT Time maxTime() override;
   EXPORT Id2MinMax loadMinMax() override;
@@ -3,24 +3,43 @@
 
 using namespace dariadb;
 
+namespace icursor_inner {
+/// values readed by one readBatch call in apply.
+const size_t APPLY_BATCH_SIZE = 256;
+}
+
+size_t dariadb::ICursor::readBatch(Meas *out, size_t n) {
+  size_t result = 0;
+  while (result < n && !is_end()) {
+    out[result++] = readNext();
+  }
+  return result;
+}
+
 void dariadb::ICursor::apply(IReadCallback *clbk) {
+  Meas batch[icursor_inner::APPLY_BATCH_SIZE];
   while (!this->is_end()) {
     if (clbk->is_canceled()) {
       break;
     }
-    auto v = readNext();
-    clbk->apply(v);
+    auto count = readBatch(batch, icursor_inner::APPLY_BATCH_SIZE);
+    for (size_t i = 0; i < count && !clbk->is_canceled(); ++i) {
+      clbk->apply(batch[i]);
+    }
   }
 }
 
 void dariadb::ICursor::apply(IReadCallback *clbk, const dariadb::QueryInterval &q) {
+  Meas batch[icursor_inner::APPLY_BATCH_SIZE];
   while (!this->is_end()) {
     if (clbk->is_canceled()) {
       break;
     }
-    auto v = readNext();
-    if (v.inQuery(q.ids, q.flag, q.from, q.to)) {
-      clbk->apply(v);
+    auto count = readBatch(batch, icursor_inner::APPLY_BATCH_SIZE);
+    for (size_t i = 0; i < count && !clbk->is_canceled(); ++i) {
+      if (batch[i].inQuery(q.ids, q.flag, q.from, q.to)) {
+        clbk->apply(batch[i]);
+      }
     }
   }
 }
@@ -22,6 +22,9 @@ public:
   virtual Time minTime() = 0;
   virtual Time maxTime() = 0;
 
+  /// read up to n values to out. return count of readed values.
+  EXPORT virtual size_t readBatch(Meas *out, size_t n);
+
   EXPORT virtual void apply(IReadCallback *clbk);
   EXPORT virtual void apply(IReadCallback *clbk, const QueryInterval &q);
   EXPORT virtual Meas read_time_point(const QueryTimePoint &q);
@@ -2,6 +2,7 @@
 #include <libdariadb/interfaces/imeasstorage.h>
 #include <libdariadb/storage/dropper_description.h>
 #include <libdariadb/storage/memstorage/description.h>
+#include <libdariadb/storage/pages/description.h>
 #include <libdariadb/storage/settings.h>
 #include <memory>
 namespace dariadb {
@@ -14,6 +15,7 @@ public:
     size_t active_works; /// async tasks runned.
     storage::DropperDescription dropper;
     storage::memstorage::Description memstorage;
+    storage::pages::Description pages;
 
     Description() { wal_count = pages_count = active_works = size_t(0); }
 
@@ -23,6 +25,10 @@ public:
       dropper.wal += other.dropper.wal;
       memstorage.allocated += other.memstorage.allocated;
       memstorage.allocator_capacity = other.memstorage.allocator_capacity;
+      pages.index_cache_hits += other.pages.index_cache_hits;
+      pages.index_cache_misses += other.pages.index_cache_misses;
+      pages.index_cache_size += other.pages.index_cache_size;
+      pages.compactions += other.pages.compactions;
     }
   };
   virtual Description description() const = 0;
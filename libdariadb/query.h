@@ -1,5 +1,6 @@
 #pragma once
 
+#include <libdariadb/aggregation.h>
 #include <libdariadb/meas.h>
 #include <algorithm>
 #include <functional>
@@ -15,12 +16,20 @@ struct QueryParam {
 struct QueryInterval : public QueryParam {
   Time from;
   Time to;
-  Time step; /// ignored in disk operations
+  /// if step!=0 and aggregation!=NONE, result contains one value per [from+k*step,
+  /// from+(k+1)*step) interval with time=from+k*step.
+  Time step;
+  Aggregation aggregation;
   QueryInterval(const IdArray &_ids, Flag _flag, Time _from, Time _to)
-      : QueryParam(_ids, _flag), from(_from), to(_to), step(0) {}
+      : QueryParam(_ids, _flag), from(_from), to(_to), step(0),
+        aggregation(Aggregation::NONE) {}
 
-  QueryInterval(const IdArray &_ids, Flag _flag, Time _from, Time _to, Time _step)
-      : QueryParam(_ids, _flag), from(_from), to(_to), step(_step) {}
+  QueryInterval(const IdArray &_ids, Flag _flag, Time _from, Time _to, Time _step,
+                Aggregation _aggregation = Aggregation::NONE)
+      : QueryParam(_ids, _flag), from(_from), to(_to), step(_step),
+        aggregation(_aggregation) {}
+
+  bool is_aggregated() const { return step != 0 && aggregation != Aggregation::NONE; }
 };
 
 struct QueryTimePoint : public QueryParam {
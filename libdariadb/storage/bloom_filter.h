@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace dariadb {
 namespace storage {
@@ -34,8 +38,81 @@ template <typename T> static bool bloom_check(const uint64_t fltr, const T &val)
   return (fltr & h) == h;
 }
 
-static uint64_t bloom_combine(const uint64_t fltr_a, const uint64_t fltr_b) {
+inline uint64_t bloom_combine(const uint64_t fltr_a, const uint64_t fltr_b) {
   return fltr_a | fltr_b;
 }
+
+/// bits in BloomFilter for one item. ~1% of false positives.
+const size_t BLOOM_BITS_PER_ITEM = 10;
+const uint8_t BLOOM_MAX_HASHES = 16;
+
+/**
+k-hash bloom filter. size depends of items count.
+filter without bits contains all values.
+*/
+class BloomFilter {
+public:
+  BloomFilter() : _hashes(0) {}
+
+  BloomFilter(size_t items_count, size_t bits_per_item = BLOOM_BITS_PER_ITEM) {
+    auto words = (std::max(items_count, size_t(1)) * bits_per_item + 63) / 64;
+    _bits.resize(words, uint64_t(0));
+    // optimal hashes count: (m/n)*ln2
+    auto k = std::lround(double(words * 64) / std::max(items_count, size_t(1)) * 0.693);
+    _hashes = static_cast<uint8_t>(
+        std::min(std::max(k, long(1)), long(BLOOM_MAX_HASHES)));
+  }
+
+  BloomFilter(const std::vector<uint64_t> &bits, uint8_t hashes)
+      : _bits(bits), _hashes(hashes) {}
+
+  void add(uint64_t value) {
+    if (_bits.empty()) {
+      return;
+    }
+    uint64_t h1, h2;
+    hash(value, &h1, &h2);
+    auto bits_count = _bits.size() * 64;
+    for (uint8_t i = 0; i < _hashes; ++i) {
+      auto pos = (h1 + i * h2) % bits_count;
+      _bits[pos / 64] |= uint64_t(1) << (pos % 64);
+    }
+  }
+
+  bool check(uint64_t value) const {
+    if (_bits.empty()) {
+      return true;
+    }
+    uint64_t h1, h2;
+    hash(value, &h1, &h2);
+    auto bits_count = _bits.size() * 64;
+    for (uint8_t i = 0; i < _hashes; ++i) {
+      auto pos = (h1 + i * h2) % bits_count;
+      if ((_bits[pos / 64] & (uint64_t(1) << (pos % 64))) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const std::vector<uint64_t> &bits() const { return _bits; }
+  uint8_t hashes() const { return _hashes; }
+
+protected:
+  /// double hashing: i-th hash is h1 + i*h2.
+  static void hash(uint64_t value, uint64_t *h1, uint64_t *h2) {
+    // splitmix64 finalizer
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    value = value ^ (value >> 31);
+    *h1 = value & 0xffffffffULL;
+    *h2 = (value >> 32) | 1;
+  }
+
+protected:
+  std::vector<uint64_t> _bits;
+  uint8_t _hashes;
+};
 }
 }
@@ -12,8 +12,8 @@ using namespace dariadb::storage;
 using namespace dariadb::compression;
 
 Chunk_Ptr Chunk::create(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size,
-                        const Meas &first_m) {
-  return Chunk_Ptr{new Chunk(hdr, buffer, _size, first_m)};
+                        const Meas &first_m, CODEC codec) {
+  return Chunk_Ptr{new Chunk(hdr, buffer, _size, first_m, codec)};
 }
 
 Chunk_Ptr Chunk::open(ChunkHeader *hdr, uint8_t *buffer) {
@@ -21,7 +21,8 @@ Chunk_Ptr Chunk::open(ChunkHeader *hdr, uint8_t *buffer) {
 }
 
 Chunk::Chunk(ChunkHeader *hdr, uint8_t *buffer)
-    : c_writer(std::make_shared<ByteBuffer>(Range{buffer, buffer + hdr->size})) {
+    : c_writer(std::make_shared<ByteBuffer>(Range{buffer, buffer + hdr->size}),
+               CODEC(hdr->codec)) {
   header = hdr;
   ENSURE(header->stat.maxTime != MIN_TIME);
   ENSURE(header->stat.minTime != MAX_TIME);
@@ -32,8 +33,9 @@ Chunk::Chunk(ChunkHeader *hdr, uint8_t *buffer)
   bw->set_pos(header->bw_pos);
 }
 
-Chunk::Chunk(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size, const Meas &first_m)
-    : c_writer(std::make_shared<ByteBuffer>(Range{buffer, buffer + _size})) {
+Chunk::Chunk(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size, const Meas &first_m,
+             CODEC codec)
+    : c_writer(std::make_shared<ByteBuffer>(Range{buffer, buffer + _size}), codec) {
   _buffer_t = buffer;
   header = hdr;
   header->size = _size;
@@ -46,6 +48,7 @@ Chunk::Chunk(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size, const Meas &firs
   header->stat.update(first_m);
 
   header->is_sorted = uint8_t(1);
+  header->codec = uint8_t(codec);
 
   std::fill(_buffer_t, _buffer_t + header->size, 0);
   is_owner = false;
@@ -117,6 +120,39 @@ uint32_t Chunk::compact(ChunkHeader *hdr) {
   return skip_count;
 }
 
+bool Chunk::seal(ChunkHeader *hdr, const uint8_t *buffer, std::vector<uint8_t> &out) {
+  auto codec = CODEC(hdr->codec);
+  if (codec == CODEC::CONSTANT || codec == CODEC::COLUMNS) {
+    return false;
+  }
+  auto used_size = hdr->bw_pos == 0 ? hdr->size : hdr->size - hdr->bw_pos + 1;
+
+  // values in order of writing. reader of chunk sorts unsorted values.
+  auto count = size_t(hdr->stat.count);
+  MeasArray values(count);
+  values[0] = hdr->first();
+  auto begin = const_cast<uint8_t *>(buffer);
+  auto bb = std::make_shared<ByteBuffer>(Range{begin, begin + hdr->size});
+  CopmressedReader rdr(bb, values[0], codec);
+  rdr.readBatch(values.data() + 1, count - 1);
+
+  auto sealed = sealed_size(values.data(), count);
+  // one byte before begin of buffer is not used by ByteBuffer.
+  auto sealed_buffer_size = uint32_t(sealed.bytes + 1);
+  if (sealed_buffer_size >= used_size) {
+    return false;
+  }
+  out.assign(sealed_buffer_size, uint8_t(0));
+  auto bw = std::make_shared<ByteBuffer>(Range{out.data(), out.data() + out.size()});
+  sealed_encode(values.data(), count, sealed.codec, bw);
+  ENSURE(bw->pos() == 0);
+
+  hdr->codec = uint8_t(sealed.codec);
+  hdr->size = sealed_buffer_size;
+  hdr->bw_pos = 0;
+  return true;
+}
+
 uint32_t Chunk::getChecksum() {
   return header->crc;
 }
@@ -176,6 +212,20 @@ public:
     return _compressed_rdr->read();
   }
 
+  size_t readBatch(Meas *out, size_t n) override {
+    size_t result = 0;
+    while (result < n && (_is_first || _top_value_exists)) {
+      out[result++] = ChunkReader::readNext();
+    }
+    auto batch = std::min(n - result, _count);
+    if (batch != 0) {
+      _compressed_rdr->readBatch(out + result, batch);
+      _count -= batch;
+      result += batch;
+    }
+    return result;
+  }
+
   bool is_end() const override {
     return _count == 0 && !_is_first && _top_value_exists == false;
   }
@@ -210,9 +260,16 @@ public:
 
 Cursor_Ptr Chunk::getReader() {
   auto b_ptr = std::make_shared<compression::ByteBuffer>(this->bw->get_range());
+  std::shared_ptr<CopmressedReader> c_rdr;
+  auto codec = CODEC(this->header->codec);
+  if (codec == CODEC::CONSTANT || codec == CODEC::COLUMNS) {
+    c_rdr = std::make_shared<CopmressedReader>(b_ptr, header->first(), header->last(),
+                                               header->stat.count, codec);
+  } else {
+    c_rdr = std::make_shared<CopmressedReader>(b_ptr, header->first(), codec);
+  }
   auto raw_res =
-      new ChunkReader(this->header->stat.count - 1, shared_from_this(), b_ptr,
-                      std::make_shared<CopmressedReader>(b_ptr, this->header->first()));
+      new ChunkReader(this->header->stat.count - 1, shared_from_this(), b_ptr, c_rdr);
 
   Cursor_Ptr result{raw_res};
 
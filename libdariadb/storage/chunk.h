@@ -37,7 +37,8 @@ struct ChunkHeader {
   uint64_t offset_in_page; /// pos in page file.
 
   Statistic stat;
-  uint8_t is_sorted;
+  uint8_t is_sorted : 1;
+  uint8_t codec : 7; /// compression::CODEC. zero in chunks written before codecs.
   Meas first() const {
     Meas m(meas_id);
     m.flag = data_first.flag;
@@ -74,14 +75,16 @@ typedef std::shared_ptr<Chunk> Chunk_Ptr;
 
 class Chunk : public std::enable_shared_from_this<Chunk> {
 protected:
-  Chunk(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size, const Meas &first_m);
+  Chunk(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size, const Meas &first_m,
+        compression::CODEC codec);
   Chunk(ChunkHeader *hdr, uint8_t *buffer);
 
 public:
   typedef uint8_t *u8vector;
 
-  EXPORT static Chunk_Ptr create(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size,
-                                 const Meas &first_m);
+  EXPORT static Chunk_Ptr
+  create(ChunkHeader *hdr, uint8_t *buffer, uint32_t _size, const Meas &first_m,
+         compression::CODEC codec = compression::CODEC::DELTA_XOR);
   EXPORT static Chunk_Ptr open(ChunkHeader *hdr, uint8_t *buffer);
   EXPORT ~Chunk();
 
@@ -99,12 +102,18 @@ public:
   EXPORT static uint32_t calcChecksum(ChunkHeader &hdr, u8vector buff);
   /// return - count of skipped bytes.
   EXPORT static uint32_t compact(ChunkHeader *hdr);
+  /// encode values of full chunk by CONSTANT or COLUMNS codec to 'out', if it is
+  /// smaller than compacted buffer. hdr is updated like after compact.
+  EXPORT static bool seal(ChunkHeader *hdr, const uint8_t *buffer,
+                          std::vector<uint8_t> &out);
   ChunkHeader *header;
   u8vector _buffer_t;
 
   compression::ByteBuffer_Ptr bw;
   compression::CopmressedWriter c_writer;
   bool is_owner; // true - dealloc memory for header and buffer.
+  /// keeps not owned header and buffer alive. for example, mapped page file.
+  std::shared_ptr<void> holder;
 };
 
 typedef std::list<Chunk_Ptr> ChunksList;
@@ -16,6 +16,8 @@ struct ChunkLink {
   dariadb::Time maxTime;
   std::string page_name;
   uint64_t index_rec_number;
+  uint64_t offset; // offset of chunk in page.
+  Statistic stat;  // statistic of chunk from index.
 };
 
 using ChunkLinkList = std::list<ChunkLink>;
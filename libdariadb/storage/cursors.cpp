@@ -2,46 +2,20 @@
 #include <libdariadb/storage/cursors.h>
 #include <libdariadb/utils/utils.h>
 #include <algorithm>
+#include <functional>
 #include <map>
-#include <set>
+#include <numeric>
 
 using namespace dariadb;
 using namespace dariadb::storage;
 
 namespace cursors_inner {
 
-Time get_top_time(ICursor *r) {
-  if (r->is_end()) {
-    return MAX_TIME;
-  } else {
-    return r->top().time;
-  }
-}
-void fill_top_times(std::vector<Time> &top_times,
-                    const std::vector<Cursor_Ptr> &readers) {
-  size_t pos = 0;
-  for (auto r : readers) {
-    top_times[pos++] = get_top_time(r.get());
-  }
-}
+/// greater - for min-heap.
+using HeapCompare = std::greater<std::pair<Time, size_t>>;
 
-/// return: pair(index,ptr)
-std::pair<size_t, ICursor *>
-get_cursor_with_min_time(std::vector<Time> &top_times,
-                         const std::vector<Cursor_Ptr> &readers) {
-  Time min_time = MAX_TIME;
-  size_t min_time_index = 0;
-  for (size_t i = 0; i < top_times.size(); ++i) {
-    if (top_times[i] != MAX_TIME && min_time > top_times[i]) {
-      min_time = top_times[i];
-      min_time_index = i;
-    }
-  }
-  auto reader_it = readers[min_time_index];
-  ENSURE(min_time != MAX_TIME);
-  ENSURE(!reader_it->is_end());
-  return std::make_pair(min_time_index, reader_it.get());
-}
+/// values read from each reader of MergeSortCursor per readBatch.
+const size_t MERGE_BUFFER_SIZE = 256;
 
 CursorsList unpack_readers(const CursorsList &readers) {
   CursorsList tmp_readers_list;
@@ -49,7 +23,8 @@ CursorsList unpack_readers(const CursorsList &readers) {
   for (auto r : readers) {
     // TODO use type enum.
     auto msr = dynamic_cast<MergeSortCursor *>(r.get());
-    if (msr == nullptr) {
+    // buffered values are not in sub readers, so merge is kept as one reader.
+    if (msr == nullptr || msr->is_buffered()) {
       ENSURE(!r->is_end());
       tmp_readers_list.emplace_back(r);
     } else {
@@ -58,6 +33,8 @@ CursorsList unpack_readers(const CursorsList &readers) {
         tmp_readers_list.emplace_back(sub_reader);
       }
       msr->_readers.clear();
+      msr->_buffers.clear();
+      msr->_heap.clear();
     }
   }
   return tmp_readers_list;
@@ -85,6 +62,13 @@ Meas FullCursor::readNext() {
   return result;
 }
 
+size_t FullCursor::readBatch(Meas *out, size_t n) {
+  auto count = std::min(n, _ma.size() - _index);
+  std::copy_n(_ma.begin() + _index, count, out);
+  _index += count;
+  return count;
+}
+
 bool FullCursor::is_end() const {
   return _index >= _ma.size();
 }
@@ -112,11 +96,12 @@ MergeSortCursor::MergeSortCursor(const CursorsList &readers) {
     ENSURE(!r->is_end());
     _readers.emplace_back(r);
   }
+  _buffers.resize(_readers.size());
 
-  _top_times.resize(_readers.size());
-  _is_end_status.resize(_top_times.size());
-  cursors_inner::fill_top_times(_top_times, _readers);
-  std::fill_n(_is_end_status.begin(), _is_end_status.size(), false);
+  _heap.reserve(_readers.size());
+  for (size_t i = 0; i < _readers.size(); ++i) {
+    push(i);
+  }
 
   _minTime = MAX_TIME;
   _maxTime = MIN_TIME;
@@ -130,52 +115,118 @@ MergeSortCursor::MergeSortCursor(const CursorsList &readers) {
   ENSURE(_minTime <= _maxTime);
 }
 
-Meas MergeSortCursor::readNext() {
-  ENSURE(!is_end());
-  auto index_and_reader = cursors_inner::get_cursor_with_min_time(_top_times, _readers);
+bool MergeSortCursor::is_buffered() const {
+  for (auto &b : _buffers) {
+    if (b.pos < b.values.size()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MergeSortCursor::has_value(size_t pos) const {
+  auto &b = _buffers[pos];
+  return b.pos < b.values.size() || !_readers[pos]->is_end();
+}
+
+const Meas &MergeSortCursor::head(size_t pos) {
+  auto &b = _buffers[pos];
+  if (b.pos == b.values.size()) {
+    b.values.resize(cursors_inner::MERGE_BUFFER_SIZE);
+    auto readed = _readers[pos]->readBatch(b.values.data(), b.values.size());
+    if (readed == size_t(0)) {
+      THROW_EXCEPTION("readBatch returned nothing before is_end()");
+    }
+    b.values.resize(readed);
+    b.pos = 0;
+  }
+  return b.values[b.pos];
+}
+
+void MergeSortCursor::skip(size_t pos, Time t) {
+  while (has_value(pos) && head(pos).time == t) {
+    ++_buffers[pos].pos;
+  }
+}
 
-  auto cursor = index_and_reader.second;
-  ENSURE(!_is_end_status[index_and_reader.first]);
-  ENSURE(!cursor->is_end());
+void MergeSortCursor::push(size_t pos) {
+  auto &b = _buffers[pos];
+  if (b.pos < b.values.size()) {
+    _heap.emplace_back(b.values[b.pos].time, pos);
+  } else if (!_readers[pos]->is_end()) {
+    // not buffered yet, reader is read only when its values are merged.
+    _heap.emplace_back(_readers[pos]->top().time, pos);
+  } else {
+    return;
+  }
+  std::push_heap(_heap.begin(), _heap.end(), cursors_inner::HeapCompare());
+}
+
+std::pair<Time, size_t> MergeSortCursor::pop() {
+  std::pop_heap(_heap.begin(), _heap.end(), cursors_inner::HeapCompare());
+  auto result = _heap.back();
+  _heap.pop_back();
+  return result;
+}
 
-  auto result = cursor->readNext();
-  _top_times[index_and_reader.first] = cursors_inner::get_top_time(cursor);
-  _is_end_status[index_and_reader.first] = cursor->is_end();
+Meas MergeSortCursor::next() {
+  ENSURE(!is_end());
+  auto pos = pop().second;
+  auto result = head(pos);
+  ++_buffers[pos].pos;
 
   // skip duplicates.
-  for (size_t i = 0; i < _readers.size(); ++i) {
-    ENSURE(_is_end_status[i] == _readers[i]->is_end());
-
-    if (!_is_end_status[i] && _top_times[i] == result.time) {
-      auto r = _readers[i].get();
-      while (!r->is_end()) {
-        if (r->top().time != result.time) {
-          break;
-        }
-        r->readNext();
-      }
-      _top_times[i] = cursors_inner::get_top_time(r);
-      _is_end_status[i] = r->is_end();
-    }
+  skip(pos, result.time);
+  push(pos);
+  while (!_heap.empty() && _heap.front().first == result.time) {
+    auto other = pop().second;
+    skip(other, result.time);
+    push(other);
+  }
+  return result;
+}
 
-    ENSURE(_is_end_status[i] == _readers[i]->is_end());
+Meas MergeSortCursor::readNext() {
+  return next();
+}
+
+size_t MergeSortCursor::readBatch(Meas *out, size_t n) {
+  size_t result = 0;
+  while (result < n && !_heap.empty()) {
+    auto pos = pop().second;
+    // values of one reader are copied, while they are before top of other readers.
+    do {
+      auto &v = head(pos);
+      if (!_heap.empty() && _heap.front() < std::make_pair(v.time, pos)) {
+        break;
+      }
+      auto t = v.time;
+      out[result++] = v;
+      ++_buffers[pos].pos;
+      skip(pos, t);
+      while (!_heap.empty() && _heap.front().first == t) {
+        auto other = pop().second;
+        skip(other, t);
+        push(other);
+      }
+    } while (result < n && has_value(pos));
+    push(pos);
   }
   return result;
 }
 
 bool MergeSortCursor::is_end() const {
-  for (size_t i = 0; i < _is_end_status.size(); ++i) {
-    if (!_is_end_status[i]) {
-      return false;
-    }
-  }
-  return true;
+  return _heap.empty();
 }
 
 Meas MergeSortCursor::top() {
   ENSURE(!is_end());
-  auto r = cursors_inner::get_cursor_with_min_time(_top_times, _readers);
-  return r.second->top();
+  auto pos = _heap.front().second;
+  auto &b = _buffers[pos];
+  if (b.pos < b.values.size()) {
+    return b.values[b.pos];
+  }
+  return _readers[pos]->top();
 }
 
 Time MergeSortCursor::minTime() {
@@ -213,6 +264,17 @@ Meas LinearCursor::readNext() {
   return result;
 }
 
+size_t LinearCursor::readBatch(Meas *out, size_t n) {
+  size_t result = 0;
+  while (result < n && !_readers.empty()) {
+    result += _readers.front()->readBatch(out + result, n - result);
+    if (_readers.front()->is_end()) {
+      _readers.pop_front();
+    }
+  }
+  return result;
+}
+
 bool LinearCursor::is_end() const {
   return _readers.empty();
 }
@@ -232,39 +294,35 @@ Time LinearCursor::maxTime() {
 
 Cursor_Ptr CursorWrapperFactory::colapseCursors(const CursorsList &readers_list) {
   std::vector<Cursor_Ptr> readers_vector{readers_list.begin(), readers_list.end()};
-  typedef std::set<size_t> positions_set;
-  std::map<size_t, positions_set> overlapped;
-  positions_set processed_pos;
-
-  CursorsList result_readers;
+  // readers overlapped directly or through other readers are merged to one group.
+  std::vector<size_t> group(readers_vector.size());
+  std::iota(group.begin(), group.end(), size_t(0));
+  std::function<size_t(size_t)> root = [&group, &root](size_t i) {
+    if (group[i] != i) {
+      group[i] = root(group[i]);
+    }
+    return group[i];
+  };
   for (size_t i = 0; i < readers_vector.size(); ++i) {
-    bool have_overlap = false;
-    for (size_t j = 0; j < readers_vector.size(); ++j) {
-      if (i != j) {
-        bool is_not_processed = processed_pos.find(j) == processed_pos.end();
-        if (!is_linear_readers(readers_vector[i], readers_vector[j]) &&
-            is_not_processed) {
-          processed_pos.insert(i);
-          processed_pos.insert(j);
-          overlapped[i].insert(j);
-          have_overlap = true;
-        }
+    for (size_t j = i + 1; j < readers_vector.size(); ++j) {
+      if (!is_linear_readers(readers_vector[i], readers_vector[j])) {
+        group[root(j)] = root(i);
       }
     }
-    if (processed_pos.find(i) == processed_pos.end() && !have_overlap) {
-      result_readers.emplace_back(readers_vector[i]);
-    }
+  }
+  std::map<size_t, CursorsList> overlapped;
+  for (size_t i = 0; i < readers_vector.size(); ++i) {
+    overlapped[root(i)].emplace_back(readers_vector[i]);
   }
 
-  for (auto kv : overlapped) {
-    CursorsList rs;
-    rs.emplace_back(readers_vector[kv.first]);
-    for (size_t pos : kv.second) {
-      rs.emplace_back(readers_vector[pos]);
+  CursorsList result_readers;
+  for (auto &kv : overlapped) {
+    if (kv.second.size() == 1) {
+      result_readers.emplace_back(kv.second.front());
+    } else {
+      Cursor_Ptr rptr{new MergeSortCursor(kv.second)};
+      result_readers.emplace_back(rptr);
     }
-    MergeSortCursor *msr = new MergeSortCursor(rs);
-    Cursor_Ptr rptr{msr};
-    result_readers.emplace_back(rptr);
   }
 
   LinearCursor *lsr = new LinearCursor(result_readers);
@@ -289,3 +347,77 @@ bool CursorWrapperFactory::is_linear_readers(const Cursor_Ptr &r1, const Cursor_
                                                  r2->minTime(), r2->maxTime());
   return !is_overlap;
 }
+
+AggregatingCursor::AggregatingCursor(const Cursor_Ptr &source, const QueryInterval &q)
+    : _source(source), _q(q), _aggregator(q.aggregation) {
+  ENSURE(q.step != 0);
+  _has_next = false;
+  _has_pending = false;
+  fill_next();
+}
+
+Time AggregatingCursor::bucket_of(Time t) const {
+  return _q.from + ((t - _q.from) / _q.step) * _q.step;
+}
+
+void AggregatingCursor::fill_next() {
+  _has_next = false;
+  _aggregator.clear();
+  Time bucket = MIN_TIME;
+  while (true) {
+    Meas v;
+    if (_has_pending) {
+      v = _pending;
+      _has_pending = false;
+    } else {
+      if (_source->is_end()) {
+        break;
+      }
+      v = _source->readNext();
+      if (!v.inQuery(_q.ids, _q.flag, _q.from, _q.to)) {
+        continue;
+      }
+    }
+    auto b = bucket_of(v.time);
+    if (_aggregator.empty()) {
+      bucket = b;
+    } else if (b != bucket) {
+      _pending = v;
+      _has_pending = true;
+      break;
+    }
+    _aggregator.add(v);
+  }
+  if (!_aggregator.empty()) {
+    _next = _aggregator.result();
+    _next.time = bucket;
+    if (Aggregator::is_from_stat(_q.aggregation)) {
+      // value is not one of source values, as in aggregate from statistic.
+      _next.flag = _q.flag;
+    }
+    _has_next = true;
+  }
+}
+
+Meas AggregatingCursor::readNext() {
+  ENSURE(_has_next);
+  auto result = _next;
+  fill_next();
+  return result;
+}
+
+bool AggregatingCursor::is_end() const {
+  return !_has_next;
+}
+
+Meas AggregatingCursor::top() {
+  return _next;
+}
+
+Time AggregatingCursor::minTime() {
+  return bucket_of(std::max(_q.from, _source->minTime()));
+}
+
+Time AggregatingCursor::maxTime() {
+  return bucket_of(std::min(_q.to, _source->maxTime()));
+}
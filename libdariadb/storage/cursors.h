@@ -14,6 +14,7 @@ class FullCursor : public ICursor {
 public:
   EXPORT FullCursor(MeasArray &ma);
   EXPORT virtual Meas readNext() override;
+  EXPORT size_t readBatch(Meas *out, size_t n) override;
 
   EXPORT bool is_end() const override;
 
@@ -28,22 +29,45 @@ public:
 };
 
 /**
-Merge sort.
+Merge sort. readers are kept in binary heap by (top time, position).
+if readers have values with equal time, value of first reader is returned.
+readers are read by batches into per-reader buffers, values are merged from them.
 */
 class MergeSortCursor : public ICursor {
 public:
   EXPORT MergeSortCursor(const CursorsList &readers);
   EXPORT virtual Meas readNext() override;
+  EXPORT size_t readBatch(Meas *out, size_t n) override;
   EXPORT bool is_end() const override;
   EXPORT Meas top() override;
   EXPORT Time minTime() override;
   EXPORT Time maxTime() override;
 
+  /// values of reader, which are read by batch and not merged yet.
+  struct Buffer {
+    MeasArray values;
+    size_t pos = 0;
+  };
+
   std::vector<Cursor_Ptr> _readers;
-  std::vector<Time> _top_times;
-  std::vector<bool> _is_end_status;
+  std::vector<Buffer> _buffers;
+  /// min-heap of (top time, position in _readers).
+  std::vector<std::pair<Time, size_t>> _heap;
   Time _minTime;
   Time _maxTime;
+
+  /// true if some values were read from readers, but not merged.
+  bool is_buffered() const;
+
+protected:
+  Meas next();
+  void push(size_t pos);
+  std::pair<Time, size_t> pop();
+  bool has_value(size_t pos) const;
+  /// current value of reader, refills buffer by readBatch.
+  const Meas &head(size_t pos);
+  /// skip values of reader with time equal to 't'.
+  void skip(size_t pos, Time t);
 };
 
 /**
@@ -53,6 +77,7 @@ class LinearCursor : public ICursor {
 public:
   EXPORT LinearCursor(const CursorsList &readers);
   EXPORT virtual Meas readNext() override;
+  EXPORT size_t readBatch(Meas *out, size_t n) override;
   EXPORT bool is_end() const override;
   EXPORT Meas top() override;
   EXPORT Time minTime() override;
@@ -63,6 +88,33 @@ public:
   Time _maxTime;
 };
 
+/**
+One value per 'step' interval of query, reduced by query.aggregation.
+Source must return values in increasing time order.
+*/
+class AggregatingCursor : public ICursor {
+public:
+  EXPORT AggregatingCursor(const Cursor_Ptr &source, const QueryInterval &q);
+  EXPORT virtual Meas readNext() override;
+  EXPORT bool is_end() const override;
+  EXPORT Meas top() override;
+  EXPORT Time minTime() override;
+  EXPORT Time maxTime() override;
+
+protected:
+  Time bucket_of(Time t) const;
+  void fill_next();
+
+  Cursor_Ptr _source;
+  QueryInterval _q;
+  Aggregator _aggregator;
+  Meas _next;
+  bool _has_next;
+  /// first value of next interval, read from source.
+  Meas _pending;
+  bool _has_pending;
+};
+
 struct EmptyCursor : public ICursor {
   Meas readNext() override {
     NOT_IMPLEMENTED;
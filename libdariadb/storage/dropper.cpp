@@ -3,6 +3,7 @@
 #include <libdariadb/storage/pages/page.h>
 #include <libdariadb/storage/settings.h>
 #include <libdariadb/utils/async/thread_manager.h>
+#include <algorithm>
 #include <ctime>
 
 using namespace dariadb;
@@ -17,6 +18,8 @@ Dropper::Dropper(EngineEnvironment_ptr engine_env, PageManager_ptr page_manager,
   _is_stoped = false;
   _settings =
       _engine_env->getResourceObject<Settings>(EngineEnvironment::Resource::SETTINGS);
+  _snapshots = _engine_env->getResourceObject<SnapshotManager>(
+      EngineEnvironment::Resource::SNAPSHOTS);
   _thread_handle = std::thread(&Dropper::drop_wal_internal, this);
 }
 
@@ -49,12 +52,22 @@ void Dropper::dropWAL(const std::string &fname) {
   }
 }
 
-void Dropper::cleanStorage(const std::string &storagePath) {
+void Dropper::cleanStorage(const std::string &storagePath, Manifest *manifest) {
   logger_info("engine: dropper - check storage ", storagePath);
   auto wals_lst = fs::ls(storagePath, WAL_FILE_EXT);
+  auto compressed_wals_lst = fs::ls(storagePath, WAL_COMPRESSED_FILE_EXT);
+  wals_lst.insert(wals_lst.end(), compressed_wals_lst.begin(), compressed_wals_lst.end());
   auto page_lst = fs::ls(storagePath, PAGE_FILE_EXT);
+  auto manifest_wals = manifest->wal_list();
 
   for (auto &wal : wals_lst) {
+    if (std::find(manifest_wals.begin(), manifest_wals.end(),
+                  fs::extract_filename(wal)) == manifest_wals.end()) {
+      // wal was dropped, but removing of file was deferred.
+      logger_info("engine: fsck rm dropped wal ", wal);
+      fs::rm(wal);
+      continue;
+    }
     auto wal_fname = fs::filename(wal);
     for (auto &pagef : page_lst) {
       auto page_fname = fs::filename(pagef);
@@ -82,12 +95,6 @@ void Dropper::drop_wal_internal() {
       fname = _files_queue.front();
       _files_queue.pop_front();
     }
-    while (!this->_dropper_lock.try_lock() || _stop) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-    if (_stop) {
-      break;
-    }
     AsyncTask at = [fname, this, env, sett](const ThreadInfo &ti) {
       try {
         TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
@@ -100,6 +107,7 @@ void Dropper::drop_wal_internal() {
         WALFile_Ptr wal = WALFile::open(env, full_path, true);
 
         auto all = wal->readAll();
+        wal = nullptr;
 
         this->write_wal_to_page(fname, all);
 
@@ -116,7 +124,6 @@ void Dropper::drop_wal_internal() {
 
     auto handle = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
     handle->wait();
-    this->_dropper_lock.unlock();
   }
   _is_stoped = true;
 }
@@ -134,6 +141,8 @@ void Dropper::write_wal_to_page(const std::string &fname, std::shared_ptr<MeasAr
   auto without_path = fs::extract_filename(fname);
   auto page_fname = fs::filename(without_path);
 
+  // readers see values of wal exactly once: in wal or in page.
+  Publication publication(_snapshots);
   pm->append(page_fname, *ma.get());
   am->erase(fname);
 }
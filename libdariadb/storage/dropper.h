@@ -2,7 +2,9 @@
 
 #include <libdariadb/storage/dropper_description.h>
 #include <libdariadb/storage/engine_environment.h>
+#include <libdariadb/storage/manifest.h>
 #include <libdariadb/storage/pages/page_manager.h>
+#include <libdariadb/storage/snapshot.h>
 #include <libdariadb/storage/wal/wal_manager.h>
 #include <condition_variable>
 #include <list>
@@ -21,11 +23,11 @@ public:
   void dropWAL(const std::string &fname) override;
 
   void flush();
-  // 1. rm PAGE files with name exists WAL file.
-  static void cleanStorage(const std::string &storagePath);
+  // 1. rm WAL files, which are not in manifest (already dropped).
+  // 2. rm PAGE files with name exists WAL file.
+  static void cleanStorage(const std::string &storagePath, Manifest *manifest);
 
   DropperDescription description() const;
-  std::mutex *getLocker() { return &_dropper_lock; }
 
 private:
   void drop_wal_internal();
@@ -42,7 +44,8 @@ private:
   WALManager_ptr _wal_manager;
   EngineEnvironment_ptr _engine_env;
   Settings *_settings;
-  std::mutex _dropper_lock;
+  /// page of wal and removing of wal are published in one version.
+  SnapshotManager *_snapshots;
 };
 }
 }
@@ -19,6 +19,10 @@ struct EngineEnvironment::Private {
     return fres->second;
   }
 
+  bool hasResource(EngineEnvironment::Resource res) const {
+    return _resource_map.find(res) != _resource_map.end();
+  }
+
   std::unordered_map<Resource, void *> _resource_map;
 };
 
@@ -34,6 +38,10 @@ void *EngineEnvironment::getResourcePtr(EngineEnvironment::Resource res) const {
   return _impl->getResourcePtr(res);
 }
 
+bool EngineEnvironment::hasResource(EngineEnvironment::Resource res) const {
+  return _impl->hasResource(res);
+}
+
 void EngineEnvironment::addResource(Resource res, void *ptr) {
   _impl->addResource(res, ptr);
 }
@@ -14,7 +14,9 @@ public:
   enum class Resource {
     // LOCK_MANAGER,
     SETTINGS,
-    MANIFEST
+    MANIFEST,
+    ROLLUP,
+    SNAPSHOTS
   };
 
 public:
@@ -23,6 +25,7 @@ public:
 
   EXPORT void addResource(Resource res, void *ptr);
   EXPORT void *getResourcePtr(Resource res) const;
+  EXPORT bool hasResource(Resource res) const;
 
   template <class T> T *getResourceObject(Resource res) const {
     return (T *)getResourcePtr(res);
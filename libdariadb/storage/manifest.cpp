@@ -122,6 +122,40 @@ public:
 
   void page_append(const std::string &rec) {
     std::lock_guard<utils::async::Locker> lg(_locker);
+    page_append_unlocked(rec);
+  }
+
+  void page_rm(const std::string &rec) {
+    std::lock_guard<utils::async::Locker> lg(_locker);
+    page_rm_unlocked(rec);
+  }
+
+  void page_replace(const std::list<std::string> &removed, const std::string &added) {
+    std::lock_guard<utils::async::Locker> lg(_locker);
+    exec_sql("BEGIN TRANSACTION;");
+    try {
+      for (auto &rec : removed) {
+        page_rm_unlocked(rec);
+      }
+      page_append_unlocked(added);
+    } catch (...) {
+      exec_sql("ROLLBACK;");
+      throw;
+    }
+    exec_sql("COMMIT;");
+  }
+
+  void exec_sql(const std::string &sql) {
+    char *zErrMsg = 0;
+    auto rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &zErrMsg);
+    if (rc != SQLITE_OK) {
+      std::string msg = std::string(zErrMsg);
+      sqlite3_free(zErrMsg);
+      THROW_EXCEPTION("engine: SQL error - ", msg);
+    }
+  }
+
+  void page_append_unlocked(const std::string &rec) {
     const std::string sql_query = "insert into pages (file) values (?);";
     sqlite3_stmt *pStmt;
     int rc;
@@ -139,8 +173,7 @@ public:
     } while (rc == SQLITE_SCHEMA);
   }
 
-  void page_rm(const std::string &rec) {
-    std::lock_guard<utils::async::Locker> lg(_locker);
+  void page_rm_unlocked(const std::string &rec) {
     const std::string sql_query = "delete from pages where file = ?;";
     sqlite3_stmt *pStmt;
     int rc;
@@ -312,6 +345,11 @@ void Manifest::page_rm(const std::string &rec) {
   _impl->page_rm(rec);
 }
 
+void Manifest::page_replace(const std::list<std::string> &removed,
+                            const std::string &added) {
+  _impl->page_replace(removed, added);
+}
+
 std::list<std::string> Manifest::wal_list() {
   return _impl->wal_list();
 }
@@ -24,6 +24,9 @@ public:
   EXPORT std::list<std::string> page_list();
   EXPORT void page_append(const std::string &rec);
   EXPORT void page_rm(const std::string &rec);
+  /// remove 'removed' and append 'added' in one transaction.
+  EXPORT void page_replace(const std::list<std::string> &removed,
+                           const std::string &added);
 
   EXPORT std::list<std::string> wal_list();
   EXPORT void wal_append(const std::string &rec);
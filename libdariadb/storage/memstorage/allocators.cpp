@@ -1,43 +1,348 @@
 #include <libdariadb/storage/memstorage/allocators.h>
+#include <libdariadb/utils/fs.h>
+#include <libdariadb/utils/logger.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <sstream>
+#include <thread>
+
+#ifdef UNIX_OS
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace dariadb;
 using namespace dariadb::storage;
 
-MemChunkAllocator::MemChunkAllocator(size_t maxSize, uint32_t bufferSize)
-    : _one_chunk_size(sizeof(ChunkHeader) + bufferSize),
-      _capacity((int)(float(maxSize) / _one_chunk_size)), _free_list(_capacity) {
+namespace {
+const size_t CACHE_BATCH = 32;
+const size_t SEGMENT_SIZE = 4 * 1024 * 1024;
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+/// max value of memory_limit.
+const size_t MAX_MEMORY_LIMIT = std::numeric_limits<uint32_t>::max();
+/// from linux/mempolicy.h
+const int MPOL_PREFERRED_MODE = 1;
+
+size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/// cpu -> numa node. empty, if system has one node.
+std::vector<size_t> read_cpu2node() {
+  std::vector<size_t> result;
+#ifdef UNIX_OS
+  for (size_t node = 0;; ++node) {
+    auto path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+    if (!utils::fs::path_exists(path)) {
+      break;
+    }
+    // format: "0-3,8-11"
+    std::ifstream in(path);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+      size_t from = 0, to = 0;
+      char dash = 0;
+      std::istringstream iss(range);
+      if (!(iss >> from)) {
+        continue;
+      }
+      to = (iss >> dash >> to) ? to : from;
+      if (result.size() <= to) {
+        result.resize(to + 1, size_t(0));
+      }
+      for (auto cpu = from; cpu <= to; ++cpu) {
+        result[cpu] = node;
+      }
+    }
+  }
+#endif
+  return result;
+}
+}
+
+MemChunkAllocator::MemChunkAllocator(size_t maxSize, uint32_t bufferSize,
+                                     HUGE_PAGES huge_pages)
+    : _one_chunk_size(sizeof(ChunkHeader) + bufferSize) {
   _maxSize = maxSize;
   _chunkSize = bufferSize;
+  _capacity = size_t(0);
   _allocated = size_t(0);
+  _huge_pages = huge_pages;
 
-  size_t buffers_size = _capacity * (_chunkSize + sizeof(ChunkHeader));
+  _cpu2node = read_cpu2node();
+  size_t nodes_count = 1;
+  for (auto n : _cpu2node) {
+    nodes_count = std::max(nodes_count, n + 1);
+  }
+  auto caches_count = std::max(size_t(std::thread::hardware_concurrency()),
+                               std::max(_cpu2node.size(), size_t(1)));
+  _cpu2node.resize(caches_count, size_t(0));
+  _caches.reset(new Cache[caches_count]);
 
-  _region = new uint8_t[buffers_size];
-  _headers = reinterpret_cast<ChunkHeader *>(_region);
-  _buffers = _region + _capacity * sizeof(ChunkHeader);
+  _segment_chunks = std::max(SEGMENT_SIZE / _one_chunk_size, size_t(1));
+  _segment_size = _segment_chunks * _one_chunk_size;
+  if (nodes_count > 1 || huge_pages != HUGE_PAGES::NONE) {
+    _segment_size = align_up(_segment_size, HUGE_PAGE_SIZE);
+  }
+  // table of segments is enough for any limit, segments are mapped on demand.
+  auto max_chunks = std::max(maxSize, MAX_MEMORY_LIMIT) / _one_chunk_size;
+  _segments_count = max_chunks / _segment_chunks + 1;
+  _segments.reset(new Segment[_segments_count]);
+  for (size_t i = 0; i < _segments_count; ++i) {
+    _segments[i].region = nullptr;
+    _segments[i].released = _segment_chunks;
+  }
 
-  memset(_region, 0, buffers_size);
-  for (size_t i = 0; i < _capacity; ++i) {
-    auto res = _free_list.push(i);
-    if (!res) {
-      THROW_EXCEPTION("engine: MemChunkAllocator::ctor - bad capacity.");
-    }
+  _nodes.resize(nodes_count);
+  for (auto &node : _nodes) {
+    node.reset(new boost::lockfree::queue<size_t>(_segment_chunks));
   }
+
+  resize(maxSize);
 }
 
 MemChunkAllocator::~MemChunkAllocator() {
-  delete[] _region;
+  for (size_t i = 0; i < _segments_count; ++i) {
+    unmap_segment(i);
+  }
+}
+
+void MemChunkAllocator::map_segment(size_t index) {
+  auto &segment = _segments[index];
+  if (segment.region != nullptr) {
+    return;
+  }
+  if (segment.states == nullptr) {
+    segment.states.reset(new std::atomic<uint8_t>[_segment_chunks]);
+    for (size_t i = 0; i < _segment_chunks; ++i) {
+      segment.states[i] = RELEASED;
+    }
+  }
+#ifdef UNIX_OS
+  void *addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (_huge_pages == HUGE_PAGES::EXPLICIT) {
+    addr = mmap(nullptr, _segment_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr == MAP_FAILED) {
+      logger_info("engine: MemChunkAllocator - huge pages pool is not available.");
+      _huge_pages = HUGE_PAGES::TRANSPARENT;
+    }
+  }
+#endif
+  if (addr == MAP_FAILED) {
+    addr = mmap(nullptr, _segment_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED) {
+      THROW_EXCEPTION("engine: MemChunkAllocator - mmap error: ", std::strerror(errno));
+    }
+#ifdef MADV_HUGEPAGE
+    if (_huge_pages != HUGE_PAGES::NONE) {
+      madvise(addr, _segment_size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+#ifdef SYS_mbind
+  if (_nodes.size() > 1) {
+    auto node = index % _nodes.size();
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_mbind, addr, _segment_size, MPOL_PREFERRED_MODE, &mask,
+                sizeof(mask) * 8, 0) != 0) {
+      logger_info("engine: MemChunkAllocator - memory is not bound to node ", node);
+    }
+  }
+#endif
+  // anonymous memory is zeroed and touched by first writing into chunk.
+  segment.region = static_cast<uint8_t *>(addr);
+#else
+  segment.region = new uint8_t[_segment_size];
+  memset(segment.region, 0, _segment_size);
+#endif
+}
+
+void MemChunkAllocator::unmap_segment(size_t index) {
+  auto &segment = _segments[index];
+  if (segment.region == nullptr) {
+    return;
+  }
+#ifdef UNIX_OS
+  munmap(segment.region, _segment_size);
+#else
+  delete[] segment.region;
+#endif
+  segment.region = nullptr;
+}
+
+size_t MemChunkAllocator::segments() {
+  std::lock_guard<std::mutex> lg(_resize_locker);
+  size_t result = 0;
+  for (size_t i = 0; i < _segments_count; ++i) {
+    if (_segments[i].region != nullptr) {
+      result++;
+    }
+  }
+  return result;
+}
+
+void MemChunkAllocator::resize(size_t maxSize) {
+  std::lock_guard<std::mutex> lg(_resize_locker);
+  auto capacity = maxSize / _one_chunk_size;
+  if (capacity > _segments_count * _segment_chunks) {
+    capacity = _segments_count * _segment_chunks;
+    logger_info("engine: MemChunkAllocator - limit ", maxSize, " is greater than max ",
+                capacity * _one_chunk_size, ", max is used.");
+  }
+  auto old_capacity = _capacity.load();
+  _maxSize = maxSize;
+  if (capacity > old_capacity) {
+    for (auto i = old_capacity / _segment_chunks; i * _segment_chunks < capacity; ++i) {
+      map_segment(i);
+    }
+    _capacity = capacity;
+    for (auto pos = old_capacity; pos < capacity; ++pos) {
+      restore(pos);
+    }
+    return;
+  }
+  if (capacity == old_capacity) {
+    return;
+  }
+
+  _capacity = capacity;
+  // free positions over limit are taken from pool. used - when they will be free.
+  std::vector<size_t> positions;
+  for (size_t i = 0; i < _cpu2node.size(); ++i) {
+    auto &cache = _caches[i];
+    std::lock_guard<utils::async::Locker> cache_lg(cache.locker);
+    positions.insert(positions.end(), cache.positions.begin(), cache.positions.end());
+    cache.positions.clear();
+  }
+  for (auto &node : _nodes) {
+    size_t pos;
+    while (node->pop(pos)) {
+      positions.push_back(pos);
+    }
+  }
+  for (auto pos : positions) {
+    if (pos < capacity) {
+      push(pos);
+    } else {
+      release(pos);
+    }
+  }
+  unmap_released();
+}
+
+bool MemChunkAllocator::release(size_t position) {
+  auto &segment = segment_of(position);
+  state_of(position) = RELEASED;
+  auto released = ++segment.released;
+  if (position < _capacity.load()) { // limit was raised meanwhile.
+    restore(position);
+    return false;
+  }
+  return released == _segment_chunks;
+}
+
+void MemChunkAllocator::restore(size_t position) {
+  uint8_t expected = RELEASED;
+  if (state_of(position).compare_exchange_strong(expected, FREE)) {
+    segment_of(position).released--;
+    push(position);
+  }
+}
+
+void MemChunkAllocator::unmap_released() {
+  auto first = (_capacity.load() + _segment_chunks - 1) / _segment_chunks;
+  for (auto i = first; i < _segments_count; ++i) {
+    if (_segments[i].released.load() == _segment_chunks) {
+      unmap_segment(i);
+    }
+  }
+}
+
+void MemChunkAllocator::push(size_t position) {
+  if (!_nodes[node_of(position)]->push(position)) {
+    THROW_EXCEPTION("engine: MemChunkAllocator - bad capacity.");
+  }
+}
+
+size_t MemChunkAllocator::current_cpu() const {
+#if defined(UNIX_OS) && defined(__linux__)
+  auto cpu = sched_getcpu();
+  if (cpu >= 0) {
+    return size_t(cpu) % _cpu2node.size();
+  }
+#endif
+  return std::hash<std::thread::id>()(std::this_thread::get_id()) % _cpu2node.size();
+}
+
+void MemChunkAllocator::refill(Cache &cache, size_t node) {
+  // local node first, then others: remote memory is better than waiting.
+  for (size_t i = 0; i < _nodes.size() && cache.positions.empty(); ++i) {
+    auto &free_list = *_nodes[(node + i) % _nodes.size()];
+    size_t pos;
+    while (cache.positions.size() < CACHE_BATCH && free_list.pop(pos)) {
+      cache.positions.push_back(pos);
+    }
+  }
+}
+
+bool MemChunkAllocator::steal(size_t &position) {
+  for (size_t i = 0; i < _cpu2node.size(); ++i) {
+    auto &cache = _caches[i];
+    std::lock_guard<utils::async::Locker> lg(cache.locker);
+    if (!cache.positions.empty()) {
+      position = cache.positions.back();
+      cache.positions.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MemChunkAllocator::pop(size_t cpu, size_t &position) {
+  auto &cache = _caches[cpu];
+  {
+    std::lock_guard<utils::async::Locker> lg(cache.locker);
+    if (cache.positions.empty()) {
+      refill(cache, _cpu2node[cpu]);
+    }
+    if (!cache.positions.empty()) {
+      position = cache.positions.back();
+      cache.positions.pop_back();
+      return true;
+    }
+  }
+  // free positions may be cached by other cpus.
+  return steal(position);
 }
 
 MemChunkAllocator::AllocatedData MemChunkAllocator::allocate() {
+  auto cpu = current_cpu();
   size_t pos;
-  if (!_free_list.pop(pos)) {
-    return EMPTY;
+  while (pop(cpu, pos)) {
+    if (pos >= _capacity.load()) { // limit was reduced.
+      if (release(pos)) {
+        std::lock_guard<std::mutex> lg(_resize_locker);
+        unmap_released();
+      }
+      continue;
+    }
+    state_of(pos) = USED;
+    _allocated++;
+    auto region = segment_of(pos).region;
+    auto index = pos % _segment_chunks;
+    auto header = reinterpret_cast<ChunkHeader *>(region) + index;
+    auto buffer = region + _segment_chunks * sizeof(ChunkHeader) + index * _chunkSize;
+    return AllocatedData(header, buffer, pos);
   }
-  _allocated++;
-  return AllocatedData(&_headers[pos], &_buffers[pos * _chunkSize], pos);
+  return EMPTY;
 }
 
 void MemChunkAllocator::free(const MemChunkAllocator::AllocatedData &d) {
@@ -48,8 +353,28 @@ void MemChunkAllocator::free(const MemChunkAllocator::AllocatedData &d) {
   memset(buffer, 0, _chunkSize);
 
   _allocated--;
-  auto res = _free_list.push(position);
-  if (!res) {
-    THROW_EXCEPTION("engine: MemChunkAllocator::free - bad capacity.");
+  if (position >= _capacity.load()) {
+    if (release(position)) {
+      std::lock_guard<std::mutex> lg(_resize_locker);
+      unmap_released();
+    }
+    return;
+  }
+  state_of(position) = FREE;
+  auto cpu = current_cpu();
+  if (node_of(position) != _cpu2node[cpu]) {
+    push(position);
+    return;
+  }
+  auto &cache = _caches[cpu];
+  std::lock_guard<utils::async::Locker> lg(cache.locker);
+  cache.positions.push_back(position);
+  if (cache.positions.size() < 2 * CACHE_BATCH) {
+    return;
+  }
+  // oldest positions are returned to nodes by one batch.
+  for (size_t i = 0; i < CACHE_BATCH; ++i) {
+    push(cache.positions[i]);
   }
+  cache.positions.erase(cache.positions.begin(), cache.positions.begin() + CACHE_BATCH);
 }
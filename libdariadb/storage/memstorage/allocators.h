@@ -2,15 +2,27 @@
 
 #include <libdariadb/st_exports.h>
 #include <libdariadb/storage/chunk.h>
+#include <libdariadb/storage/memstorage/huge_pages.h>
 #include <libdariadb/utils/async/locker.h>
 #include <libdariadb/utils/utils.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <boost/lockfree/queue.hpp>
 
 namespace dariadb {
 namespace storage {
 
+/**
+Pool of chunks with fixed size.
+Memory is mapped by segments and touched lazily. limit of pool can be changed at
+runtime: new segments are mapped at once, segments over limit are unmapped, when
+all their chunks are freed. On numa systems segments are bound to nodes by turns.
+Free positions are cached per cpu, so threads rarely meet on shared free lists
+of nodes.
+*/
 struct MemChunkAllocator : public utils::NonCopy {
   struct AllocatedData {
     ChunkHeader *header;
@@ -32,22 +44,73 @@ struct MemChunkAllocator : public utils::NonCopy {
       AllocatedData(nullptr, nullptr, std::numeric_limits<size_t>::max());
 
   size_t _one_chunk_size;
-  size_t _maxSize;     /// max size in bytes)
-  uint32_t _chunkSize; /// size of chunk
-  size_t _capacity;    /// max size in chunks
-  size_t _allocated;   /// already allocated count of chunks.
+  std::atomic_size_t _maxSize;   /// max size in bytes)
+  uint32_t _chunkSize;           /// size of chunk
+  std::atomic_size_t _capacity;  /// max size in chunks
+  std::atomic_size_t _allocated; /// already allocated count of chunks.
 
-  ChunkHeader *_headers;
-  uint8_t *_buffers;
-  uint8_t *_region;
-
-  boost::lockfree::queue<size_t> _free_list;
-
-  EXPORT MemChunkAllocator(size_t maxSize, uint32_t bufferSize);
+  EXPORT MemChunkAllocator(size_t maxSize, uint32_t bufferSize,
+                           HUGE_PAGES huge_pages = HUGE_PAGES::NONE);
   MemChunkAllocator(const MemChunkAllocator &) = delete;
   EXPORT ~MemChunkAllocator();
   EXPORT AllocatedData allocate();
   EXPORT void free(const AllocatedData &d);
+  /// change limit of pool. allocated chunks over new limit stay valid, until free.
+  EXPORT void resize(size_t maxSize);
+
+  /// numa nodes, which chunks are spread on.
+  size_t nodes() const { return _nodes.size(); }
+  size_t node_of(size_t position) const {
+    return (position / _segment_chunks) % _nodes.size();
+  }
+  /// count of mapped segments.
+  EXPORT size_t segments();
+  /// size of table of segments, which covers max limit.
+  size_t segments_count() const { return _segments_count; }
+  size_t segment_index(size_t position) const { return position / _segment_chunks; }
+
+protected:
+  enum STATE : uint8_t { FREE = 0, USED, RELEASED };
+
+  struct Segment {
+    uint8_t *region; /// nullptr, if segment is not mapped.
+    /// state of each chunk. chunks of not mapped segment are released.
+    std::unique_ptr<std::atomic<uint8_t>[]> states;
+    std::atomic_size_t released;
+  };
+  /// free positions, cached by one cpu. refilled and returned to nodes by batches.
+  struct alignas(64) Cache {
+    utils::async::Locker locker;
+    std::vector<size_t> positions;
+  };
+
+  Segment &segment_of(size_t position) { return _segments[position / _segment_chunks]; }
+  std::atomic<uint8_t> &state_of(size_t position) {
+    return segment_of(position).states[position % _segment_chunks];
+  }
+  void map_segment(size_t index);
+  void unmap_segment(size_t index);
+  /// position over limit is taken from pool. true - if segment has no other chunks.
+  bool release(size_t position);
+  /// released position below limit is returned to pool.
+  void restore(size_t position);
+  void push(size_t position);
+  bool pop(size_t cpu, size_t &position);
+  void unmap_released();
+
+  size_t current_cpu() const;
+  void refill(Cache &cache, size_t node);
+  bool steal(size_t &position);
+
+  HUGE_PAGES _huge_pages;
+  size_t _segment_chunks;
+  size_t _segment_size; /// in bytes.
+  size_t _segments_count;
+  std::unique_ptr<Segment[]> _segments;
+  std::mutex _resize_locker;
+  std::vector<std::unique_ptr<boost::lockfree::queue<size_t>>> _nodes;
+  std::vector<size_t> _cpu2node;
+  std::unique_ptr<Cache[]> _caches;
 };
 }
 }
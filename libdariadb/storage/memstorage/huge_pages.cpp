@@ -0,0 +1,50 @@
+#include <libdariadb/storage/memstorage/huge_pages.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/strings.h>
+#include <sstream>
+
+std::istream &dariadb::storage::operator>>(std::istream &in, HUGE_PAGES &pages) {
+  std::string token;
+  in >> token;
+
+  token = utils::strings::to_upper(token);
+
+  if (token == "NONE") {
+    pages = HUGE_PAGES::NONE;
+    return in;
+  }
+  if (token == "TRANSPARENT") {
+    pages = HUGE_PAGES::TRANSPARENT;
+    return in;
+  }
+  if (token == "EXPLICIT") {
+    pages = HUGE_PAGES::EXPLICIT;
+    return in;
+  }
+  THROW_EXCEPTION("engine: bad huge pages mode - ", token);
+}
+
+std::ostream &dariadb::storage::operator<<(std::ostream &stream,
+                                           const HUGE_PAGES &pages) {
+  switch (pages) {
+  case HUGE_PAGES::NONE:
+    stream << "NONE";
+    break;
+  case HUGE_PAGES::TRANSPARENT:
+    stream << "TRANSPARENT";
+    break;
+  case HUGE_PAGES::EXPLICIT:
+    stream << "EXPLICIT";
+    break;
+  default:
+    THROW_EXCEPTION("engine: bad huge pages mode - ", (uint16_t)pages);
+    break;
+  };
+  return stream;
+}
+
+std::string dariadb::storage::to_string(const HUGE_PAGES &pages) {
+  std::stringstream ss;
+  ss << pages;
+  return ss.str();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <istream>
+#include <ostream>
+
+namespace dariadb {
+namespace storage {
+/**
+pages of memory, used by chunk allocator:
+NONE - regular pages.
+TRANSPARENT - kernel is advised to back memory by transparent huge pages.
+EXPLICIT - memory is allocated from pool of huge pages (linux only). TRANSPARENT is
+           used, when pool is not configured.
+*/
+enum class HUGE_PAGES : uint16_t { NONE = 0, TRANSPARENT, EXPLICIT };
+
+EXPORT std::istream &operator>>(std::istream &in, HUGE_PAGES &pages);
+EXPORT std::ostream &operator<<(std::ostream &stream, const HUGE_PAGES &pages);
+
+EXPORT std::string to_string(const HUGE_PAGES &pages);
+}
+}
@@ -4,8 +4,8 @@ using namespace dariadb;
 using namespace dariadb::storage;
 
 MemChunk::MemChunk(bool is_from_pool, ChunkHeader *index, uint8_t *buffer, uint32_t size,
-                   const Meas &first_m)
-    : Chunk(index, buffer, size, first_m) {
+                   const Meas &first_m, compression::CODEC codec)
+    : Chunk(index, buffer, size, first_m, codec) {
   index_ptr = index;
   buffer_ptr = buffer;
   _track = nullptr;
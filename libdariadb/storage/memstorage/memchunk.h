@@ -17,7 +17,7 @@ struct MemChunk : public Chunk {
   bool _is_from_pool;
 
   MemChunk(bool is_from_pool, ChunkHeader *index, uint8_t *buffer, uint32_t size,
-           const Meas &first_m);
+           const Meas &first_m, compression::CODEC codec);
   MemChunk(bool is_from_pool, ChunkHeader *index, uint8_t *buffer);
   ~MemChunk();
 };
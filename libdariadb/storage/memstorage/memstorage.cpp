@@ -5,18 +5,27 @@
 #include <libdariadb/storage/memstorage/memchunk.h>
 #include <libdariadb/storage/memstorage/memstorage.h>
 #include <libdariadb/storage/memstorage/timetrack.h>
+#include <libdariadb/storage/memstorage/trackmap.h>
 #include <libdariadb/storage/settings.h>
 #include <libdariadb/utils/async/thread_manager.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <memory>
 #include <set>
-#include <shared_mutex>
 #include <thread>
+#include <unordered_map>
 
 using namespace dariadb;
 using namespace dariadb::storage;
 using namespace dariadb::utils::async;
 
+namespace {
+/// how often dropping thread checks memory_limit of settings.
+const std::chrono::milliseconds MEMORY_LIMIT_CHECK_PERIOD(100);
+}
+
 /**
 Map:
   Meas.id -> TimeTrack{ MemChunkList[MemChunk{data}]}
@@ -25,17 +34,23 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
   Private(const EngineEnvironment_ptr &env, size_t id_count)
       : _env(env), _settings(_env->getResourceObject<Settings>(
                        EngineEnvironment::Resource::SETTINGS)),
-        _chunk_allocator(_settings->memory_limit.value(), _settings->chunk_size.value()) {
-    _chunks.resize(_chunk_allocator._capacity);
+        _chunk_allocator(_settings->memory_limit.value(), _settings->chunk_size.value(),
+                         _settings->memory_huge_pages.value()),
+        _id2track(id_count) {
+    _chunks.reset(new SegmentChunks[_chunk_allocator.segments_count()]);
     _stoped = false;
     _down_level_storage = nullptr;
     _disk_storage = nullptr;
     _drop_stop = false;
-    _drop_thread = std::thread{std::bind(&MemStorage::Private::drop_thread_func, this)};
-
-    if (id_count != 0) {
-      _id2track.reserve(id_count);
+    _free_epoch = 0;
+    if (_env->hasResource(EngineEnvironment::Resource::SNAPSHOTS)) {
+      _snapshots =
+          _env->getResourceObject<SnapshotManager>(EngineEnvironment::Resource::SNAPSHOTS);
+    } else {
+      _own_snapshots = std::make_unique<SnapshotManager>();
+      _snapshots = _own_snapshots.get();
     }
+    _drop_thread = std::thread{std::bind(&MemStorage::Private::drop_thread_func, this)};
   }
   void stop() {
     if (!_stoped) {
@@ -43,14 +58,19 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
       _drop_stop = true;
       _drop_cond.notify_all();
       _drop_thread.join();
+      _free_cond.notify_all();
 
       if (this->_down_level_storage != nullptr) {
         logger_info("engine", _settings->alias, ": memstorage - drop all chunk to disk");
         this->drop_by_limit(1.0, true);
+        // late values, which were not merged for lack of memory, wait for next drop.
+        while (has_late_values() && this->drop_by_limit(1.0, true) != 0) {
+        }
       }
 
-      for (size_t i = 0; i < _chunks.size(); ++i) {
-        _chunks[i] = nullptr;
+      for (size_t i = 0; i < _chunk_allocator.segments_count(); ++i) {
+        std::lock_guard<std::mutex> lg(_chunks[i].locker);
+        _chunks[i].chunks.clear();
       }
       _id2track.clear();
       _stoped = true;
@@ -61,34 +81,34 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
 
   memstorage::Description description() const {
     memstorage::Description result;
-    result.allocated = _chunk_allocator._allocated;
+    result.allocated = _chunk_allocator._allocated.load();
     result.allocator_capacity = _chunk_allocator._capacity;
     return result;
   }
 
+  TimeTrack_ptr track_of(Id id) {
+    return _id2track.find_or_insert(id, [this, id]() {
+      return std::make_shared<TimeTrack>(this, Time(0), id, &_chunk_allocator,
+                                         _settings->chunk_codec.value(),
+                                         _settings->ooo_buffer_size.value());
+    });
+  }
+
+  /// memory is exhausted: wake dropping and sleep, until it frees chunks.
+  void wait_free_chunks(size_t &epoch) {
+    std::unique_lock<std::mutex> ul(_free_locker);
+    _drop_cond.notify_all();
+    _free_cond.wait_for(ul, std::chrono::milliseconds(10),
+                        [this, epoch]() { return _free_epoch != epoch || _drop_stop; });
+    epoch = _free_epoch.load();
+  }
+
   Status append(const Meas &value) override {
-    _all_tracks_locker.lock_shared();
-    auto track = _id2track.find(value.id);
-    TimeTrack_ptr target_track = nullptr;
-    if (track == _id2track.end()) {
-      _all_tracks_locker.unlock_shared();
-      std::lock_guard<std::shared_mutex> lg(_all_tracks_locker);
-
-      track = _id2track.find(value.id);
-      if (track == _id2track.end()) { // still not exists.
-        target_track =
-            std::make_shared<TimeTrack>(this, Time(0), value.id, &_chunk_allocator);
-        _id2track.emplace(std::make_pair(value.id, target_track));
-      } else {
-        target_track = track->second;
-      }
-    } else {
-      target_track = track->second;
-      _all_tracks_locker.unlock_shared();
-    }
+    auto target_track = track_of(value.id);
 
+    auto epoch = _free_epoch.load();
     while (target_track->append(value) != Status(1, 0) && !_drop_stop) {
-      _drop_cond.notify_all();
+      wait_free_chunks(epoch);
     }
 
     if (_disk_storage != nullptr) {
@@ -98,29 +118,85 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
     return Status(1, 0);
   }
 
-  void drop_by_limit(float chunk_percent_to_free, bool in_stop) {
+  Status append(const MeasArray::const_iterator &begin,
+                const MeasArray::const_iterator &end) override {
+    // staging of thread: values grouped by id, in order of writing.
+    thread_local MeasArray staging;
+    staging.assign(begin, end);
+    std::stable_sort(staging.begin(), staging.end(),
+                     [](const Meas &l, const Meas &r) { return l.id < r.id; });
+
+    auto it = staging.cbegin();
+    while (it != staging.cend()) {
+      auto id = it->id;
+      auto id_end =
+          std::find_if(it, staging.cend(), [id](const Meas &m) { return m.id != id; });
+      auto target_track = track_of(id);
+
+      auto epoch = _free_epoch.load();
+      auto pos = it;
+      while (true) {
+        pos += target_track->append(pos, id_end).writed;
+        if (pos == id_end || _drop_stop) {
+          break;
+        }
+        wait_free_chunks(epoch);
+      }
+
+      if (_disk_storage != nullptr) {
+        _disk_storage->append(it, id_end);
+        target_track->_max_sync_time = (id_end - 1)->time;
+      }
+      it = id_end;
+    }
+    return Status(staging.size(), 0);
+  }
+
+  bool has_late_values() {
+    bool result = false;
+    _id2track.foreach([&result](const TimeTrack_ptr &t) {
+      result = result || t->has_late_values();
+    });
+    return result;
+  }
+
+  /// return count of dropped chunks.
+  size_t drop_by_limit(float chunk_percent_to_free, bool in_stop) {
     logger_info("engine", _settings->alias, ": memstorage - drop_by_limit ",
                 chunk_percent_to_free);
-    auto cur_chunk_count = this->_chunk_allocator._allocated;
+    size_t cur_chunk_count = this->_chunk_allocator._allocated;
     auto chunks_to_delete = (size_t)(cur_chunk_count * chunk_percent_to_free);
 
     std::vector<Chunk *> all_chunks;
     all_chunks.reserve(cur_chunk_count);
     size_t pos = 0;
 
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
-    std::vector<MemChunk_Ptr> chunks_copy(_chunks.size());
-    auto it =
-        std::copy_if(_chunks.begin(), _chunks.end(), chunks_copy.begin(), [](auto c) {
-          return c != nullptr && !c->_track->is_locked_to_drop;
-        });
-    sl.unlock();
-    chunks_copy.resize(std::distance(chunks_copy.begin(), it));
+    // late values must be in chunks, before they are written to disk. on stop track
+    // may have only late values.
+    std::set<TimeTrack_ptr> tracks_to_merge;
+    if (in_stop) {
+      _id2track.foreach([&tracks_to_merge](const TimeTrack_ptr &t) {
+        tracks_to_merge.insert(t);
+      });
+    } else {
+      for (auto &c : chunks_to_drop()) {
+        tracks_to_merge.insert(c->_track->shared_from_this());
+      }
+    }
+    // chunks of dropped tracks are not rewritten, until they are retired.
+    for (auto &t : tracks_to_merge) {
+      t->flush();
+      t->begin_drop();
+    }
+
+    auto chunks_copy = chunks_to_drop();
 
     std::sort(chunks_copy.begin(), chunks_copy.end(),
               [](const MemChunk_Ptr &left, const MemChunk_Ptr &right) {
                 return left->header->data_first.time < right->header->data_first.time;
               });
+    std::vector<MemChunk_Ptr> dropped;
+    dropped.reserve(chunks_copy.size());
     for (auto &c : chunks_copy) {
       if (pos >= chunks_to_delete) {
         break;
@@ -128,17 +204,22 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
       if (c == nullptr) {
         continue;
       }
-      if (!in_stop & !c->isFull()) { // not full
-        ENSURE(!in_stop);
-        ENSURE(!c->isFull());
+      if (tracks_to_merge.count(c->_track->shared_from_this()) == 0) {
+        continue;
+      }
+      // current chunk is filled yet. merged chunks may be not full.
+      if (!in_stop && !c->isFull() && c->_track->is_current(c.get())) {
         continue;
       }
       all_chunks.push_back(c.get());
+      dropped.push_back(c);
       ++pos;
     }
     if (pos != 0) {
       logger_info("engine", _settings->alias, ": memstorage - drop begin ", pos,
                   " chunks of ", cur_chunk_count);
+      // page and retired chunks are seen by readers in one version.
+      Publication publication(_snapshots);
       if (_down_level_storage != nullptr) {
         AsyncTask at = [this, &all_chunks, pos](const ThreadInfo &ti) {
           TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
@@ -153,83 +234,129 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
                       ": memstorage _down_level_storage == nullptr");
         }
       }
-      std::set<TimeTrack *> updated_tracks;
-      for (size_t i = 0; i < pos; ++i) {
-        auto c = all_chunks[i];
-        auto mc = dynamic_cast<MemChunk *>(c);
-        ENSURE(mc != nullptr);
-
-        TimeTrack *track = mc->_track;
-        track->rm_chunk(mc);
-        updated_tracks.insert(track);
-
-        auto chunk_pos = mc->_a_data.position;
-        _chunk_allocator.free(mc->_a_data);
-        _chunks[chunk_pos] = nullptr;
-      }
-      for (auto &t : updated_tracks) {
-        t->rereadMinMax();
+      // chunks, which wait for readers, are not dropped again.
+      for (auto &mc : dropped) {
+        unregister(mc);
       }
+      _snapshots->publish(
+          [dropped](uint64_t version) {
+            std::set<TimeTrack *> updated_tracks;
+            for (auto &mc : dropped) {
+              mc->_track->retire_chunk(mc.get(), version);
+              updated_tracks.insert(mc->_track);
+            }
+            for (auto &t : updated_tracks) {
+              t->rereadMinMax();
+            }
+          },
+          [this, dropped]() {
+            for (auto mc : dropped) {
+              mc->_track->rm_retired(mc.get());
+              freeChunk(mc);
+            }
+            {
+              std::lock_guard<std::mutex> lg(_free_locker);
+              _free_epoch++;
+            }
+            _free_cond.notify_all();
+          });
+    }
+    for (auto &t : tracks_to_merge) {
+      t->end_drop();
+    }
+    if (pos != 0) {
       logger_info("engine", _settings->alias, ": memstorage - drop end.");
     }
+    return pos;
+  }
+
+  /// chunks of all tracks.
+  std::vector<MemChunk_Ptr> chunks_to_drop() {
+    std::vector<MemChunk_Ptr> result;
+    result.reserve(_chunk_allocator._allocated.load());
+    for (size_t i = 0; i < _chunk_allocator.segments_count(); ++i) {
+      std::lock_guard<std::mutex> lg(_chunks[i].locker);
+      for (auto &kv : _chunks[i].chunks) {
+        result.push_back(kv.second);
+      }
+    }
+    return result;
+  }
+
+  /// memory_limit of settings can be changed at runtime.
+  void apply_memory_limit() {
+    size_t limit = _settings->memory_limit.value();
+    size_t old_limit = _chunk_allocator._maxSize;
+    if (limit == old_limit) {
+      return;
+    }
+    logger_info("engine", _settings->alias, ": memstorage - memory limit ", old_limit,
+                " to ", limit);
+    _chunk_allocator.resize(limit);
+    { // writers, which wait for free chunks, can use new ones.
+      std::lock_guard<std::mutex> lg(_free_locker);
+      _free_epoch++;
+    }
+    _free_cond.notify_all();
+  }
+
+  /// 'percent_to_drop' of chunks and all over threshold, if limit was reduced.
+  float percent_to_drop() {
+    auto result = _settings->percent_to_drop.value();
+    float allocated = float(_chunk_allocator._allocated.load());
+    float threshold =
+        _chunk_allocator._capacity * _settings->percent_when_start_droping.value();
+    if (allocated > threshold) {
+      result += (allocated - threshold) / allocated;
+    }
+    return std::min(result, float(1.0));
   }
 
   Id2Time getSyncMap() {
     Id2Time result;
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
-    result.reserve(_id2track.size());
-    for (auto t : _id2track) {
-      result[t.first] = t.second->_max_sync_time;
-    }
+    _id2track.foreach (
+        [&result](const TimeTrack_ptr &t) { result[t->_meas_id] = t->_max_sync_time; });
     return result;
   }
 
   Id2MinMax loadMinMax() override {
     Id2MinMax result;
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
-    for (auto t : _id2track) {
-      if (t.second->_cur_chunk == nullptr) {
-        continue;
+    _id2track.foreach ([&result](const TimeTrack_ptr &t) {
+      if (t->_cur_chunk != nullptr) {
+        result[t->_meas_id] = t->_min_max;
       }
-      result[t.first] = t.second->_min_max;
-    }
+    });
     return result;
   }
 
   Time minTime() override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     Time result = MAX_TIME;
-    for (auto t : _id2track) {
-      result = std::min(result, t.second->minTime());
-    }
+    _id2track.foreach (
+        [&result](const TimeTrack_ptr &t) { result = std::min(result, t->minTime()); });
     return result;
   }
   virtual Time maxTime() override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     Time result = MIN_TIME;
-    for (auto t : _id2track) {
-      result = std::max(result, t.second->maxTime());
-    }
+    _id2track.foreach (
+        [&result](const TimeTrack_ptr &t) { result = std::max(result, t->maxTime()); });
     return result;
   }
 
   virtual bool minMaxTime(dariadb::Id id, dariadb::Time *minResult,
                           dariadb::Time *maxResult) override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     auto tracker = _id2track.find(id);
-    if (tracker != _id2track.end()) {
-      return tracker->second->minMaxTime(id, minResult, maxResult);
+    if (tracker != nullptr) {
+      return tracker->minMaxTime(id, minResult, maxResult);
     }
     return false;
   }
 
   Id2Cursor intervalReader(const QueryInterval &q) override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     Id2Cursor result;
     for (auto id : q.ids) {
       auto tracker = _id2track.find(id);
-      if (tracker != _id2track.end()) {
-        auto rdr = tracker->second->intervalReader(q);
+      if (tracker != nullptr) {
+        auto rdr = tracker->intervalReader(q);
         if (!rdr.empty()) {
           result[id] = rdr[id];
         }
@@ -239,12 +366,11 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
   }
 
   Statistic stat(const Id id, Time from, Time to) override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     Statistic result;
 
     auto tracker = _id2track.find(id);
-    if (tracker != _id2track.end()) {
-      result = tracker->second->stat(id, from, to);
+    if (tracker != nullptr) {
+      result = tracker->stat(id, from, to);
     }
 
     return result;
@@ -258,16 +384,15 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
   }
 
   virtual Id2Meas readTimePoint(const QueryTimePoint &q) override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     QueryTimePoint local_q({}, q.flag, q.time_point);
     local_q.ids.resize(1);
     Id2Meas result;
     for (auto id : q.ids) {
       result[id].id = id;
       auto tracker = _id2track.find(id);
-      if (tracker != _id2track.end()) {
+      if (tracker != nullptr) {
         local_q.ids[0] = id;
-        auto sub_res = tracker->second->readTimePoint(local_q);
+        auto sub_res = tracker->readTimePoint(local_q);
         result[id] = sub_res[id];
       } else {
         result[id].flag = FLAGS::_NO_DATA;
@@ -277,16 +402,15 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
   }
 
   virtual Id2Meas currentValue(const IdArray &ids, const Flag &flag) override {
-    std::shared_lock<std::shared_mutex> sl(_all_tracks_locker);
     IdArray local_ids;
     local_ids.resize(1);
     Id2Meas result;
     for (auto id : ids) {
       result[id].id = id;
       auto tracker = _id2track.find(id);
-      if (tracker != _id2track.end()) {
+      if (tracker != nullptr) {
         local_ids[0] = id;
-        auto sub_res = tracker->second->currentValue(local_ids, flag);
+        auto sub_res = tracker->currentValue(local_ids, flag);
         result[id] = sub_res[id];
       } else {
         result[id].flag = FLAGS::_NO_DATA;
@@ -302,64 +426,83 @@ struct MemStorage::Private : public IMeasStorage, public MemoryChunkContainer {
   void setDiskStorage(IMeasWriter *_disk) { _disk_storage = _disk; }
 
   void addChunk(MemChunk_Ptr &chunk) override {
-    ENSURE(chunk->_a_data.position < _chunks.size());
     ENSURE(chunk->_is_from_pool);
-
-    _chunks[chunk->_a_data.position] = chunk;
+    {
+      auto &segment = chunks_of(chunk->_a_data.position);
+      std::lock_guard<std::mutex> lg(segment.locker);
+      segment.chunks[chunk->_a_data.position] = chunk;
+    }
     if (is_time_to_drop()) {
       _drop_cond.notify_all();
     }
   }
 
-  void freeChunk(MemChunk_Ptr &chunk) {
-    ENSURE(chunk->_a_data.position < _chunks.size());
+  void freeChunk(MemChunk_Ptr &chunk) override {
     ENSURE(chunk->_is_from_pool);
+    unregister(chunk);
+    _chunk_allocator.free(chunk->_a_data);
+  }
 
-    _chunks[chunk->_a_data.position] = nullptr;
-    if (is_time_to_drop()) {
-      _drop_cond.notify_all();
-    }
+  void unregister(const MemChunk_Ptr &chunk) {
+    auto &segment = chunks_of(chunk->_a_data.position);
+    std::lock_guard<std::mutex> lg(segment.locker);
+    segment.chunks.erase(chunk->_a_data.position);
   }
 
-  std::mutex *getLockers() { return &_drop_locker; }
+  SnapshotManager *snapshots() override { return _snapshots; }
+
+  struct SegmentChunks;
+  SegmentChunks &chunks_of(size_t position) {
+    return _chunks[_chunk_allocator.segment_index(position)];
+  }
 
   bool is_time_to_drop() {
     return (_chunk_allocator._allocated) >=
            (_chunk_allocator._capacity * _settings->percent_when_start_droping.value());
   }
 
+  /// limit and allocated chunks are checked without lock, thread sleeps only if
+  /// there is nothing to drop.
   void drop_thread_func() {
     while (!_drop_stop) {
-      std::unique_lock<std::mutex> ul(_drop_locker);
-      _drop_cond.wait(ul);
-      if (_drop_stop) {
-        break;
-      }
-
-      if (!is_time_to_drop()) {
+      apply_memory_limit();
+      if (is_time_to_drop() && drop_by_limit(percent_to_drop(), false) != 0) {
         continue;
       }
-
-      drop_by_limit(_settings->percent_to_drop.value(), false);
+      std::unique_lock<std::mutex> ul(_drop_locker);
+      if (!_drop_stop) {
+        _drop_cond.wait_for(ul, MEMORY_LIMIT_CHECK_PERIOD);
+      }
     }
     logger_info("engine", _settings->alias, ": memstorage - dropping thread stoped.");
   }
 
-  Id2Track _id2track;
   EngineEnvironment_ptr _env;
   storage::Settings *_settings;
   MemChunkAllocator _chunk_allocator;
-  std::shared_mutex _all_tracks_locker;
+  TrackMap _id2track;
   IChunkStorage *_down_level_storage;
   IMeasWriter *_disk_storage;
 
-  std::vector<MemChunk_Ptr> _chunks;
+  /// chunks from allocator by position. registration is locked by segment of position.
+  struct SegmentChunks {
+    std::mutex locker;
+    std::unordered_map<size_t, MemChunk_Ptr> chunks;
+  };
+  std::unique_ptr<SegmentChunks[]> _chunks;
   bool _stoped;
 
   std::thread _drop_thread;
-  bool _drop_stop;
+  std::atomic_bool _drop_stop;
   std::mutex _drop_locker;
-  std::condition_variable _drop_cond;
+  std::condition_variable_any _drop_cond;
+  /// writers wait on it, while memory is exhausted.
+  std::mutex _free_locker;
+  std::condition_variable _free_cond;
+  std::atomic_size_t _free_epoch; /// incremented, when dropping frees chunks.
+  /// readers pin version of chunks. dropped chunks are freed after readers of them.
+  SnapshotManager *_snapshots;
+  std::unique_ptr<SnapshotManager> _own_snapshots;
 };
 
 MemStorage_ptr MemStorage::create(const EngineEnvironment_ptr &env, size_t id_count) {
@@ -414,6 +557,11 @@ Status MemStorage::append(const Meas &value) {
   return _impl->append(value);
 }
 
+Status MemStorage::append(const MeasArray::const_iterator &begin,
+                          const MeasArray::const_iterator &end) {
+  return _impl->append(begin, end);
+}
+
 void MemStorage::flush() {
   _impl->flush();
 }
@@ -430,10 +578,6 @@ void MemStorage::setDiskStorage(IMeasWriter *_disk) {
   _impl->setDiskStorage(_disk);
 }
 
-std::mutex *MemStorage::getLockers() {
-  return _impl->getLockers();
-}
-
 Id2MinMax MemStorage::loadMinMax() {
   return _impl->loadMinMax();
 }
@@ -38,11 +38,13 @@ public:
   EXPORT virtual Id2Meas currentValue(const IdArray &ids, const Flag &flag) override;
   using IMeasStorage::append;
   EXPORT Status append(const Meas &value) override;
+  /// values are grouped by id, track of id is locked once.
+  EXPORT Status append(const MeasArray::const_iterator &begin,
+                       const MeasArray::const_iterator &end) override;
   EXPORT void flush() override;
   EXPORT void setDownLevel(IChunkStorage *_down);
   EXPORT void setDiskStorage(IMeasWriter *_disk); // when strategy==CACHE;
   EXPORT void stop();
-  EXPORT std::mutex *getLockers();
   EXPORT Id2MinMax loadMinMax() override;
   EXPORT Id2Time getSyncMap(); /// Id to max dropped to disk time.
 private:
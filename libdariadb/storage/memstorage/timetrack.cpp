@@ -4,43 +4,57 @@
 #include <libdariadb/flags.h>
 #include <libdariadb/storage/cursors.h>
 #include <libdariadb/storage/memstorage/timetrack.h>
+#include <algorithm>
 
 using namespace dariadb;
 using namespace dariadb::storage;
 
+namespace {
+bool before_time(const Meas &m, const Time t) {
+  return m.time < t;
+}
+bool after_time(const Time t, const Meas &m) {
+  return t < m.time;
+}
+}
+
+/// memory of readed chunks is not freed, while reader holds snapshot.
 struct MemTrackReader : dariadb::ICursor {
-  MemTrackReader(const Cursor_Ptr &r, const TimeTrack_ptr &track) {
+  MemTrackReader(const Cursor_Ptr &r, const Snapshot_Ptr &snapshot) {
     _r = r;
-    _track = track;
-    ENSURE(track != nullptr);
+    _snapshot = snapshot;
+    ENSURE(snapshot != nullptr);
     ENSURE(r != nullptr);
-    _track->is_locked_to_drop = true;
   }
 
-  ~MemTrackReader() { _track->is_locked_to_drop = false; }
   Meas readNext() override { return _r->readNext(); }
 
   Meas top() override { return _r->top(); }
   bool is_end() const override { return _r->is_end(); }
 
-  Time minTime() override { return _track->minTime(); }
+  Time minTime() override { return _r->minTime(); }
 
-  Time maxTime() override { return _track->minTime(); }
+  Time maxTime() override { return _r->maxTime(); }
+
+  size_t readBatch(Meas *out, size_t n) override { return _r->readBatch(out, n); }
 
   Cursor_Ptr _r;
-  TimeTrack_ptr _track;
+  Snapshot_Ptr _snapshot;
 };
 
 TimeTrack::TimeTrack(MemoryChunkContainer *mcc, const Time step, Id meas_id,
-                     MemChunkAllocator *allocator) {
+                     MemChunkAllocator *allocator, compression::CODEC codec,
+                     size_t ooo_limit) {
   _allocator = allocator;
+  _codec = codec;
   _meas_id = meas_id;
   _step = step;
   _min_max.min.time = MAX_TIME;
   _min_max.max.time = MIN_TIME;
   _max_sync_time = MIN_TIME;
   _mcc = mcc;
-  is_locked_to_drop = false;
+  _dropping = 0;
+  _ooo_limit = ooo_limit;
 }
 
 TimeTrack::~TimeTrack() {}
@@ -51,7 +65,52 @@ void TimeTrack::updateMinMax(const Meas &value) {
 }
 
 Status TimeTrack::append(const Meas &value) {
-  std::lock_guard<utils::async::Locker> lg(_locker);
+  std::vector<MemChunk_Ptr> merged;
+  Status result;
+  {
+    std::lock_guard<utils::async::Locker> lg(_locker);
+    result = append_value(value);
+    merged.swap(_merged);
+  }
+  free_merged(merged);
+  return result;
+}
+
+Status TimeTrack::append(const MeasArray::const_iterator &begin,
+                         const MeasArray::const_iterator &end) {
+  std::vector<MemChunk_Ptr> merged;
+  Status result;
+  {
+    std::lock_guard<utils::async::Locker> lg(_locker);
+    size_t writed = 0;
+    auto it = begin;
+    for (; it != end; ++it, ++writed) {
+      if (append_value(*it).writed == 0) {
+        break;
+      }
+    }
+    result = Status(writed, std::distance(it, end));
+    merged.swap(_merged);
+  }
+  free_merged(merged);
+  return result;
+}
+
+void TimeTrack::free_merged(std::vector<MemChunk_Ptr> &merged) {
+  if (merged.empty()) {
+    return;
+  }
+  // snapshots are not published under lock of track: applies of drop lock it.
+  auto mcc = _mcc;
+  _mcc->snapshots()->defer([mcc, merged]() {
+    for (auto c : merged) {
+      mcc->freeChunk(c);
+    }
+  });
+  merged.clear();
+}
+
+Status TimeTrack::append_value(const Meas &value) {
   if (_cur_chunk == nullptr || _cur_chunk->isFull()) {
     if (!create_new_chunk(value)) {
       return Status(0, 1);
@@ -60,7 +119,8 @@ Status TimeTrack::append(const Meas &value) {
       return Status(1, 0);
     }
   }
-  if (_cur_chunk->header->stat.maxTime < value.time) {
+  if (_cur_chunk->header->stat.maxTime < value.time &&
+      (_ooo.empty() || _ooo.back().time < value.time)) {
     if (!_cur_chunk->append(value)) {
       if (!create_new_chunk(value)) {
         return Status(0, 1);
@@ -76,65 +136,94 @@ Status TimeTrack::append(const Meas &value) {
 }
 
 void TimeTrack::append_to_past(const Meas &value) {
-  auto is_cur_chunk = false;
-  MemChunk_Ptr target_to_replace = nullptr;
-
-  // find target chunk.
-  if (_index.empty() || _cur_chunk->header->stat.minTime < value.time) {
-    target_to_replace = _cur_chunk;
-    is_cur_chunk = true;
-    ENSURE(target_to_replace.use_count() <= long(3));
+  auto it = std::lower_bound(_ooo.begin(), _ooo.end(), value, meas_time_compare_less());
+  if (it != _ooo.end() && it->time == value.time) {
+    *it = value;
   } else {
-    target_to_replace = get_target_to_replace_from_index(value.time);
+    _ooo.insert(it, value);
   }
+  // chunks of track, which is dropped, are rewritten later.
+  if (_ooo.size() >= _ooo_limit && _dropping == 0) {
+    merge_ooo();
+  }
+}
 
-  ENSURE(target_to_replace != nullptr);
-  MemChunk_Ptr new_chunk = nullptr;
-
-  MeasSet mset;
-  if (is_cur_chunk) {
-    _cur_chunk = nullptr;
-  } else {
-    _index.erase(target_to_replace->header->stat.maxTime);
+MemChunk_Ptr TimeTrack::get_target_to_replace(const Time t) {
+  if (_index.empty() || _index.rbegin()->first < t) {
+    if (_cur_chunk != nullptr || _index.empty()) {
+      return _cur_chunk;
+    }
+    return _index.rbegin()->second;
   }
+  return get_target_to_replace_from_index(t);
+}
 
-  if (target_to_replace->_is_from_pool) {
-    _mcc->freeChunk(target_to_replace);
+void TimeTrack::merge_ooo() {
+  if (_ooo.empty()) {
+    return;
   }
-  /// unpack and sort.
-  auto rdr = target_to_replace->getReader();
-  while (!rdr->is_end()) {
-    auto v = rdr->readNext();
-    if (v.time == value.time) {
-      continue;
+  std::vector<std::pair<MemChunk_Ptr, MeasArray>> targets;
+  for (auto &v : _ooo) {
+    auto target = get_target_to_replace(v.time);
+    auto pos = std::find_if(targets.begin(), targets.end(),
+                            [&target](auto &kv) { return kv.first == target; });
+    if (pos == targets.end()) {
+      pos = targets.insert(targets.end(), std::make_pair(target, MeasArray()));
     }
-    mset.insert(v);
+    pos->second.push_back(v);
   }
-  rdr = nullptr;
-
-  mset.insert(value);
+  _ooo.clear();
+  for (auto &kv : targets) {
+    rewrite_chunk(kv.first, kv.second);
+  }
+}
 
-  /// need to leak detection.
-  ENSURE(target_to_replace.use_count() == long(1));
-  auto old_chunk_size = target_to_replace->header->size;
-  target_to_replace = nullptr;
+void TimeTrack::rewrite_chunk(const MemChunk_Ptr &target, const MeasArray &values) {
+  // without target, track has no chunks and values are its first chunk.
+  auto is_cur_chunk = target == nullptr || target == _cur_chunk;
+  MeasArray mar;
+  if (target != nullptr) {
+    /// unpack and merge with sorted values.
+    mar.reserve(size_t(target->header->stat.count) + values.size());
+    auto v_it = values.cbegin();
+    auto rdr = target->getReader();
+    while (!rdr->is_end()) {
+      auto v = rdr->readNext();
+      while (v_it != values.cend() && v_it->time < v.time) {
+        mar.push_back(*v_it++);
+      }
+      if (v_it != values.cend() && v_it->time == v.time) {
+        continue;
+      }
+      mar.push_back(v);
+    }
+    mar.insert(mar.end(), v_it, values.cend());
 
-  MeasArray mar{mset.begin(), mset.end()};
+    if (is_cur_chunk) {
+      _cur_chunk = nullptr;
+    } else {
+      _index.erase(target->header->stat.maxTime);
+    }
+    // readers may read target yet: it is freed after them.
+    _merged.push_back(target);
+  } else {
+    mar = values;
+  }
   ENSURE(mar.front().time <= mar.back().time);
 
-  auto buffer_size = old_chunk_size + sizeof(Meas) * 2;
-  uint8_t *new_buffer = new uint8_t[buffer_size];
-  std::fill_n(new_buffer, buffer_size, uint8_t(0));
-  ChunkHeader *hdr = new ChunkHeader;
-
-  new_chunk =
-      MemChunk_Ptr{new MemChunk(false, hdr, new_buffer, buffer_size, mar.front())};
-  new_chunk->_track = this;
-  for (size_t i = 1; i < mar.size(); ++i) {
-    auto v = mar[i];
-    auto status = new_chunk->append(v);
-    if (!status) {
-      THROW_EXCEPTION("logic error.");
+  MemChunk_Ptr new_chunk = nullptr;
+  for (auto it = mar.cbegin(); it != mar.cend(); ++it) {
+    if (new_chunk != nullptr && new_chunk->append(*it)) {
+      continue;
+    }
+    if (new_chunk != nullptr) {
+      _index.insert(std::make_pair(new_chunk->header->stat.maxTime, new_chunk));
+    }
+    new_chunk = allocate_chunk(*it);
+    if (new_chunk == nullptr) {
+      auto middle = _ooo.insert(_ooo.end(), it, mar.cend());
+      std::inplace_merge(_ooo.begin(), middle, _ooo.end(), meas_time_compare_less());
+      return;
     }
   }
 
@@ -187,7 +276,17 @@ MemChunk_Ptr TimeTrack::get_target_to_replace_from_index(const Time t) {
   return target_to_replace;
 }
 
-void TimeTrack::flush() {}
+void TimeTrack::flush() {
+  std::vector<MemChunk_Ptr> merged;
+  {
+    std::lock_guard<utils::async::Locker> lg(_locker);
+    if (_dropping == 0) {
+      merge_ooo();
+    }
+    merged.swap(_merged);
+  }
+  free_merged(merged);
+}
 
 Time TimeTrack::TimeTrack::minTime() {
   return _min_max.min.time;
@@ -202,9 +301,14 @@ bool TimeTrack::minMaxTime(dariadb::Id id, dariadb::Time *minResult,
   if (id != this->_meas_id) {
     return false;
   }
+  auto snapshot = _mcc->snapshots()->pin();
   std::lock_guard<utils::async::Locker> lg(_locker);
   *minResult = MAX_TIME;
   *maxResult = MIN_TIME;
+  for (auto &c : retired_chunks(snapshot->number())) {
+    *minResult = std::min(c->header->stat.minTime, *minResult);
+    *maxResult = std::max(c->header->stat.maxTime, *maxResult);
+  }
   for (auto kv : _index) {
     auto c = kv.second;
     *minResult = std::min(c->header->stat.minTime, *minResult);
@@ -214,6 +318,10 @@ bool TimeTrack::minMaxTime(dariadb::Id id, dariadb::Time *minResult,
     *minResult = std::min(_cur_chunk->header->stat.minTime, *minResult);
     *maxResult = std::max(_cur_chunk->header->stat.maxTime, *maxResult);
   }
+  if (!_ooo.empty()) {
+    *minResult = std::min(_ooo.front().time, *minResult);
+    *maxResult = std::max(_ooo.back().time, *maxResult);
+  }
   return true;
 }
 
@@ -232,12 +340,33 @@ bool chunkInQuery(const QueryInterval &q, const Chunk_Ptr &c) {
   return chunkInQuery(q.from, q.to, c);
 }
 
-Id2Cursor TimeTrack::intervalReader(const QueryInterval &q) {
-  std::lock_guard<utils::async::Locker> lg(_locker);
+std::vector<MemChunk_Ptr> TimeTrack::retired_chunks(uint64_t version) {
+  std::vector<MemChunk_Ptr> result;
+  for (auto &kv : _retired) {
+    if (version < kv.second) {
+      result.push_back(kv.first);
+    }
+  }
+  return result;
+}
 
+Cursor_Ptr TimeTrack::cursor(Time from, Time to, uint64_t version) {
   CursorsList readers;
-  auto end = _index.upper_bound(q.to);
-  auto begin = _index.lower_bound(q.from);
+  // side buffer is first: its values win on equal time.
+  auto ooo_begin = std::lower_bound(_ooo.begin(), _ooo.end(), from, before_time);
+  auto ooo_end =
+      std::upper_bound(ooo_begin, _ooo.end(), to, after_time);
+  if (ooo_begin != ooo_end) {
+    MeasArray ma{ooo_begin, ooo_end};
+    readers.push_back(Cursor_Ptr{new FullCursor(ma)});
+  }
+
+  // chunk with first greater max time may contain values of interval.
+  auto end = _index.upper_bound(to);
+  if (end != _index.end()) {
+    ++end;
+  }
+  auto begin = _index.lower_bound(from);
   if (begin != _index.begin()) {
     --begin;
   }
@@ -246,29 +375,60 @@ Id2Cursor TimeTrack::intervalReader(const QueryInterval &q) {
       break;
     }
     auto c = it->second;
-    if (chunkInQuery(q, c)) {
+    if (chunkInQuery(from, to, c)) {
       auto rdr = c->getReader();
       readers.push_back(rdr);
     }
   }
-  if (_cur_chunk != nullptr && chunkInQuery(q, _cur_chunk)) {
+  if (_cur_chunk != nullptr && chunkInQuery(from, to, _cur_chunk)) {
     auto rdr = _cur_chunk->getReader();
     readers.push_back(rdr);
   }
+  for (auto &c : retired_chunks(version)) {
+    if (chunkInQuery(from, to, c)) {
+      readers.push_back(c->getReader());
+    }
+  }
   if (readers.empty()) {
+    return nullptr;
+  }
+  return CursorWrapperFactory::colapseCursors(readers);
+}
+
+Id2Cursor TimeTrack::intervalReader(const QueryInterval &q) {
+  auto snapshot = _mcc->snapshots()->pin();
+  std::lock_guard<utils::async::Locker> lg(_locker);
+
+  auto result = cursor(q.from, q.to, snapshot->number());
+  if (result == nullptr) {
     return Id2Cursor();
   }
-  Cursor_Ptr result = CursorWrapperFactory::colapseCursors(readers);
   Id2Cursor i2r;
-  i2r[this->_meas_id] = result;
+  i2r[this->_meas_id] = Cursor_Ptr{new MemTrackReader(result, snapshot)};
   return i2r;
 }
 
 Statistic TimeTrack::stat(const Id id, Time from, Time to) {
+  auto snapshot = _mcc->snapshots()->pin();
   std::lock_guard<utils::async::Locker> lg(_locker);
   ENSURE(id == this->_meas_id);
   Statistic result;
+  auto ooo_it = std::lower_bound(_ooo.begin(), _ooo.end(), from, before_time);
+  if (ooo_it != _ooo.end() && ooo_it->time <= to) {
+    // late values replace values of chunks, so statistic of chunks is not valid.
+    auto rdr = cursor(from, to, snapshot->number());
+    while (!rdr->is_end()) {
+      auto v = rdr->readNext();
+      if (v.inInterval(from, to)) {
+        result.update(v);
+      }
+    }
+    return result;
+  }
   auto end = _index.upper_bound(to);
+  if (end != _index.end()) {
+    ++end;
+  }
   auto begin = _index.lower_bound(from);
   if (begin != _index.begin()) {
     --begin;
@@ -289,6 +449,11 @@ Statistic TimeTrack::stat(const Id id, Time from, Time to) {
     auto st = _cur_chunk->stat(from, to);
     result.update(st);
   }
+  for (auto &c : retired_chunks(snapshot->number())) {
+    if (chunkInQuery(from, to, c)) {
+      result.update(c->stat(from, to));
+    }
+  }
   return result;
 }
 
@@ -303,9 +468,19 @@ void TimeTrack::foreach (const QueryInterval &q, IReadCallback * clbk) {
 }
 
 Id2Meas TimeTrack::readTimePoint(const QueryTimePoint &q) {
+  auto snapshot = _mcc->snapshots()->pin();
   std::lock_guard<utils::async::Locker> lg(_locker);
   Id2Meas result;
   result[this->_meas_id].flag = FLAGS::_NO_DATA;
+  for (auto &c : retired_chunks(snapshot->number())) {
+    if (c->header->stat.minTime <= q.time_point &&
+        c->header->stat.maxTime >= q.time_point) {
+      auto m = c->getReader()->read_time_point(q);
+      if (m.time > result[this->_meas_id].time) {
+        result[this->_meas_id] = m;
+      }
+    }
+  }
 
   auto end = _index.upper_bound(q.time_point);
   auto begin = _index.lower_bound(q.time_point);
@@ -343,6 +518,14 @@ Id2Meas TimeTrack::readTimePoint(const QueryTimePoint &q) {
       }
     }
   }
+  auto ooo_it = std::upper_bound(_ooo.begin(), _ooo.end(), q.time_point, after_time);
+  if (ooo_it != _ooo.begin()) {
+    --ooo_it;
+    if (ooo_it->time >= result[this->_meas_id].time ||
+        result[this->_meas_id].flag == FLAGS::_NO_DATA) {
+      result[this->_meas_id] = *ooo_it;
+    }
+  }
   if (result[this->_meas_id].flag == FLAGS::_NO_DATA) {
     result[this->_meas_id].time = q.time_point;
   }
@@ -356,6 +539,9 @@ Id2Meas TimeTrack::currentValue(const IdArray &ids, const Flag &flag) {
   Id2Meas result;
   if (_cur_chunk != nullptr) {
     auto last = _cur_chunk->header->last();
+    if (!_ooo.empty() && _ooo.back().time == last.time) {
+      last = _ooo.back();
+    }
     if (last.inFlag(flag)) {
       result[_meas_id] = last;
       return result;
@@ -365,13 +551,37 @@ Id2Meas TimeTrack::currentValue(const IdArray &ids, const Flag &flag) {
   return result;
 }
 
-void TimeTrack::rm_chunk(MemChunk *c) {
+void TimeTrack::begin_drop() {
   std::lock_guard<utils::async::Locker> lg(_locker);
-  _index.erase(c->header->stat.maxTime);
+  ++_dropping;
+}
 
+void TimeTrack::end_drop() {
+  std::lock_guard<utils::async::Locker> lg(_locker);
+  ENSURE(_dropping != 0);
+  --_dropping;
+}
+
+void TimeTrack::retire_chunk(MemChunk *c, uint64_t version) {
+  std::lock_guard<utils::async::Locker> lg(_locker);
+  MemChunk_Ptr chunk = nullptr;
+  auto it = _index.find(c->header->stat.maxTime);
+  if (it != _index.end() && it->second.get() == c) {
+    chunk = it->second;
+    _index.erase(it);
+  }
   if (_cur_chunk.get() == c) {
+    chunk = _cur_chunk;
     _cur_chunk = nullptr;
   }
+  if (chunk != nullptr) {
+    _retired.emplace_back(chunk, version);
+  }
+}
+
+void TimeTrack::rm_retired(MemChunk *c) {
+  std::lock_guard<utils::async::Locker> lg(_locker);
+  _retired.remove_if([c](const auto &kv) { return kv.first.get() == c; });
 }
 
 void TimeTrack::rereadMinMax() {
@@ -398,15 +608,29 @@ bool TimeTrack::create_new_chunk(const Meas &value) {
     this->_index.insert(std::make_pair(_cur_chunk->header->stat.maxTime, _cur_chunk));
     _cur_chunk = nullptr;
   }
+  _cur_chunk = allocate_chunk(value);
+  return _cur_chunk != nullptr;
+}
+
+MemChunk_Ptr TimeTrack::allocate_chunk(const Meas &first) {
   auto new_chunk_data = _allocator->allocate();
   if (new_chunk_data.header == nullptr) {
-    return false;
+    return nullptr;
   }
   auto mc = MemChunk_Ptr{new MemChunk{true, new_chunk_data.header, new_chunk_data.buffer,
-                                      _allocator->_chunkSize, value}};
+                                      _allocator->_chunkSize, first, _codec}};
   mc->_track = this;
   mc->_a_data = new_chunk_data;
   this->_mcc->addChunk(mc);
-  _cur_chunk = mc;
-  return true;
+  return mc;
+}
+
+bool TimeTrack::is_current(const MemChunk *c) {
+  std::lock_guard<utils::async::Locker> lg(_locker);
+  return _cur_chunk.get() == c;
+}
+
+bool TimeTrack::has_late_values() {
+  std::lock_guard<utils::async::Locker> lg(_locker);
+  return !_ooo.empty();
 }
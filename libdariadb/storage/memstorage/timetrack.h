@@ -2,8 +2,10 @@
 
 #include <libdariadb/interfaces/imeasstorage.h>
 #include <libdariadb/storage/memstorage/memchunk.h>
+#include <libdariadb/storage/snapshot.h>
 #include <extern/stx-btree/include/stx/btree_map.h>
 #include <memory>
+#include <vector>
 
 namespace dariadb {
 namespace storage {
@@ -11,21 +13,31 @@ namespace storage {
 class MemoryChunkContainer {
 public:
   virtual void addChunk(MemChunk_Ptr &c) = 0;
+  /// chunk is removed and its memory is returned to pool.
   virtual void freeChunk(MemChunk_Ptr &c) = 0;
+  /// readers pin version of chunks, replaced chunks are freed after them.
+  virtual SnapshotManager *snapshots() = 0;
   virtual ~MemoryChunkContainer() {}
 };
 
 struct TimeTrack;
 using TimeTrack_ptr = std::shared_ptr<TimeTrack>;
-using Id2Track = std::unordered_map<Id, TimeTrack_ptr>;
 
 struct TimeTrack : public IMeasStorage, public std::enable_shared_from_this<TimeTrack> {
   TimeTrack(MemoryChunkContainer *mcc, const Time step, Id meas_id,
-            MemChunkAllocator *allocator);
+            MemChunkAllocator *allocator, compression::CODEC codec, size_t ooo_limit);
   ~TimeTrack();
   void updateMinMax(const Meas &value);
   virtual Status append(const Meas &value) override;
+  using IMeasStorage::append;
+  /// values of track under one lock. stops on first value, which was not written.
+  Status append(const MeasArray::const_iterator &begin,
+                const MeasArray::const_iterator &end) override;
+  /// append without lock.
+  Status append_value(const Meas &value);
+  /// late value to side buffer. buffer is merged to chunks, when it is full.
   void append_to_past(const Meas &value);
+  /// merge side buffer to chunks.
   void flush() override;
   Time minTime() override;
   Time maxTime() override;
@@ -39,13 +51,38 @@ struct TimeTrack : public IMeasStorage, public std::enable_shared_from_this<Time
 
   Id2MinMax loadMinMax() override { NOT_IMPLEMENTED; }
 
-  void rm_chunk(MemChunk *c);
+  /// chunks of track are written to disk: merges wait for end_drop.
+  void begin_drop();
+  void end_drop();
+  /// dropped chunk is hidden from readers of 'version' and newer ones.
+  void retire_chunk(MemChunk *c, uint64_t version);
+  /// readers of retired chunk are finished.
+  void rm_retired(MemChunk *c);
+  /// chunks replaced by merge are freed after readers of current version.
+  void free_merged(std::vector<MemChunk_Ptr> &merged);
   void rereadMinMax();
   bool create_new_chunk(const Meas &value);
+  /// chunk from pool, registered in container. nullptr if pool is exhausted.
+  MemChunk_Ptr allocate_chunk(const Meas &first);
+  /// chunk, which receives new values of track.
+  bool is_current(const MemChunk *c);
+  bool has_late_values();
 
   MemChunk_Ptr get_target_to_replace_from_index(const Time t);
+  /// chunk, which must contain value with time 't'. nullptr, if track has no chunks.
+  MemChunk_Ptr get_target_to_replace(const Time t);
+  /// all values of side buffer, by one rewrite of each target chunk.
+  void merge_ooo();
+  /// 'values' sorted by time. replace values of 'target' with equal time.
+  /// values, for which pool has no chunks, return to side buffer.
+  void rewrite_chunk(const MemChunk_Ptr &target, const MeasArray &values);
+  /// readers of chunks and side buffer, seen in 'version'. without lock.
+  Cursor_Ptr cursor(Time from, Time to, uint64_t version);
+  /// retired chunks, which are seen in 'version'.
+  std::vector<MemChunk_Ptr> retired_chunks(uint64_t version);
 
   MemChunkAllocator *_allocator;
+  compression::CODEC _codec; /// of new chunks.
   Id _meas_id;
   MeasMinMax _min_max;
   Time _max_sync_time;
@@ -55,7 +92,15 @@ struct TimeTrack : public IMeasStorage, public std::enable_shared_from_this<Time
   // stx::btree_map<Time, MemChunk_Ptr> _index;
   std::map<Time, MemChunk_Ptr> _index;
   MemoryChunkContainer *_mcc;
-  bool is_locked_to_drop;
+  /// count of drops, which write chunks of track to disk.
+  size_t _dropping;
+  /// dropped chunks and version, since which they are hidden.
+  std::list<std::pair<MemChunk_Ptr, uint64_t>> _retired;
+  /// chunks replaced by merge, while track is locked.
+  std::vector<MemChunk_Ptr> _merged;
+  /// late values, sorted by time. on equal time they replace values of chunks.
+  MeasArray _ooo;
+  size_t _ooo_limit; /// values in side buffer, when it is merged to chunks.
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include <libdariadb/storage/memstorage/trackmap.h>
+
+using namespace dariadb;
+using namespace dariadb::storage;
+
+namespace {
+const size_t MIN_TABLE_SIZE = 16;
+
+size_t table_size_for(size_t tracks) {
+  // at least half of table is empty, so search always stops.
+  size_t result = MIN_TABLE_SIZE;
+  while (result < tracks * 2) {
+    result *= 2;
+  }
+  return result;
+}
+}
+
+TrackMap::Table::Table(size_t size)
+    : mask(size - 1), slots(new std::atomic<TimeTrack *>[size]) {
+  for (size_t i = 0; i < size; ++i) {
+    slots[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+void TrackMap::Table::insert(TimeTrack *track) {
+  auto i = (hash(track->_meas_id) >> SHARD_BITS) & mask;
+  while (slots[i].load(std::memory_order_relaxed) != nullptr) {
+    i = (i + 1) & mask;
+  }
+  slots[i].store(track, std::memory_order_release);
+}
+
+TrackMap::TrackMap(size_t id_count) : _shards(new Shard[SHARD_MASK + 1]) {
+  auto size = table_size_for(id_count / (SHARD_MASK + 1) + 1);
+  for (size_t i = 0; i <= SHARD_MASK; ++i) {
+    reset(_shards[i], size);
+  }
+}
+
+TrackMap::~TrackMap() {}
+
+void TrackMap::reset(Shard &shard, size_t table_size) {
+  shard.tracks.clear();
+  shard.tables.clear();
+  shard.tables.emplace_back(new Table(table_size));
+  shard.table.store(shard.tables.back().get(), std::memory_order_release);
+}
+
+TimeTrack_ptr TrackMap::find_or_insert(Id id,
+                                       const std::function<TimeTrack_ptr()> &create) {
+  auto track = find(id);
+  if (track != nullptr) {
+    return track->shared_from_this();
+  }
+
+  auto &shard = _shards[hash(id) & SHARD_MASK];
+  std::lock_guard<std::mutex> lg(shard.locker);
+  track = find(id);
+  if (track != nullptr) { // was inserted by other writer.
+    return track->shared_from_this();
+  }
+
+  auto result = create();
+  shard.tracks.push_back(result);
+  auto table = shard.table.load(std::memory_order_relaxed);
+  auto size = table_size_for(shard.tracks.size());
+  if (size <= table->mask + 1) {
+    table->insert(result.get());
+    return result;
+  }
+  auto new_table = new Table(size);
+  shard.tables.emplace_back(new_table);
+  for (auto &t : shard.tracks) {
+    new_table->insert(t.get());
+  }
+  shard.table.store(new_table, std::memory_order_release);
+  return result;
+}
+
+void TrackMap::foreach (const std::function<void(const TimeTrack_ptr &)> &clbk) {
+  for (size_t i = 0; i <= SHARD_MASK; ++i) {
+    std::lock_guard<std::mutex> lg(_shards[i].locker);
+    for (auto &t : _shards[i].tracks) {
+      clbk(t);
+    }
+  }
+}
+
+size_t TrackMap::size() {
+  size_t result = 0;
+  for (size_t i = 0; i <= SHARD_MASK; ++i) {
+    std::lock_guard<std::mutex> lg(_shards[i].locker);
+    result += _shards[i].tracks.size();
+  }
+  return result;
+}
+
+void TrackMap::clear() {
+  for (size_t i = 0; i <= SHARD_MASK; ++i) {
+    reset(_shards[i], MIN_TABLE_SIZE);
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <libdariadb/storage/memstorage/timetrack.h>
+#include <libdariadb/utils/utils.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dariadb {
+namespace storage {
+/**
+Map: Meas.id -> TimeTrack.
+ids are spread over shards, shard is open addressing table of atomic pointers,
+so lookup of existing id takes no lock. new tracks are inserted under lock of shard.
+full table is replaced by copy of double size. replaced tables are freed with map,
+because readers may still use them.
+*/
+class TrackMap : public utils::NonCopy {
+public:
+  EXPORT TrackMap(size_t id_count);
+  EXPORT ~TrackMap();
+
+  /// nullptr if not exists. lock free.
+  TimeTrack *find(Id id) const {
+    auto h = hash(id);
+    auto table = _shards[h & SHARD_MASK].table.load(std::memory_order_acquire);
+    for (auto i = (h >> SHARD_BITS) & table->mask;; i = (i + 1) & table->mask) {
+      auto track = table->slots[i].load(std::memory_order_acquire);
+      if (track == nullptr || track->_meas_id == id) {
+        return track;
+      }
+    }
+  }
+
+  /// 'create' is called under lock of shard, if 'id' not exists.
+  EXPORT TimeTrack_ptr find_or_insert(Id id,
+                                      const std::function<TimeTrack_ptr()> &create);
+  /// shard by shard, under lock of shard.
+  EXPORT void foreach (const std::function<void(const TimeTrack_ptr &)> &clbk);
+  EXPORT size_t size();
+  /// not thread safe.
+  EXPORT void clear();
+
+private:
+  static const size_t SHARD_BITS = 6;
+  static const size_t SHARD_MASK = (size_t(1) << SHARD_BITS) - 1;
+
+  struct Table {
+    size_t mask;
+    std::unique_ptr<std::atomic<TimeTrack *>[]> slots;
+    Table(size_t size);
+    /// 'track' must be not exists.
+    void insert(TimeTrack *track);
+  };
+
+  struct alignas(64) Shard {
+    std::atomic<Table *> table;
+    std::mutex locker;
+    std::vector<TimeTrack_ptr> tracks;          /// owners of tracks.
+    std::vector<std::unique_ptr<Table>> tables; /// current and replaced.
+  };
+
+  static size_t hash(Id id) { return size_t((uint64_t(id) * 0x9E3779B97F4A7C15) >> 32); }
+
+  void reset(Shard &shard, size_t table_size);
+
+  std::unique_ptr<Shard[]> _shards;
+};
+}
+}
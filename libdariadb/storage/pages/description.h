@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace dariadb {
+namespace storage {
+namespace pages {
+struct Description {
+  size_t index_cache_hits;   /// pages opened from cache.
+  size_t index_cache_misses; /// pages opened from disk.
+  size_t index_cache_size;   /// cache size in bytes.
+  size_t compactions;        /// finished background compaction jobs.
+  Description() {
+    index_cache_hits = index_cache_misses = index_cache_size = compactions = size_t(0);
+  }
+};
+}
+}
+}
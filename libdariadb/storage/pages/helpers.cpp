@@ -6,11 +6,18 @@
 #include <libdariadb/storage/pages/helpers.h>
 #include <libdariadb/storage/pages/page.h>
 #include <libdariadb/utils/async/thread_manager.h>
+#include <libdariadb/utils/crc.h>
 #include <algorithm>
 
 #include <cstring>
 #include <fstream>
 
+#ifdef UNIX_OS
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace dariadb {
 namespace storage {
 namespace PageInner {
@@ -79,15 +86,17 @@ std::map<Id, MeasArray> splitById(const MeasArray &ma) {
 }
 
 std::list<HdrAndBuffer> compressValues(std::map<Id, MeasArray> &to_compress,
-                                       PageFooter &phdr, uint32_t max_chunk_size) {
+                                       PageFooter &phdr, uint32_t max_chunk_size,
+                                       compression::CODEC codec) {
   using namespace dariadb::utils::async;
   std::list<HdrAndBuffer> results;
   utils::async::Locker result_locker;
   std::list<utils::async::TaskResult_Ptr> async_compressions;
   for (auto &kv : to_compress) {
     auto cur_Id = kv.first;
-    utils::async::AsyncTask at = [cur_Id, &results, &phdr, max_chunk_size, &result_locker,
-                                  &to_compress](const utils::async::ThreadInfo &ti) {
+    utils::async::AsyncTask at = [cur_Id, &results, &phdr, max_chunk_size, codec,
+                                  &result_locker, &to_compress](
+                                     const utils::async::ThreadInfo &ti) {
       using namespace dariadb::utils::async;
       TKIND_CHECK(dariadb::utils::async::THREAD_KINDS::COMMON, ti.kind);
       auto fit = to_compress.find(cur_Id);
@@ -98,7 +107,7 @@ std::list<HdrAndBuffer> compressValues(std::map<Id, MeasArray> &to_compress,
         ChunkHeader hdr;
         boost::shared_array<uint8_t> buffer_ptr{new uint8_t[max_chunk_size]};
         memset(buffer_ptr.get(), 0, max_chunk_size);
-        auto ch = Chunk::create(&hdr, buffer_ptr.get(), max_chunk_size, *it);
+        auto ch = Chunk::create(&hdr, buffer_ptr.get(), max_chunk_size, *it, codec);
         ++it;
         while (it != end) {
           if (!ch->append(*it)) {
@@ -111,10 +120,9 @@ std::list<HdrAndBuffer> compressValues(std::map<Id, MeasArray> &to_compress,
         result_locker.lock();
         phdr.max_chunk_id++;
 
+        // statistic of page is updated, when chunk is written.
         ch->header->id = phdr.max_chunk_id;
 
-        phdr.stat.update(ch->header->stat);
-
         HdrAndBuffer subres;
         subres.hdr = hdr;
         subres.buffer = buffer_ptr;
@@ -133,53 +141,334 @@ std::list<HdrAndBuffer> compressValues(std::map<Id, MeasArray> &to_compress,
   return results;
 }
 
-uint64_t writeToFile(FILE *file, FILE *index_file, PageFooter &phdr, IndexFooter &ihdr,
-                     std::list<HdrAndBuffer> &compressed_results, uint64_t file_size) {
-
-  using namespace dariadb::utils::async;
-  uint64_t page_size = 0;
-
-  uint64_t offset = file_size;
-  std::vector<IndexReccord> ireccords;
-  ireccords.resize(compressed_results.size());
-  size_t pos = 0;
-  for (auto hb : compressed_results) {
-    ChunkHeader chunk_header = hb.hdr;
-    auto chunk_buffer_ptr = hb.buffer;
-
-    phdr.addeded_chunks++;
-    phdr.stat.update(chunk_header.stat);
-    // ihdr.stat.update(chunk_header.stat);
-    auto skip_count = Chunk::compact(&chunk_header);
-    chunk_header.offset_in_page = offset;
-    // update checksum;
-    Chunk::updateChecksum(chunk_header, chunk_buffer_ptr.get() + skip_count);
+uint64_t writeChunk(PageWriter &writer, std::vector<IndexReccord> &ireccords,
+                    PageFooter &phdr, IndexFooter &ihdr, ChunkHeader chunk_header,
+                    uint8_t *chunk_buffer_ptr) {
+  phdr.addeded_chunks++;
+  phdr.stat.update(chunk_header.stat);
+  std::vector<uint8_t> sealed;
+  if (Chunk::seal(&chunk_header, chunk_buffer_ptr, sealed)) {
+    chunk_buffer_ptr = sealed.data();
+  }
+  auto skip_count = Chunk::compact(&chunk_header);
+  // update checksum;
+  Chunk::updateChecksum(chunk_header, chunk_buffer_ptr + skip_count);
 #ifdef DOUBLE_CHECKS
-    {
-      auto ch = Chunk::open(&chunk_header, chunk_buffer_ptr.get() + skip_count);
-      ENSURE(ch->checkChecksum());
-      auto rdr = ch->getReader();
-      while (!rdr->is_end()) {
-        rdr->readNext();
-      }
-      ch->close();
+  {
+    auto ch = Chunk::open(&chunk_header, chunk_buffer_ptr + skip_count);
+    ENSURE(ch->checkChecksum());
+    auto rdr = ch->getReader();
+    while (!rdr->is_end()) {
+      rdr->readNext();
     }
+  }
 #endif
-    std::fwrite(&(chunk_header), sizeof(ChunkHeader), 1, file);
-    std::fwrite(chunk_buffer_ptr.get() + skip_count, sizeof(uint8_t), chunk_header.size,
-                file);
+  writer.write(chunk_header, chunk_buffer_ptr + skip_count);
 
-    offset += sizeof(ChunkHeader) + chunk_header.size;
+  auto index_reccord = init_chunk_index_rec(chunk_header, &ihdr);
+  ireccords.push_back(index_reccord);
+  ihdr.stat = phdr.stat;
+  return writer.size();
+}
 
-    auto index_reccord = init_chunk_index_rec(chunk_header, &ihdr);
-    ireccords[pos] = index_reccord;
-    pos++;
+uint64_t writeToFile(PageWriter &writer, std::vector<IndexReccord> &ireccords,
+                     PageFooter &phdr, IndexFooter &ihdr,
+                     std::list<HdrAndBuffer> &compressed_results) {
+  ireccords.reserve(ireccords.size() + compressed_results.size());
+  for (auto hb : compressed_results) {
+    writeChunk(writer, ireccords, phdr, ihdr, hb.hdr, hb.buffer.get());
   }
-  std::fwrite(ireccords.data(), sizeof(IndexReccord), ireccords.size(), index_file);
-  page_size = offset;
   ihdr.stat = phdr.stat;
   ENSURE(memcmp(&phdr.stat, &ihdr.stat, sizeof(Statistic)) == 0);
-  return page_size;
+  return writer.size();
+}
+
+bool readBlock(const uint8_t *data, size_t size, BlockHeader &hdr,
+               std::vector<uint8_t> &raw) {
+  if (size < sizeof(BlockHeader)) {
+    return false;
+  }
+  memcpy(&hdr, data, sizeof(BlockHeader));
+  if (hdr.magic != BLOCK_MAGIC || size - sizeof(BlockHeader) < hdr.packed_size) {
+    return false;
+  }
+  auto packed = data + sizeof(BlockHeader);
+  if (utils::crc32(packed, hdr.packed_size) != hdr.crc) {
+    return false;
+  }
+  if (hdr.method == (uint8_t)compression::BLOCK_COMPRESSION::NONE) {
+    raw.assign(packed, packed + hdr.packed_size);
+    return raw.size() == hdr.raw_size;
+  }
+  raw.resize(hdr.raw_size);
+  return compression::lz_decompress(packed, hdr.packed_size, raw.data(), raw.size());
+}
+
+PageWriter::PageWriter(FILE *file, uint64_t file_size,
+                       compression::BLOCK_COMPRESSION method)
+    : _file(file), _file_size(file_size), _method(method) {
+  if (_method != compression::BLOCK_COMPRESSION::NONE) {
+    _block.reserve(BLOCK_SIZE * 2);
+  }
+}
+
+void PageWriter::write(ChunkHeader &hdr, const uint8_t *buffer) {
+  if (_method == compression::BLOCK_COMPRESSION::NONE) {
+    hdr.offset_in_page = _file_size;
+    std::fwrite(&hdr, sizeof(ChunkHeader), 1, _file);
+    std::fwrite(buffer, sizeof(uint8_t), hdr.size, _file);
+    _file_size += sizeof(ChunkHeader) + hdr.size;
+    return;
+  }
+  auto in_block = _block.size();
+  // offset in page index must not overlap block offset.
+  if (in_block + sizeof(ChunkHeader) + hdr.size >= (size_t(1) << BLOCK_OFFSET_BITS)) {
+    THROW_EXCEPTION("page: chunk is out of block - ", in_block + hdr.size);
+  }
+  if (_file_size >= (uint64_t(1) << (64 - BLOCK_OFFSET_BITS))) {
+    THROW_EXCEPTION("page: file is too big for blocks - ", _file_size);
+  }
+  hdr.offset_in_page = (_file_size << BLOCK_OFFSET_BITS) | in_block;
+  auto hdr_ptr = reinterpret_cast<const uint8_t *>(&hdr);
+  _block.insert(_block.end(), hdr_ptr, hdr_ptr + sizeof(ChunkHeader));
+  _block.insert(_block.end(), buffer, buffer + hdr.size);
+  if (_block.size() >= BLOCK_SIZE) {
+    flush();
+  }
+}
+
+void PageWriter::flush() {
+  if (_block.empty()) {
+    return;
+  }
+  std::vector<uint8_t> packed(compression::lz_bound(_block.size()));
+  auto packed_size = compression::lz_compress(_block.data(), _block.size(),
+                                              packed.data(), packed.size(), _method);
+  BlockHeader bhdr;
+  bhdr.magic = BLOCK_MAGIC;
+  bhdr.method = (uint8_t)_method;
+  bhdr.raw_size = static_cast<uint32_t>(_block.size());
+  const uint8_t *data = packed.data();
+  if (packed_size == 0 || packed_size >= _block.size()) {
+    bhdr.method = (uint8_t)compression::BLOCK_COMPRESSION::NONE;
+    data = _block.data();
+    packed_size = _block.size();
+  }
+  bhdr.packed_size = static_cast<uint32_t>(packed_size);
+  bhdr.crc = utils::crc32(data, packed_size);
+  std::fwrite(&bhdr, sizeof(BlockHeader), 1, _file);
+  std::fwrite(data, sizeof(uint8_t), packed_size, _file);
+  _file_size += sizeof(BlockHeader) + packed_size;
+  _block.clear();
+}
+
+PageReader::PageReader(const std::string &filename, bool is_blocks)
+    : _filename(filename), _is_blocks(is_blocks), _block_offset(0), _fd(-1),
+      _fd_size(0), _planned_pos(0) {}
+
+PageReader::~PageReader() {
+#ifdef UNIX_OS
+  if (_fd >= 0) {
+    close(_fd);
+  }
+#endif
+}
+
+void PageReader::map() {
+  // file is mapped only on first reading.
+  if (_file == nullptr) {
+    _file = utils::fs::MappedFile::open(_filename);
+  }
+}
+
+void PageReader::prefetch(const ChunkLinkList &links) {
+#ifdef UNIX_OS
+  auto tm = utils::async::ThreadManager::instance();
+  if (tm == nullptr || tm->aio() == nullptr || links.size() < 2) {
+    return;
+  }
+  _planned.clear();
+  _planned_index.clear();
+  _planned_pos = 0;
+  for (auto &l : links) {
+    auto offset = _is_blocks ? l.offset >> BLOCK_OFFSET_BITS : l.offset;
+    // chunks of one block are read one after another.
+    if (_planned.empty() || _planned.back() != offset) {
+      _planned_index.emplace(offset, _planned.size());
+      _planned.push_back(offset);
+    }
+  }
+#else
+  (void)(links);
+#endif
+}
+
+void PageReader::fetch(uint64_t offset) {
+#ifdef UNIX_OS
+  using namespace utils::async;
+  // first position of offset, which is not fetched yet.
+  auto pos = _planned.size();
+  auto range = _planned_index.equal_range(offset);
+  for (auto i = range.first; i != range.second; ++i) {
+    if (i->second >= _planned_pos && i->second < pos) {
+      pos = i->second;
+    }
+  }
+  if (pos == _planned.size()) {
+    return;
+  }
+  auto it = _planned.begin() + pos;
+  auto tm = ThreadManager::instance();
+  auto aio = tm == nullptr ? nullptr : tm->aio();
+  if (aio == nullptr) {
+    return;
+  }
+  if (_fd < 0) {
+    _fd = ::open(_filename.c_str(), O_RDONLY);
+    if (_fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(_fd, &st) != 0) {
+      close(_fd);
+      _fd = -1;
+      return;
+    }
+    _fd_size = uint64_t(st.st_size);
+  }
+  auto window =
+      std::min(size_t(_planned.end() - it), std::max(tm->aio_queue_depth(), size_t(1)));
+  std::vector<uint64_t> offsets(it, it + window);
+  _planned_pos = size_t(it - _planned.begin()) + window;
+  std::sort(offsets.begin(), offsets.end());
+  offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+  // first batch - headers, second - chunks or blocks with headers.
+  const size_t hdr_size = _is_blocks ? sizeof(BlockHeader) : sizeof(ChunkHeader);
+  std::vector<uint8_t> headers(offsets.size() * hdr_size);
+  std::vector<IORequest> requests(offsets.size());
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    requests[i] = IORequest{_fd, false, offsets[i], headers.data() + i * hdr_size,
+                            hdr_size, 0};
+  }
+  aio->submit(requests)->wait();
+
+  std::vector<std::shared_ptr<std::vector<uint8_t>>> buffers;
+  std::vector<IORequest> bodies;
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    if (requests[i].result != int64_t(hdr_size)) {
+      continue;
+    }
+    auto hdr = headers.data() + i * hdr_size;
+    size_t body_size = 0;
+    if (_is_blocks) {
+      BlockHeader bhdr;
+      memcpy(&bhdr, hdr, hdr_size);
+      body_size = bhdr.magic == BLOCK_MAGIC ? bhdr.packed_size : 0;
+    } else {
+      ChunkHeader chdr;
+      memcpy(&chdr, hdr, hdr_size);
+      body_size = chdr.size;
+    }
+    // broken header: chunk is read from mapping, where it is checked.
+    if (offsets[i] + hdr_size + body_size > _fd_size) {
+      continue;
+    }
+    auto buffer = std::make_shared<std::vector<uint8_t>>(hdr_size + body_size);
+    memcpy(buffer->data(), hdr, hdr_size);
+    bodies.push_back(IORequest{_fd, false, offsets[i] + hdr_size,
+                               buffer->data() + hdr_size, body_size, 0});
+    buffers.push_back(buffer);
+  }
+  aio->submit(bodies)->wait();
+
+  for (size_t i = 0; i < bodies.size(); ++i) {
+    if (bodies[i].result != int64_t(bodies[i].size)) {
+      continue;
+    }
+    auto readed_offset = bodies[i].offset - hdr_size;
+    if (!_is_blocks) {
+      _prefetched[readed_offset] = buffers[i];
+      continue;
+    }
+    BlockHeader bhdr;
+    auto block = std::make_shared<std::vector<uint8_t>>();
+    if (readBlock(buffers[i]->data(), buffers[i]->size(), bhdr, *block)) {
+      _prefetched[readed_offset] = block;
+    }
+  }
+#else
+  (void)(offset);
+#endif
+}
+
+void PageReader::loadBlock(uint64_t block_offset) {
+  auto fres = _prefetched.find(block_offset);
+  if (fres == _prefetched.end()) {
+    fetch(block_offset);
+    fres = _prefetched.find(block_offset);
+  }
+  if (fres != _prefetched.end()) {
+    _block = fres->second;
+    _block_offset = block_offset;
+    _prefetched.erase(fres);
+    return;
+  }
+  map();
+  BlockHeader bhdr;
+  auto block = std::make_shared<std::vector<uint8_t>>();
+  if (block_offset >= _file->size() ||
+      !readBlock(_file->data() + block_offset, _file->size() - block_offset, bhdr,
+                 *block)) {
+    THROW_EXCEPTION("engine: page block read error - ", _filename);
+  }
+  // chunks of previous block keep it, while they are used.
+  _block = block;
+  _block_offset = block_offset;
+}
+
+Chunk_Ptr PageReader::open(const std::shared_ptr<void> &holder, const uint8_t *data,
+                           size_t size, uint64_t offset) {
+  if (offset + sizeof(ChunkHeader) > size) {
+    THROW_EXCEPTION("engine: page read error - ", _filename);
+  }
+  // mapping is read only, chunks of page are never changed.
+  auto cheader = reinterpret_cast<ChunkHeader *>(const_cast<uint8_t *>(data + offset));
+  auto buffer = const_cast<uint8_t *>(data + offset + sizeof(ChunkHeader));
+  if (offset + sizeof(ChunkHeader) + cheader->size > size) {
+    THROW_EXCEPTION("engine: page read error - ", _filename);
+  }
+  Chunk_Ptr ptr = Chunk::open(cheader, buffer);
+  ptr->holder = holder;
+  if (!ptr->checkChecksum()) {
+    logger_fatal("engine: bad checksum of chunk #", ptr->header->id,
+                 " for measurement id:", ptr->header->meas_id);
+    return nullptr;
+  }
+  return ptr;
+}
+
+Chunk_Ptr PageReader::read(uint64_t offset) {
+  if (!_is_blocks) {
+    auto fres = _prefetched.find(offset);
+    if (fres == _prefetched.end()) {
+      fetch(offset);
+      fres = _prefetched.find(offset);
+    }
+    if (fres != _prefetched.end()) {
+      auto chunk = fres->second;
+      _prefetched.erase(fres);
+      return open(chunk, chunk->data(), chunk->size(), 0);
+    }
+    map();
+    return open(_file, _file->data(), _file->size(), offset);
+  }
+  auto block_offset = offset >> BLOCK_OFFSET_BITS;
+  auto in_block = offset & ((uint64_t(1) << BLOCK_OFFSET_BITS) - 1);
+  if (_block == nullptr || _block_offset != block_offset) {
+    loadBlock(block_offset);
+  }
+  return open(_block, _block->data(), _block->size(), in_block);
 }
 
 IndexReccord init_chunk_index_rec(const ChunkHeader &cheader, IndexFooter *iheader) {
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <libdariadb/compression/lz.h>
 #include <libdariadb/storage/chunk.h>
 #include <libdariadb/storage/pages/index.h>
 #include <libdariadb/storage/pages/page.h>
+#include <libdariadb/utils/fs.h>
 #include <fstream>
 #include <map>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/shared_array.hpp>
@@ -13,6 +16,83 @@
 namespace dariadb {
 namespace storage {
 namespace PageInner {
+#pragma pack(push, 1)
+/// group of chunks in page with block compression.
+struct BlockHeader {
+  uint32_t magic;
+  uint8_t method; // compression::BLOCK_COMPRESSION. NONE - block is stored as is.
+  uint32_t raw_size;
+  uint32_t packed_size;
+  uint32_t crc; // checksum of packed bytes.
+};
+#pragma pack(pop)
+
+const uint32_t BLOCK_MAGIC = 0xDAB10C5E;
+/// chunks are added to block while it is smaller.
+const size_t BLOCK_SIZE = 64 * 1024;
+/// offset of chunk in page with blocks: (block offset << BLOCK_OFFSET_BITS) | offset in
+/// unpacked block.
+const int BLOCK_OFFSET_BITS = 24;
+
+/// read block from begin of 'data'. false if block is broken.
+bool readBlock(const uint8_t *data, size_t size, BlockHeader &hdr,
+               std::vector<uint8_t> &raw);
+
+/// writes chunks to page file one by one or grouped to compressed blocks.
+class PageWriter {
+public:
+  PageWriter(FILE *file, uint64_t file_size, compression::BLOCK_COMPRESSION method);
+  /// set hdr.offset_in_page and write chunk.
+  void write(ChunkHeader &hdr, const uint8_t *buffer);
+  /// write not full block.
+  void flush();
+  /// bytes written to file.
+  uint64_t size() const { return _file_size; }
+
+private:
+  FILE *_file;
+  uint64_t _file_size;
+  compression::BLOCK_COMPRESSION _method;
+  std::vector<uint8_t> _block;
+};
+
+/// reads chunks by offset from index. chunks are not copied: they point to mapped page
+/// file or to last unpacked block and keep it alive.
+class PageReader {
+public:
+  PageReader(const std::string &filename, bool is_blocks);
+  ~PageReader();
+  /// chunks (or blocks) of 'links' will be read in this order. they are read by
+  /// batches of aio (not bigger than queue depth), if it is enabled.
+  /// chunks, which were not read, are read from mapping.
+  void prefetch(const ChunkLinkList &links);
+  /// nullptr if checksum of chunk is bad.
+  Chunk_Ptr read(uint64_t offset);
+
+private:
+  void map();
+  void loadBlock(uint64_t block_offset);
+  /// read next batch of planned offsets, if 'offset' is planned.
+  void fetch(uint64_t offset);
+  Chunk_Ptr open(const std::shared_ptr<void> &holder, const uint8_t *data, size_t size,
+                 uint64_t offset);
+
+  std::string _filename;
+  utils::fs::MappedFile_Ptr _file;
+  bool _is_blocks;
+  uint64_t _block_offset;
+  std::shared_ptr<std::vector<uint8_t>> _block;
+  int _fd; /// used by aio.
+  uint64_t _fd_size;
+  /// chunk (with header) or unpacked block by offset.
+  std::unordered_map<uint64_t, std::shared_ptr<std::vector<uint8_t>>> _prefetched;
+  /// offsets of chunks (or blocks) in reading order.
+  std::vector<uint64_t> _planned;
+  /// positions of offset in _planned.
+  std::unordered_multimap<uint64_t, size_t> _planned_index;
+  size_t _planned_pos;
+};
+
 struct HdrAndBuffer {
   dariadb::storage::ChunkHeader hdr;
   boost::shared_array<uint8_t> buffer;
@@ -21,10 +101,18 @@ struct HdrAndBuffer {
 std::map<Id, MeasArray> splitById(const MeasArray &ma);
 
 std::list<HdrAndBuffer> compressValues(std::map<Id, MeasArray> &to_compress,
-                                       PageFooter &phdr, uint32_t max_chunk_size);
+                                       PageFooter &phdr, uint32_t max_chunk_size,
+                                       compression::CODEC codec);
+
+/// write chunk to page file. header and buffer are not changed. return page size.
+uint64_t writeChunk(PageWriter &writer, std::vector<IndexReccord> &ireccords,
+                    PageFooter &phdr, IndexFooter &ihdr, ChunkHeader chunk_header,
+                    uint8_t *chunk_buffer_ptr);
 
-uint64_t writeToFile(FILE *file, FILE *index_file, PageFooter &phdr, IndexFooter &,
-                     std::list<HdrAndBuffer> &compressed_results, uint64_t file_size = 0);
+/// write chunks to page file. index reccords of chunks are added to 'ireccords'.
+uint64_t writeToFile(PageWriter &writer, std::vector<IndexReccord> &ireccords,
+                     PageFooter &phdr, IndexFooter &,
+                     std::list<HdrAndBuffer> &compressed_results);
 
 IndexReccord init_chunk_index_rec(const ChunkHeader &cheader, IndexFooter *iheader);
 
@@ -32,29 +32,114 @@ inline bool check_blooms(const IndexReccord &_index_it, dariadb::Id id,
 
 PageIndex::~PageIndex() {}
 
+inline ChunkLink make_link(const IndexReccord &_index_it, uint64_t pos) {
+  ChunkLink sub_result;
+  sub_result.id = _index_it.chunk_id;
+  sub_result.index_rec_number = pos;
+  sub_result.offset = _index_it.offset;
+  sub_result.minTime = _index_it.stat.minTime;
+  sub_result.maxTime = _index_it.stat.maxTime;
+  sub_result.meas_id = _index_it.meas_id;
+  sub_result.stat = _index_it.stat;
+  return sub_result;
+}
+
 PageIndex_ptr PageIndex::open(const std::string &_filename) {
   PageIndex_ptr res = std::make_shared<PageIndex>();
   res->filename = _filename;
   res->iheader = readIndexFooter(_filename);
+  if (res->iheader.is_sorted) {
+    res->readDirectory();
+  }
   return res;
 }
 
-ChunkLinkList PageIndex::get_chunks_links(const dariadb::IdArray &ids, dariadb::Time from,
-                                          dariadb::Time to, dariadb::Flag flag) {
-  ChunkLinkList result;
-  IndexReccord *records = new IndexReccord[this->iheader.recs_count];
+void PageIndex::readDirectory() {
+  _directory.resize(iheader.ids_count);
+  if (_directory.empty()) {
+    return;
+  }
   auto index_file = std::fopen(filename.c_str(), "rb");
   if (index_file == nullptr) {
-    delete[] records;
     THROW_EXCEPTION("can`t open file ", this->filename);
   }
+  std::fseek(index_file, iheader.recs_count * sizeof(IndexReccord), SEEK_SET);
+  auto readed = std::fread(_directory.data(), sizeof(IndexDirectoryReccord),
+                           _directory.size(), index_file);
+  std::fclose(index_file);
+  if (readed < _directory.size()) {
+    THROW_EXCEPTION("engine: index directory read error - ", this->filename);
+  }
+}
 
-  auto readed = std::fread(records, sizeof(IndexReccord), iheader.recs_count, index_file);
-  if (readed < iheader.recs_count) {
-    delete[] records;
-    THROW_EXCEPTION("engine: index read error - ", this->filename);
+ChunkLinkList PageIndex::get_chunks_links(const dariadb::IdArray &ids, dariadb::Time from,
+                                          dariadb::Time to, dariadb::Flag flag) {
+  if (!iheader.is_sorted || ids.empty()) {
+    return get_chunks_links_by_scan(ids, from, to, flag);
+  }
+
+  ChunkLinkList result;
+  dariadb::IdSet unique_ids{ids.begin(), ids.end()};
+  std::vector<IndexReccord> readed_reccords;
+  FILE *index_file = nullptr;
+  for (auto id : unique_ids) {
+    auto dir_it = std::lower_bound(
+        _directory.begin(), _directory.end(), id,
+        [](const IndexDirectoryReccord &dr, Id v) { return dr.meas_id < v; });
+    if (dir_it == _directory.end() || dir_it->meas_id != id) {
+      continue;
+    }
+
+    const IndexReccord *records = nullptr;
+    if (_reccords != nullptr) {
+      records = _reccords->data() + dir_it->first;
+    } else {
+      if (index_file == nullptr) {
+        index_file = std::fopen(filename.c_str(), "rb");
+        if (index_file == nullptr) {
+          THROW_EXCEPTION("can`t open file ", this->filename);
+        }
+      }
+      readed_reccords.resize(dir_it->count);
+      std::fseek(index_file, dir_it->first * sizeof(IndexReccord), SEEK_SET);
+      auto readed = std::fread(readed_reccords.data(), sizeof(IndexReccord),
+                               readed_reccords.size(), index_file);
+      if (readed < readed_reccords.size()) {
+        std::fclose(index_file);
+        THROW_EXCEPTION("engine: index read error - ", this->filename);
+      }
+      records = readed_reccords.data();
+    }
+
+    // reccords of id are sorted by minTime.
+    for (uint64_t i = 0; i < dir_it->count; ++i) {
+      auto _index_it = records[i];
+      if (_index_it.stat.minTime > to) {
+        break;
+      }
+      if (check_index_rec(_index_it, from, to) && check_blooms(_index_it, id, flag)) {
+        result.push_back(make_link(_index_it, dir_it->first + i));
+      }
+    }
+  }
+  if (index_file != nullptr) {
+    std::fclose(index_file);
+  }
+  return result;
+}
+
+ChunkLinkList PageIndex::get_chunks_links_by_scan(const dariadb::IdArray &ids,
+                                                  dariadb::Time from, dariadb::Time to,
+                                                  dariadb::Flag flag) {
+  ChunkLinkList result;
+  std::vector<IndexReccord> readed_reccords;
+  const IndexReccord *records = nullptr;
+  if (_reccords != nullptr) {
+    records = _reccords->data();
+  } else {
+    readed_reccords = readReccords();
+    records = readed_reccords.data();
   }
-  std::fclose(index_file);
   for (uint32_t pos = 0; pos < this->iheader.recs_count; ++pos) {
 
     auto _index_it = records[pos];
@@ -71,22 +156,18 @@ ChunkLinkList PageIndex::get_chunks_links(const dariadb::IdArray &ids, dariadb::
         }
       }
       if (bloom_result) {
-        ChunkLink sub_result;
-        sub_result.id = _index_it.chunk_id;
-        sub_result.index_rec_number = pos;
-        sub_result.minTime = _index_it.stat.minTime;
-        sub_result.maxTime = _index_it.stat.maxTime;
-        sub_result.meas_id = _index_it.meas_id;
-        result.push_back(sub_result);
+        result.push_back(make_link(_index_it, pos));
       }
     }
   }
-  delete[] records;
 
   return result;
 }
 
 std::vector<IndexReccord> PageIndex::readReccords() {
+  if (_reccords != nullptr) {
+    return *_reccords;
+  }
   std::vector<IndexReccord> records;
   records.resize(iheader.recs_count);
 
@@ -103,6 +184,25 @@ std::vector<IndexReccord> PageIndex::readReccords() {
   return records;
 }
 
+void PageIndex::loadReccords() {
+  if (_reccords == nullptr) {
+    _reccords = std::make_shared<std::vector<IndexReccord>>(readReccords());
+  }
+}
+
+std::vector<Id> PageIndex::ids() const {
+  std::vector<Id> result(_directory.size());
+  std::transform(_directory.begin(), _directory.end(), result.begin(),
+                 [](const IndexDirectoryReccord &dr) { return Id(dr.meas_id); });
+  return result;
+}
+
+size_t PageIndex::memory_size() const {
+  return sizeof(PageIndex) + filename.size() +
+         _directory.size() * sizeof(IndexDirectoryReccord) +
+         (_reccords == nullptr ? 0 : _reccords->size() * sizeof(IndexReccord));
+}
+
 IndexFooter PageIndex::readIndexFooter(std::string ifile) {
   std::ifstream istream;
   istream.open(ifile, std::fstream::in | std::fstream::binary);
@@ -116,3 +216,60 @@ IndexFooter PageIndex::readIndexFooter(std::string ifile) {
   istream.close();
   return result;
 }
+
+BloomFilter PageIndex::readIdBloom(const std::string &ifile, const IndexFooter &footer) {
+  if (footer.id_bloom_words == 0) {
+    return BloomFilter();
+  }
+  auto index_file = std::fopen(ifile.c_str(), "rb");
+  if (index_file == nullptr) {
+    THROW_EXCEPTION("can`t open file ", ifile);
+  }
+  std::vector<uint64_t> bits(footer.id_bloom_words);
+  std::fseek(index_file,
+             footer.recs_count * sizeof(IndexReccord) +
+                 footer.ids_count * sizeof(IndexDirectoryReccord),
+             SEEK_SET);
+  auto readed = std::fread(bits.data(), sizeof(uint64_t), bits.size(), index_file);
+  std::fclose(index_file);
+  if (readed < bits.size()) {
+    THROW_EXCEPTION("engine: index bloom read error - ", ifile);
+  }
+  return BloomFilter(bits, footer.id_bloom_hashes);
+}
+
+void PageIndex::writeIndexFile(FILE *index_file, IndexFooter &ihdr,
+                               std::vector<IndexReccord> &reccords) {
+  std::stable_sort(reccords.begin(), reccords.end(),
+                   [](const IndexReccord &l, const IndexReccord &r) {
+                     return l.meas_id < r.meas_id ||
+                            (l.meas_id == r.meas_id && l.stat.minTime < r.stat.minTime);
+                   });
+  std::vector<IndexDirectoryReccord> directory;
+  for (size_t i = 0; i < reccords.size(); ++i) {
+    if (directory.empty() || directory.back().meas_id != reccords[i].meas_id) {
+      IndexDirectoryReccord dr;
+      dr.meas_id = reccords[i].meas_id;
+      dr.first = i;
+      directory.push_back(dr);
+    }
+    directory.back().count++;
+  }
+
+  BloomFilter id_bloom(directory.size());
+  for (auto &dr : directory) {
+    id_bloom.add(dr.meas_id);
+  }
+
+  ihdr.is_sorted = true;
+  ihdr.recs_count = reccords.size();
+  ihdr.ids_count = directory.size();
+  ihdr.id_bloom_words = static_cast<uint32_t>(id_bloom.bits().size());
+  ihdr.id_bloom_hashes = id_bloom.hashes();
+  std::fwrite(reccords.data(), sizeof(IndexReccord), reccords.size(), index_file);
+  std::fwrite(directory.data(), sizeof(IndexDirectoryReccord), directory.size(),
+              index_file);
+  std::fwrite(id_bloom.bits().data(), sizeof(uint64_t), id_bloom.bits().size(),
+              index_file);
+  std::fwrite(&ihdr, sizeof(IndexFooter), 1, index_file);
+}
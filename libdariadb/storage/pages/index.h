@@ -8,16 +8,25 @@ namespace dariadb {
 namespace storage {
 #pragma pack(push, 1)
 struct IndexFooter {
-  bool is_sorted;    // items in index file sorted by time
+  bool is_sorted;    // items in index file sorted by (meas_id, minTime)
   uint64_t id_bloom; // bloom filter of Meas.id
 
   Statistic stat;
   uint64_t recs_count;
+  uint64_t ids_count; // count of reccords in id directory.
+  uint32_t id_bloom_words; // size of BloomFilter of ids after directory.
+  uint8_t id_bloom_hashes;
+  // compression::BLOCK_COMPRESSION of page. NONE - chunks are not grouped to blocks.
+  uint8_t block_compression;
 
   uint16_t level;
   IndexFooter() : stat() {
     level = 0;
     recs_count = 0;
+    ids_count = 0;
+    id_bloom_words = 0;
+    id_bloom_hashes = 0;
+    block_compression = 0;
     is_sorted = false;
     id_bloom = bloom_empty<Id>();
   }
@@ -34,6 +43,17 @@ struct IndexReccord {
     offset = 0;
   }
 };
+/// range of reccords of one id in sorted index.
+struct IndexDirectoryReccord {
+  uint64_t meas_id;
+  uint64_t first; // number of first reccord of id.
+  uint64_t count;
+  IndexDirectoryReccord() {
+    meas_id = 0;
+    first = 0;
+    count = 0;
+  }
+};
 #pragma pack(pop)
 
 class PageIndex;
@@ -50,11 +70,31 @@ public:
   ChunkLinkList get_chunks_links(const dariadb::IdArray &ids, dariadb::Time from,
                                  dariadb::Time to, dariadb::Flag flag);
   std::vector<IndexReccord> readReccords();
+  /// keep reccords in memory. used by IndexCache.
+  void loadReccords();
+  /// size of loaded reccords in bytes.
+  size_t memory_size() const;
+  /// ids from id directory.
+  std::vector<Id> ids() const;
   static IndexFooter readIndexFooter(std::string ifile);
+  static BloomFilter readIdBloom(const std::string &ifile, const IndexFooter &footer);
+  /// sort reccords and write them with id directory, id bloom and footer.
+  static void writeIndexFile(FILE *index_file, IndexFooter &ihdr,
+                             std::vector<IndexReccord> &reccords);
 
   static std::string index_name_from_page_name(const std::string &page_name) {
     return page_name + "i";
   }
+
+protected:
+  void readDirectory();
+  ChunkLinkList get_chunks_links_by_scan(const dariadb::IdArray &ids,
+                                         dariadb::Time from, dariadb::Time to,
+                                         dariadb::Flag flag);
+
+protected:
+  std::shared_ptr<std::vector<IndexReccord>> _reccords;
+  std::vector<IndexDirectoryReccord> _directory;
 };
 }
 }
@@ -0,0 +1,79 @@
+#include <libdariadb/storage/pages/index_cache.h>
+
+using namespace dariadb;
+using namespace dariadb::storage;
+
+IndexCache::IndexCache(size_t max_size) : _max_size(max_size) {
+  _size = _hits = _misses = size_t(0);
+}
+
+IndexCache::~IndexCache() {}
+
+Page_Ptr IndexCache::open(const std::string &page_file_name) {
+  {
+    std::lock_guard<std::mutex> lg(_locker);
+    auto it = _name2item.find(page_file_name);
+    if (it != _name2item.end()) {
+      ++_hits;
+      _items.splice(_items.begin(), _items, it->second);
+      return Page::open(page_file_name, it->second->footer, it->second->index);
+    }
+    ++_misses;
+  }
+
+  CacheItem item;
+  item.page_file_name = page_file_name;
+  item.footer = Page::readFooter(page_file_name);
+  item.index = PageIndex::open(PageIndex::index_name_from_page_name(page_file_name));
+  item.index->loadReccords();
+  item.size = sizeof(CacheItem) + page_file_name.size() + item.index->memory_size();
+  if (item.size <= _max_size) {
+    insert(item);
+  }
+  return Page::open(page_file_name, item.footer, item.index);
+}
+
+void IndexCache::insert(const CacheItem &item) {
+  std::lock_guard<std::mutex> lg(_locker);
+  auto it = _name2item.find(item.page_file_name);
+  if (it != _name2item.end()) { // was loaded by other thread.
+    return;
+  }
+
+  while (!_items.empty() && _size + item.size > _max_size) {
+    erase_item(std::prev(_items.end()));
+  }
+  _items.push_front(item);
+  _name2item[item.page_file_name] = _items.begin();
+  _size += item.size;
+}
+
+void IndexCache::erase(const std::string &page_file_name) {
+  std::lock_guard<std::mutex> lg(_locker);
+  auto it = _name2item.find(page_file_name);
+  if (it != _name2item.end()) {
+    erase_item(it->second);
+  }
+}
+
+void IndexCache::erase_item(Items::iterator it) {
+  _size -= it->size;
+  _name2item.erase(it->page_file_name);
+  _items.erase(it);
+}
+
+void IndexCache::clear() {
+  std::lock_guard<std::mutex> lg(_locker);
+  _items.clear();
+  _name2item.clear();
+  _size = size_t(0);
+}
+
+pages::Description IndexCache::description() const {
+  std::lock_guard<std::mutex> lg(_locker);
+  pages::Description result;
+  result.index_cache_hits = _hits;
+  result.index_cache_misses = _misses;
+  result.index_cache_size = _size;
+  return result;
+}
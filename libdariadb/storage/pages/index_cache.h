@@ -0,0 +1,57 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <libdariadb/storage/pages/description.h>
+#include <libdariadb/storage/pages/page.h>
+#include <libdariadb/utils/utils.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace dariadb {
+namespace storage {
+
+class IndexCache;
+typedef std::shared_ptr<IndexCache> IndexCache_Ptr;
+/**
+LRU cache of page footers and loaded page indexes.
+size of cache is limited by bytes. pages are immutable, so entry must be
+removed only when page is erased.
+*/
+class IndexCache : public utils::NonCopy {
+public:
+  EXPORT IndexCache(size_t max_size);
+  EXPORT ~IndexCache();
+  /// open page with cached footer and index. load them on cache miss.
+  EXPORT Page_Ptr open(const std::string &page_file_name);
+  EXPORT void erase(const std::string &page_file_name);
+  EXPORT void clear();
+  EXPORT pages::Description description() const;
+
+protected:
+  struct CacheItem {
+    std::string page_file_name;
+    PageFooter footer;
+    PageIndex_ptr index;
+    size_t size;
+    CacheItem() : footer(MIN_LEVEL, 0) {}
+  };
+  using Items = std::list<CacheItem>;
+
+  void insert(const CacheItem &item);
+  void erase_item(Items::iterator it);
+
+protected:
+  size_t _max_size;
+  size_t _size;
+  size_t _hits;
+  size_t _misses;
+  /// most recently used items at front.
+  Items _items;
+  std::unordered_map<std::string, Items::iterator> _name2item;
+  mutable std::mutex _locker;
+};
+}
+}
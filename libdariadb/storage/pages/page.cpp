@@ -27,13 +27,14 @@ Page::~Page() {
 }
 
 Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk_id,
-                      uint32_t max_chunk_size, const MeasArray &ma) {
+                      uint32_t max_chunk_size, const MeasArray &ma,
+                      compression::CODEC codec, compression::BLOCK_COMPRESSION blocks) {
   auto to_compress = PageInner::splitById(ma);
 
   PageFooter phdr(lvl, chunk_id);
 
   std::list<PageInner::HdrAndBuffer> compressed_results =
-      PageInner::compressValues(to_compress, phdr, max_chunk_size);
+      PageInner::compressValues(to_compress, phdr, max_chunk_size, codec);
   auto file = std::fopen(file_name.c_str(), "ab");
   if (file == nullptr) {
     THROW_EXCEPTION("file is null");
@@ -47,22 +48,27 @@ Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk
     THROW_EXCEPTION("can`t open file ", file_name);
   }
 
-  auto page_size =
-      PageInner::writeToFile(file, index_file, phdr, ihdr, compressed_results);
-  phdr.filesize = page_size;
+  std::vector<IndexReccord> ireccords;
+  PageInner::PageWriter writer(file, 0, blocks);
+  PageInner::writeToFile(writer, ireccords, phdr, ihdr, compressed_results);
+  writer.flush();
+  phdr.filesize = writer.size();
   ihdr.level = phdr.level;
+  ihdr.block_compression = (uint8_t)blocks;
   ENSURE(memcmp(&phdr.stat, &ihdr.stat, sizeof(Statistic)) == 0);
   std::fwrite((char *)&phdr, sizeof(PageFooter), 1, file);
   std::fclose(file);
 
-  std::fwrite(&ihdr, sizeof(IndexFooter), 1, index_file);
+  PageIndex::writeIndexFile(index_file, ihdr, ireccords);
   std::fclose(index_file);
   return open(file_name, phdr);
 }
 
 Page_Ptr Page::repackTo(const std::string &file_name, uint16_t lvl, uint64_t chunk_id,
                         uint32_t max_chunk_size,
-                        const std::list<std::string> &pages_full_paths) {
+                        const std::list<std::string> &pages_full_paths,
+                        utils::async::RateLimiter *limiter, compression::CODEC codec,
+                        compression::BLOCK_COMPRESSION blocks) {
   std::unordered_map<std::string, Page_Ptr> openned_pages;
   openned_pages.reserve(pages_full_paths.size());
 
@@ -98,6 +104,8 @@ Page_Ptr Page::repackTo(const std::string &file_name, uint16_t lvl, uint64_t chu
     THROW_EXCEPTION("can`t open file ", file_name);
   }
 
+  std::vector<IndexReccord> ireccords;
+  PageInner::PageWriter writer(out_file, 0, blocks);
   for (auto &kv : links) {
     auto lst = kv.second;
     std::vector<ChunkLink> link_vec(lst.begin(), lst.end());
@@ -112,26 +120,21 @@ Page_Ptr Page::repackTo(const std::string &file_name, uint16_t lvl, uint64_t chu
       }
       for (auto f2l : fname2links) {
         auto p = openned_pages[f2l.first];
-        auto chunk_callback = [&phdr, &ihdr, &out_index_file,
-                               &out_file](const Chunk_Ptr &chunk) {
-          // chunk->close();
-          chunk->is_owner = false;
+        auto chunk_callback = [&phdr, &ihdr, &ireccords, &writer,
+                               limiter](const Chunk_Ptr &chunk) {
           if (!chunk->checkChecksum()) {
             THROW_EXCEPTION("checksum error");
           }
-          auto hdr_ptr = chunk->header;
-          PageInner::HdrAndBuffer hab;
-          hab.buffer = boost::shared_array<uint8_t>(chunk->_buffer_t);
-          hab.hdr = *(hdr_ptr);
+          // chunk is written from mapped page as is, only id is changed.
+          ChunkHeader hdr = *chunk->header;
           phdr.max_chunk_id++;
-          hab.hdr.id = phdr.max_chunk_id;
-
-          std::list<PageInner::HdrAndBuffer> compressed_results{hab};
-          auto page_size = PageInner::writeToFile(out_file, out_index_file, phdr, ihdr,
-                                                  compressed_results, phdr.filesize);
-
+          hdr.id = phdr.max_chunk_id;
+          auto page_size = PageInner::writeChunk(writer, ireccords, phdr, ihdr, hdr,
+                                                 chunk->_buffer_t);
+          if (limiter != nullptr) {
+            limiter->consume(page_size - phdr.filesize);
+          }
           phdr.filesize = page_size;
-          delete hdr_ptr;
           return false;
         };
         p->apply_to_chunks(f2l.second, chunk_callback);
@@ -160,21 +163,30 @@ Page_Ptr Page::repackTo(const std::string &file_name, uint16_t lvl, uint64_t chu
       all_values[sorted_and_filtered.front().id] = sorted_and_filtered;
 
       auto compressed_results =
-          PageInner::compressValues(all_values, phdr, max_chunk_size);
+          PageInner::compressValues(all_values, phdr, max_chunk_size, codec);
 
-      auto page_size = PageInner::writeToFile(out_file, out_index_file, phdr, ihdr,
-                                              compressed_results, phdr.filesize);
+      auto page_size =
+          PageInner::writeToFile(writer, ireccords, phdr, ihdr, compressed_results);
+      if (limiter != nullptr) {
+        limiter->consume(page_size - phdr.filesize);
+      }
       phdr.filesize = page_size;
     }
   }
 
   ENSURE(memcmp(&phdr.stat, &ihdr.stat, sizeof(Statistic)) == 0);
 
+  writer.flush();
+  if (limiter != nullptr) {
+    limiter->consume(writer.size() - phdr.filesize);
+  }
+  phdr.filesize = writer.size();
   std::fwrite((char *)&phdr, sizeof(PageFooter), 1, out_file);
   std::fclose(out_file);
   ihdr.level = phdr.level;
+  ihdr.block_compression = (uint8_t)blocks;
 
-  std::fwrite(&ihdr, sizeof(IndexFooter), 1, out_index_file);
+  PageIndex::writeIndexFile(out_index_file, ihdr, ireccords);
   std::fclose(out_index_file);
 
   return open(file_name, phdr);
@@ -182,7 +194,8 @@ Page_Ptr Page::repackTo(const std::string &file_name, uint16_t lvl, uint64_t chu
 
 // chunks from memstorage.
 Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk_id,
-                      const std::vector<Chunk *> &a, size_t count) {
+                      const std::vector<Chunk *> &a, size_t count,
+                      compression::BLOCK_COMPRESSION blocks) {
   using namespace dariadb::utils::async;
 
   PageFooter phdr(lvl, chunk_id);
@@ -200,11 +213,9 @@ Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk
     THROW_EXCEPTION("can`t open file ", file_name);
   }
 
-  uint64_t offset = 0;
-  size_t page_size = 0;
+  PageInner::PageWriter writer(file, 0, blocks);
   std::vector<IndexReccord> ireccords;
   ireccords.resize(count);
-  size_t pos = 0;
 
   for (size_t i = 0; i < count; ++i) {
     ChunkHeader *chunk_header = a[i]->header;
@@ -221,6 +232,13 @@ Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk
       ENSURE(readed == (ch->header->stat.count));
     }
 #endif //  DEBUG
+    // memory chunk is not changed, it can be read now.
+    ChunkHeader sealed_header = *chunk_header;
+    std::vector<uint8_t> sealed;
+    if (Chunk::seal(&sealed_header, chunk_buffer_ptr, sealed)) {
+      chunk_header = &sealed_header;
+      chunk_buffer_ptr = sealed.data();
+    }
     phdr.max_chunk_id++;
     phdr.stat.update(chunk_header->stat);
     ihdr.stat.update(chunk_header->stat);
@@ -228,7 +246,6 @@ Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk
     chunk_header->id = phdr.max_chunk_id;
 
     phdr.addeded_chunks++;
-    chunk_header->offset_in_page = offset;
 
     auto skip_count = Chunk::compact(chunk_header);
     // update checksum;
@@ -249,25 +266,21 @@ Page_Ptr Page::create(const std::string &file_name, uint16_t lvl, uint64_t chunk
     }
 #endif //  DEBUG
 
-    std::fwrite(chunk_header, sizeof(ChunkHeader), 1, file);
-    std::fwrite(chunk_buffer_ptr + skip_count, sizeof(uint8_t), chunk_header->size, file);
-
-    offset += sizeof(ChunkHeader) + chunk_header->size;
+    writer.write(*chunk_header, chunk_buffer_ptr + skip_count);
 
     auto index_reccord = PageInner::init_chunk_index_rec(*chunk_header, &ihdr);
-    ireccords[pos] = index_reccord;
-    pos++;
+    ireccords[i] = index_reccord;
   }
 
   ENSURE(memcmp(&phdr.stat, &ihdr.stat, sizeof(Statistic)) == 0);
-  page_size = offset;
-  phdr.filesize = page_size;
+  writer.flush();
+  phdr.filesize = writer.size();
   std::fwrite(&(phdr), sizeof(PageFooter), 1, file);
   std::fclose(file);
 
-  std::fwrite(ireccords.data(), sizeof(IndexReccord), ireccords.size(), index_file);
   ihdr.level = phdr.level;
-  std::fwrite(&ihdr, sizeof(IndexFooter), 1, index_file);
+  ihdr.block_compression = (uint8_t)blocks;
+  PageIndex::writeIndexFile(index_file, ihdr, ireccords);
   std::fclose(index_file);
 
   return Page::open(file_name, phdr);
@@ -290,6 +303,13 @@ Page_Ptr Page::open(const std::string &file_name, const PageFooter &phdr) {
   return Page_Ptr(res);
 }
 
+Page_Ptr Page::open(const std::string &file_name, const PageFooter &phdr,
+                    const PageIndex_ptr &index) {
+  auto res = new Page(phdr, file_name);
+  res->_index = index;
+  return Page_Ptr(res);
+}
+
 void Page::restoreIndexFile(const std::string &file_name) {
   logger_info("engine: page - restore index file ", file_name);
   auto phdr = Page::readFooter(file_name);
@@ -298,8 +318,6 @@ void Page::restoreIndexFile(const std::string &file_name) {
   res->footer = phdr;
   res->update_index_recs(phdr);
   res->_index = PageIndex::open(PageIndex::index_name_from_page_name(file_name));
-
-  ENSURE(memcmp(&phdr.stat, &res->_index->iheader.stat, sizeof(Statistic)) == 0);
   delete res;
 }
 
@@ -329,21 +347,16 @@ bool Page::checksum() {
   using dariadb::timeutil::to_string;
   logger_info("engine: checksum page ", this->filename);
 
-  auto page_io = std::fopen(filename.c_str(), "rb");
-  if (page_io == nullptr) {
-    THROW_EXCEPTION("can`t open file ", this->filename);
-  }
+  PageInner::PageReader page_io(filename, is_blocks());
   bool result = true;
   auto indexReccords = _index->readReccords();
   for (auto it : indexReccords) {
-    Chunk_Ptr c = readChunkByOffset(page_io, it.offset);
-    if (!c->checkChecksum()) {
+    Chunk_Ptr c = page_io.read(it.offset);
+    if (c == nullptr || !c->checkChecksum()) {
       result = false;
       break;
     }
   }
-
-  std::fclose(page_io);
   return result;
 }
 
@@ -353,29 +366,66 @@ void Page::update_index_recs(const PageFooter &phdr) {
   if (index_file == nullptr) {
     THROW_EXCEPTION("can`t open file ", this->filename);
   }
-  auto page_io = std::fopen(filename.c_str(), "rb");
-  if (page_io == nullptr) {
-    THROW_EXCEPTION("can`t open file ", this->filename);
-  }
+  auto page_io = utils::fs::MappedFile::open(filename);
+  auto data = page_io->data();
+  auto size = page_io->size();
 
   IndexFooter ihdr;
+  std::vector<IndexReccord> ireccords;
+  ireccords.reserve(phdr.addeded_chunks);
+  // statistic in footer of old pages may be wrong, so it is built from chunks.
+  Statistic stat;
 
-  for (size_t i = 0; i < phdr.addeded_chunks; ++i) {
-    ChunkHeader info;
-    auto readed = std::fread(&info, sizeof(ChunkHeader), 1, page_io);
-    if (readed < size_t(1)) {
-      THROW_EXCEPTION("engine: page read error - ", this->filename);
+  uint32_t magic = 0;
+  if (size >= sizeof(magic)) {
+    memcpy(&magic, data, sizeof(magic));
+  }
+  if (magic == PageInner::BLOCK_MAGIC) {
+    // method of stored blocks is unknown, if all blocks are not compressed.
+    ihdr.block_compression = (uint8_t)compression::BLOCK_COMPRESSION::FAST;
+    uint64_t block_offset = 0;
+    std::vector<uint8_t> raw;
+    while (ireccords.size() < phdr.addeded_chunks) {
+      PageInner::BlockHeader bhdr;
+      if (block_offset >= size ||
+          !PageInner::readBlock(data + block_offset, size - block_offset, bhdr, raw)) {
+        THROW_EXCEPTION("engine: page block read error - ", this->filename);
+      }
+      if (block_offset == 0 && bhdr.method != 0) {
+        ihdr.block_compression = bhdr.method;
+      }
+      for (size_t in_block = 0; in_block < raw.size();) {
+        ChunkHeader info;
+        memcpy(&info, raw.data() + in_block, sizeof(ChunkHeader));
+        auto index_reccord = PageInner::init_chunk_index_rec(info, &ihdr);
+        ENSURE(index_reccord.offset ==
+               ((block_offset << PageInner::BLOCK_OFFSET_BITS) | in_block));
+        ireccords.push_back(index_reccord);
+        stat.update(info.stat);
+        in_block += sizeof(ChunkHeader) + info.size;
+      }
+      block_offset += sizeof(PageInner::BlockHeader) + bhdr.packed_size;
+    }
+  } else {
+    uint64_t offset = 0;
+    for (size_t i = 0; i < phdr.addeded_chunks; ++i) {
+      if (offset + sizeof(ChunkHeader) > size) {
+        THROW_EXCEPTION("engine: page read error - ", this->filename);
+      }
+      ChunkHeader info;
+      memcpy(&info, data + offset, sizeof(ChunkHeader));
+      auto index_reccord = PageInner::init_chunk_index_rec(info, &ihdr);
+      ENSURE(index_reccord.offset == info.offset_in_page);
+      ireccords.push_back(index_reccord);
+      stat.update(info.stat);
+
+      offset += sizeof(ChunkHeader) + info.size;
     }
-    auto index_reccord = PageInner::init_chunk_index_rec(info, &ihdr);
-    ENSURE(index_reccord.offset == info.offset_in_page);
-    std::fwrite(&index_reccord, sizeof(IndexReccord), 1, index_file);
-
-    std::fseek(page_io, info.size, SEEK_CUR);
   }
-  ihdr.stat = phdr.stat;
-  std::fwrite(&ihdr, sizeof(IndexFooter), 1, index_file);
+  ihdr.stat = stat;
+  ihdr.level = phdr.level;
+  PageIndex::writeIndexFile(index_file, ihdr, ireccords);
   std::fclose(index_file);
-  std::fclose(page_io);
 }
 
 bool Page::minMaxTime(dariadb::Id id, dariadb::Time *minTime, dariadb::Time *maxTime) {
@@ -389,72 +439,53 @@ bool Page::minMaxTime(dariadb::Id id, dariadb::Time *minTime, dariadb::Time *max
   }
   *minTime = dariadb::MAX_TIME;
   *maxTime = dariadb::MIN_TIME;
-  auto indexReccords = _index->readReccords();
   for (auto &link : all_chunks) {
-    auto _index_it = indexReccords[link.index_rec_number];
-    *minTime = std::min(*minTime, _index_it.stat.minTime);
-    *maxTime = std::max(*maxTime, _index_it.stat.maxTime);
+    *minTime = std::min(*minTime, link.minTime);
+    *maxTime = std::max(*maxTime, link.maxTime);
   }
   return result;
 }
 
-Chunk_Ptr Page::readChunkByOffset(FILE *page_io, int offset) {
-  std::fseek(page_io, offset, SEEK_SET);
-  ChunkHeader *cheader = new ChunkHeader;
-  auto readed = std::fread(cheader, sizeof(ChunkHeader), 1, page_io);
-  if (readed < size_t(1)) {
-    delete cheader;
-    THROW_EXCEPTION("engine: page read error");
-  }
-  uint8_t *buffer = new uint8_t[cheader->size];
-  memset(buffer, 0, cheader->size);
-  readed = std::fread(buffer, cheader->size, 1, page_io);
-  if (readed < size_t(1)) {
-    delete cheader;
-    delete[] buffer;
-    THROW_EXCEPTION("engine: page read error");
-  }
-  Chunk_Ptr ptr = nullptr;
-  ptr = Chunk::open(cheader, buffer);
-  ptr->is_owner = true;
-  if (!ptr->checkChecksum()) {
-    logger_fatal("engine: bad checksum of chunk #", ptr->header->id,
-                 " for measurement id:", ptr->header->meas_id);
-    return nullptr;
-  }
-  return ptr;
+bool Page::is_blocks() const {
+  return _index->iheader.block_compression !=
+         (uint8_t)compression::BLOCK_COMPRESSION::NONE;
 }
 
 dariadb::Id2Meas Page::valuesBeforeTimePoint(const QueryTimePoint &q) {
   dariadb::Id2Meas result;
-  dariadb::IdSet to_read{q.ids.begin(), q.ids.end()};
-  auto callback = [&result, &to_read, &q](const Chunk_Ptr &c) {
-    auto reader = c->getReader();
-    auto m = reader->read_time_point(q);
-
-    auto f_res = result.find(m.id);
-    if (f_res == result.end()) {
-      to_read.erase(m.id);
-      result[m.id] = m;
-    } else {
-      if (m.time > f_res->first) {
-        result[m.id] = m;
-      }
-    }
-    if (to_read.empty()) {
-      return true;
-    } else {
-      return false;
-    }
-  };
   auto raw_links =
       _index->get_chunks_links(q.ids, _index->iheader.stat.minTime, q.time_point, q.flag);
   if (raw_links.empty()) {
     return result;
   }
-  apply_to_chunks(raw_links, callback);
+  // chunk can't contain value newer than result, if chunk.maxTime <= result.time.
+  std::vector<ChunkLink> links{raw_links.begin(), raw_links.end()};
+  std::sort(links.begin(), links.end(), [](const ChunkLink &l, const ChunkLink &r) {
+    return l.maxTime > r.maxTime;
+  });
+
+  PageInner::PageReader page_io(filename, is_blocks());
+  for (auto &link : links) {
+    auto f_res = result.find(link.meas_id);
+    if (f_res != result.end() && f_res->second.time >= link.maxTime) {
+      continue;
+    }
+    Chunk_Ptr c = page_io.read(link.offset);
+    if (c == nullptr) {
+      continue;
+    }
+    auto reader = c->getReader();
+    auto m = reader->read_time_point(q);
+    if (m.id != link.meas_id || m.time > q.time_point || !m.inQuery(q.ids, q.flag)) {
+      continue; // no values before time point
+    }
+    if (f_res == result.end() || m.time > f_res->second.time) {
+      result[m.id] = m;
+    }
+  }
   return result;
 }
+
 Id2Cursor Page::intervalReader(const QueryInterval &query) {
   auto links = linksByIterval(query);
   return intervalReader(query, links);
@@ -483,18 +514,23 @@ Statistic Page::stat(const Id id, Time from, Time to) {
   if (_ch_links_iterator == links.cend()) {
     return result;
   }
-  auto page_io = std::fopen(filename.c_str(), "rb");
-  if (page_io == nullptr) {
-    THROW_EXCEPTION("can`t open file ", this->filename);
+  // page file is opened only for chunks on the interval boundaries.
+  ChunkLinkList boundaries;
+  for (auto &link : links) {
+    if (!utils::inInterval(from, to, link.stat.minTime) ||
+        !utils::inInterval(from, to, link.stat.maxTime)) {
+      boundaries.push_back(link);
+    }
   }
-  auto indexReccords = _index->readReccords();
+  PageInner::PageReader page_io(filename, is_blocks());
+  page_io.prefetch(boundaries);
   for (; _ch_links_iterator != links.cend(); ++_ch_links_iterator) {
-    auto _index_it = indexReccords[_ch_links_iterator->index_rec_number];
-    if (utils::inInterval(from, to, _index_it.stat.minTime) &&
-        utils::inInterval(from, to, _index_it.stat.maxTime)) {
-      result.update(_index_it.stat);
+    auto &link = *_ch_links_iterator;
+    if (utils::inInterval(from, to, link.stat.minTime) &&
+        utils::inInterval(from, to, link.stat.maxTime)) {
+      result.update(link.stat);
     } else {
-      Chunk_Ptr c = readChunkByOffset(page_io, _index_it.offset);
+      Chunk_Ptr c = page_io.read(link.offset);
       if (c == nullptr) {
         continue;
       }
@@ -502,7 +538,6 @@ Statistic Page::stat(const Id id, Time from, Time to) {
       result.update(sub_result);
     }
   }
-  fclose(page_io);
   return result;
 }
 
@@ -513,14 +548,10 @@ void Page::apply_to_chunks(const ChunkLinkList &links,
   if (_ch_links_iterator == links.cend()) {
     return;
   }
-  auto page_io = std::fopen(filename.c_str(), "rb");
-  if (page_io == nullptr) {
-    THROW_EXCEPTION("can`t open file ", this->filename);
-  }
-  auto indexReccords = _index->readReccords();
+  PageInner::PageReader page_io(filename, is_blocks());
+  page_io.prefetch(links);
   for (; _ch_links_iterator != links.cend(); ++_ch_links_iterator) {
-    auto _index_it = indexReccords[_ch_links_iterator->index_rec_number];
-    Chunk_Ptr c = readChunkByOffset(page_io, _index_it.offset);
+    Chunk_Ptr c = page_io.read(_ch_links_iterator->offset);
     if (c == nullptr) {
       continue;
     }
@@ -528,26 +559,26 @@ void Page::apply_to_chunks(const ChunkLinkList &links,
       break;
     }
   }
-  fclose(page_io);
 }
 
 void Page::appendChunks(const std::vector<Chunk *> &, size_t) {
   NOT_IMPLEMENTED;
 }
 
-Id2MinMax Page::loadMinMax() {
-  Id2MinMax result;
-  auto page_io = std::fopen(filename.c_str(), "rb");
-  if (page_io == nullptr) {
-    THROW_EXCEPTION("can`t open file ", this->filename);
-  }
+void Page::foreachChunk(std::function<void(const Chunk_Ptr &)> callback) {
+  PageInner::PageReader page_io(filename, is_blocks());
   auto indexReccords = _index->readReccords();
   for (uint32_t i = 0; i < footer.addeded_chunks; ++i) {
-    auto _index_it = indexReccords[i];
-    Chunk_Ptr search_res = readChunkByOffset(page_io, _index_it.offset);
-    if (search_res == nullptr) {
-      continue;
+    Chunk_Ptr c = page_io.read(indexReccords[i].offset);
+    if (c != nullptr) {
+      callback(c);
     }
+  }
+}
+
+Id2MinMax Page::loadMinMax() {
+  Id2MinMax result;
+  foreachChunk([&result](const Chunk_Ptr &search_res) {
     auto info = search_res->header;
     auto fres = result.find(info->meas_id);
     if (fres == result.end()) {
@@ -557,7 +588,6 @@ Id2MinMax Page::loadMinMax() {
       result[info->meas_id].updateMin(info->first());
       result[info->meas_id].updateMax(info->last());
     }
-  }
-  std::fclose(page_io);
+  });
   return result;
 }
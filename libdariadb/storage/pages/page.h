@@ -1,9 +1,11 @@
 #pragma once
+#include <libdariadb/compression/lz.h>
 #include <libdariadb/interfaces/imeaswriter.h>
 #include <libdariadb/st_exports.h>
 #include <libdariadb/storage/chunk.h>
 #include <libdariadb/storage/chunkcontainer.h>
 #include <libdariadb/storage/pages/index.h>
+#include <libdariadb/utils/async/rate_limiter.h>
 #include <libdariadb/utils/fs.h>
 
 namespace dariadb {
@@ -25,7 +27,6 @@ struct PageFooter {
     max_chunk_id = chunk_id;
     addeded_chunks = 0;
     filesize = 0;
-    max_chunk_id = 0;
   }
 };
 #pragma pack(pop)
@@ -41,17 +42,30 @@ public:
   /// called by Dropper from Wal level.
   EXPORT static Page_Ptr create(const std::string &file_name, uint16_t lvl,
                                 uint64_t chunk_id, uint32_t max_chunk_size,
-                                const MeasArray &ma);
-  /// used for repack many pages to one
+                                const MeasArray &ma,
+                                compression::CODEC codec = compression::CODEC::DELTA_XOR,
+                                compression::BLOCK_COMPRESSION blocks =
+                                    compression::BLOCK_COMPRESSION::NONE);
+  /// used for repack many pages to one. if limiter is set, writing is throttled.
   EXPORT static Page_Ptr repackTo(const std::string &file_name, uint16_t lvl,
                                   uint64_t chunk_id, uint32_t max_chunk_size,
-                                  const std::list<std::string> &pages_full_paths);
+                                  const std::list<std::string> &pages_full_paths,
+                                  utils::async::RateLimiter *limiter = nullptr,
+                                  compression::CODEC codec =
+                                      compression::CODEC::DELTA_XOR,
+                                  compression::BLOCK_COMPRESSION blocks =
+                                      compression::BLOCK_COMPRESSION::NONE);
   /// called by dropper from MemoryStorage.
   EXPORT static Page_Ptr create(const std::string &file_name, uint16_t lvl,
                                 uint64_t chunk_id, const std::vector<Chunk *> &a,
-                                size_t count);
+                                size_t count,
+                                compression::BLOCK_COMPRESSION blocks =
+                                    compression::BLOCK_COMPRESSION::NONE);
 
   EXPORT static Page_Ptr open(const std::string &file_name);
+  /// open page with already readed footer and index.
+  EXPORT static Page_Ptr open(const std::string &file_name, const PageFooter &phdr,
+                              const PageIndex_ptr &index);
 
   EXPORT static PageFooter readFooter(std::string file_name);
   EXPORT static IndexFooter readIndexFooter(std::string page_file_name);
@@ -68,6 +82,8 @@ public:
   EXPORT void appendChunks(const std::vector<Chunk *> &a, size_t count) override;
 
   EXPORT Id2MinMax loadMinMax();
+  /// chunks with bad checksum are skipped.
+  EXPORT void foreachChunk(std::function<void(const Chunk_Ptr &)> callback);
   EXPORT Id2Cursor intervalReader(const QueryInterval &query, const ChunkLinkList &links);
   EXPORT Statistic stat(const Id id, Time from, Time to);
   bool checksum(); // return false if bad checksum.
@@ -75,7 +91,8 @@ private:
   void update_index_recs(const PageFooter &phdr);
 
   static Page_Ptr open(const std::string &file_name, const PageFooter &phdr);
-  static Chunk_Ptr readChunkByOffset(FILE *page_io, int offset);
+  /// true if chunks are grouped to compressed blocks.
+  bool is_blocks() const;
 
   ChunkLinkList linksByIterval(const QueryInterval &qi);
   // callback - return true for break iteration.
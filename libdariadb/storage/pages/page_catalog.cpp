@@ -0,0 +1,401 @@
+#include <libdariadb/storage/pages/page_catalog.h>
+#include <libdariadb/utils/fs.h>
+#include <algorithm>
+
+using namespace dariadb;
+using namespace dariadb::storage;
+
+namespace {
+/// catalog of tests may contain pages without files.
+uint64_t page_file_size(const std::string &path) {
+  return utils::fs::file_exists(path) ? utils::fs::file_size(path) : 0;
+}
+}
+
+bool PageCatalog::PageDescription::contains(Id id) const {
+  if (hdr.id_bloom_words == 0) { // index written without BloomFilter.
+    return storage::bloom_check(hdr.id_bloom, id);
+  }
+  return id_bloom.check(id);
+}
+
+PageCatalog::PageCatalog() {}
+
+PageCatalog::~PageCatalog() {}
+
+void PageCatalog::insert(const std::string &name, const std::string &path,
+                         const IndexFooter &hdr, const BloomFilter &id_bloom,
+                         const std::vector<Id> &ids, uint64_t since) {
+  auto size = page_file_size(path);
+  std::lock_guard<std::mutex> lg(_locker);
+  insert_unlocked(name, path, hdr, id_bloom, ids, since, size);
+}
+
+void PageCatalog::replace(const std::list<std::string> &erased, const std::string &name,
+                          const std::string &path, const IndexFooter &hdr,
+                          const BloomFilter &id_bloom, const std::vector<Id> &ids) {
+  auto size = page_file_size(path);
+  std::lock_guard<std::mutex> lg(_locker);
+  for (auto &e : erased) {
+    erase_unlocked(e);
+  }
+  insert_unlocked(name, path, hdr, id_bloom, ids, 0, size);
+}
+
+void PageCatalog::insert_unlocked(const std::string &name, const std::string &path,
+                                  const IndexFooter &hdr, const BloomFilter &id_bloom,
+                                  const std::vector<Id> &ids, uint64_t since,
+                                  uint64_t file_size) {
+  erase_unlocked(name);
+
+  auto descr = std::make_unique<PageDescription>();
+  descr->name = name;
+  descr->path = path;
+  descr->hdr = hdr;
+  descr->id_bloom = id_bloom;
+  descr->ids = ids;
+  descr->since = since;
+  descr->file_size = file_size;
+
+  auto ptr = descr.get();
+  if (ptr->ids.empty()) {
+    _without_ids.insert(ptr);
+  } else {
+    for (auto id : ptr->ids) {
+      _postings[id].insert(ptr);
+    }
+  }
+  _pages[name] = std::move(descr);
+
+  Node_Ptr node{new Node};
+  node->page = ptr;
+  node->priority = static_cast<uint32_t>(_rnd());
+  update(node.get());
+  tree_insert(_root, node);
+}
+
+void PageCatalog::settle(const std::string &name) {
+  std::lock_guard<std::mutex> lg(_locker);
+  auto it = _pages.find(name);
+  if (it != _pages.end()) {
+    it->second->since = 0;
+  }
+}
+
+void PageCatalog::erase(const std::string &name) {
+  std::lock_guard<std::mutex> lg(_locker);
+  erase_unlocked(name);
+}
+
+void PageCatalog::erase_unlocked(const std::string &name) {
+  auto it = _pages.find(name);
+  if (it == _pages.end()) {
+    return;
+  }
+  auto ptr = it->second.get();
+  if (ptr->ids.empty()) {
+    _without_ids.erase(ptr);
+  } else {
+    for (auto id : ptr->ids) {
+      auto pit = _postings.find(id);
+      if (pit != _postings.end()) {
+        pit->second.erase(ptr);
+        if (pit->second.empty()) {
+          _postings.erase(pit);
+        }
+      }
+    }
+  }
+  tree_erase(_root, ptr);
+  _pages.erase(it);
+}
+
+void PageCatalog::clear() {
+  std::lock_guard<std::mutex> lg(_locker);
+  _root = nullptr;
+  _pages.clear();
+  _postings.clear();
+  _without_ids.clear();
+}
+
+bool PageCatalog::less(const PageDescription *l, const PageDescription *r) {
+  return l->hdr.stat.minTime < r->hdr.stat.minTime ||
+         (l->hdr.stat.minTime == r->hdr.stat.minTime && l->name < r->name);
+}
+
+void PageCatalog::update(Node *node) {
+  node->size = 1;
+  node->max_time = node->page->hdr.stat.maxTime;
+  for (auto child : {node->left.get(), node->right.get()}) {
+    if (child != nullptr) {
+      node->size += child->size;
+      node->max_time = std::max(node->max_time, child->max_time);
+    }
+  }
+}
+
+void PageCatalog::split(Node_Ptr node, const PageDescription *key, Node_Ptr &l,
+                        Node_Ptr &r) {
+  if (node == nullptr) {
+    l = nullptr;
+    r = nullptr;
+    return;
+  }
+  if (less(node->page, key)) {
+    split(std::move(node->right), key, node->right, r);
+    update(node.get());
+    l = std::move(node);
+  } else {
+    split(std::move(node->left), key, l, node->left);
+    update(node.get());
+    r = std::move(node);
+  }
+}
+
+PageCatalog::Node_Ptr PageCatalog::merge(Node_Ptr l, Node_Ptr r) {
+  if (l == nullptr) {
+    return r;
+  }
+  if (r == nullptr) {
+    return l;
+  }
+  if (l->priority > r->priority) {
+    l->right = merge(std::move(l->right), std::move(r));
+    update(l.get());
+    return l;
+  }
+  r->left = merge(std::move(l), std::move(r->left));
+  update(r.get());
+  return r;
+}
+
+void PageCatalog::tree_insert(Node_Ptr &node, Node_Ptr &new_node) {
+  if (node == nullptr) {
+    node = std::move(new_node);
+    return;
+  }
+  if (new_node->priority > node->priority) {
+    split(std::move(node), new_node->page, new_node->left, new_node->right);
+    update(new_node.get());
+    node = std::move(new_node);
+    return;
+  }
+  tree_insert(less(new_node->page, node->page) ? node->left : node->right, new_node);
+  update(node.get());
+}
+
+void PageCatalog::tree_erase(Node_Ptr &node, const PageDescription *pd) {
+  if (node == nullptr) {
+    return;
+  }
+  if (node->page == pd) {
+    node = merge(std::move(node->left), std::move(node->right));
+    return;
+  }
+  tree_erase(less(pd, node->page) ? node->left : node->right, pd);
+  update(node.get());
+}
+
+void PageCatalog::tree_query(const Node *node, Time from, Time to,
+                             std::vector<const PageDescription *> &out) {
+  if (node == nullptr || node->max_time < from) {
+    return;
+  }
+  tree_query(node->left.get(), from, to, out);
+  if (node->page->hdr.stat.minTime > to) { // right subtree starts later.
+    return;
+  }
+  if (node->page->hdr.stat.maxTime >= from) {
+    out.push_back(node->page);
+  }
+  tree_query(node->right.get(), from, to, out);
+}
+
+void PageCatalog::tree_list(const Node *node, std::vector<const PageDescription *> &out) {
+  if (node == nullptr) {
+    return;
+  }
+  tree_list(node->left.get(), out);
+  out.push_back(node->page);
+  tree_list(node->right.get(), out);
+}
+
+size_t PageCatalog::count_before(Time to) const {
+  size_t result = 0;
+  auto node = _root.get();
+  while (node != nullptr) {
+    if (node->page->hdr.stat.minTime <= to) {
+      result += 1 + (node->left == nullptr ? 0 : node->left->size);
+      node = node->right.get();
+    } else {
+      node = node->left.get();
+    }
+  }
+  return result;
+}
+
+std::vector<const PageCatalog::PageDescription *>
+PageCatalog::candidates(const IdArray &ids, Time from, Time to, uint64_t version) {
+  size_t postings_size = _without_ids.size();
+  for (auto id : ids) {
+    auto pit = _postings.find(id);
+    if (pit != _postings.end()) {
+      postings_size += pit->second.size();
+    }
+  }
+
+  std::vector<const PageDescription *> pages;
+  if (!ids.empty() && postings_size < count_before(to)) {
+    auto in_interval = [from, to](const PageDescription *pd) {
+      return pd->hdr.stat.minTime <= to && pd->hdr.stat.maxTime >= from;
+    };
+    for (auto id : ids) {
+      auto pit = _postings.find(id);
+      if (pit == _postings.end()) {
+        continue;
+      }
+      for (auto pd : pit->second) {
+        if (in_interval(pd)) {
+          pages.push_back(pd);
+        }
+      }
+    }
+    for (auto pd : _without_ids) {
+      if (in_interval(pd) && std::any_of(ids.begin(), ids.end(),
+                                         [pd](Id id) { return pd->contains(id); })) {
+        pages.push_back(pd);
+      }
+    }
+    std::sort(pages.begin(), pages.end(), less);
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+  } else {
+    tree_query(_root.get(), from, to, pages);
+    if (!ids.empty()) {
+      pages.erase(std::remove_if(pages.begin(), pages.end(),
+                                 [&ids](const PageDescription *pd) {
+                                   return !std::any_of(
+                                       ids.begin(), ids.end(),
+                                       [pd](Id id) { return pd->contains(id); });
+                                 }),
+                  pages.end());
+    }
+  }
+  pages.erase(std::remove_if(pages.begin(), pages.end(),
+                             [version](const PageDescription *pd) {
+                               return !is_visible(pd, version);
+                             }),
+              pages.end());
+  return pages;
+}
+
+std::list<std::string> PageCatalog::find(const IdArray &ids, Time from, Time to,
+                                         uint64_t version, const Predicate &pred) {
+  std::lock_guard<std::mutex> lg(_locker);
+  std::list<std::string> result;
+  for (auto pd : candidates(ids, from, to, version)) {
+    if (pred == nullptr || pred(pd->hdr)) {
+      result.push_back(pd->path);
+    }
+  }
+  return result;
+}
+
+std::list<std::string> PageCatalog::find(const Predicate &pred, uint64_t version) {
+  std::lock_guard<std::mutex> lg(_locker);
+  std::vector<const PageDescription *> pages;
+  tree_list(_root.get(), pages);
+  std::list<std::string> result;
+  for (auto pd : pages) {
+    if (is_visible(pd, version) && (pred == nullptr || pred(pd->hdr))) {
+      result.push_back(pd->path);
+    }
+  }
+  return result;
+}
+
+std::vector<std::pair<std::string, IndexFooter>>
+PageCatalog::footers(const Predicate &pred, uint64_t version,
+                     std::vector<uint64_t> *sizes) {
+  std::lock_guard<std::mutex> lg(_locker);
+  std::vector<const PageDescription *> pages;
+  tree_list(_root.get(), pages);
+  std::vector<std::pair<std::string, IndexFooter>> result;
+  for (auto pd : pages) {
+    if (is_visible(pd, version) && (pred == nullptr || pred(pd->hdr))) {
+      result.emplace_back(pd->path, pd->hdr);
+      if (sizes != nullptr) {
+        sizes->push_back(pd->file_size);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<std::pair<std::string, IndexFooter>>
+PageCatalog::footers(const IdArray &ids, Time from, Time to, uint64_t version) {
+  std::lock_guard<std::mutex> lg(_locker);
+  std::vector<std::pair<std::string, IndexFooter>> result;
+  for (auto pd : candidates(ids, from, to, version)) {
+    result.emplace_back(pd->path, pd->hdr);
+  }
+  return result;
+}
+
+Statistic PageCatalog::stat(Id id, Time from, Time to, uint64_t version,
+                            std::list<std::string> *to_read) {
+  std::lock_guard<std::mutex> lg(_locker);
+  Statistic result;
+  auto visit = [&result, from, to, version, to_read](const PageDescription *pd) {
+    auto &st = pd->hdr.stat;
+    if (st.minTime > to || st.maxTime < from || !is_visible(pd, version)) {
+      return;
+    }
+    // footer statistic is a statistic of id, if page stores one id.
+    if (pd->ids.size() == size_t(1) && utils::inInterval(from, to, st.minTime) &&
+        utils::inInterval(from, to, st.maxTime)) {
+      result.update(st);
+    } else {
+      to_read->push_back(pd->path);
+    }
+  };
+
+  auto pit = _postings.find(id);
+  if (pit != _postings.end()) {
+    for (auto pd : pit->second) {
+      visit(pd);
+    }
+  }
+  for (auto pd : _without_ids) {
+    if (pd->contains(id)) {
+      visit(pd);
+    }
+  }
+  return result;
+}
+
+size_t PageCatalog::size() const {
+  std::lock_guard<std::mutex> lg(_locker);
+  return _pages.size();
+}
+
+bool PageCatalog::contains(const std::string &name) const {
+  std::lock_guard<std::mutex> lg(_locker);
+  return _pages.find(name) != _pages.end();
+}
+
+Time PageCatalog::minTime() {
+  std::lock_guard<std::mutex> lg(_locker);
+  auto node = _root.get();
+  if (node == nullptr) {
+    return MAX_TIME;
+  }
+  while (node->left != nullptr) {
+    node = node->left.get();
+  }
+  return node->page->hdr.stat.minTime;
+}
+
+Time PageCatalog::maxTime() {
+  std::lock_guard<std::mutex> lg(_locker);
+  return _root == nullptr ? MIN_TIME : _root->max_time;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <libdariadb/meas.h>
+#include <libdariadb/st_exports.h>
+#include <libdariadb/storage/bloom_filter.h>
+#include <libdariadb/storage/pages/index.h>
+#include <libdariadb/utils/utils.h>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dariadb {
+namespace storage {
+
+/**
+in-memory catalog of page footers.
+pages are searched by time interval (interval tree: treap by minTime, where node
+stores max of maxTime in subtree) and by ids (posting lists built from id
+directory of index file). insert and erase update both structures in O(log n).
+page published in snapshot version 'since' is seen by readers of this and newer
+versions, queries take version of reader.
+*/
+class PageCatalog : public utils::NonCopy {
+public:
+  struct PageDescription {
+    std::string name; // file name in storage.
+    std::string path; // full path to page file.
+    IndexFooter hdr;
+    BloomFilter id_bloom;
+    /// ids from id directory. empty for index without directory.
+    std::vector<Id> ids;
+    /// version, in which page was published. 0 - page is seen by all readers.
+    uint64_t since;
+    /// size of page file on insert, pages are not changed after writing.
+    uint64_t file_size;
+
+    bool contains(Id id) const;
+  };
+
+  using Predicate = std::function<bool(const IndexFooter &)>;
+  /// version of reader, which sees all pages.
+  static const uint64_t ALL_VERSIONS = std::numeric_limits<uint64_t>::max();
+
+  EXPORT PageCatalog();
+  EXPORT ~PageCatalog();
+
+  EXPORT void insert(const std::string &name, const std::string &path,
+                     const IndexFooter &hdr, const BloomFilter &id_bloom,
+                     const std::vector<Id> &ids, uint64_t since = 0);
+  /// erase pages 'erased' and insert new one. readers see both changes at once.
+  EXPORT void replace(const std::list<std::string> &erased, const std::string &name,
+                      const std::string &path, const IndexFooter &hdr,
+                      const BloomFilter &id_bloom, const std::vector<Id> &ids);
+  /// page is seen by all readers: readers of older versions are finished.
+  EXPORT void settle(const std::string &name);
+  EXPORT void erase(const std::string &name);
+  EXPORT void clear();
+
+  /// full paths of pages, sorted by minTime, which intersect [from, to] and
+  /// may contain one of ids. empty 'ids' - any id.
+  EXPORT std::list<std::string> find(const IdArray &ids, Time from, Time to,
+                                     uint64_t version, const Predicate &pred = nullptr);
+  /// full paths of pages sorted by minTime, where pred is true. version 0 - pages seen
+  /// by all readers.
+  EXPORT std::list<std::string> find(const Predicate &pred,
+                                     uint64_t version = ALL_VERSIONS);
+  /// full paths and footers of pages sorted by minTime, where pred is true.
+  /// 'sizes' - if not nullptr, sizes of page files in same order.
+  EXPORT std::vector<std::pair<std::string, IndexFooter>>
+  footers(const Predicate &pred, uint64_t version = ALL_VERSIONS,
+          std::vector<uint64_t> *sizes = nullptr);
+  /// same as find(ids, from, to, version), but with footers.
+  EXPORT std::vector<std::pair<std::string, IndexFooter>>
+  footers(const IdArray &ids, Time from, Time to, uint64_t version);
+  /// statistic of pages, which store only 'id' and lie inside [from, to].
+  /// other pages, which intersect [from, to] and may contain 'id', are added to 'to_read'.
+  EXPORT Statistic stat(Id id, Time from, Time to, uint64_t version,
+                        std::list<std::string> *to_read);
+
+  EXPORT size_t size() const;
+  /// true if page with name is in catalog.
+  EXPORT bool contains(const std::string &name) const;
+  EXPORT Time minTime();
+  EXPORT Time maxTime();
+
+protected:
+  /// node of interval tree.
+  struct Node {
+    const PageDescription *page;
+    uint32_t priority;
+    Time max_time; // max of maxTime in subtree.
+    size_t size;   // pages in subtree.
+    std::unique_ptr<Node> left;
+    std::unique_ptr<Node> right;
+  };
+  using Node_Ptr = std::unique_ptr<Node>;
+
+  void insert_unlocked(const std::string &name, const std::string &path,
+                       const IndexFooter &hdr, const BloomFilter &id_bloom,
+                       const std::vector<Id> &ids, uint64_t since, uint64_t file_size);
+  void erase_unlocked(const std::string &name);
+
+  /// order of pages: by minTime, then by name.
+  static bool less(const PageDescription *l, const PageDescription *r);
+  struct Less {
+    bool operator()(const PageDescription *l, const PageDescription *r) const {
+      return less(l, r);
+    }
+  };
+  /// pages sorted by 'less'.
+  using PageSet = std::set<const PageDescription *, Less>;
+  static void update(Node *node);
+  /// l - pages less than 'key', r - other.
+  static void split(Node_Ptr node, const PageDescription *key, Node_Ptr &l, Node_Ptr &r);
+  static Node_Ptr merge(Node_Ptr l, Node_Ptr r);
+  static void tree_insert(Node_Ptr &node, Node_Ptr &new_node);
+  static void tree_erase(Node_Ptr &node, const PageDescription *pd);
+  /// pages, which intersect [from, to], sorted.
+  static void tree_query(const Node *node, Time from, Time to,
+                         std::vector<const PageDescription *> &out);
+  /// all pages sorted.
+  static void tree_list(const Node *node, std::vector<const PageDescription *> &out);
+  /// count of pages with minTime <= to.
+  size_t count_before(Time to) const;
+  /// pages sorted by minTime, which intersect [from, to] and may contain one of ids.
+  std::vector<const PageDescription *> candidates(const IdArray &ids, Time from, Time to,
+                                                  uint64_t version);
+  static bool is_visible(const PageDescription *pd, uint64_t version) {
+    return pd->since <= version;
+  }
+
+protected:
+  std::unordered_map<std::string, std::unique_ptr<PageDescription>> _pages;
+  /// pages with id directory, by id.
+  std::unordered_map<Id, PageSet> _postings;
+  /// pages without id directory.
+  PageSet _without_ids;
+
+  Node_Ptr _root;
+  std::minstd_rand _rnd;
+
+  mutable std::mutex _locker;
+};
+}
+}
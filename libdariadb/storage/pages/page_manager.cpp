@@ -1,40 +1,40 @@
 #ifdef MSVC
-#define _SCL_SECURE_NO_WARNINGS // for stx::btree in msvc build.
 #endif
 #include <libdariadb/flags.h>
 #include <libdariadb/storage/bloom_filter.h>
 #include <libdariadb/storage/cursors.h>
 #include <libdariadb/storage/manifest.h>
+#include <libdariadb/storage/pages/index_cache.h>
 #include <libdariadb/storage/pages/page.h>
+#include <libdariadb/storage/pages/page_catalog.h>
 #include <libdariadb/storage/pages/page_manager.h>
+#include <libdariadb/storage/rollup.h>
 #include <libdariadb/storage/settings.h>
+#include <libdariadb/storage/snapshot.h>
 #include <libdariadb/utils/async/locker.h>
+#include <libdariadb/utils/async/rate_limiter.h>
 #include <libdariadb/utils/async/thread_manager.h>
 #include <libdariadb/utils/fs.h>
 #include <libdariadb/utils/utils.h>
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 
-#include <stx/btree_multimap.h>
-
 using namespace dariadb;
 using namespace dariadb::storage;
 using namespace dariadb::utils::async;
 
-struct PageFooterDescription {
-  std::string path;
-  IndexFooter hdr;
-};
-
-using File2PageFooter = stx::btree_multimap<dariadb::Time, PageFooterDescription>;
 
 class PageManager::Private {
 public:
@@ -43,13 +43,182 @@ public:
     _env = env;
     _settings = _env->getResourceObject<Settings>(EngineEnvironment::Resource::SETTINGS);
     _manifest = _env->getResourceObject<Manifest>(EngineEnvironment::Resource::MANIFEST);
+    _rollups = nullptr;
+    if (_env->hasResource(EngineEnvironment::Resource::ROLLUP)) {
+      _rollups =
+          _env->getResourceObject<RollupManager>(EngineEnvironment::Resource::ROLLUP);
+    }
+    if (_env->hasResource(EngineEnvironment::Resource::SNAPSHOTS)) {
+      _snapshots = _env->getResourceObject<SnapshotManager>(
+          EngineEnvironment::Resource::SNAPSHOTS);
+    } else {
+      _own_snapshots = std::make_unique<SnapshotManager>();
+      _snapshots = _own_snapshots.get();
+    }
     last_id = 0;
+    _compactions = 0;
+    _compaction_stop = false;
+    _backfill_stop = false;
+    _backfill_pending = false;
+    _index_cache = std::make_unique<IndexCache>(_settings->index_cache_size.value());
+    _rate_limiter =
+        std::make_unique<RateLimiter>(_settings->compaction_rate_limit.value());
     reloadIndexFooters();
+    if (_rollups != nullptr && _rollups->need_backfill()) {
+      start_backfill();
+    }
+  }
+
+  struct BackfillState {
+    std::list<std::string> pages;
+    std::set<std::string> filled;
+  };
+
+  /// tiers, which were added to existing storage, are filled by chunks of pages in
+  /// background, one page per run. done pages are remembered by rollups, so back-fill
+  /// is resumed after restart. compaction waits, while back-fill is not finished.
+  void start_backfill() {
+    auto state = std::make_shared<BackfillState>();
+    for (auto &pname : _catalog.find(nullptr)) {
+      if (_rollups->need_backfill(utils::fs::extract_filename(pname))) {
+        state->pages.push_back(pname);
+      } else {
+        state->filled.insert(pname);
+      }
+    }
+    logger_info("engine", _settings->alias, ": rollup back-fill of ",
+                state->pages.size(), " pages...");
+    _backfill_pending = true;
+    AsyncTask at = [this, state](const ThreadInfo &ti) {
+      TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
+      if (_backfill_stop) {
+        return false;
+      }
+      if (!state->pages.empty()) {
+        auto pname = state->pages.front();
+        state->pages.pop_front();
+        try {
+          backfill_page(pname, state->filled);
+        } catch (std::exception &ex) {
+          logger_fatal("engine", _settings->alias, ": rollup back-fill of ", pname,
+                       " error - ", ex.what());
+        }
+        state->filled.insert(pname);
+        if (!state->pages.empty()) {
+          return true;
+        }
+      }
+      _rollups->backfill_done();
+      _backfill_pending = false;
+      logger_info("engine", _settings->alias, ": rollup back-fill done.");
+      return false;
+    };
+    _backfill_task = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
+  }
+
+  void backfill_page(const std::string &pname, const std::set<std::string> &filled) {
+    PinnedSnapshot pin(_snapshots);
+    auto page_name = utils::fs::extract_filename(pname);
+    if (!_catalog.contains(page_name)) { // page was removed by eraseOld.
+      return;
+    }
+    auto pg = open_page_to_read(pname);
+    std::vector<Chunk_Ptr> chunks;
+    pg->foreachChunk([&chunks](const Chunk_Ptr &c) { chunks.push_back(c); });
+    std::vector<Chunk *> a(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      a[i] = chunks[i].get();
+    }
+    mark_overwritten(a, a.size(), &filled);
+    _rollups->backfill(a, a.size(), page_name);
+  }
+
+  /// rollups sum values, so time of id, which is stored in pages twice, is counted
+  /// twice. such times of new values are marked in rollups. 'times' - sorted times
+  /// of id in new values. 'among' - pages to check, nullptr - all pages.
+  void mark_overwritten(Id id, const std::vector<Time> &times,
+                        const std::set<std::string> *among) {
+    std::vector<Time> repeated;
+    for (size_t i = 1; i < times.size(); ++i) {
+      if (times[i] == times[i - 1]) {
+        repeated.push_back(times[i]);
+      }
+    }
+    QueryInterval q(IdArray{id}, Flag(0), times.front(), times.back());
+    for (auto &pname :
+         _catalog.find(q.ids, q.from, q.to, PageCatalog::ALL_VERSIONS)) {
+      if (among != nullptr && among->count(pname) == 0) {
+        continue;
+      }
+      auto pg = open_page_to_read(pname);
+      for (auto &kv : pg->intervalReader(q)) {
+        auto c = kv.second;
+        while (!c->is_end()) {
+          auto v = c->readNext();
+          if (std::binary_search(times.begin(), times.end(), v.time)) {
+            repeated.push_back(v.time);
+          }
+        }
+      }
+    }
+    if (!repeated.empty()) {
+      std::sort(repeated.begin(), repeated.end());
+      repeated.erase(std::unique(repeated.begin(), repeated.end()), repeated.end());
+      _rollups->overwritten(id, repeated);
+    }
+  }
+
+  void mark_overwritten(const MeasArray &ma) {
+    std::map<Id, std::vector<Time>> times;
+    for (auto &m : ma) {
+      times[m.id].push_back(m.time);
+    }
+    for (auto &kv : times) {
+      std::sort(kv.second.begin(), kv.second.end());
+      mark_overwritten(kv.first, kv.second, nullptr);
+    }
+  }
+
+  /// chunks are decompressed only for ids, which intersect pages or other chunks.
+  void mark_overwritten(const std::vector<Chunk *> &a, size_t count,
+                        const std::set<std::string> *among) {
+    std::map<Id, std::vector<Chunk *>> by_id;
+    for (size_t i = 0; i < count; ++i) {
+      by_id[a[i]->header->meas_id].push_back(a[i]);
+    }
+    for (auto &kv : by_id) {
+      auto &chunks = kv.second;
+      std::sort(chunks.begin(), chunks.end(), [](const Chunk *l, const Chunk *r) {
+        return l->header->stat.minTime < r->header->stat.minTime;
+      });
+      bool intersected = false;
+      auto max_time = chunks.front()->header->stat.maxTime;
+      for (size_t i = 1; i < chunks.size(); ++i) {
+        intersected = intersected || chunks[i]->header->stat.minTime <= max_time;
+        max_time = std::max(max_time, chunks[i]->header->stat.maxTime);
+      }
+      if (!intersected &&
+          _catalog
+              .find(IdArray{kv.first}, chunks.front()->header->stat.minTime, max_time,
+                    PageCatalog::ALL_VERSIONS)
+              .empty()) {
+        continue;
+      }
+      std::vector<Time> times;
+      for (auto c : chunks) {
+        auto rdr = c->getReader();
+        while (!rdr->is_end()) {
+          times.push_back(rdr->readNext().time);
+        }
+      }
+      std::sort(times.begin(), times.end());
+      mark_overwritten(kv.first, times, among);
+    }
   }
 
   void reloadIndexFooters() {
     if (utils::fs::path_exists(_settings->raw_path.value())) {
-      _file2footer.clear();
+      _catalog.clear();
       auto pages = _manifest->page_list();
 
       for (auto n : pages) {
@@ -59,14 +228,18 @@ public:
 
         auto index_filename = PageIndex::index_name_from_page_name(file_name);
         if (utils::fs::file_exists(index_filename)) {
-          auto ihdr = Page::readIndexFooter(index_filename);
-          insert_pagedescr(n, ihdr);
+          insert_pagedescr(n, index_filename);
         }
       }
     }
   }
 
   ~Private() {
+    stopCompaction();
+    _backfill_stop = true;
+    if (_backfill_task != nullptr) {
+      _backfill_task->wait();
+    }
     if (_cur_page != nullptr) {
       _cur_page = nullptr;
     }
@@ -76,6 +249,7 @@ public:
     if (!utils::fs::path_exists(_settings->raw_path.value())) {
       return;
     }
+    std::lock_guard<std::mutex> lg(_compaction_locker);
 
     auto pages = _manifest->page_list();
 
@@ -107,8 +281,8 @@ public:
   void flush() {}
 
   bool minMaxTime(dariadb::Id id, dariadb::Time *minResult, dariadb::Time *maxResult) {
-    auto pages = pages_by_filter(
-        [id](const IndexFooter &ih) { return (storage::bloom_check(ih.id_bloom, id)); });
+    auto snapshot = _snapshots->pin();
+    auto pages = _catalog.find(IdArray{id}, MIN_TIME, MAX_TIME, snapshot->number());
 
     using MMRes = std::tuple<bool, dariadb::Time, dariadb::Time>;
     std::vector<MMRes> results{pages.size()};
@@ -152,130 +326,114 @@ public:
   }
 
   Page_Ptr open_page_to_read(const std::string &pname) const {
-    std::lock_guard<std::mutex> lg(_page_open_lock);
     Page_Ptr pg = nullptr;
-    if (_cur_page != nullptr && pname == _cur_page->filename) {
-      pg = _cur_page;
-    } else {
-      pg = Page_Ptr{Page::open(pname)};
+    {
+      std::lock_guard<std::mutex> lg(_page_open_lock);
+      if (_cur_page != nullptr && pname == _cur_page->filename) {
+        pg = _cur_page;
+      }
+    }
+    if (pg == nullptr) {
+      pg = _index_cache->open(pname);
     }
     return pg;
   }
 
   Statistic stat(const Id &id, Time from, Time to) {
-    auto pred = [id, from, to](const IndexFooter &hdr) {
-      auto interval_check((hdr.stat.minTime >= from && hdr.stat.maxTime <= to) ||
-                          (utils::inInterval(from, to, hdr.stat.minTime)) ||
-                          (utils::inInterval(from, to, hdr.stat.maxTime)) ||
-                          (utils::inInterval(hdr.stat.minTime, hdr.stat.maxTime, from)) ||
-                          (utils::inInterval(hdr.stat.minTime, hdr.stat.maxTime, to)));
-      if (interval_check) {
-        if (storage::bloom_check(hdr.id_bloom, id)) {
-          return true;
+    auto snapshot = _snapshots->pin();
+
+    // pages inside [from,to] with one id are answered by footers, other - by index.
+    std::list<std::string> page_list;
+    Statistic result = _catalog.stat(id, from, to, snapshot->number(), &page_list);
+    std::vector<std::string> pages{page_list.begin(), page_list.end()};
+    std::vector<Statistic> sub_results(pages.size());
+
+    auto tasks_count =
+        std::min(pages.size(), size_t(_settings->threads_in_diskio.value()));
+    std::vector<TaskResult_Ptr> task_res(tasks_count);
+    for (size_t num = 0; num < tasks_count; ++num) {
+      AsyncTask at = [id, from, to, &pages, &sub_results, num, tasks_count,
+                      this](const ThreadInfo &ti) {
+        TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
+        for (size_t i = num; i < pages.size(); i += tasks_count) {
+          auto p = open_page_to_read(pages[i]);
+          sub_results[i] = p->stat(id, from, to);
         }
-      }
-      return false;
-    };
-    Statistic result;
-
-    AsyncTask at = [id, from, to, pred, this, &result](const ThreadInfo &ti) {
-      TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-      ChunkLinkList to_read;
+        return false;
+      };
+      task_res[num] = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
+    }
 
-      auto page_list = pages_by_filter(std::function<bool(const IndexFooter &)>(pred));
+    for (auto &tw : task_res) {
+      tw->wait();
+    }
+    for (auto &sub_result : sub_results) {
+      result.update(sub_result);
+    }
+    return result;
+  }
 
-      for (auto pname : page_list) {
-        auto p = Page::open(pname);
-        auto sub_result = p->stat(id, from, to);
-        result.update(sub_result);
+  bool isOverlapped(const Id id, Time from, Time to) {
+    auto snapshot = _snapshots->pin();
+    auto pages = _catalog.footers(IdArray{id}, from, to, snapshot->number());
+    for (size_t i = 1; i < pages.size(); ++i) {
+      if (pages[i].second.stat.minTime <= pages[i - 1].second.stat.maxTime) {
+        return true;
       }
-
-      return false;
-    };
-    auto pm_async = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
-    pm_async->wait();
-    return result;
+    }
+    return false;
   }
 
   Id2Cursor intervalReader(const QueryInterval &query) {
+    if (query.ids.empty()) {
+      return Id2Cursor();
+    }
+    auto snapshot = _snapshots->pin();
     auto pred = [&query](const IndexFooter &hdr) {
-      auto interval_check(
-          (hdr.stat.minTime >= query.from && hdr.stat.maxTime <= query.to) ||
-          (utils::inInterval(query.from, query.to, hdr.stat.minTime)) ||
-          (utils::inInterval(query.from, query.to, hdr.stat.maxTime)) ||
-          (utils::inInterval(hdr.stat.minTime, hdr.stat.maxTime, query.from)) ||
-          (utils::inInterval(hdr.stat.minTime, hdr.stat.maxTime, query.to)));
-      if (interval_check) {
-        for (auto id : query.ids) {
-          if (storage::bloom_check(hdr.id_bloom, id) &&
-              (query.flag == Flag(0) ||
-               storage::bloom_check(hdr.stat.flag_bloom, query.flag))) {
-            return true;
-          }
-        }
-      }
-      return false;
+      return query.flag == Flag(0) ||
+             storage::bloom_check(hdr.stat.flag_bloom, query.flag);
     };
 
-    Id2CursorsList result;
-    utils::async::Locker result_locker;
-
-    AsyncTask at = [&query, this, &result, &result_locker, pred](const ThreadInfo &ti) {
-      TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-      ChunkLinkList to_read;
-
-      auto page_list = pages_by_filter(std::function<bool(const IndexFooter &)>(pred));
-
-      for (auto pname : page_list) {
-        auto p = Page::open(pname);
-        auto sub_result = p->intervalReader(query);
-        for (auto kv : sub_result) {
-          result[kv.first].push_back(kv.second);
+    auto page_list =
+        _catalog.find(query.ids, query.from, query.to, snapshot->number(), pred);
+    std::vector<std::string> pages{page_list.begin(), page_list.end()};
+    std::vector<Id2Cursor> sub_results(pages.size());
+
+    // pages are readed by 'tasks_count' tasks. task 'n' reads pages n, n+tasks_count,...
+    auto tasks_count =
+        std::min(pages.size(), size_t(_settings->threads_in_diskio.value()));
+    std::vector<TaskResult_Ptr> task_res(tasks_count);
+    for (size_t num = 0; num < tasks_count; ++num) {
+      AsyncTask at = [&query, &pages, &sub_results, num, tasks_count,
+                      this](const ThreadInfo &ti) {
+        TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
+        for (size_t i = num; i < pages.size(); i += tasks_count) {
+          auto p = open_page_to_read(pages[i]);
+          sub_results[i] = p->intervalReader(query);
         }
-      }
-
-      return false;
-    };
-    auto pm_async = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
-    pm_async->wait();
-    return CursorWrapperFactory::colapseCursors(result);
-  }
-
-  std::list<std::string> pages_by_filter(std::function<bool(const IndexFooter &)> pred) {
-    std::list<PageFooterDescription> sub_result;
-
-    for (auto f2h : _file2footer) {
-      auto hdr = f2h.second.hdr;
-      if (pred(hdr)) {
+        return false;
+      };
+      task_res[num] = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
+    }
 
-        sub_result.push_back(f2h.second);
-      }
+    for (auto &tw : task_res) {
+      tw->wait();
     }
 
-    std::vector<PageFooterDescription> vec_res{sub_result.begin(), sub_result.end()};
-    std::sort(vec_res.begin(), vec_res.end(),
-              [](auto lr, auto rr) { return lr.hdr.stat.minTime < rr.hdr.stat.minTime; });
-    std::list<std::string> result;
-    for (auto hd : vec_res) {
-      auto page_file_name = utils::fs::append_path(_settings->raw_path.value(), hd.path);
-      result.push_back(page_file_name);
-    }
-#ifdef DEBUG
-    std::list<Time> tm;
-    for (auto pname : result) {
-      auto pi = PageIndex::open(PageIndex::index_name_from_page_name(pname));
-      if (!tm.empty()) {
-        if (pi->iheader.stat.minTime < tm.back()) {
-          THROW_EXCEPTION("logic_error");
-        }
+    // merge in order of pages.
+    Id2CursorsList result;
+    for (auto &sub_result : sub_results) {
+      for (auto kv : sub_result) {
+        result[kv.first].push_back(kv.second);
       }
-      tm.push_back(pi->iheader.stat.minTime);
     }
-#endif
-    return result;
+    return CursorWrapperFactory::colapseCursors(result);
   }
 
+
   Id2Meas valuesBeforeTimePoint(const QueryTimePoint &query) {
+    auto snapshot = _snapshots->pin();
+    auto version = snapshot->number();
     Id2Meas result;
 
     for (auto id : query.ids) {
@@ -283,33 +441,34 @@ public:
       result[id].time = query.time_point;
     }
 
-    AsyncTask at = [&query, &result, this](const ThreadInfo &ti) {
+    AsyncTask at = [&query, &result, version, this](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-      auto pred = [query](const IndexFooter &hdr) {
-        auto in_check =
-            utils::inInterval(hdr.stat.minTime, hdr.stat.maxTime, query.time_point) ||
-            (hdr.stat.maxTime < query.time_point);
-        if (in_check) {
-          for (auto id : query.ids) {
-            if (storage::bloom_check(hdr.id_bloom, id)) {
-              return true;
-            }
-          }
-        }
-        return false;
-      };
-
-      auto page_list = pages_by_filter(std::function<bool(IndexFooter)>(pred));
+      auto page_list = _catalog.footers(query.ids, MIN_TIME, query.time_point, version);
+      // max_before[i] - max of maxTime of pages [0, i).
+      std::vector<Time> max_before(page_list.size() + 1, MIN_TIME);
+      for (size_t i = 0; i < page_list.size(); ++i) {
+        max_before[i + 1] = std::max(max_before[i], page_list[i].second.stat.maxTime);
+      }
 
-      for (auto it = page_list.rbegin(); it != page_list.rend(); ++it) {
-        auto pname = *it;
-        auto pg = open_page_to_read(pname);
+      for (size_t i = page_list.size(); i > 0; --i) {
+        auto pg = open_page_to_read(page_list[i - 1].first);
 
         auto subres = pg->valuesBeforeTimePoint(query);
         for (auto kv : subres) {
-          result[kv.first] = kv.second;
+          auto &cur = result[kv.first];
+          // pages overlap in time, so older page may hold newer value.
+          if (cur.flag == FLAGS::_NO_DATA || cur.time < kv.second.time) {
+            cur = kv.second;
+          }
         }
-        if (subres.size() == query.ids.size()) {
+        // rest pages can not hold values newer than found.
+        auto found_all = !query.ids.empty() &&
+                         std::all_of(result.begin(), result.end(),
+                                     [&max_before, i](const Id2Meas::value_type &kv) {
+                                       return kv.second.flag != FLAGS::_NO_DATA &&
+                                              kv.second.time >= max_before[i - 1];
+                                     });
+        if (found_all) {
           break;
         }
       }
@@ -329,34 +488,13 @@ public:
   // PM
   size_t files_count() const { return _manifest->page_list().size(); }
 
-  dariadb::Time minTime() {
-
-    auto pred = [](const IndexFooter &) { return true; };
-
-    auto page_list = pages_by_filter(std::function<bool(IndexFooter)>(pred));
-
-    dariadb::Time res = dariadb::MAX_TIME;
-    for (auto pname : page_list) {
-      auto ih = Page::readIndexFooter(PageIndex::index_name_from_page_name(pname));
-      res = std::min(ih.stat.minTime, res);
-    }
-
-    return res;
+  compression::BLOCK_COMPRESSION blocks_for(uint16_t level) const {
+    return compression::block_compression_for(_settings->page_compression.value(),
+                                              level);
   }
-  dariadb::Time maxTime() {
 
-    auto pred = [](const IndexFooter &) { return true; };
-
-    auto page_list = pages_by_filter(std::function<bool(IndexFooter)>(pred));
-
-    dariadb::Time res = dariadb::MIN_TIME;
-    for (auto pname : page_list) {
-      auto ih = Page::readIndexFooter(PageIndex::index_name_from_page_name(pname));
-      res = std::max(ih.stat.maxTime, res);
-    }
-
-    return res;
-  }
+  dariadb::Time minTime() { return _catalog.minTime(); }
+  dariadb::Time maxTime() { return _catalog.maxTime(); }
 
   // from wall
   void append(const std::string &file_prefix, const dariadb::MeasArray &ma) {
@@ -369,12 +507,24 @@ public:
     std::string page_name = file_prefix + PAGE_FILE_EXT;
     std::string file_name =
         dariadb::utils::fs::append_path(_settings->raw_path.value(), page_name);
-    res = Page::create(file_name, MIN_LEVEL, last_id, _settings->chunk_size.value(), ma);
+    {
+      std::lock_guard<std::mutex> lg(_last_id_locker);
+      res = Page::create(file_name, MIN_LEVEL, last_id, _settings->chunk_size.value(),
+                         ma, _settings->chunk_codec.value(), blocks_for(MIN_LEVEL));
+      last_id = res->footer.max_chunk_id;
+    }
     _manifest->page_append(page_name);
-    last_id = res->footer.max_chunk_id;
 
-    insert_pagedescr(page_name, Page::readIndexFooter(
-                                    PageIndex::index_name_from_page_name(file_name)));
+    if (_rollups != nullptr) {
+      mark_overwritten(ma);
+    }
+    publish_pagedescr(page_name, PageIndex::index_name_from_page_name(file_name));
+    if (_rollups != nullptr) {
+      _rollups->append(ma);
+      if (_backfill_pending) {
+        _rollups->page_filled(page_name);
+      }
+    }
   }
 
   static void erase(const std::string &storage_path, const std::string &fname) {
@@ -383,40 +533,55 @@ public:
     utils::fs::rm(PageIndex::index_name_from_page_name(full_file_name));
   }
 
+  static void rebuildIndex(const std::string &storage_path, const std::string &fname) {
+    auto full_file_name = utils::fs::append_path(storage_path, fname);
+    utils::fs::rm(PageIndex::index_name_from_page_name(full_file_name));
+    Page::restoreIndexFile(full_file_name);
+  }
+
   void erase_page(const std::string &full_file_name) {
     auto fname = utils::fs::extract_filename(full_file_name);
-
     _manifest->page_rm(fname);
-    utils::fs::rm(full_file_name);
-    utils::fs::rm(PageIndex::index_name_from_page_name(full_file_name));
-    auto it = _file2footer.begin();
-    for (; it != _file2footer.end(); ++it) {
-      if (it->second.path == fname) {
-        break;
-      }
-    }
-    _file2footer.erase(it);
+    _catalog.erase(fname);
+    remove_page_files(full_file_name);
+  }
+
+  /// page must be already removed from manifest and catalog.
+  /// files are removed, when readers of current snapshot are finished.
+  void remove_page_files(const std::string &full_file_name) {
+    auto cache = _index_cache.get();
+    _snapshots->defer([cache, full_file_name]() {
+      cache->erase(full_file_name);
+      utils::fs::rm(full_file_name);
+      utils::fs::rm(PageIndex::index_name_from_page_name(full_file_name));
+    });
   }
 
   void eraseOld(const Time t) {
+    std::lock_guard<std::mutex> lg(_compaction_locker);
     auto pred = [t](const IndexFooter &hdr) {
       auto in_check = hdr.stat.maxTime <= t;
       return in_check;
     };
 
-    auto page_list = pages_by_filter(std::function<bool(IndexFooter)>(pred));
+    auto page_list = _catalog.find(pred);
     for (auto &p : page_list) {
       this->erase_page(p);
     }
   }
 
   void repack() {
+    std::lock_guard<std::mutex> lg(_compaction_locker);
+    if (_backfill_pending) {
+      logger_info("engine", _settings->alias, ": repack is skipped, rollup back-fill.");
+      return;
+    }
     auto max_files_per_level = _settings->max_pages_in_level.value();
 
     for (uint16_t level = MIN_LEVEL; level < MAX_LEVEL; ++level) {
       auto pred = [level](const IndexFooter &hdr) { return hdr.level == level; };
 
-      auto page_list = pages_by_filter(std::function<bool(IndexFooter)>(pred));
+      auto page_list = _catalog.find(pred, 0);
 
       while (page_list.size() > max_files_per_level) { // while level is filled
         std::list<std::string> part;
@@ -430,63 +595,249 @@ public:
         if (part.size() < size_t(2)) {
           break;
         }
-        repack(level + 1, part);
+        repack(level + 1, part, nullptr);
       }
     }
   }
 
-  void repack(uint16_t out_lvl, std::list<std::string> part) {
+  /// _compaction_locker must be locked. readers are not blocked: new page replaces
+  /// 'part' in catalog at once, old files live while readers hold older snapshot.
+  void repack(uint16_t out_lvl, std::list<std::string> part, RateLimiter *limiter) {
     Page_Ptr res = nullptr;
     std::string page_name = utils::fs::random_file_name(".page");
     logger_info("engine", _settings->alias, ": repack to level", out_lvl, " page: ",
                 page_name);
+    std::list<std::string> part_names;
     for (auto &p : part) {
-      logger_info("==> ", utils::fs::extract_filename(p));
+      part_names.push_back(utils::fs::extract_filename(p));
+      logger_info("==> ", part_names.back());
     }
     auto start_time = clock();
     std::string file_name =
         dariadb::utils::fs::append_path(_settings->raw_path.value(), page_name);
-    res =
-        Page::repackTo(file_name, out_lvl, last_id, _settings->chunk_size.value(), part);
-    _manifest->page_append(page_name);
-    last_id = res->footer.max_chunk_id;
 
-    for (auto erasedPage : part) {
-      this->erase_page(erasedPage);
+    // data of part is older than pages, which will be written while repacking,
+    // so ids of its chunks are reserved now by count of chunks in part. merged values
+    // of overlapped chunks may take more chunks: then page is written again with ids
+    // reserved by count of values (page has at least one value per chunk).
+    uint64_t chunks_count = 0;
+    uint64_t values_count = 0;
+    for (auto &p : part) {
+      auto footer = Page::readIndexFooter(PageIndex::index_name_from_page_name(p));
+      chunks_count += footer.recs_count;
+      values_count += footer.stat.count;
+    }
+    for (auto reserved : {chunks_count, values_count}) {
+      uint64_t first_id = 0;
+      {
+        std::lock_guard<std::mutex> lg(_last_id_locker);
+        first_id = last_id;
+        last_id += reserved + 1;
+      }
+      try {
+        res = Page::repackTo(file_name, out_lvl, first_id, _settings->chunk_size.value(),
+                             part, limiter, _settings->chunk_codec.value(),
+                             blocks_for(out_lvl));
+      } catch (...) {
+        erase(_settings->raw_path.value(), page_name);
+        throw;
+      }
+      if (res->footer.max_chunk_id <= first_id + reserved + 1) {
+        break;
+      }
+      logger_info("engine", _settings->alias, ": repack needs more than ", reserved,
+                  " chunk ids, page is written again.");
+      res = nullptr;
+      erase(_settings->raw_path.value(), page_name);
+    }
+    _manifest->page_replace(part_names, page_name);
+    insert_pagedescr(page_name, PageIndex::index_name_from_page_name(file_name),
+                     part_names);
+    for (auto &erasedPage : part) {
+      remove_page_files(erasedPage);
     }
-
-    insert_pagedescr(page_name, Page::readIndexFooter(
-                                    PageIndex::index_name_from_page_name(file_name)));
     auto elapsed = double(clock() - start_time) / CLOCKS_PER_SEC;
 
     logger("engine", _settings->alias, ": repack end. elapsed ", elapsed, "s");
   }
 
+  struct CompactionJob {
+    uint16_t level;
+    std::list<std::string> pages;
+  };
+
+  /// first level with more than max_pages_in_level pages. from its pages (sorted by
+  /// time) take max_pages_in_level neighbours with biggest overlap, then smallest size.
+  CompactionJob pick_compaction_job() {
+    CompactionJob result;
+    result.level = MIN_LEVEL;
+    auto max_files_per_level = size_t(_settings->max_pages_in_level.value());
+    if (max_files_per_level < size_t(2)) {
+      return result;
+    }
+
+    // pages, which are hidden from some readers, are not compacted yet.
+    std::vector<uint64_t> all_sizes;
+    auto all_pages = _catalog.footers(nullptr, 0, &all_sizes);
+    std::map<uint16_t, std::vector<std::pair<std::string, IndexFooter>>> levels;
+    std::map<uint16_t, std::vector<uint64_t>> level_sizes;
+    for (size_t i = 0; i < all_pages.size(); ++i) {
+      levels[all_pages[i].second.level].push_back(all_pages[i]);
+      level_sizes[all_pages[i].second.level].push_back(all_sizes[i]);
+    }
+
+    for (auto &kv : levels) {
+      auto &pages = kv.second;
+      if (kv.first == MAX_LEVEL || pages.size() <= max_files_per_level) {
+        continue;
+      }
+      auto &sizes = level_sizes[kv.first];
+
+      size_t best_pos = 0;
+      Time best_overlap = 0;
+      uint64_t best_size = std::numeric_limits<uint64_t>::max();
+      for (size_t i = 0; i + max_files_per_level <= pages.size(); ++i) {
+        Time overlap = 0;
+        uint64_t size = 0;
+        for (size_t j = i; j < i + max_files_per_level; ++j) {
+          size += sizes[j];
+          auto &lhs = pages[j].second.stat;
+          for (size_t k = j + 1; k < i + max_files_per_level; ++k) {
+            auto &rhs = pages[k].second.stat;
+            auto from = std::max(lhs.minTime, rhs.minTime);
+            auto to = std::min(lhs.maxTime, rhs.maxTime);
+            if (from <= to) {
+              overlap += to - from + 1;
+            }
+          }
+        }
+        if (overlap > best_overlap || (overlap == best_overlap && size < best_size)) {
+          best_pos = i;
+          best_overlap = overlap;
+          best_size = size;
+        }
+      }
+
+      result.level = kv.first;
+      for (size_t i = best_pos; i < best_pos + max_files_per_level; ++i) {
+        result.pages.push_back(pages[i].first);
+      }
+      break;
+    }
+    return result;
+  }
+
+  bool compactOnce() {
+    std::lock_guard<std::mutex> lg(_compaction_locker);
+    if (_backfill_pending) { // new page would mix filled and not filled values.
+      return false;
+    }
+    auto job = pick_compaction_job();
+    if (job.pages.empty()) {
+      return false;
+    }
+    repack(job.level + 1, job.pages, _rate_limiter.get());
+    _compactions++;
+    return true;
+  }
+
+  void startCompaction() {
+    std::lock_guard<std::mutex> lg(_compaction_thread_locker);
+    if (_compaction_thread.joinable() || _settings->compaction_period.value() == 0) {
+      return;
+    }
+    _compaction_stop = false;
+    _compaction_thread = std::thread(&PageManager::Private::compaction_thread_func, this);
+  }
+
+  void stopCompaction() {
+    {
+      std::lock_guard<std::mutex> lg(_compaction_thread_locker);
+      _compaction_stop = true;
+    }
+    _compaction_cond.notify_all();
+    if (_compaction_thread.joinable()) {
+      _compaction_thread.join();
+    }
+  }
+
+  void compaction_thread_func() {
+    logger_info("engine", _settings->alias, ": compaction thread started.");
+    auto period = std::chrono::milliseconds(_settings->compaction_period.value());
+    std::unique_lock<std::mutex> ul(_compaction_thread_locker);
+    while (!_compaction_stop) {
+      _compaction_cond.wait_for(ul, period, [this]() { return _compaction_stop.load(); });
+      if (_compaction_stop) {
+        break;
+      }
+      ul.unlock();
+      try {
+        while (!_compaction_stop && compactOnce()) {
+        }
+      } catch (std::exception &ex) {
+        logger_fatal("engine", _settings->alias, ": compaction error - ", ex.what());
+      }
+      ul.lock();
+    }
+    logger_info("engine", _settings->alias, ": compaction thread stoped.");
+  }
+
   void appendChunks(const std::vector<Chunk *> &a, size_t count) {
     Page_Ptr res = nullptr;
     std::string page_name = utils::fs::random_file_name(".page");
     logger_info("engine", _settings->alias, ": write chunks to ", page_name);
     std::string file_name =
         dariadb::utils::fs::append_path(_settings->raw_path.value(), page_name);
-    res = Page::create(file_name, MIN_LEVEL, last_id, a, count);
+    {
+      std::lock_guard<std::mutex> lg(_last_id_locker);
+      res = Page::create(file_name, MIN_LEVEL, last_id, a, count, blocks_for(MIN_LEVEL));
+      last_id = res->footer.max_chunk_id;
+    }
     _manifest->page_append(page_name);
-    last_id = res->footer.max_chunk_id;
 
-    insert_pagedescr(page_name, Page::readIndexFooter(
-                                    PageIndex::index_name_from_page_name(file_name)));
+    if (_rollups != nullptr) {
+      mark_overwritten(a, count, nullptr);
+    }
+    publish_pagedescr(page_name, PageIndex::index_name_from_page_name(file_name));
+    if (_rollups != nullptr) {
+      _rollups->append(a, count);
+      if (_backfill_pending) {
+        _rollups->page_filled(page_name);
+      }
+    }
   }
 
-  void insert_pagedescr(std::string page_name, IndexFooter hdr) {
-    PageFooterDescription ph_d;
-    ph_d.hdr = hdr;
-    ph_d.path = page_name;
-    _file2footer.insert(std::make_pair(ph_d.hdr.stat.maxTime, ph_d));
+  /// page written from upper level is inserted to catalog in new snapshot version
+  /// (or in version of begun publication), readers of older ones do not see it.
+  void publish_pagedescr(const std::string &page_name, const std::string &index_file_name) {
+    auto index = PageIndex::open(index_file_name);
+    auto id_bloom = PageIndex::readIdBloom(index_file_name, index->iheader);
+    auto full_path = utils::fs::append_path(_settings->raw_path.value(), page_name);
+    auto hdr = index->iheader;
+    auto ids = index->ids();
+    auto catalog = &_catalog;
+    _snapshots->publish(
+        [catalog, page_name, full_path, hdr, id_bloom, ids](uint64_t version) {
+          catalog->insert(page_name, full_path, hdr, id_bloom, ids, version);
+        },
+        [catalog, page_name]() { catalog->settle(page_name); });
+  }
+
+  /// insert page to catalog. pages 'replaced' are removed from catalog at same time.
+  void insert_pagedescr(std::string page_name, const std::string &index_file_name,
+                        const std::list<std::string> &replaced = {}) {
+    auto index = PageIndex::open(index_file_name);
+    auto id_bloom = PageIndex::readIdBloom(index_file_name, index->iheader);
+    auto full_path = utils::fs::append_path(_settings->raw_path.value(), page_name);
+    _catalog.replace(replaced, page_name, full_path, index->iheader, id_bloom,
+                     index->ids());
   }
 
   Id2MinMax loadMinMax() {
+    auto snapshot = _snapshots->pin();
     Id2MinMax result;
 
-    auto pages = pages_by_filter([](const IndexFooter &ih) { return true; });
+    auto pages = _catalog.find(nullptr, snapshot->number());
 
     AsyncTask at = [&result, &pages, this](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
@@ -505,15 +856,39 @@ public:
     return result;
   }
 
+  pages::Description description() const {
+    auto result = _index_cache->description();
+    result.compactions = _compactions;
+    return result;
+  }
+
 protected:
   Page_Ptr _cur_page;
   mutable std::mutex _page_open_lock;
+  std::unique_ptr<IndexCache> _index_cache;
 
+  std::mutex _last_id_locker;
   uint64_t last_id;
-  File2PageFooter _file2footer;
+  PageCatalog _catalog;
+  /// readers pin snapshot, while pages are readed. shared by levels of engine.
+  SnapshotManager *_snapshots;
+  std::unique_ptr<SnapshotManager> _own_snapshots;
+
+  /// only one repack/erase job at a time.
+  std::mutex _compaction_locker;
+  std::unique_ptr<RateLimiter> _rate_limiter;
+  std::atomic_size_t _compactions;
+  std::thread _compaction_thread;
+  std::mutex _compaction_thread_locker;
+  std::condition_variable _compaction_cond;
+  std::atomic_bool _compaction_stop;
+  TaskResult_Ptr _backfill_task;
+  std::atomic_bool _backfill_stop;
+  std::atomic_bool _backfill_pending;
   EngineEnvironment_ptr _env;
   Settings *_settings;
   Manifest *_manifest;
+  RollupManager *_rollups; /// nullptr - if rollups are disabled.
 };
 
 PageManager_ptr PageManager::create(const EngineEnvironment_ptr env) {
@@ -546,10 +921,18 @@ Statistic PageManager::stat(const Id id, Time from, Time to) {
   return impl->stat(id, from, to);
 }
 
+bool PageManager::isOverlapped(const Id id, Time from, Time to) {
+  return impl->isOverlapped(id, from, to);
+}
+
 size_t PageManager::files_count() const {
   return impl->files_count();
 }
 
+pages::Description PageManager::description() const {
+  return impl->description();
+}
+
 size_t PageManager::chunks_in_cur_page() const {
   return impl->chunks_in_cur_page();
 }
@@ -577,6 +960,11 @@ void PageManager::erase(const std::string &storage_path, const std::string &fnam
   Private::erase(storage_path, fname);
 }
 
+void PageManager::rebuildIndex(const std::string &storage_path,
+                               const std::string &fname) {
+  Private::rebuildIndex(storage_path, fname);
+}
+
 void PageManager::erase_page(const std::string &fname) {
   impl->erase_page(fname);
 }
@@ -585,6 +973,18 @@ void PageManager::repack() {
   impl->repack();
 }
 
+bool PageManager::compactOnce() {
+  return impl->compactOnce();
+}
+
+void PageManager::startCompaction() {
+  impl->startCompaction();
+}
+
+void PageManager::stopCompaction() {
+  impl->stopCompaction();
+}
+
 void PageManager::appendChunks(const std::vector<Chunk *> &a, size_t count) {
   impl->appendChunks(a, count);
 }
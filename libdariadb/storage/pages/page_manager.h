@@ -5,6 +5,7 @@
 #include <libdariadb/storage/chunk.h>
 #include <libdariadb/storage/chunkcontainer.h>
 #include <libdariadb/storage/engine_environment.h>
+#include <libdariadb/storage/pages/description.h>
 #include <libdariadb/utils/utils.h>
 #include <vector>
 
@@ -24,7 +25,11 @@ public:
   EXPORT Id2Meas valuesBeforeTimePoint(const QueryTimePoint &q) override;
   EXPORT Id2Cursor intervalReader(const QueryInterval &query) override;
   EXPORT Statistic stat(const Id id, Time from, Time to) override;
+  /// true, if pages which may store 'id' in [from, to] overlap in time,
+  /// so they may store values with the same time twice.
+  EXPORT bool isOverlapped(const Id id, Time from, Time to);
   EXPORT size_t files_count() const;
+  EXPORT pages::Description description() const;
   EXPORT size_t chunks_in_cur_page() const;
   EXPORT dariadb::Time minTime();
   EXPORT dariadb::Time maxTime();
@@ -37,7 +42,15 @@ public:
   EXPORT void eraseOld(const Time t);
   EXPORT void erase_page(const std::string &fname);
   EXPORT static void erase(const std::string &storage_path, const std::string &fname);
+  /// write index file of page again.
+  EXPORT static void rebuildIndex(const std::string &storage_path,
+                                  const std::string &fname);
   EXPORT void repack();
+  /// run one background compaction job. false - if nothing to compact.
+  EXPORT bool compactOnce();
+  /// start thread, which calls compactOnce every 'compaction_period' ms.
+  EXPORT void startCompaction();
+  EXPORT void stopCompaction();
   EXPORT Id2MinMax loadMinMax();
 
 protected:
@@ -0,0 +1,719 @@
+#include <libdariadb/storage/manifest.h>
+#include <libdariadb/storage/rollup.h>
+#include <libdariadb/storage/settings.h>
+#include <libdariadb/storage/snapshot.h>
+#include <libdariadb/timeutil.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/fs.h>
+#include <libdariadb/utils/logger.h>
+#include <libdariadb/utils/strings.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+
+using namespace dariadb;
+using namespace dariadb::storage;
+
+namespace rollup_inner {
+/// buckets of tier in one partition.
+const Time BUCKETS_IN_PARTITION = 1024;
+/// files of one partition are merged, when their count is greater.
+const size_t MAX_FILES_IN_PARTITION = 4;
+/// exists in tier folder, while the tier is not back-filled from pages. lines are
+/// names of pages, which values are already in the tier.
+const std::string BACKFILL_FILE = "backfill";
+/// ranges of times, which were written to pages more than once.
+const std::string OVERWRITTEN_FILE = "overwritten";
+
+#pragma pack(push, 1)
+struct OverwrittenReccord {
+  Id id;
+  Time from;
+  Time to;
+};
+#pragma pack(pop)
+
+using Key = std::pair<Id, Time>;
+using Reccords = std::map<Key, Statistic>;
+}
+
+using namespace rollup_inner;
+
+RollupTiers dariadb::storage::parse_rollup_tiers(const std::string &s) {
+  RollupTiers result;
+  for (auto &t : utils::strings::split(s, ',')) {
+    auto step_retention = utils::strings::split(t, ':');
+    if (step_retention.size() != 2) {
+      THROW_EXCEPTION("rollup: bad tier - ", t);
+    }
+    RollupTier tier;
+    tier.step = std::stoull(step_retention[0]);
+    tier.retention = std::stoull(step_retention[1]);
+    if (tier.step == Time(0)) {
+      THROW_EXCEPTION("rollup: step must be greater than zero - ", t);
+    }
+    result.push_back(tier);
+  }
+  std::sort(result.begin(), result.end(),
+            [](const RollupTier &l, const RollupTier &r) { return l.step < r.step; });
+  return result;
+}
+
+class RollupManager::Private {
+public:
+  /// file is seen by readers of snapshot version 'since' and newer ones.
+  struct PartitionFile {
+    std::string name;
+    uint64_t since;
+  };
+
+  struct TierFiles {
+    RollupTier tier;
+    std::string path;
+    /// partition number -> files.
+    std::map<Time, std::list<PartitionFile>> partitions;
+    /// tier was created after pages were written.
+    bool backfill;
+    /// pages, which are back-filled or appended, while tier is back-filled.
+    std::set<std::string> filled;
+  };
+
+  Private(const EngineEnvironment_ptr env) {
+    _settings = env->getResourceObject<Settings>(EngineEnvironment::Resource::SETTINGS);
+    _tiers = parse_rollup_tiers(_settings->rollup_tiers.value());
+    _next_file = 0;
+    _snapshots = nullptr;
+    if (_tiers.empty()) {
+      return;
+    }
+    if (env->hasResource(EngineEnvironment::Resource::SNAPSHOTS)) {
+      _snapshots =
+          env->getResourceObject<SnapshotManager>(EngineEnvironment::Resource::SNAPSHOTS);
+    } else {
+      _own_snapshots = std::make_unique<SnapshotManager>();
+      _snapshots = _own_snapshots.get();
+    }
+    bool has_pages = false;
+    if (env->hasResource(EngineEnvironment::Resource::MANIFEST)) {
+      auto manifest =
+          env->getResourceObject<Manifest>(EngineEnvironment::Resource::MANIFEST);
+      has_pages = !manifest->page_list().empty();
+    }
+    utils::fs::mkdir(_settings->rollup_path.value());
+    for (auto &t : _tiers) {
+      TierFiles tf;
+      tf.tier = t;
+      tf.path = utils::fs::append_path(_settings->rollup_path.value(),
+                                       std::to_string(t.step));
+      auto backfill_file = utils::fs::append_path(tf.path, BACKFILL_FILE);
+      if (!utils::fs::path_exists(tf.path)) {
+        utils::fs::mkdir(tf.path);
+        if (has_pages) {
+          std::ofstream(backfill_file).close();
+        }
+      }
+      tf.backfill = utils::fs::file_exists(backfill_file);
+      if (tf.backfill) {
+        // back-fill was interrupted, it is continued from the next page.
+        std::ifstream ifs(backfill_file);
+        std::string page;
+        while (std::getline(ifs, page)) {
+          if (!page.empty()) {
+            tf.filled.insert(page);
+          }
+        }
+        if (tf.filled.empty()) {
+          for (auto &f : utils::fs::ls(tf.path, ROLLUP_FILE_EXT)) {
+            utils::fs::rm(f);
+          }
+        }
+      }
+      // file was not written to the end.
+      for (auto &f : utils::fs::ls(tf.path, ".tmp")) {
+        logger_info("engine", _settings->alias, ": rollup rm ", f);
+        utils::fs::rm(f);
+      }
+      for (auto &f : utils::fs::ls(tf.path, ROLLUP_FILE_EXT)) {
+        // <partition>_<number>.rollup
+        auto parts = utils::strings::split(utils::fs::filename(f), '_');
+        if (parts.size() != 2) {
+          THROW_EXCEPTION("rollup: bad file name - ", f);
+        }
+        tf.partitions[std::stoull(parts[0])].push_back(PartitionFile{f, 0});
+        _next_file = std::max(_next_file, uint64_t(std::stoull(parts[1]) + 1));
+      }
+      _files.push_back(tf);
+    }
+    load_overwritten();
+  }
+
+  std::string overwritten_file() const {
+    return utils::fs::append_path(_settings->rollup_path.value(), OVERWRITTEN_FILE);
+  }
+
+  void load_overwritten() {
+    auto file = std::fopen(overwritten_file().c_str(), "rb");
+    if (file == nullptr) {
+      return;
+    }
+    OverwrittenReccord r;
+    while (std::fread(&r, sizeof(OverwrittenReccord), 1, file) == 1) {
+      _overwritten[r.id].emplace_back(r.from, r.to);
+    }
+    std::fclose(file);
+  }
+
+  /// times are sorted. times closer than smallest step are joined to one range.
+  void overwritten(Id id, const std::vector<Time> &times) {
+    if (times.empty() || _tiers.empty()) {
+      return;
+    }
+    std::vector<OverwrittenReccord> recs;
+    auto min_step = _tiers.front().step;
+    for (auto t : times) {
+      if (!recs.empty() && t - recs.back().to < min_step) {
+        recs.back().to = t;
+      } else {
+        recs.push_back(OverwrittenReccord{id, t, t});
+      }
+    }
+    std::lock_guard<std::shared_mutex> lg(_overwritten_locker);
+    auto file = std::fopen(overwritten_file().c_str(), "ab");
+    if (file == nullptr) {
+      THROW_EXCEPTION("can`t open file ", overwritten_file());
+    }
+    std::fwrite(recs.data(), sizeof(OverwrittenReccord), recs.size(), file);
+    std::fclose(file);
+    for (auto &r : recs) {
+      _overwritten[id].emplace_back(r.from, r.to);
+    }
+  }
+
+  bool is_exact(Id id, Time from, Time to) const {
+    std::shared_lock<std::shared_mutex> lg(_overwritten_locker);
+    auto it = _overwritten.find(id);
+    if (it == _overwritten.end()) {
+      return true;
+    }
+    return std::none_of(it->second.begin(), it->second.end(),
+                        [from, to](const std::pair<Time, Time> &r) {
+                          return r.first <= to && r.second >= from;
+                        });
+  }
+
+  /// ranges, which end before 't', are not needed.
+  void erase_overwritten(Time t) {
+    std::lock_guard<std::shared_mutex> lg(_overwritten_locker);
+    std::vector<OverwrittenReccord> recs;
+    for (auto &kv : _overwritten) {
+      auto &ranges = kv.second;
+      ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                  [t](const std::pair<Time, Time> &r) {
+                                    return r.second < t;
+                                  }),
+                   ranges.end());
+      for (auto &r : ranges) {
+        recs.push_back(OverwrittenReccord{kv.first, r.first, r.second});
+      }
+    }
+    auto tmp_name = overwritten_file() + ".tmp";
+    auto file = std::fopen(tmp_name.c_str(), "wb");
+    if (file == nullptr) {
+      THROW_EXCEPTION("can`t open file ", tmp_name);
+    }
+    std::fwrite(recs.data(), sizeof(OverwrittenReccord), recs.size(), file);
+    std::fclose(file);
+    if (std::rename(tmp_name.c_str(), overwritten_file().c_str()) != 0) {
+      THROW_EXCEPTION("rollup: can`t rename ", tmp_name);
+    }
+  }
+
+  static Time bucket_of(const RollupTier &tier, Time t) { return t - t % tier.step; }
+
+  static Time partition_of(const RollupTier &tier, Time bucket) {
+    return bucket / tier.step / BUCKETS_IN_PARTITION;
+  }
+
+  void append(const MeasArray &ma) {
+    std::lock_guard<std::mutex> lg(_write_locker);
+    for (auto &tf : _files) {
+      Reccords recs;
+      for (auto &m : ma) {
+        recs[Key(m.id, bucket_of(tf.tier, m.time))].update(m);
+      }
+      write(tf, recs);
+    }
+  }
+
+  void append(const std::vector<Chunk *> &a, size_t count) {
+    std::lock_guard<std::mutex> lg(_write_locker);
+    for (auto &tf : _files) {
+      write(tf, chunks_reccords(tf.tier, a, count));
+    }
+  }
+
+  static Reccords chunks_reccords(const RollupTier &tier, const std::vector<Chunk *> &a,
+                                  size_t count) {
+    Reccords recs;
+    for (size_t i = 0; i < count; ++i) {
+      auto hdr = a[i]->header;
+      auto bucket = bucket_of(tier, hdr->stat.minTime);
+      // chunk inside one bucket - without decompression.
+      if (bucket == bucket_of(tier, hdr->stat.maxTime)) {
+        recs[Key(hdr->meas_id, bucket)].update(hdr->stat);
+        continue;
+      }
+      auto rdr = a[i]->getReader();
+      while (!rdr->is_end()) {
+        auto m = rdr->readNext();
+        recs[Key(m.id, bucket_of(tier, m.time))].update(m);
+      }
+    }
+    return recs;
+  }
+
+  bool need_backfill() const {
+    std::shared_lock<std::shared_mutex> lg(_locker);
+    return std::any_of(_files.begin(), _files.end(),
+                       [](const TierFiles &tf) { return tf.backfill; });
+  }
+
+  bool need_backfill(const std::string &page) const {
+    std::shared_lock<std::shared_mutex> lg(_locker);
+    return std::any_of(_files.begin(), _files.end(), [&page](const TierFiles &tf) {
+      return tf.backfill && tf.filled.count(page) == 0;
+    });
+  }
+
+  /// page is remembered in marker file, so back-fill is resumed after it.
+  void set_filled(TierFiles &tf, const std::string &page) {
+    std::ofstream ofs(utils::fs::append_path(tf.path, BACKFILL_FILE), std::ios::app);
+    ofs << page << '\n';
+    ofs.close();
+    std::lock_guard<std::shared_mutex> lg(_locker);
+    tf.filled.insert(page);
+  }
+
+  void backfill(const std::vector<Chunk *> &a, size_t count, const std::string &page) {
+    std::lock_guard<std::mutex> lg(_write_locker);
+    for (auto &tf : _files) {
+      if (tf.backfill && tf.filled.count(page) == 0) {
+        write(tf, chunks_reccords(tf.tier, a, count));
+        set_filled(tf, page);
+      }
+    }
+  }
+
+  void page_filled(const std::string &page) {
+    std::lock_guard<std::mutex> lg(_write_locker);
+    for (auto &tf : _files) {
+      if (tf.backfill) {
+        set_filled(tf, page);
+      }
+    }
+  }
+
+  void backfill_done() {
+    std::lock_guard<std::mutex> lg(_write_locker);
+    for (auto &tf : _files) {
+      if (tf.backfill) {
+        utils::fs::rm(utils::fs::append_path(tf.path, BACKFILL_FILE));
+        std::lock_guard<std::shared_mutex> lg_files(_locker);
+        tf.backfill = false;
+        tf.filled.clear();
+      }
+    }
+  }
+
+  void write(TierFiles &tf, const Reccords &recs) {
+    std::map<Time, std::vector<RollupReccord>> by_partition;
+    for (auto &kv : recs) {
+      RollupReccord r;
+      r.id = kv.first.first;
+      r.bucket = kv.first.second;
+      r.stat = kv.second;
+      by_partition[partition_of(tf.tier, r.bucket)].push_back(r);
+    }
+
+    for (auto &kv : by_partition) {
+      auto fname = write_file(tf, kv.first, kv.second);
+      auto partition = kv.first;
+      auto files = &tf.partitions;
+      // values are seen in rollup in version, where their page is published.
+      _snapshots->publish(
+          [this, files, partition, fname](uint64_t version) {
+            std::lock_guard<std::shared_mutex> lg(_locker);
+            (*files)[partition].push_back(PartitionFile{fname, version});
+          },
+          [this, files, partition, fname]() {
+            std::lock_guard<std::shared_mutex> lg(_locker);
+            auto it = files->find(partition);
+            if (it != files->end()) {
+              for (auto &f : it->second) {
+                if (f.name == fname) {
+                  f.since = 0;
+                }
+              }
+            }
+          });
+      bool need_merge = false;
+      {
+        std::shared_lock<std::shared_mutex> lg(_locker);
+        auto it = tf.partitions.find(partition);
+        need_merge = it != tf.partitions.end() &&
+                     size_t(std::count_if(it->second.begin(), it->second.end(),
+                                          [](const PartitionFile &f) {
+                                            return f.since == 0;
+                                          })) > MAX_FILES_IN_PARTITION;
+      }
+      if (need_merge) {
+        merge(tf, partition, MIN_TIME);
+      }
+    }
+
+    if (tf.tier.retention != Time(0)) {
+      erase_before(tf, retention_limit(tf.tier), true);
+    }
+  }
+
+  /// reccords must be sorted by (id, bucket).
+  std::string write_file(const TierFiles &tf, Time partition,
+                         const std::vector<RollupReccord> &recs) {
+    ENSURE(!recs.empty());
+    auto fname = utils::fs::append_path(tf.path, std::to_string(partition) + "_" +
+                                                     std::to_string(_next_file++) +
+                                                     ROLLUP_FILE_EXT);
+    auto tmp_name = fname + ".tmp";
+
+    RollupHeader hdr;
+    hdr.count = recs.size();
+    hdr.minBucket = MAX_TIME;
+    hdr.maxBucket = MIN_TIME;
+    for (auto &r : recs) {
+      hdr.minBucket = std::min(hdr.minBucket, r.bucket);
+      hdr.maxBucket = std::max(hdr.maxBucket, r.bucket);
+    }
+
+    auto file = std::fopen(tmp_name.c_str(), "wb");
+    if (file == nullptr) {
+      THROW_EXCEPTION("can`t open file ", tmp_name);
+    }
+    std::fwrite(&hdr, sizeof(RollupHeader), 1, file);
+    std::fwrite(recs.data(), sizeof(RollupReccord), recs.size(), file);
+    std::fclose(file);
+    if (std::rename(tmp_name.c_str(), fname.c_str()) != 0) {
+      THROW_EXCEPTION("rollup: can`t rename ", tmp_name);
+    }
+    return fname;
+  }
+
+  static std::vector<RollupReccord> read_file(const std::string &fname) {
+    auto file = std::fopen(fname.c_str(), "rb");
+    if (file == nullptr) {
+      THROW_EXCEPTION("can`t open file ", fname);
+    }
+    RollupHeader hdr;
+    std::vector<RollupReccord> result;
+    if (std::fread(&hdr, sizeof(RollupHeader), 1, file) == 1) {
+      result.resize(hdr.count);
+      auto readed = std::fread(result.data(), sizeof(RollupReccord), hdr.count, file);
+      result.resize(readed);
+    }
+    std::fclose(file);
+    return result;
+  }
+
+  /// merge files of partition, which are seen by all readers, to one. buckets, which
+  /// end before 'erase_before', are dropped.
+  void merge(TierFiles &tf, Time partition, Time erase_before) {
+    std::list<std::string> old_files;
+    {
+      std::shared_lock<std::shared_mutex> lg(_locker);
+      auto it = tf.partitions.find(partition);
+      if (it == tf.partitions.end()) {
+        return;
+      }
+      for (auto &f : it->second) {
+        if (f.since == 0) {
+          old_files.push_back(f.name);
+        }
+      }
+    }
+
+    Reccords recs;
+    for (auto &f : old_files) {
+      for (auto &r : read_file(f)) {
+        if (r.bucket + tf.tier.step > erase_before) {
+          recs[Key(r.id, r.bucket)].update(r.stat);
+        }
+      }
+    }
+    std::vector<RollupReccord> merged;
+    merged.reserve(recs.size());
+    for (auto &kv : recs) {
+      RollupReccord r;
+      r.id = kv.first.first;
+      r.bucket = kv.first.second;
+      r.stat = kv.second;
+      merged.push_back(r);
+    }
+
+    std::string new_file;
+    if (!merged.empty()) {
+      new_file = write_file(tf, partition, merged);
+    }
+    {
+      std::lock_guard<std::shared_mutex> lg(_locker);
+      auto &files = tf.partitions[partition];
+      for (auto &f : old_files) {
+        files.remove_if([&f](const PartitionFile &pf) { return pf.name == f; });
+      }
+      if (!new_file.empty()) {
+        files.push_back(PartitionFile{new_file, 0});
+      }
+      if (files.empty()) {
+        tf.partitions.erase(partition);
+      }
+    }
+    for (auto &f : old_files) {
+      utils::fs::rm(f);
+    }
+  }
+
+  /// erase buckets, which end before 't'. if 'whole_partitions' - partition with 't'
+  /// is not rewritten.
+  void erase_before(TierFiles &tf, Time t, bool whole_partitions) {
+    std::list<Time> to_rm;
+    std::list<Time> to_merge;
+    {
+      std::shared_lock<std::shared_mutex> lg(_locker);
+      for (auto &kv : tf.partitions) {
+        auto partition_end = (kv.first + 1) * BUCKETS_IN_PARTITION * tf.tier.step;
+        if (partition_end <= t) {
+          to_rm.push_back(kv.first);
+        } else if (kv.first * BUCKETS_IN_PARTITION * tf.tier.step < t) {
+          to_merge.push_back(kv.first);
+        }
+      }
+    }
+    for (auto p : to_rm) {
+      std::list<PartitionFile> files;
+      {
+        std::lock_guard<std::shared_mutex> lg(_locker);
+        files = tf.partitions[p];
+        tf.partitions.erase(p);
+      }
+      for (auto &f : files) {
+        utils::fs::rm(f.name);
+      }
+    }
+    if (!whole_partitions) {
+      for (auto p : to_merge) {
+        merge(tf, p, t);
+      }
+    }
+  }
+
+  static Time retention_limit(const RollupTier &tier) {
+    auto now = timeutil::current_time();
+    return now > tier.retention ? now - tier.retention : MIN_TIME;
+  }
+
+  void eraseOld(Time t) {
+    std::lock_guard<std::mutex> lg(_write_locker);
+    auto min_limit = MAX_TIME;
+    for (auto &tf : _files) {
+      auto limit = tf.tier.retention == Time(0) ? t : retention_limit(tf.tier);
+      erase_before(tf, limit, false);
+      min_limit = std::min(min_limit, limit);
+    }
+    if (!_files.empty()) {
+      erase_overwritten(min_limit);
+    }
+  }
+
+  /// tier, which is back-filled, is not used.
+  bool tier_for(Time from, Time step, RollupTier *tier) const {
+    std::shared_lock<std::shared_mutex> lg(_locker);
+    for (auto it = _files.rbegin(); it != _files.rend(); ++it) {
+      if (!it->backfill && step % it->tier.step == 0 && from % it->tier.step == 0) {
+        *tier = it->tier;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// reccords of id in [from, to] from file. reccords are sorted by (id, bucket).
+  static void read_from_file(const std::string &fname, Id id, Time from, Time to,
+                             std::map<Time, Statistic> &result) {
+    auto file = std::fopen(fname.c_str(), "rb");
+    if (file == nullptr) {
+      THROW_EXCEPTION("can`t open file ", fname);
+    }
+    RollupHeader hdr;
+    if (std::fread(&hdr, sizeof(RollupHeader), 1, file) != 1 || hdr.minBucket > to ||
+        hdr.maxBucket < from) {
+      std::fclose(file);
+      return;
+    }
+    auto read_at = [file](uint64_t pos, RollupReccord *r) {
+      std::fseek(file, long(sizeof(RollupHeader) + pos * sizeof(RollupReccord)),
+                 SEEK_SET);
+      return std::fread(r, sizeof(RollupReccord), 1, file) == 1;
+    };
+
+    // first reccord not less than (id, from).
+    uint64_t lo = 0;
+    uint64_t hi = hdr.count;
+    RollupReccord r;
+    while (lo < hi) {
+      auto middle = lo + (hi - lo) / 2;
+      if (!read_at(middle, &r)) {
+        hi = middle;
+        continue;
+      }
+      if (Key(r.id, r.bucket) < Key(id, from)) {
+        lo = middle + 1;
+      } else {
+        hi = middle;
+      }
+    }
+
+    if (lo < hdr.count && read_at(lo, &r)) {
+      do {
+        if (r.id != id || r.bucket > to) {
+          break;
+        }
+        result[r.bucket].update(r.stat);
+      } while (std::fread(&r, sizeof(RollupReccord), 1, file) == 1);
+    }
+    std::fclose(file);
+  }
+
+  std::map<Time, Statistic> read(const RollupTier &tier, Id id, Time from, Time to) {
+    std::map<Time, Statistic> result;
+    if (_tiers.empty()) {
+      return result;
+    }
+    auto snapshot = _snapshots->pin();
+    auto version = snapshot->number();
+    std::shared_lock<std::shared_mutex> lg(_locker);
+    auto tf = std::find_if(_files.begin(), _files.end(), [&tier](const TierFiles &f) {
+      return f.tier.step == tier.step;
+    });
+    if (tf == _files.end()) {
+      return result;
+    }
+    from = bucket_of(tier, from);
+    auto last = partition_of(tier, to);
+    for (auto it = tf->partitions.lower_bound(partition_of(tier, from));
+         it != tf->partitions.end() && it->first <= last; ++it) {
+      for (auto &f : it->second) {
+        if (f.since <= version) {
+          read_from_file(f.name, id, from, to, result);
+        }
+      }
+    }
+    return result;
+  }
+
+  size_t files_count() const {
+    std::shared_lock<std::shared_mutex> lg(_locker);
+    size_t result = 0;
+    for (auto &tf : _files) {
+      for (auto &kv : tf.partitions) {
+        result += kv.second.size();
+      }
+    }
+    return result;
+  }
+
+  Settings *_settings;
+  RollupTiers _tiers;
+  std::vector<TierFiles> _files;
+  uint64_t _next_file;
+  /// id -> ranges of times, which buckets are not exact.
+  std::map<Id, std::vector<std::pair<Time, Time>>> _overwritten;
+  mutable std::shared_mutex _overwritten_locker;
+  /// new files are published with pages of their values.
+  SnapshotManager *_snapshots;
+  std::unique_ptr<SnapshotManager> _own_snapshots;
+  /// appends and erases are serialized.
+  std::mutex _write_locker;
+  /// lists of files.
+  mutable std::shared_mutex _locker;
+};
+
+RollupManager_ptr RollupManager::create(const EngineEnvironment_ptr env) {
+  return RollupManager_ptr{new RollupManager(env)};
+}
+
+RollupManager::RollupManager(const EngineEnvironment_ptr env)
+    : _impl(new RollupManager::Private(env)) {}
+
+RollupManager::~RollupManager() {
+  _impl = nullptr;
+}
+
+void RollupManager::append(const MeasArray &ma) {
+  _impl->append(ma);
+}
+
+void RollupManager::append(const std::vector<Chunk *> &a, size_t count) {
+  _impl->append(a, count);
+}
+
+bool RollupManager::tier_for(Time from, Time step, RollupTier *tier) const {
+  return _impl->tier_for(from, step, tier);
+}
+
+std::map<Time, Statistic> RollupManager::read(const RollupTier &tier, Id id, Time from,
+                                              Time to) {
+  return _impl->read(tier, id, from, to);
+}
+
+const RollupTiers &RollupManager::tiers() const {
+  return _impl->_tiers;
+}
+
+size_t RollupManager::files_count() const {
+  return _impl->files_count();
+}
+
+bool RollupManager::need_backfill() const {
+  return _impl->need_backfill();
+}
+
+bool RollupManager::need_backfill(const std::string &page) const {
+  return _impl->need_backfill(page);
+}
+
+void RollupManager::backfill(const std::vector<Chunk *> &a, size_t count,
+                             const std::string &page) {
+  _impl->backfill(a, count, page);
+}
+
+void RollupManager::page_filled(const std::string &page) {
+  _impl->page_filled(page);
+}
+
+void RollupManager::backfill_done() {
+  _impl->backfill_done();
+}
+
+void RollupManager::overwritten(Id id, const std::vector<Time> &times) {
+  _impl->overwritten(id, times);
+}
+
+bool RollupManager::is_exact(Id id, Time from, Time to) const {
+  return _impl->is_exact(id, from, to);
+}
+
+void RollupManager::eraseOld(Time t) {
+  _impl->eraseOld(t);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <libdariadb/meas.h>
+#include <libdariadb/st_exports.h>
+#include <libdariadb/stat.h>
+#include <libdariadb/storage/chunk.h>
+#include <libdariadb/storage/engine_environment.h>
+#include <libdariadb/utils/utils.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dariadb {
+namespace storage {
+
+const std::string ROLLUP_FILE_EXT = ".rollup";
+
+/// statistic of values per 'step' interval.
+struct RollupTier {
+  Time step;
+  /// in milliseconds. 0 - data is erased with raw values by eraseOld.
+  Time retention;
+};
+using RollupTiers = std::vector<RollupTier>;
+
+/// parse "step:retention,step:retention". times in milliseconds.
+EXPORT RollupTiers parse_rollup_tiers(const std::string &s);
+
+#pragma pack(push, 1)
+struct RollupReccord {
+  Id id;
+  Time bucket; /// begin of 'step' interval.
+  Statistic stat;
+};
+
+struct RollupHeader {
+  uint64_t count; /// count of reccords.
+  Time minBucket;
+  Time maxBucket;
+};
+#pragma pack(pop)
+
+class RollupManager;
+using RollupManager_ptr = std::shared_ptr<RollupManager>;
+/**
+pre-aggregated values of pages. values written to pages are added to every tier.
+tier files are partitioned by time, reccords in file are sorted by (id, bucket).
+one bucket may be stored in several files, statistics are combined on read.
+tier, which was added to storage with pages, is back-filled from them in background
+and is not used by queries until back-fill is done.
+new files are seen by readers in snapshot version of their pages. buckets of times,
+which were written to pages twice, are not exact: statistics would count them twice.
+*/
+class RollupManager : public utils::NonCopy {
+public:
+  EXPORT static RollupManager_ptr create(const EngineEnvironment_ptr env);
+  EXPORT ~RollupManager();
+
+  EXPORT void append(const MeasArray &ma);
+  EXPORT void append(const std::vector<Chunk *> &a, size_t count);
+
+  /// tier with biggest step, whose buckets are aligned to buckets of query.
+  EXPORT bool tier_for(Time from, Time step, RollupTier *tier) const;
+  /// statistic by bucket begin, for buckets of 'tier' with begin in [from, to].
+  EXPORT std::map<Time, Statistic> read(const RollupTier &tier, Id id, Time from,
+                                        Time to);
+  EXPORT const RollupTiers &tiers() const;
+  EXPORT size_t files_count() const;
+
+  /// true if some tier was created, when pages already were written.
+  EXPORT bool need_backfill() const;
+  /// true if values of page (file name) are not in some back-filled tier.
+  EXPORT bool need_backfill(const std::string &page) const;
+  /// append chunks of existing page to tiers, which need back-fill.
+  EXPORT void backfill(const std::vector<Chunk *> &a, size_t count,
+                       const std::string &page);
+  /// values of new page were appended, back-fill must skip it after restart.
+  EXPORT void page_filled(const std::string &page);
+  EXPORT void backfill_done();
+
+  /// 'times' (sorted) of id were written to pages again: their buckets are not exact.
+  EXPORT void overwritten(Id id, const std::vector<Time> &times);
+  /// false if buckets of id in [from, to] count some values twice.
+  EXPORT bool is_exact(Id id, Time from, Time to) const;
+
+  /// erase buckets before 't' in tiers without retention and apply retention of others.
+  EXPORT void eraseOld(Time t);
+
+protected:
+  EXPORT RollupManager(const EngineEnvironment_ptr env);
+
+private:
+  class Private;
+  std::unique_ptr<Private> _impl;
+};
+}
+}
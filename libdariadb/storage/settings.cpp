@@ -5,6 +5,7 @@
 #include <libdariadb/utils/logger.h>
 #include <libdariadb/utils/strings.h>
 #include <extern/json/src/json.hpp>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -15,17 +16,42 @@ using json = nlohmann::json;
 
 const uint64_t WAL_CACHE_SIZE = 4096 / sizeof(dariadb::Meas) * 10;
 const uint64_t WAL_FILE_SIZE = (1024 * 1024) * 4 / sizeof(dariadb::Meas);
+const uint32_t WAL_SYNC_PERIOD = 100;
 const uint32_t CHUNK_SIZE = 1024;
+const uint64_t INDEX_CACHE_SIZE = 16 * 1024 * 1024; // 16 mb
+const uint16_t THREADS_IN_COMMON = 4;
+const uint16_t THREADS_IN_DISKIO = 2;
+const uint16_t AIO_QUEUE_DEPTH = 64;
 const size_t MAXIMUM_MEMORY_LIMIT = 100 * 1024 * 1024; // 100 mb
+const uint32_t COMPACTION_PERIOD = 1000;
+const uint64_t COMPACTION_RATE_LIMIT = 32 * 1024 * 1024; // 32 mb/s
+const std::string ROLLUP_TIERS = "";
+const std::string PAGE_COMPRESSION = "NONE";
+const uint32_t OOO_BUFFER_SIZE = 256;
 
 const std::string c_wal_file_size = "wal_file_size";
 const std::string c_wal_cache_size = "wal_cache_size";
+const std::string c_wal_sync = "wal_sync";
+const std::string c_wal_sync_period = "wal_sync_period";
+const std::string c_wal_compression = "wal_compression";
 const std::string c_chunk_size = "chunk_size";
+const std::string c_chunk_codec = "chunk_codec";
+const std::string c_page_compression = "page_compression";
+const std::string c_index_cache_size = "index_cache_size";
+const std::string c_threads_in_common = "threads_in_common";
+const std::string c_threads_in_diskio = "threads_in_diskio";
+const std::string c_aio_backend = "aio_backend";
+const std::string c_aio_queue_depth = "aio_queue_depth";
 const std::string c_strategy = "strategy";
 const std::string c_memory_limit = "memory_limit";
 const std::string c_percent_when_start_droping = "percent_when_start_droping";
 const std::string c_percent_to_drop = "percent_to_drop";
+const std::string c_ooo_buffer_size = "ooo_buffer_size";
+const std::string c_memory_huge_pages = "memory_huge_pages";
 const std::string c_max_pages_per_level = "max_pages_per_level";
+const std::string c_compaction_period = "compaction_period";
+const std::string c_compaction_rate_limit = "compaction_rate_limit";
+const std::string c_rollup_tiers = "rollup_tiers";
 
 std::string settings_file_path(const std::string &path) {
   return dariadb::utils::fs::append_path(path, SETTINGS_FILE_NAME);
@@ -39,6 +65,23 @@ template <class T> void Settings::ReadOnlyOption<T>::from_string(const std::stri
 template <> std::string Settings::ReadOnlyOption<dariadb::STRATEGY>::value_str() const {
   return dariadb::to_string(this->value());
 }
+template <>
+std::string Settings::ReadOnlyOption<dariadb::storage::WAL_SYNC>::value_str() const {
+  return dariadb::storage::to_string(this->value());
+}
+template <>
+std::string Settings::ReadOnlyOption<dariadb::storage::HUGE_PAGES>::value_str() const {
+  return dariadb::storage::to_string(this->value());
+}
+template <>
+std::string Settings::ReadOnlyOption<dariadb::compression::CODEC>::value_str() const {
+  return dariadb::compression::to_string(this->value());
+}
+template <>
+std::string
+Settings::ReadOnlyOption<dariadb::utils::async::AIO_BACKEND>::value_str() const {
+  return dariadb::utils::async::to_string(this->value());
+}
 template <> std::string Settings::ReadOnlyOption<std::string>::value_str() const {
   return this->value();
 }
@@ -52,14 +95,30 @@ Settings_ptr Settings::create(const std::string &storage_path) {
 Settings::Settings(const std::string &path_to_storage)
     : storage_path(nullptr, "storage path", path_to_storage),
       raw_path(nullptr, "raw path", fs::append_path(path_to_storage, "raw")),
+      rollup_path(nullptr, "rollup path", fs::append_path(path_to_storage, "rollup")),
       wal_file_size(this, c_wal_file_size, WAL_FILE_SIZE),
       wal_cache_size(this, c_wal_cache_size, WAL_CACHE_SIZE),
+      wal_sync(this, c_wal_sync, WAL_SYNC::OS),
+      wal_sync_period(this, c_wal_sync_period, WAL_SYNC_PERIOD),
+      wal_compression(this, c_wal_compression, false),
       chunk_size(this, c_chunk_size, CHUNK_SIZE),
+      chunk_codec(this, c_chunk_codec, compression::CODEC::DELTA_XOR),
+      page_compression(this, c_page_compression, PAGE_COMPRESSION),
+      index_cache_size(this, c_index_cache_size, INDEX_CACHE_SIZE),
+      threads_in_common(this, c_threads_in_common, THREADS_IN_COMMON),
+      threads_in_diskio(this, c_threads_in_diskio, THREADS_IN_DISKIO),
+      aio_backend(this, c_aio_backend, utils::async::AIO_BACKEND::SYNC),
+      aio_queue_depth(this, c_aio_queue_depth, AIO_QUEUE_DEPTH),
       strategy(this, c_strategy, STRATEGY::COMPRESSED),
       memory_limit(this, c_memory_limit, MAXIMUM_MEMORY_LIMIT),
       percent_when_start_droping(this, c_percent_when_start_droping, float(0.75)),
       percent_to_drop(this, c_percent_to_drop, float(0.1)),
-      max_pages_in_level(this, c_max_pages_per_level, uint16_t(2)) {
+      ooo_buffer_size(this, c_ooo_buffer_size, OOO_BUFFER_SIZE),
+      memory_huge_pages(this, c_memory_huge_pages, HUGE_PAGES::NONE),
+      max_pages_in_level(this, c_max_pages_per_level, uint16_t(2)),
+      compaction_period(this, c_compaction_period, COMPACTION_PERIOD),
+      compaction_rate_limit(this, c_compaction_rate_limit, COMPACTION_RATE_LIMIT),
+      rollup_tiers(this, c_rollup_tiers, ROLLUP_TIERS) {
   auto f = settings_file_path(storage_path.value());
   if (utils::fs::path_exists(f)) {
     load(f);
@@ -77,18 +136,35 @@ void Settings::set_default() {
   logger("engine", alias, ": Settings set default Settings");
   wal_cache_size.setValue(WAL_CACHE_SIZE);
   wal_file_size.setValue(WAL_FILE_SIZE);
+  wal_sync.setValue(WAL_SYNC::OS);
+  wal_sync_period.setValue(WAL_SYNC_PERIOD);
+  wal_compression.setValue(false);
   chunk_size.setValue(CHUNK_SIZE);
+  chunk_codec.setValue(compression::CODEC::DELTA_XOR);
+  page_compression.setValue(PAGE_COMPRESSION);
+  index_cache_size.setValue(INDEX_CACHE_SIZE);
+  threads_in_common.setValue(THREADS_IN_COMMON);
+  threads_in_diskio.setValue(THREADS_IN_DISKIO);
+  aio_backend.setValue(utils::async::AIO_BACKEND::SYNC);
+  aio_queue_depth.setValue(AIO_QUEUE_DEPTH);
   memory_limit.setValue(MAXIMUM_MEMORY_LIMIT);
   strategy.setValue(STRATEGY::COMPRESSED);
   percent_when_start_droping.setValue(float(0.75));
   percent_to_drop.setValue(float(0.15));
+  ooo_buffer_size.setValue(OOO_BUFFER_SIZE);
+  memory_huge_pages.setValue(HUGE_PAGES::NONE);
+  compaction_period.setValue(COMPACTION_PERIOD);
+  compaction_rate_limit.setValue(COMPACTION_RATE_LIMIT);
+  rollup_tiers.setValue(ROLLUP_TIERS);
 }
 
 std::vector<dariadb::utils::async::ThreadPool::Params> Settings::thread_pools_params() {
   using namespace dariadb::utils::async;
   std::vector<ThreadPool::Params> result{
-      ThreadPool::Params{size_t(4), (ThreadKind)THREAD_KINDS::COMMON},
-      ThreadPool::Params{size_t(1), (ThreadKind)THREAD_KINDS::DISK_IO}};
+      ThreadPool::Params{size_t(std::max(threads_in_common.value(), uint16_t(1))),
+                         (ThreadKind)THREAD_KINDS::COMMON},
+      ThreadPool::Params{size_t(std::max(threads_in_diskio.value(), uint16_t(1))),
+                         (ThreadKind)THREAD_KINDS::DISK_IO}};
   return result;
 }
 
@@ -119,7 +195,11 @@ void Settings::load(const std::string &file) {
   std::string content = dariadb::utils::fs::read_file(file);
   json js = json::parse(content);
   for (auto &o : _all_options) {
-    auto str_val = js[o.first];
+    auto fres = js.find(o.first);
+    if (fres == js.end()) { // option added after settings file was written.
+      continue;
+    }
+    std::string str_val = *fres;
     o.second->from_string(str_val);
   }
 }
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <libdariadb/compression/codec.h>
 #include <libdariadb/engines/strategy.h>
 #include <libdariadb/meas.h>
 #include <libdariadb/st_exports.h>
+#include <libdariadb/storage/memstorage/huge_pages.h>
+#include <libdariadb/storage/wal/wal_sync.h>
+#include <libdariadb/utils/async/aio.h>
 #include <libdariadb/utils/async/thread_pool.h>
 #include <libdariadb/utils/logger.h>
 
@@ -87,11 +91,25 @@ public:
 
   ReadOnlyOption<std::string> storage_path;
   ReadOnlyOption<std::string> raw_path;
+  ReadOnlyOption<std::string> rollup_path;
   // wal level options;
   Option<uint64_t> wal_file_size;  // measurements count in one file
   Option<uint64_t> wal_cache_size; // inner buffer size
+  Option<WAL_SYNC> wal_sync;        // when written values become durable.
+  Option<uint32_t> wal_sync_period; // in milliseconds. max delay of buffer writing.
+                                    // 0 - buffer is written when full or flushed.
+  Option<bool> wal_compression;     // if true - new wal files store compressed blocks.
 
   Option<uint32_t> chunk_size;
+  Option<compression::CODEC> chunk_codec; // encoding of new chunks.
+  // block compression of pages by level "NONE,FAST,HIGH". last is used for upper levels.
+  Option<std::string> page_compression;
+  Option<uint64_t> index_cache_size; // in bytes. cache of page indexes.
+
+  Option<uint16_t> threads_in_common; // threads in pool for common tasks.
+  Option<uint16_t> threads_in_diskio; // threads in pool for disk reading.
+  Option<utils::async::AIO_BACKEND> aio_backend; // batched reading of page chunks.
+  Option<uint16_t> aio_queue_depth;              // max requests of aio in flight.
 
   Option<STRATEGY> strategy;
 
@@ -99,8 +117,14 @@ public:
   Option<uint32_t> memory_limit;            // in bytes;
   Option<float> percent_when_start_droping; // fill percent, when start dropping.
   Option<float> percent_to_drop;            // how many chunk drop.
+  Option<uint32_t> ooo_buffer_size; // late values of track, buffered before merge.
+  Option<HUGE_PAGES> memory_huge_pages;     // pages of chunk allocator.
   // pages per level.
   Option<uint16_t> max_pages_in_level;
+  Option<uint32_t> compaction_period; // in milliseconds. 0 - no background compaction.
+  Option<uint64_t> compaction_rate_limit; // in bytes per second. 0 - no limit.
+  // pre-aggregated tiers "step:retention,..." in milliseconds. empty - no rollups.
+  Option<std::string> rollup_tiers;
 
   bool load_min_max; // if true - engine dont load min max. needed to ctl tool.
   std::string alias; // is set, used in log messages;
@@ -109,6 +133,13 @@ protected:
 };
 
 template <> EXPORT std::string Settings::ReadOnlyOption<STRATEGY>::value_str() const;
+template <> EXPORT std::string Settings::ReadOnlyOption<WAL_SYNC>::value_str() const;
+template <> EXPORT std::string Settings::ReadOnlyOption<HUGE_PAGES>::value_str() const;
+template <>
+EXPORT std::string Settings::ReadOnlyOption<compression::CODEC>::value_str() const;
+template <>
+EXPORT std::string
+Settings::ReadOnlyOption<utils::async::AIO_BACKEND>::value_str() const;
 template <> EXPORT std::string Settings::ReadOnlyOption<std::string>::value_str() const;
 }
 }
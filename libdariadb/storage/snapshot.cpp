@@ -0,0 +1,111 @@
+#include <libdariadb/storage/snapshot.h>
+#include <libdariadb/utils/logger.h>
+#include <atomic>
+
+using namespace dariadb;
+using namespace dariadb::storage;
+
+namespace {
+/// snapshots pinned by current thread, last pinned first.
+thread_local PinnedSnapshot *pinned_by_thread = nullptr;
+}
+
+Snapshot::Snapshot(uint64_t number) : _number(number) {}
+
+Snapshot::~Snapshot() {
+  for (auto &action : _deferred) {
+    try {
+      action();
+    } catch (std::exception &ex) {
+      logger_fatal("engine: snapshot #", _number, " deferred action error - ",
+                   ex.what());
+    }
+  }
+}
+
+SnapshotManager::SnapshotManager() {
+  _current = std::make_shared<Snapshot>(uint64_t(0));
+  _in_publication = false;
+}
+
+SnapshotManager::~SnapshotManager() {}
+
+Snapshot_Ptr SnapshotManager::pin() const {
+  for (auto p = pinned_by_thread; p != nullptr; p = p->_prev) {
+    if (p->_manager == this) {
+      return p->_snapshot;
+    }
+  }
+  return std::atomic_load(&_current);
+}
+
+void SnapshotManager::defer(const std::function<void()> &action) {
+  publish(nullptr, action);
+}
+
+void SnapshotManager::publish(const Apply &apply, const std::function<void()> &action) {
+  std::unique_lock<std::mutex> ul(_locker);
+  if (apply != nullptr) {
+    _applies.push_back(apply);
+  }
+  if (action != nullptr) {
+    _actions.push_back(action);
+  }
+  if (!_in_publication) {
+    make_version(ul);
+  }
+}
+
+void SnapshotManager::make_version(std::unique_lock<std::mutex> &lock) {
+  // old version is released after unlock: its actions may be run at once.
+  Snapshot_Ptr old = _current;
+  auto next = std::make_shared<Snapshot>(old->_number + 1);
+  for (auto &apply : _applies) {
+    apply(next->_number);
+  }
+  _applies.clear();
+  old->_deferred.splice(old->_deferred.end(), _actions);
+  old->_next = next;
+  std::atomic_store(&_current, next);
+  lock.unlock();
+}
+
+void SnapshotManager::begin_publication() {
+  _publication_locker.lock();
+  std::lock_guard<std::mutex> lg(_locker);
+  _in_publication = true;
+}
+
+void SnapshotManager::end_publication() {
+  {
+    std::unique_lock<std::mutex> ul(_locker);
+    _in_publication = false;
+    make_version(ul);
+  }
+  _publication_locker.unlock();
+}
+
+uint64_t SnapshotManager::version() const {
+  return std::atomic_load(&_current)->number();
+}
+
+Publication::Publication(SnapshotManager *manager) : _manager(manager) {
+  _manager->begin_publication();
+}
+
+Publication::~Publication() {
+  _manager->end_publication();
+}
+
+PinnedSnapshot::PinnedSnapshot(SnapshotManager *manager)
+    : PinnedSnapshot(manager, manager->pin()) {}
+
+PinnedSnapshot::PinnedSnapshot(SnapshotManager *manager, const Snapshot_Ptr &snapshot)
+    : _manager(manager), _snapshot(snapshot) {
+  _prev = pinned_by_thread;
+  pinned_by_thread = this;
+}
+
+PinnedSnapshot::~PinnedSnapshot() {
+  pinned_by_thread = _prev;
+}
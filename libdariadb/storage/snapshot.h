@@ -0,0 +1,101 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <libdariadb/utils/utils.h>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace dariadb {
+namespace storage {
+
+class Snapshot;
+using Snapshot_Ptr = std::shared_ptr<Snapshot>;
+/**
+version of set of storage files. reader holds it while files are readed.
+actions deferred in version (removing of files) are run, when readers of this
+and all older versions are finished.
+*/
+class Snapshot : public utils::NonCopy {
+public:
+  EXPORT Snapshot(uint64_t number);
+  EXPORT ~Snapshot();
+  uint64_t number() const { return _number; }
+
+protected:
+  friend class SnapshotManager;
+  uint64_t _number;
+  std::list<std::function<void()>> _deferred;
+  Snapshot_Ptr _next; // newer version. older versions keep it alive.
+};
+
+/**
+versions of all levels of storage. change is published in new version: 'apply' makes
+it visible to readers of new version (page is inserted, wal file or chunk is hidden),
+'action' is run after readers of older versions (files and memory are freed).
+changes made inside of Publication are published in one version, so reader sees
+values moved from upper level to lower one exactly once.
+*/
+class SnapshotManager : public utils::NonCopy {
+public:
+  using Apply = std::function<void(uint64_t version)>;
+
+  EXPORT SnapshotManager();
+  EXPORT ~SnapshotManager();
+  /// snapshot pinned by calling thread (see PinnedSnapshot) or current version.
+  EXPORT Snapshot_Ptr pin() const;
+  /// 'action' will be run after readers of current version. publish new version.
+  EXPORT void defer(const std::function<void()> &action);
+  /// publish change in new version or in version of begun publication.
+  EXPORT void publish(const Apply &apply, const std::function<void()> &action);
+  EXPORT uint64_t version() const;
+
+protected:
+  friend class Publication;
+  /// waits for end of other publication.
+  void begin_publication();
+  void end_publication();
+  /// _locker must be locked by 'lock', it is unlocked before deferred actions run.
+  void make_version(std::unique_lock<std::mutex> &lock);
+
+protected:
+  Snapshot_Ptr _current;
+  std::mutex _locker;
+  std::mutex _publication_locker;
+  bool _in_publication;
+  std::list<Apply> _applies;
+  std::list<std::function<void()>> _actions;
+};
+
+/// changes of storage, which are published by managers while it lives, become visible
+/// to readers at once.
+class Publication : public utils::NonCopy {
+public:
+  EXPORT Publication(SnapshotManager *manager);
+  EXPORT ~Publication();
+
+protected:
+  SnapshotManager *_manager;
+};
+
+/// snapshot of manager pinned for calling thread: pin() of manager returns it, so
+/// all levels readed by thread are seen in one version.
+class PinnedSnapshot : public utils::NonCopy {
+public:
+  /// pin current version.
+  EXPORT PinnedSnapshot(SnapshotManager *manager);
+  /// pin 'snapshot', which was pinned by other thread of the same reader.
+  EXPORT PinnedSnapshot(SnapshotManager *manager, const Snapshot_Ptr &snapshot);
+  EXPORT ~PinnedSnapshot();
+  Snapshot_Ptr snapshot() const { return _snapshot; }
+
+protected:
+  friend class SnapshotManager;
+  const SnapshotManager *_manager;
+  Snapshot_Ptr _snapshot;
+  PinnedSnapshot *_prev;
+};
+}
+}
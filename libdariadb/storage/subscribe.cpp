@@ -47,3 +47,15 @@ void SubscribeNotificator::on_append(const dariadb::Meas &m) const {
     }
   }
 }
+
+void SubscribeNotificator::on_append(const MeasArray::const_iterator &begin,
+                                     const MeasArray::const_iterator &end) const {
+  for (auto si : _subscribes) {
+    ENSURE(si->clbk != nullptr);
+    for (auto it = begin; it != end; ++it) {
+      if (si->isYours(*it)) {
+        si->clbk->apply(*it);
+      }
+    }
+  }
+}
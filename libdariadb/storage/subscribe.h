@@ -29,8 +29,9 @@ struct SubscribeNotificator {
   void start();
   void stop();
   void add(const SubscribeInfo_ptr &n);
-  // TODO replace Meas to MEasArray and run on thread.
   void on_append(const dariadb::Meas &m) const;
+  void on_append(const MeasArray::const_iterator &begin,
+                 const MeasArray::const_iterator &end) const;
 };
 }
 }
@@ -10,6 +10,8 @@
 #include <libdariadb/utils/logger.h>
 #include <libdariadb/utils/utils.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <tuple>
 
@@ -21,6 +23,12 @@ EXPORT WALManager *WALManager::_instance = nullptr;
 
 WALManager::~WALManager() {
   this->flush();
+  {
+    std::lock_guard<std::mutex> lg(_locker);
+    _writer_stop = true;
+  }
+  _writer_cond.notify_all();
+  _writer_thread.join();
 }
 
 WALManager_ptr WALManager::create(const EngineEnvironment_ptr env) {
@@ -31,6 +39,13 @@ WALManager::WALManager(const EngineEnvironment_ptr env) {
   _env = env;
   _settings = _env->getResourceObject<Settings>(EngineEnvironment::Resource::SETTINGS);
   _down = nullptr;
+  if (_env->hasResource(EngineEnvironment::Resource::SNAPSHOTS)) {
+    _snapshots =
+        _env->getResourceObject<SnapshotManager>(EngineEnvironment::Resource::SNAPSHOTS);
+  } else {
+    _own_snapshots = std::make_unique<SnapshotManager>();
+    _snapshots = _own_snapshots.get();
+  }
   auto manifest =
       _env->getResourceObject<Manifest>(EngineEnvironment::Resource::MANIFEST);
   if (dariadb::utils::fs::path_exists(_settings->raw_path.value())) {
@@ -47,7 +62,12 @@ WALManager::WALManager(const EngineEnvironment_ptr env) {
   }
 
   _buffer.resize(_settings->wal_cache_size.value());
+  _writing.resize(_buffer.size());
   _buffer_pos = 0;
+
+  _appended_seq = _writed_seq = _durable_seq = _sync_request_seq = 0;
+  _writer_stop = false;
+  _writer_thread = std::thread(&WALManager::writer_thread_func, this);
 }
 
 void WALManager::create_new() {
@@ -59,6 +79,8 @@ void WALManager::create_new() {
 }
 
 void WALManager::dropAll() {
+  flush();
+  std::lock_guard<std::shared_mutex> lg(_files_locker);
   if (_down != nullptr) {
     auto all_files = wal_files();
     this->_wal = nullptr;
@@ -73,8 +95,13 @@ void WALManager::dropAll() {
 }
 
 void WALManager::dropClosedFiles(size_t count) {
+  std::lock_guard<std::shared_mutex> lg(_files_locker);
+  drop_closed_files(count);
+}
+
+void WALManager::drop_closed_files(size_t count) {
   if (_down != nullptr) {
-    auto closed = this->closedWals();
+    auto closed = this->closed_wals();
 
     size_t to_drop = std::min(closed.size(), count);
     for (size_t i = 0; i < to_drop; ++i) {
@@ -102,8 +129,8 @@ void WALManager::dropClosedFiles(size_t count) {
 
 void WALManager::drop_old_if_needed() {
   if (_settings->strategy.value() != STRATEGY::WAL) {
-    auto closed = this->closedWals();
-    dropClosedFiles(closed.size());
+    auto closed = this->closed_wals();
+    drop_closed_files(closed.size());
   }
 }
 
@@ -118,7 +145,49 @@ std::list<std::string> WALManager::wal_files() const {
   return res;
 }
 
+std::list<WALFile_Ptr> WALManager::wals_to_read(uint64_t version) {
+  auto files = wal_files();
+  std::list<WALFile_Ptr> result;
+  std::lock_guard<std::mutex> lg(_closed_wals_locker);
+  std::unordered_map<std::string, WALFile_Ptr> still_exists;
+  for (const auto &f : files) {
+    if (_wal != nullptr && _wal->filename() == f) {
+      result.push_back(_wal);
+      continue;
+    }
+    if (_retired_wals.find(f) != _retired_wals.end()) {
+      continue;
+    }
+    WALFile_Ptr wal = nullptr;
+    auto fres = _closed_wals.find(f);
+    if (fres == _closed_wals.end()) {
+      wal = WALFile::open(_env, f, true);
+    } else {
+      wal = fres->second;
+    }
+    still_exists[f] = wal;
+    result.push_back(wal);
+  }
+  _closed_wals = std::move(still_exists);
+  for (auto &kv : _retired_wals) {
+    if (version < kv.second.second) {
+      result.push_back(kv.second.first);
+    }
+  }
+  return result;
+}
+
+MeasArray WALManager::buffered_values() const {
+  std::lock_guard<std::mutex> lg(_locker);
+  return MeasArray(_buffer.begin(), _buffer.begin() + _buffer_pos);
+}
+
 std::list<std::string> WALManager::closedWals() {
+  std::shared_lock<std::shared_mutex> lg(_files_locker);
+  return closed_wals();
+}
+
+std::list<std::string> WALManager::closed_wals() {
   auto all_files = wal_files();
   std::list<std::string> result;
   for (auto fn : all_files) {
@@ -141,19 +210,22 @@ void WALManager::dropWAL(const std::string &fname, IWALDropper *storage) {
 }
 
 void WALManager::setDownlevel(IWALDropper *down) {
+  std::lock_guard<std::shared_mutex> lg(_files_locker);
   _down = down;
   this->drop_old_if_needed();
 }
 
+// readers hold _files_locker shared: writer can not move values from buffer to file
+// meanwhile, but producers are not blocked by reading of files.
 dariadb::Time WALManager::minTime() {
-  std::lock_guard<std::mutex> lg(_locker);
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
   dariadb::Time result = dariadb::MAX_TIME;
-  auto env = _env;
-  AsyncTask at = [files, &result, env](const ThreadInfo &ti) {
+  AsyncTask at = [&files, &result](const ThreadInfo &ti) {
     TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-    for (auto filename : files) {
-      auto wal = WALFile::open(env, filename, true);
+    for (auto &wal : files) {
       auto local = wal->minTime();
       result = std::min(local, result);
     }
@@ -163,26 +235,21 @@ dariadb::Time WALManager::minTime() {
   auto am_async = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
   am_async->wait();
 
-  size_t pos = 0;
-  for (auto &v : _buffer) {
+  for (auto &v : buffer) {
     result = std::min(v.time, result);
-    ++pos;
-    if (pos > _buffer_pos) {
-      break;
-    }
   }
   return result;
 }
 
 dariadb::Time WALManager::maxTime() {
-  std::lock_guard<std::mutex> lg(_locker);
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
   dariadb::Time result = dariadb::MIN_TIME;
-  auto env = _env;
-  AsyncTask at = [files, &result, env](const ThreadInfo &ti) {
+  AsyncTask at = [&files, &result](const ThreadInfo &ti) {
     TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-    for (auto filename : files) {
-      auto wal = WALFile::open(env, filename, true);
+    for (auto &wal : files) {
       auto local = wal->maxTime();
       result = std::max(local, result);
     }
@@ -191,31 +258,25 @@ dariadb::Time WALManager::maxTime() {
 
   auto am_async = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
   am_async->wait();
-  size_t pos = 0;
-  for (auto &v : _buffer) {
+  for (auto &v : buffer) {
     result = std::max(v.time, result);
-    ++pos;
-    if (pos > _buffer_pos) {
-      break;
-    }
   }
   return result;
 }
 
 bool WALManager::minMaxTime(dariadb::Id id, dariadb::Time *minResult,
                             dariadb::Time *maxResult) {
-  std::lock_guard<std::mutex> lg(_locker);
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
   using MMRes = std::tuple<bool, dariadb::Time, dariadb::Time>;
   std::vector<MMRes> results{files.size()};
-  auto env = _env;
-  AsyncTask at = [files, &results, id, env](const ThreadInfo &ti) {
+  AsyncTask at = [&files, &results, id](const ThreadInfo &ti) {
     TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
     size_t num = 0;
 
-    for (auto filename : files) {
-
-      auto wal = WALFile::open(env, filename, true);
+    for (auto &wal : files) {
       dariadb::Time lmin = dariadb::MAX_TIME, lmax = dariadb::MIN_TIME;
       if (wal->minMaxTime(id, &lmin, &lmax)) {
         results[num] = MMRes(true, lmin, lmax);
@@ -241,36 +302,29 @@ bool WALManager::minMaxTime(dariadb::Id id, dariadb::Time *minResult,
     }
   }
 
-  size_t pos = 0;
-  for (auto v : _buffer) {
+  for (auto &v : buffer) {
     if (v.id == id) {
       res = true;
       *minResult = std::min(v.time, *minResult);
       *maxResult = std::max(v.time, *maxResult);
     }
-    ++pos;
-    if (pos > _buffer_pos) {
-      break;
-    }
   }
   return res;
 }
 
 Id2Cursor WALManager::intervalReader(const QueryInterval &q) {
-  std::lock_guard<std::mutex> lg(_locker);
   Id2CursorsList readers_list;
 
   utils::async::Locker readers_locker;
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
 
   if (!files.empty()) {
-    auto env = _env;
-    AsyncTask at = [files, &q, env, &readers_list,
-                    &readers_locker](const ThreadInfo &ti) {
+    AsyncTask at = [&files, &q, &readers_list, &readers_locker](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-      for (auto filename : files) {
-        auto wal = WALFile::open(env, filename, true);
-
+      for (auto &wal : files) {
         auto rdr_map = wal->intervalReader(q);
         if (rdr_map.empty()) {
           continue;
@@ -287,16 +341,11 @@ Id2Cursor WALManager::intervalReader(const QueryInterval &q) {
     am_async->wait();
   }
 
-  size_t pos = 0;
   Id2MSet i2ms;
-  for (auto v : _buffer) {
-    if (pos >= _buffer_pos) {
-      break;
-    }
+  for (auto &v : buffer) {
     if (v.inQuery(q.ids, q.flag, q.from, q.to)) {
       i2ms[v.id].insert(v);
     }
-    ++pos;
   }
 
   if (!i2ms.empty()) {
@@ -313,18 +362,17 @@ Id2Cursor WALManager::intervalReader(const QueryInterval &q) {
 }
 
 Statistic WALManager::stat(const Id id, Time from, Time to) {
-  std::lock_guard<std::mutex> lg(_locker);
   Statistic result;
 
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
 
   if (!files.empty()) {
-    auto env = _env;
-    AsyncTask at = [files, &result, id, from, to, env](const ThreadInfo &ti) {
+    AsyncTask at = [&files, &result, id, from, to](const ThreadInfo &ti) {
       TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-      for (auto filename : files) {
-        auto wal = WALFile::open(env, filename, true);
-
+      for (auto &wal : files) {
         auto st = wal->stat(id, from, to);
         result.update(st);
       }
@@ -335,17 +383,12 @@ Statistic WALManager::stat(const Id id, Time from, Time to) {
     am_async->wait();
   }
 
-  size_t pos = 0;
   IdArray ids{id};
   ENSURE(ids[0] == id);
-  for (auto v : _buffer) {
-    if (pos >= _buffer_pos) {
-      break;
-    }
+  for (auto &v : buffer) {
     if (v.inQuery(ids, Flag(0), from, to)) {
       result.update(v);
     }
-    ++pos;
   }
   return result;
 }
@@ -358,18 +401,18 @@ void WALManager::foreach (const QueryInterval &q, IReadCallback * clbk) {
 }
 
 Id2Meas WALManager::readTimePoint(const QueryTimePoint &query) {
-  std::lock_guard<std::mutex> lg(_locker);
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
   dariadb::Id2Meas sub_result;
 
   std::vector<Id2Meas> results{files.size()};
-  auto env = _env;
-  AsyncTask at = [files, &query, &results, env](const ThreadInfo &ti) {
+  AsyncTask at = [&files, &query, &results](const ThreadInfo &ti) {
     TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
     size_t num = 0;
 
-    for (auto filename : files) {
-      auto wal = WALFile::open(env, filename, true);
+    for (auto &wal : files) {
       results[num] = wal->readTimePoint(query);
       num++;
     }
@@ -391,8 +434,7 @@ Id2Meas WALManager::readTimePoint(const QueryTimePoint &query) {
       }
     }
   }
-  size_t pos = 0;
-  for (auto v : _buffer) {
+  for (auto &v : buffer) {
     if (v.inQuery(query.ids, query.flag)) {
       auto it = sub_result.find(v.id);
       if (it == sub_result.end()) {
@@ -404,10 +446,6 @@ Id2Meas WALManager::readTimePoint(const QueryTimePoint &query) {
         }
       }
     }
-    ++pos;
-    if (pos > _buffer_pos) {
-      break;
-    }
   }
 
   for (auto id : query.ids) {
@@ -421,13 +459,13 @@ Id2Meas WALManager::readTimePoint(const QueryTimePoint &query) {
 
 Id2Meas WALManager::currentValue(const IdArray &ids, const Flag &flag) {
   dariadb::Id2Meas meases;
-  AsyncTask at = [&ids, flag, &meases, this](const ThreadInfo &ti) {
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  AsyncTask at = [&ids, flag, &meases, &files](const ThreadInfo &ti) {
     TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
 
-    auto files = wal_files();
-
-    for (const auto &f : files) {
-      auto c = WALFile::open(_env, f, true);
+    for (const auto &c : files) {
       auto sub_rdr = c->currentValue(ids, flag);
 
       for (auto &kv : sub_rdr) {
@@ -450,46 +488,168 @@ Id2Meas WALManager::currentValue(const IdArray &ids, const Flag &flag) {
 }
 
 dariadb::Status WALManager::append(const Meas &value) {
-  std::lock_guard<std::mutex> lg(_locker);
+  sequencedAppend(value);
+  return dariadb::Status(1, 0);
+}
+
+dariadb::Status WALManager::append(const MeasArray::const_iterator &begin,
+                                   const MeasArray::const_iterator &end) {
+  sequencedAppend(begin, end);
+  return dariadb::Status(std::distance(begin, end), 0);
+}
+
+uint64_t WALManager::sequencedAppend(const Meas &value) {
+  std::unique_lock<std::mutex> ul(_locker);
+  while (_buffer_pos >= _buffer.size()) { // buffer is full, wait for writer.
+    _writer_cond.notify_one();
+    _writed_cond.wait(ul);
+  }
   _buffer[_buffer_pos] = value;
   _buffer_pos++;
+  auto result = ++_appended_seq;
 
-  if (_buffer_pos >= _settings->wal_cache_size.value()) {
-    flush_buffer();
+  if (_buffer_pos >= _buffer.size()) {
+    _writer_cond.notify_one();
   }
-  return dariadb::Status(1, 0);
+  return result;
 }
 
-void WALManager::flush_buffer() {
-  if (_buffer_pos == size_t(0)) {
-    return;
+uint64_t WALManager::sequencedAppend(const MeasArray::const_iterator &begin,
+                                     const MeasArray::const_iterator &end) {
+  std::unique_lock<std::mutex> ul(_locker);
+  auto it = begin;
+  while (it != end) {
+    while (_buffer_pos >= _buffer.size()) { // buffer is full, wait for writer.
+      _writer_cond.notify_one();
+      _writed_cond.wait(ul);
+    }
+    auto count = std::min(size_t(std::distance(it, end)), _buffer.size() - _buffer_pos);
+    std::copy(it, it + count, _buffer.begin() + _buffer_pos);
+    it += count;
+    _buffer_pos += count;
+    _appended_seq += count;
+    if (_buffer_pos >= _buffer.size()) {
+      _writer_cond.notify_one();
+    }
   }
-  AsyncTask at = [this](const ThreadInfo &ti) {
-    TKIND_CHECK(THREAD_KINDS::DISK_IO, ti.kind);
-    if (_wal == nullptr) {
+  return _appended_seq;
+}
+
+void WALManager::waitDurable(uint64_t seq) {
+  std::unique_lock<std::mutex> ul(_locker);
+  seq = std::min(seq, _appended_seq);
+  while (_durable_seq < seq) {
+    _sync_request_seq = std::max(_sync_request_seq, seq);
+    _writer_cond.notify_one();
+    _writed_cond.wait(ul);
+  }
+}
+
+uint64_t WALManager::durableSequence() const {
+  std::lock_guard<std::mutex> lg(_locker);
+  return _durable_seq;
+}
+
+WALFile_Ptr WALManager::write_buffer() {
+  std::lock_guard<std::shared_mutex> fl(_files_locker);
+  size_t count = 0;
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lg(_locker);
+    if (_buffer_pos == size_t(0)) {
+      return _wal;
+    }
+    count = _buffer_pos;
+    seq = _appended_seq;
+    std::swap(_buffer, _writing);
+    _buffer_pos = 0;
+  }
+  _writed_cond.notify_all(); // producers can fill buffer while it is writing.
+
+  if (_wal == nullptr) {
+    create_new();
+  }
+  size_t pos = 0;
+  size_t total_writed = 0;
+  while (1) {
+    auto res = _wal->append(_writing.begin() + pos, _writing.begin() + count);
+    total_writed += res.writed;
+    if (total_writed != count) {
+      if (_settings->wal_sync.value() != WAL_SYNC::OS) {
+        _wal->sync();
+      }
       create_new();
+      pos += res.writed;
+    } else {
+      break;
     }
-    size_t pos = 0;
-    size_t total_writed = 0;
-    while (1) {
-      auto res = _wal->append(_buffer.begin() + pos, _buffer.begin() + _buffer_pos);
-      total_writed += res.writed;
-      if (total_writed != _buffer_pos) {
-        create_new();
-        pos += res.writed;
-      } else {
-        break;
+  }
+  std::lock_guard<std::mutex> lg(_locker);
+  _writed_seq = seq;
+  return _wal;
+}
+
+void WALManager::writer_thread_func() {
+  std::unique_lock<std::mutex> ul(_locker);
+  auto last_sync = std::chrono::steady_clock::now();
+  while (true) {
+    auto period = std::chrono::milliseconds(_settings->wal_sync_period.value());
+    auto wakeup = [this]() {
+      return _writer_stop || _buffer_pos >= _buffer.size() ||
+             _sync_request_seq > _durable_seq;
+    };
+    if (period.count() == 0) { // no periodic writing, wait_for(0) would spin.
+      _writer_cond.wait(ul, wakeup);
+    } else {
+      _writer_cond.wait_for(ul, period, wakeup);
+    }
+
+    ul.unlock();
+    auto wal = write_buffer();
+    ul.lock();
+    _writed_cond.notify_all();
+
+    auto now = std::chrono::steady_clock::now();
+    bool need_sync = false;
+    switch (_settings->wal_sync.value()) {
+    case WAL_SYNC::OS:
+      _durable_seq = _writed_seq;
+      break;
+    case WAL_SYNC::BATCH:
+      need_sync = _durable_seq < _writed_seq;
+      break;
+    case WAL_SYNC::PERIODIC:
+      need_sync = _durable_seq < _writed_seq &&
+                  (now - last_sync >= period || _sync_request_seq > _durable_seq);
+      break;
+    }
+
+    if (need_sync) {
+      // producers can fill buffer while file is syncing.
+      auto target = _writed_seq;
+      ul.unlock();
+      if (wal != nullptr) {
+        wal->sync();
       }
+      ul.lock();
+      _durable_seq = std::max(_durable_seq, target);
+      last_sync = now;
     }
-    _buffer_pos = 0;
-    return false;
-  };
-  auto async_r = ThreadManager::instance()->post(THREAD_KINDS::DISK_IO, AT(at));
-  async_r->wait();
+    _writed_cond.notify_all();
+
+    if (_writer_stop && _buffer_pos == size_t(0)) {
+      break;
+    }
+  }
 }
 
 void WALManager::flush() {
-  flush_buffer();
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lg(_locker);
+    seq = _appended_seq;
+  }
+  waitDurable(seq);
 }
 
 size_t WALManager::filesCount() const {
@@ -497,26 +657,43 @@ size_t WALManager::filesCount() const {
 }
 
 void WALManager::erase(const std::string &fname) {
-  _env->getResourceObject<Manifest>(EngineEnvironment::Resource::MANIFEST)->wal_rm(fname);
-  utils::fs::rm(utils::fs::append_path(_settings->raw_path.value(), fname));
+  auto full_path = utils::fs::append_path(_settings->raw_path.value(), fname);
+  auto manifest = _env->getResourceObject<Manifest>(EngineEnvironment::Resource::MANIFEST);
+  // file is hidden from readers of new version, together with publication of its page.
+  // readers of older versions read it, until they are finished.
+  _snapshots->publish(
+      [this, manifest, fname, full_path](uint64_t version) {
+        std::lock_guard<std::mutex> lg(_closed_wals_locker);
+        auto fres = _closed_wals.find(full_path);
+        auto wal = fres != _closed_wals.end() ? fres->second
+                                              : WALFile::open(_env, full_path, true);
+        _closed_wals.erase(full_path);
+        _retired_wals[full_path] = std::make_pair(wal, version);
+        manifest->wal_rm(fname);
+      },
+      [this, full_path]() {
+        {
+          std::lock_guard<std::mutex> lg(_closed_wals_locker);
+          _retired_wals.erase(full_path);
+        }
+        utils::fs::rm(full_path);
+      });
 }
 
 Id2MinMax WALManager::loadMinMax() {
-  auto files = wal_files();
+  auto snapshot = _snapshots->pin();
+  std::shared_lock<std::shared_mutex> fl(_files_locker);
+  auto files = wals_to_read(snapshot->number());
+  auto buffer = buffered_values();
 
   dariadb::Id2MinMax result;
-  for (const auto &f : files) {
-    auto c = WALFile::open(_env, f, true);
+  for (const auto &c : files) {
     auto sub_res = c->loadMinMax();
 
     minmax_append(result, sub_res);
   }
 
-  size_t pos = 0;
-  for (auto val : _buffer) {
-    if (pos >= _buffer_pos) {
-      break;
-    }
+  for (auto &val : buffer) {
     auto fres = result.find(val.id);
     if (fres == result.end()) {
       result[val.id].min = val;
@@ -525,7 +702,6 @@ Id2MinMax WALManager::loadMinMax() {
       fres->second.updateMax(val);
       fres->second.updateMin(val);
     }
-    ++pos;
   }
   return result;
 }
@@ -5,12 +5,17 @@
 #include <libdariadb/interfaces/imeasstorage.h>
 #include <libdariadb/st_exports.h>
 #include <libdariadb/storage/settings.h>
+#include <libdariadb/storage/snapshot.h>
 #include <libdariadb/storage/wal/walfile.h>
 #include <libdariadb/utils/async/locker.h>
 #include <libdariadb/utils/utils.h>
+#include <unordered_map>
 #include <vector>
 
+#include <condition_variable>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
 
 namespace dariadb {
 namespace storage {
@@ -36,8 +41,22 @@ public:
   EXPORT virtual Id2Meas readTimePoint(const QueryTimePoint &q) override;
   EXPORT virtual Id2Meas currentValue(const IdArray &ids, const Flag &flag) override;
   EXPORT virtual Status append(const Meas &value) override;
+  using IMeasStorage::append;
+  EXPORT virtual Status append(const MeasArray::const_iterator &begin,
+                               const MeasArray::const_iterator &end) override;
   EXPORT virtual void flush() override;
 
+  /// append value and return its sequence number.
+  EXPORT uint64_t sequencedAppend(const Meas &value);
+  /// append values under one lock and return sequence number of last.
+  EXPORT uint64_t sequencedAppend(const MeasArray::const_iterator &begin,
+                                  const MeasArray::const_iterator &end);
+  /// block until value with sequence number 'seq' and all previous values
+  /// are durable. (see Settings::wal_sync)
+  EXPORT void waitDurable(uint64_t seq);
+  /// sequence number of last durable value.
+  EXPORT uint64_t durableSequence() const;
+
   EXPORT std::list<std::string> closedWals();
   EXPORT void dropWAL(const std::string &fname, IWALDropper *storage);
 
@@ -54,19 +73,49 @@ public:
 protected:
   void create_new();
   std::list<std::string> wal_files() const;
-  void flush_buffer();
+  /// files seen by readers of snapshot 'version'.
+  std::list<WALFile_Ptr> wals_to_read(uint64_t version);
+  /// copy of values in buffer, which are not written to file yet.
+  MeasArray buffered_values() const;
+  std::list<std::string> closed_wals();
+  void drop_closed_files(size_t count);
+  WALFile_Ptr write_buffer();
   void drop_old_if_needed();
+  void writer_thread_func();
 
 private:
   EXPORT static WALManager *_instance;
 
   WALFile_Ptr _wal;
   mutable std::mutex _locker;
+  /// guards _wal, content of files and _writing. writer holds it to append.
+  mutable std::shared_mutex _files_locker;
   IWALDropper *_down;
 
   MeasArray _buffer;
   size_t _buffer_pos;
+  MeasArray _writing;
+
+  // group commit: producers append values to _buffer, writer thread swaps it
+  // with _writing and writes it to file without _locker, so producers are not
+  // blocked by disk. file is synced according to Settings::wal_sync.
+  std::thread _writer_thread;
+  bool _writer_stop;
+  std::condition_variable _writer_cond; // wake up writer.
+  std::condition_variable _writed_cond; // buffer was written or synced.
+  uint64_t _appended_seq;               // last value in buffer.
+  uint64_t _writed_seq;                 // last value written to file.
+  uint64_t _durable_seq;                // last value synced to disk.
+  uint64_t _sync_request_seq;           // somebody waits durability of this value.
   std::set<std::string> _files_send_to_drop;
+  /// readonly closed files. keeps summary of file content in memory.
+  std::unordered_map<std::string, WALFile_Ptr> _closed_wals;
+  /// erased files, which are read by readers of versions before 'second'.
+  std::unordered_map<std::string, std::pair<WALFile_Ptr, uint64_t>> _retired_wals;
+  std::mutex _closed_wals_locker;
+  /// readers pin snapshot, while files are readed. shared by levels of engine.
+  SnapshotManager *_snapshots;
+  std::unique_ptr<SnapshotManager> _own_snapshots;
   EngineEnvironment_ptr _env;
   Settings *_settings;
 };
@@ -0,0 +1,49 @@
+#include <libdariadb/storage/wal/wal_sync.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/strings.h>
+#include <sstream>
+
+std::istream &dariadb::storage::operator>>(std::istream &in, WAL_SYNC &sync) {
+  std::string token;
+  in >> token;
+
+  token = utils::strings::to_upper(token);
+
+  if (token == "OS") {
+    sync = WAL_SYNC::OS;
+    return in;
+  }
+  if (token == "BATCH") {
+    sync = WAL_SYNC::BATCH;
+    return in;
+  }
+  if (token == "PERIODIC") {
+    sync = WAL_SYNC::PERIODIC;
+    return in;
+  }
+  THROW_EXCEPTION("engine: bad wal sync policy - ", token);
+}
+
+std::ostream &dariadb::storage::operator<<(std::ostream &stream, const WAL_SYNC &sync) {
+  switch (sync) {
+  case WAL_SYNC::OS:
+    stream << "OS";
+    break;
+  case WAL_SYNC::BATCH:
+    stream << "BATCH";
+    break;
+  case WAL_SYNC::PERIODIC:
+    stream << "PERIODIC";
+    break;
+  default:
+    THROW_EXCEPTION("engine: bad wal sync policy - ", (uint16_t)sync);
+    break;
+  };
+  return stream;
+}
+
+std::string dariadb::storage::to_string(const WAL_SYNC &sync) {
+  std::stringstream ss;
+  ss << sync;
+  return ss.str();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <istream>
+#include <ostream>
+
+namespace dariadb {
+namespace storage {
+/**
+when written wal values become durable:
+OS - flushing to disk is managed by operation system.
+BATCH - each batch of values is synced to disk.
+PERIODIC - written values are synced to disk every 'wal_sync_period' milliseconds.
+*/
+enum class WAL_SYNC : uint16_t { OS = 0, BATCH, PERIODIC };
+
+EXPORT std::istream &operator>>(std::istream &in, WAL_SYNC &sync);
+EXPORT std::ostream &operator<<(std::ostream &stream, const WAL_SYNC &sync);
+
+EXPORT std::string to_string(const WAL_SYNC &sync);
+}
+}
@@ -1,26 +1,60 @@
 #ifdef MSVC
 #define _CRT_SECURE_NO_WARNINGS // disable msvc /sdl warning on fopen call.
 #endif
+#include <libdariadb/compression/compression.h>
 #include <libdariadb/flags.h>
 #include <libdariadb/storage/callbacks.h>
 #include <libdariadb/storage/cursors.h>
 #include <libdariadb/storage/manifest.h>
 #include <libdariadb/storage/settings.h>
 #include <libdariadb/storage/wal/walfile.h>
+#include <libdariadb/utils/crc.h>
 #include <libdariadb/utils/fs.h>
+#include <libdariadb/utils/logger.h>
 #include <libdariadb/utils/utils.h>
 
 #include <algorithm>
 
+#ifdef UNIX_OS
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iterator>
 #include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 using namespace dariadb;
 using namespace dariadb::storage;
 
+namespace {
+#pragma pack(push, 1)
+/// header of block. block contains values of one batch, sorted by id.
+/// compressed block: id column, first value, compressed values.
+/// if compression does not reduce size, values are stored as is.
+struct WALBlockHeader {
+  uint32_t crc;   /// crc32 of block with zero in this field.
+  uint32_t size;  /// size of data after header.
+  uint32_t count; /// values in block.
+  uint32_t ids;   /// records in id column. 0 - values are not compressed.
+};
+
+/// record of id column: 'count' values of 'id' go one after another.
+struct WALBlockId {
+  Id id;
+  uint32_t count;
+};
+#pragma pack(pop)
+
+/// upper bound of compressed size of one value: time + value + flag.
+const size_t MAX_COMPRESSED_MEAS_SIZE = 32;
+}
+
 class WALFile::Private {
 public:
   Private(const EngineEnvironment_ptr env) {
@@ -28,11 +62,17 @@ public:
     _settings = _env->getResourceObject<Settings>(EngineEnvironment::Resource::SETTINGS);
     _writed = 0;
     _is_readonly = false;
-    auto rnd_fname = utils::fs::random_file_name(WAL_FILE_EXT);
+    _is_compressed = _settings->wal_compression.value();
+    auto rnd_fname = utils::fs::random_file_name(
+        _is_compressed ? WAL_COMPRESSED_FILE_EXT : WAL_FILE_EXT);
     _filename = utils::fs::append_path(_settings->raw_path.value(), rnd_fname);
     _env->getResourceObject<Manifest>(EngineEnvironment::Resource::MANIFEST)
         ->wal_append(rnd_fname);
     _file = nullptr;
+    _summary_loaded = true; // new file is empty.
+    _values_loaded = true;
+    _min_time = MAX_TIME;
+    _max_time = MIN_TIME;
   }
 
   Private(const EngineEnvironment_ptr env, const std::string &fname, bool readonly) {
@@ -40,8 +80,26 @@ public:
     _settings = _env->getResourceObject<Settings>(EngineEnvironment::Resource::SETTINGS);
     _writed = WALFile::writed(fname);
     _is_readonly = readonly;
+    _is_compressed = WALFile::is_compressed(fname);
     _filename = fname;
     _file = nullptr;
+    _values_loaded = false;
+    if (_is_compressed && !_is_readonly) {
+      // values after last correct block can not be readed, so they are removed.
+      auto file_size = utils::fs::file_size(fname);
+      auto content = read_content();
+      auto correct_size =
+          decompress_blocks(content.data(), content.size(), &_read_buffer);
+      _values_loaded = true;
+      if (correct_size != file_size) {
+        logger_info("engine", _settings->alias, ": wal ", fname, " truncated from ",
+                    file_size, " to ", correct_size);
+        utils::fs::resize_file(fname, correct_size);
+      }
+    }
+    _summary_loaded = false;
+    _min_time = MAX_TIME;
+    _max_time = MIN_TIME;
   }
 
   ~Private() {
@@ -63,27 +121,13 @@ public:
     }
   }
 
-  void open_to_read() {
-    if (_file != nullptr) {
-      std::fclose(_file);
-      _file = nullptr;
-    }
-    _file = std::fopen(_filename.c_str(), "rb");
-    if (_file == nullptr) {
-      throw_open_error_exception();
-    }
-  }
-
   Status append(const Meas &value) {
     ENSURE(!_is_readonly);
 
     if (_writed > _settings->wal_file_size.value()) {
       return Status(0, 1);
     }
-    open_to_append();
-    std::fwrite(&value, sizeof(Meas), size_t(1), _file);
-    std::fflush(_file);
-    _writed++;
+    write_values(&value, size_t(1));
     return Status(1, 0);
   }
 
@@ -92,12 +136,9 @@ public:
     ENSURE(!_is_readonly);
 
     auto sz = std::distance(begin, end);
-    open_to_append();
     auto max_size = _settings->wal_file_size.value();
     auto write_size = (sz + _writed) > max_size ? (max_size - _writed) : sz;
-    std::fwrite(&(*begin), sizeof(Meas), write_size, _file);
-    std::fflush(_file);
-    _writed += write_size;
+    write_values(&(*begin), write_size);
     return Status(write_size, 0);
   }
 
@@ -106,55 +147,201 @@ public:
     ENSURE(!_is_readonly);
 
     auto list_size = std::distance(begin, end);
-    open_to_append();
-
     auto max_size = _settings->wal_file_size.value();
 
     auto write_size = (list_size + _writed) > max_size ? (max_size - _writed) : list_size;
     MeasArray ma{begin, end};
-    std::fwrite(ma.data(), sizeof(Meas), write_size, _file);
-    std::fflush(_file);
-    _writed += write_size;
+    write_values(ma.data(), write_size);
     return Status(write_size, 0);
   }
 
-  Statistic stat(const Id id, Time from, Time to) {
-    Statistic result;
-    open_to_read();
+  void write_values(const Meas *values, size_t count) {
+    if (count == size_t(0)) {
+      return;
+    }
+    open_to_append();
+    if (!_is_compressed) {
+      std::fwrite(values, sizeof(Meas), count, _file);
+      std::fflush(_file);
+      if (_values_loaded) {
+        _read_buffer.insert(_read_buffer.end(), values, values + count);
+      }
+      if (_summary_loaded) {
+        update_summary(values, count, _writed);
+      }
+    } else {
+      // values in block are grouped by id.
+      MeasArray ordered(values, values + count);
+      std::stable_sort(ordered.begin(), ordered.end(),
+                       [](const Meas &l, const Meas &r) { return l.id < r.id; });
+      std::vector<uint8_t> block;
+      compress_block(ordered.data(), count, block);
+      std::fwrite(block.data(), sizeof(uint8_t), block.size(), _file);
+      std::fflush(_file);
+      if (_values_loaded) {
+        _read_buffer.insert(_read_buffer.end(), ordered.begin(), ordered.end());
+      }
+      if (_summary_loaded) {
+        update_summary(ordered.data(), count, _writed);
+      }
+    }
+    _writed += count;
+  }
 
-    IdArray ids{id};
-    ENSURE(ids[0] == id);
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
+  /// compress values sorted by id to block and write it to 'out'.
+  static void compress_block(const Meas *values, size_t count, std::vector<uint8_t> &out) {
+    std::vector<WALBlockId> id_column;
+    for (size_t i = 0; i < count; ++i) {
+      if (id_column.empty() || id_column.back().id != values[i].id) {
+        id_column.push_back(WALBlockId{values[i].id, uint32_t(0)});
       }
-      if (val.inQuery(ids, Flag(0), from, to)) {
-        result.update(val);
+      id_column.back().count++;
+    }
+
+    std::vector<uint8_t> buffer(count * MAX_COMPRESSED_MEAS_SIZE + 1);
+    auto bb = std::make_shared<compression::ByteBuffer>(
+        compression::Range{buffer.data(), buffer.data() + buffer.size()});
+    compression::CopmressedWriter cwriter(bb);
+    for (size_t i = 0; i < count; ++i) {
+      if (!cwriter.append(values[i])) {
+        THROW_EXCEPTION("wal: block overflow");
       }
     }
-    std::fclose(_file);
-    _file = nullptr;
 
-    return result;
+    auto data_begin = buffer.data() + bb->pos();
+    auto data_size = buffer.size() - bb->pos();
+    auto column_size = id_column.size() * sizeof(WALBlockId);
+    auto raw_size = count * sizeof(Meas);
+
+    WALBlockHeader hdr;
+    memset(&hdr, 0, sizeof(WALBlockHeader));
+    hdr.count = static_cast<uint32_t>(count);
+    if (column_size + sizeof(Meas) + data_size < raw_size) {
+      hdr.ids = static_cast<uint32_t>(id_column.size());
+      hdr.size = static_cast<uint32_t>(column_size + sizeof(Meas) + data_size);
+    } else {
+      hdr.size = static_cast<uint32_t>(raw_size);
+    }
+
+    auto block_begin = out.size();
+    out.resize(block_begin + sizeof(WALBlockHeader) + hdr.size);
+    auto block = out.data() + block_begin;
+    auto payload = block + sizeof(WALBlockHeader);
+    if (hdr.ids != 0) {
+      memcpy(payload, id_column.data(), column_size);
+      memcpy(payload + column_size, values, sizeof(Meas));
+      memcpy(payload + column_size + sizeof(Meas), data_begin, data_size);
+    } else {
+      memcpy(payload, values, raw_size);
+    }
+    memcpy(block, &hdr, sizeof(WALBlockHeader));
+    hdr.crc = utils::crc32(block, sizeof(WALBlockHeader) + hdr.size);
+    memcpy(block, &hdr, sizeof(WALBlockHeader));
   }
 
-  Id2Cursor intervalReader(const QueryInterval &q) {
-    open_to_read();
+  /// check layout of block payload.
+  static bool is_correct_block(const WALBlockHeader &hdr, const uint8_t *payload) {
+    if (hdr.ids == 0) {
+      return hdr.size == hdr.count * sizeof(Meas);
+    }
+    auto column_size = size_t(hdr.ids) * sizeof(WALBlockId);
+    if (column_size + sizeof(Meas) > hdr.size) {
+      return false;
+    }
+    size_t count = 0;
+    for (uint32_t i = 0; i < hdr.ids; ++i) {
+      WALBlockId record;
+      memcpy(&record, payload + i * sizeof(WALBlockId), sizeof(WALBlockId));
+      count += record.count;
+    }
+    return count == hdr.count;
+  }
 
-    Id2MSet subresult;
+  /// decompress values of correct block to 'out'.
+  static void decompress_block(const WALBlockHeader &hdr, const uint8_t *payload,
+                               MeasArray *out) {
+    auto out_begin = out->size();
+    out->resize(out_begin + hdr.count);
+    auto values = out->data() + out_begin;
+    if (hdr.ids == 0) {
+      memcpy(values, payload, hdr.size);
+      return;
+    }
 
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
+    auto column_size = size_t(hdr.ids) * sizeof(WALBlockId);
+    std::vector<WALBlockId> id_column(hdr.ids);
+    memcpy(id_column.data(), payload, column_size);
+    Meas first;
+    memcpy(&first, payload + column_size, sizeof(Meas));
+    auto data = const_cast<uint8_t *>(payload) + column_size + sizeof(Meas);
+    auto bb = std::make_shared<compression::ByteBuffer>(
+        compression::Range{data, const_cast<uint8_t *>(payload) + hdr.size});
+    compression::CopmressedReader creader(bb, first);
+    values[0] = first;
+    creader.readBatch(values + 1, hdr.count - 1);
+
+    size_t pos = 0;
+    for (const auto &record : id_column) {
+      for (uint32_t i = 0; i < record.count; ++i) {
+        values[pos++].id = record.id;
+      }
+    }
+  }
+
+  /// decompress blocks of file content. stops on first bad block.
+  /// return size of correct blocks.
+  static size_t decompress_blocks(const uint8_t *data, size_t size, MeasArray *out,
+                                  size_t *values_count = nullptr) {
+    size_t pos = 0;
+    std::vector<uint8_t> block;
+    while (size - pos >= sizeof(WALBlockHeader)) {
+      WALBlockHeader hdr;
+      memcpy(&hdr, data + pos, sizeof(WALBlockHeader));
+      auto block_size = sizeof(WALBlockHeader) + hdr.size;
+      if (block_size > size - pos || hdr.count == 0) {
+        break;
+      }
+      block.assign(data + pos, data + pos + block_size);
+      reinterpret_cast<WALBlockHeader *>(block.data())->crc = 0;
+      if (utils::crc32(block.data(), block_size) != hdr.crc) {
+        break;
+      }
+      auto payload = block.data() + sizeof(WALBlockHeader);
+      if (!is_correct_block(hdr, payload)) {
         break;
       }
-      if (val.inQuery(q.ids, q.flag, q.from, q.to)) {
-        subresult[val.id].insert(val);
+
+      if (out != nullptr) {
+        decompress_block(hdr, payload, out);
+      }
+      if (values_count != nullptr) {
+        *values_count += hdr.count;
       }
+      pos += block_size;
     }
-    std::fclose(_file);
-    _file = nullptr;
+    return pos;
+  }
+
+  Statistic stat(const Id id, Time from, Time to) {
+    Statistic result;
+    IdArray ids{id};
+    ENSURE(ids[0] == id);
+
+    foreach_value(ids, from, to, [&result, &ids, from, to](const Meas &m) {
+      if (m.inQuery(ids, Flag(0), from, to)) {
+        result.update(m);
+      }
+    });
+    return result;
+  }
+
+  Id2Cursor intervalReader(const QueryInterval &q) {
+    Id2MSet subresult;
+    foreach_value(q.ids, q.from, q.to, [&subresult, &q](const Meas &m) {
+      if (m.inQuery(q.ids, q.flag, q.from, q.to)) {
+        subresult[m.id].insert(m);
+      }
+    });
 
     if (subresult.empty()) {
       return Id2Cursor();
@@ -183,20 +370,13 @@ public:
     dariadb::IdSet readed_ids;
     dariadb::Id2Meas sub_res;
 
-    open_to_read();
-
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
-      }
-      if (val.inQuery(q.ids, q.flag) && (val.time <= q.time_point)) {
-        replace_if_older(sub_res, val);
-        readed_ids.insert(val.id);
-      }
-    }
-    std::fclose(_file);
-    _file = nullptr;
+    foreach_value(q.ids, MIN_TIME, q.time_point,
+                  [this, &sub_res, &readed_ids, &q](const Meas &val) {
+                    if (val.inQuery(q.ids, q.flag) && (val.time <= q.time_point)) {
+                      replace_if_older(sub_res, val);
+                      readed_ids.insert(val.id);
+                    }
+                  });
 
     if (!q.ids.empty() && readed_ids.size() != q.ids.size()) {
       for (auto id : q.ids) {
@@ -218,7 +398,7 @@ public:
       s.emplace(std::make_pair(m.id, m));
     } else {
       if (fres->second.time < m.time) {
-        s.emplace(std::make_pair(m.id, m));
+        fres->second = m;
       }
     }
   }
@@ -227,19 +407,13 @@ public:
     dariadb::Id2Meas sub_res;
     dariadb::IdSet readed_ids;
 
-    open_to_read();
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
-      }
-      if (val.inFlag(flag) && val.inIds(ids)) {
-        replace_if_older(sub_res, val);
-        readed_ids.emplace(val.id);
-      }
-    }
-    std::fclose(_file);
-    _file = nullptr;
+    foreach_value(ids, MIN_TIME, MAX_TIME,
+                  [this, &sub_res, &readed_ids, &ids, &flag](const Meas &val) {
+                    if (val.inFlag(flag) && val.inIds(ids)) {
+                      replace_if_older(sub_res, val);
+                      readed_ids.emplace(val.id);
+                    }
+                  });
 
     if (!ids.empty() && readed_ids.size() != ids.size()) {
       for (auto id : ids) {
@@ -256,83 +430,49 @@ public:
   }
 
   dariadb::Time minTime() {
-    open_to_read();
-
-    dariadb::Time result = dariadb::MAX_TIME;
-
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
-      }
-      result = std::min(val.time, result);
-    }
-    std::fclose(_file);
-    _file = nullptr;
-    return result;
+    load_summary();
+    return _min_time;
   }
 
   dariadb::Time maxTime() {
-    open_to_read();
-
-    dariadb::Time result = dariadb::MIN_TIME;
-
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
-      }
-      result = std::max(val.time, result);
-    }
-    std::fclose(_file);
-    _file = nullptr;
-    return result;
+    load_summary();
+    return _max_time;
   }
 
   bool minMaxTime(dariadb::Id id, dariadb::Time *minResult, dariadb::Time *maxResult) {
-    open_to_read();
+    load_summary();
 
     *minResult = dariadb::MAX_TIME;
     *maxResult = dariadb::MIN_TIME;
-    bool result = false;
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
-      }
-      if (val.id == id) {
-        result = true;
-        *minResult = std::min(*minResult, val.time);
-        *maxResult = std::max(*maxResult, val.time);
-      }
+    auto fres = _summary.find(id);
+    if (fres == _summary.end()) {
+      return false;
     }
-    std::fclose(_file);
-    _file = nullptr;
-    return result;
+    *minResult = fres->second.min_time;
+    *maxResult = fres->second.max_time;
+    return true;
   }
 
   void flush() {}
 
+  void sync() {
+    if (_file == nullptr) {
+      return;
+    }
+    std::fflush(_file);
+#ifdef UNIX_OS
+    fdatasync(fileno(_file));
+#else
+    _commit(_fileno(_file));
+#endif
+  }
+
   std::string filename() const { return _filename; }
 
   std::shared_ptr<MeasArray> readAll() {
-    open_to_read();
-
-    auto ma = std::make_shared<MeasArray>(_settings->wal_file_size.value());
-    auto raw = ma.get();
-    size_t pos = 0;
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
-      }
-      (*raw)[pos] = val;
-      pos++;
-    }
-    ma->resize(pos);
-    std::fclose(_file);
-    _file = nullptr;
-    return ma;
+    size_t count = 0;
+    auto values = load_values(&count);
+    return std::make_shared<MeasArray>(values, values + count);
   }
 
   [[noreturn]] void throw_open_error_exception() const {
@@ -346,6 +486,10 @@ public:
       ss << f << std::endl;
     }
     auto wals_exists = utils::fs::ls(_settings->raw_path.value(), WAL_FILE_EXT);
+    auto compressed_wals_exists =
+        utils::fs::ls(_settings->raw_path.value(), WAL_COMPRESSED_FILE_EXT);
+    wals_exists.insert(wals_exists.end(), compressed_wals_exists.begin(),
+                       compressed_wals_exists.end());
     for (auto f : wals_exists) {
       ss << f << std::endl;
     }
@@ -353,35 +497,188 @@ public:
   }
 
   Id2MinMax loadMinMax() {
-    open_to_read();
     Id2MinMax result;
-    while (1) {
-      Meas val = Meas();
-      if (fread(&val, sizeof(Meas), size_t(1), _file) == 0) {
-        break;
+    load_summary();
+    if (_summary.empty()) {
+      return result;
+    }
+    size_t count = 0;
+    auto values = load_values(&count);
+    for (const auto &kv : _summary) {
+      if (kv.second.min_pos >= count || kv.second.max_pos >= count) {
+        continue;
       }
+      auto &mm = result[kv.first];
+      mm.min = values[kv.second.min_pos];
+      mm.max = values[kv.second.max_pos];
+    }
+    return result;
+  }
 
-      auto fres = result.find(val.id);
-      if (fres == result.end()) {
-        result[val.id].min = val;
-        result[val.id].max = val;
-      } else {
-        fres->second.updateMax(val);
-        fres->second.updateMin(val);
+  /// return pointer to all values of file and their count. readonly files are
+  /// mapped to memory, values of writable file are readed once and kept by append.
+  const Meas *load_values(size_t *count) {
+    if (!_is_readonly) {
+      if (!_values_loaded) {
+        auto content = read_content();
+        if (_is_compressed) {
+          decompress_blocks(content.data(), content.size(), &_read_buffer);
+        } else {
+          auto readed = content.size() / sizeof(Meas);
+          _read_buffer.resize(readed);
+          memcpy(_read_buffer.data(), content.data(), readed * sizeof(Meas));
+        }
+        _values_loaded = true;
       }
+      *count = _read_buffer.size();
+      return _read_buffer.data();
     }
-    std::fclose(_file);
-    _file = nullptr;
+
+    if (_is_compressed) {
+      if (_mapped == nullptr) { // readonly file is decompressed once.
+        _mapped = utils::fs::MappedFile::open(_filename);
+        _read_buffer.reserve(_writed);
+        decompress_blocks(_mapped->data(), _mapped->size(), &_read_buffer);
+        _writed = _read_buffer.size();
+      }
+      *count = _read_buffer.size();
+      return _read_buffer.data();
+    }
+
+    if (_mapped == nullptr) {
+      _mapped = utils::fs::MappedFile::open(_filename);
+      _writed = _mapped->size() / sizeof(Meas);
+    }
+    *count = _writed;
+    return reinterpret_cast<const Meas *>(_mapped->data());
+  }
+
+  /// read file opened to append.
+  std::vector<uint8_t> read_content() const {
+    // _file is opened to append, so content is readed with other handle.
+    auto file = std::fopen(_filename.c_str(), "rb");
+    if (file == nullptr) {
+      throw_open_error_exception();
+    }
+    std::fseek(file, 0, SEEK_END);
+    auto file_size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    std::vector<uint8_t> result(file_size);
+    auto readed = std::fread(result.data(), sizeof(uint8_t), result.size(), file);
+    std::fclose(file);
+    result.resize(readed);
     return result;
   }
 
+  /// builds summary of file on first use.
+  void load_summary() {
+    if (_summary_loaded) {
+      return;
+    }
+    size_t count = 0;
+    auto values = load_values(&count);
+    update_summary(values, count, size_t(0));
+    _summary_loaded = true;
+  }
+
+  /// values[0] has position 'first_pos' in file.
+  void update_summary(const Meas *values, size_t count, size_t first_pos) {
+    for (size_t i = first_pos; i < first_pos + count; ++i) {
+      const auto &v = values[i - first_pos];
+      auto fres = _summary.find(v.id);
+      if (fres == _summary.end()) {
+        IdSummary s;
+        s.min_time = s.max_time = v.time;
+        s.min_pos = s.max_pos = i;
+        s.positions.push_back(i);
+        _summary.emplace(std::make_pair(v.id, std::move(s)));
+      } else {
+        auto &s = fres->second;
+        s.positions.push_back(i);
+        if (v.time < s.min_time) {
+          s.min_time = v.time;
+          s.min_pos = i;
+        }
+        if (v.time > s.max_time) {
+          s.max_time = v.time;
+          s.max_pos = i;
+        }
+      }
+      _min_time = std::min(_min_time, v.time);
+      _max_time = std::max(_max_time, v.time);
+    }
+  }
+
+  /// calls 'f' for values of ids, if file contains values of them in [from, to].
+  /// only values at positions from summary of ids are readed.
+  template <class F> void foreach_value(const IdArray &ids, Time from, Time to, F f) {
+    load_summary();
+    std::vector<const IdSummary *> summaries;
+    auto check = [&summaries, from, to](const IdSummary &s) {
+      if (s.max_time >= from && s.min_time <= to) {
+        summaries.push_back(&s);
+      }
+    };
+    if (ids.empty()) {
+      for (const auto &kv : _summary) {
+        check(kv.second);
+      }
+    } else {
+      for (auto id : ids) {
+        auto fres = _summary.find(id);
+        if (fres != _summary.end()) {
+          check(fres->second);
+        }
+      }
+    }
+    if (summaries.empty()) {
+      return;
+    }
+
+    size_t count = 0;
+    auto values = load_values(&count);
+    if (ids.empty()) {
+      for (size_t i = 0; i < count; ++i) {
+        f(values[i]);
+      }
+      return;
+    }
+    for (auto s : summaries) {
+      for (auto pos : s->positions) {
+        if (pos >= count) { // not readed yet.
+          break;
+        }
+        f(values[pos]);
+      }
+    }
+  }
+
 protected:
+  /// values of one id in file.
+  struct IdSummary {
+    Time min_time;
+    Time max_time;
+    size_t min_pos;
+    size_t max_pos;
+    std::vector<size_t> positions; // sorted positions of values in file.
+  };
+
   std::string _filename;
   bool _is_readonly;
+  bool _is_compressed;
   size_t _writed;
   EngineEnvironment_ptr _env;
   Settings *_settings;
   FILE *_file;
+
+  utils::fs::MappedFile_Ptr _mapped;
+  /// decoded values of compressed readonly file or all values of writable file.
+  MeasArray _read_buffer;
+  bool _values_loaded; /// values of writable file are in _read_buffer.
+  bool _summary_loaded;
+  std::unordered_map<Id, IdSummary> _summary;
+  Time _min_time;
+  Time _max_time;
 };
 
 WALFile_Ptr WALFile::create(const EngineEnvironment_ptr env) {
@@ -416,6 +713,10 @@ void WALFile::flush() { // write all to storage;
   _Impl->flush();
 }
 
+void WALFile::sync() {
+  _Impl->sync();
+}
+
 Status WALFile::append(const Meas &value) {
   return _Impl->append(value);
 }
@@ -457,8 +758,23 @@ std::shared_ptr<MeasArray> WALFile::readAll() {
 }
 
 size_t WALFile::writed(std::string fname) {
-  std::ifstream in(fname, std::ifstream::ate | std::ifstream::binary);
-  return in.tellg() / sizeof(Meas);
+  if (!is_compressed(fname)) {
+    std::ifstream in(fname, std::ifstream::ate | std::ifstream::binary);
+    return in.tellg() / sizeof(Meas);
+  }
+
+  std::ifstream in(fname, std::ifstream::binary);
+  std::vector<uint8_t> content{std::istreambuf_iterator<char>(in),
+                               std::istreambuf_iterator<char>()};
+  size_t result = 0;
+  Private::decompress_blocks(content.data(), content.size(), nullptr, &result);
+  return result;
+}
+
+bool WALFile::is_compressed(const std::string &fname) {
+  return fname.size() >= WAL_COMPRESSED_FILE_EXT.size() &&
+         fname.compare(fname.size() - WAL_COMPRESSED_FILE_EXT.size(),
+                       WAL_COMPRESSED_FILE_EXT.size(), WAL_COMPRESSED_FILE_EXT) == 0;
 }
 
 Id2MinMax WALFile::loadMinMax() {
@@ -10,6 +10,8 @@
 namespace dariadb {
 namespace storage {
 const std::string WAL_FILE_EXT = ".wal"; // append-only-file
+/// wal file with values in compressed blocks (see Settings::wal_compression).
+const std::string WAL_COMPRESSED_FILE_EXT = ".walz";
 
 class WALFile;
 typedef std::shared_ptr<WALFile> WALFile_Ptr;
@@ -36,11 +38,14 @@ public:
   EXPORT bool minMaxTime(dariadb::Id id, dariadb::Time *minResult,
                          dariadb::Time *maxResult) override;
   EXPORT void flush() override;
+  /// write all appended values to disk.
+  EXPORT void sync();
 
   EXPORT std::string filename() const;
 
   EXPORT std::shared_ptr<MeasArray> readAll();
   EXPORT static size_t writed(std::string fname);
+  EXPORT static bool is_compressed(const std::string &fname);
   EXPORT Id2MinMax loadMinMax() override;
 
 protected:
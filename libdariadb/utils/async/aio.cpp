@@ -0,0 +1,449 @@
+#include <libdariadb/utils/async/aio.h>
+#include <libdariadb/utils/exception.h>
+#include <libdariadb/utils/logger.h>
+#include <libdariadb/utils/strings.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef UNIX_OS
+#include <cerrno>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+using namespace dariadb::utils::async;
+
+std::istream &dariadb::utils::async::operator>>(std::istream &in, AIO_BACKEND &backend) {
+  std::string token;
+  in >> token;
+
+  token = utils::strings::to_upper(token);
+
+  if (token == "SYNC") {
+    backend = AIO_BACKEND::SYNC;
+    return in;
+  }
+  if (token == "THREADS") {
+    backend = AIO_BACKEND::THREADS;
+    return in;
+  }
+  if (token == "URING") {
+    backend = AIO_BACKEND::URING;
+    return in;
+  }
+  THROW_EXCEPTION("engine: bad aio backend - ", token);
+}
+
+std::ostream &dariadb::utils::async::operator<<(std::ostream &stream,
+                                               const AIO_BACKEND &backend) {
+  switch (backend) {
+  case AIO_BACKEND::SYNC:
+    stream << "SYNC";
+    break;
+  case AIO_BACKEND::THREADS:
+    stream << "THREADS";
+    break;
+  case AIO_BACKEND::URING:
+    stream << "URING";
+    break;
+  default:
+    THROW_EXCEPTION("engine: bad aio backend - ", (uint16_t)backend);
+    break;
+  };
+  return stream;
+}
+
+std::string dariadb::utils::async::to_string(const AIO_BACKEND &backend) {
+  std::stringstream ss;
+  ss << backend;
+  return ss.str();
+}
+
+AsyncIO::~AsyncIO() {}
+
+#ifdef UNIX_OS
+namespace {
+/// transfer all bytes of request. short result only on end of file.
+void do_request(IORequest &r) {
+  size_t done = 0;
+  while (done < r.size) {
+    auto buffer = r.buffer + done;
+    auto size = r.size - done;
+    auto offset = off_t(r.offset + done);
+    auto res = r.is_write ? ::pwrite(r.fd, buffer, size, offset)
+                          : ::pread(r.fd, buffer, size, offset);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      r.result = -errno;
+      return;
+    }
+    if (res == 0) {
+      break;
+    }
+    done += size_t(res);
+  }
+  r.result = int64_t(done);
+}
+
+class SyncIO : public AsyncIO {
+public:
+  SyncIO() : AsyncIO(AIO_BACKEND::SYNC) {}
+
+  TaskResult_Ptr submit(std::vector<IORequest> &requests, IOCallback callback) override {
+    for (auto &r : requests) {
+      do_request(r);
+    }
+    if (callback) {
+      callback(requests);
+    }
+    auto result = std::make_shared<TaskResult>();
+    result->unlock();
+    return result;
+  }
+};
+
+/// state of submitted batch. deleted by thread, which completes last part of it.
+struct Batch {
+  std::vector<IORequest> *requests;
+  std::atomic_size_t remaining;
+  IOCallback callback;
+  TaskResult_Ptr result;
+
+  virtual ~Batch() {}
+
+  void complete_one() {
+    if (remaining.fetch_sub(1) == 1) {
+      if (callback) {
+        callback(*requests);
+      }
+      auto r = result;
+      delete this;
+      r->unlock();
+    }
+  }
+};
+
+Batch *make_batch(std::vector<IORequest> &requests, IOCallback &callback) {
+  auto batch = new Batch;
+  batch->requests = &requests;
+  batch->remaining = requests.size();
+  batch->callback = callback;
+  batch->result = std::make_shared<TaskResult>();
+  return batch;
+}
+
+TaskResult_Ptr empty_batch(std::vector<IORequest> &requests, IOCallback &callback) {
+  if (callback) {
+    callback(requests);
+  }
+  auto result = std::make_shared<TaskResult>();
+  result->unlock();
+  return result;
+}
+
+class ThreadsIO : public AsyncIO {
+public:
+  ThreadsIO(size_t threads)
+      : AsyncIO(AIO_BACKEND::THREADS),
+        _pool(ThreadPool::Params(threads, (ThreadKind)THREAD_KINDS::DISK_IO)) {}
+
+  ~ThreadsIO() { _pool.stop(); }
+
+  TaskResult_Ptr submit(std::vector<IORequest> &requests, IOCallback callback) override {
+    if (requests.empty()) {
+      return empty_batch(requests, callback);
+    }
+    // one task by thread, each does every 'tasks'-th request.
+    auto tasks = std::min(requests.size(), _pool.threads_count());
+    auto batch = make_batch(requests, callback);
+    batch->remaining = tasks;
+    auto result = batch->result;
+    for (size_t t = 0; t < tasks; ++t) {
+      AsyncTask at = [batch, t, tasks](const ThreadInfo &) {
+        auto &rs = *batch->requests;
+        for (size_t i = t; i < rs.size(); i += tasks) {
+          do_request(rs[i]);
+        }
+        batch->complete_one();
+        return false;
+      };
+      _pool.post(AT(at));
+    }
+    return result;
+  }
+
+private:
+  ThreadPool _pool;
+};
+
+#ifdef HAVE_IO_URING
+/// io_uring by raw syscalls. requests are readv/writev of one buffer.
+class UringIO : public AsyncIO {
+  struct Slot {
+    Batch *batch;
+    size_t index;
+    iovec iov;
+  };
+  struct UringBatch : public Batch {
+    std::vector<Slot> slots;
+  };
+
+public:
+  static AsyncIO_Ptr create(size_t queue_depth) {
+    std::shared_ptr<UringIO> result{new UringIO()};
+    if (!result->init(unsigned(std::max(queue_depth, size_t(1))))) {
+      return nullptr;
+    }
+    return result;
+  }
+
+  ~UringIO() {
+    if (_reaper.joinable()) {
+      // nop without user data stops reaper, after requests in flight are reaped:
+      // their completions point to slots of batches.
+      {
+        std::unique_lock<std::mutex> lg(_mutex);
+        enter_pending();
+        _cond.wait(lg, [this]() { return _in_flight == 0; });
+        io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_NOP;
+        push(lg, sqe);
+        enter_pending();
+      }
+      _reaper.join();
+    }
+    if (_sqes != nullptr) {
+      munmap(_sqes, _sqes_size);
+    }
+    if (_cq_ptr != nullptr && _cq_ptr != _sq_ptr) {
+      munmap(_cq_ptr, _cq_size);
+    }
+    if (_sq_ptr != nullptr) {
+      munmap(_sq_ptr, _sq_size);
+    }
+    if (_fd >= 0) {
+      close(_fd);
+    }
+  }
+
+  TaskResult_Ptr submit(std::vector<IORequest> &requests, IOCallback callback) override {
+    if (requests.empty()) {
+      return empty_batch(requests, callback);
+    }
+    auto batch = new UringBatch;
+    batch->requests = &requests;
+    batch->remaining = requests.size();
+    batch->callback = callback;
+    batch->result = std::make_shared<TaskResult>();
+    batch->slots.resize(requests.size());
+    auto result = batch->result;
+
+    std::unique_lock<std::mutex> lg(_mutex);
+    for (size_t i = 0; i < requests.size(); ++i) {
+      auto &r = requests[i];
+      auto &slot = batch->slots[i];
+      slot.batch = batch;
+      slot.index = i;
+      slot.iov.iov_base = r.buffer;
+      slot.iov.iov_len = r.size;
+
+      io_uring_sqe sqe;
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = r.is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe.fd = r.fd;
+      sqe.off = r.offset;
+      sqe.addr = reinterpret_cast<uint64_t>(&slot.iov);
+      sqe.len = 1;
+      sqe.user_data = reinterpret_cast<uint64_t>(&slot);
+      push(lg, sqe);
+    }
+    enter_pending();
+    return result;
+  }
+
+private:
+  UringIO() : AsyncIO(AIO_BACKEND::URING) {}
+
+  bool init(unsigned entries) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    _fd = int(syscall(__NR_io_uring_setup, entries, &p));
+    if (_fd < 0) {
+      return false;
+    }
+    _sq_entries = p.sq_entries;
+    _sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+    }
+    _sq_ptr = map(_sq_size, IORING_OFF_SQ_RING);
+    if (_sq_ptr == nullptr) {
+      return false;
+    }
+    _cq_ptr = single_mmap ? _sq_ptr : map(_cq_size, IORING_OFF_CQ_RING);
+    if (_cq_ptr == nullptr) {
+      return false;
+    }
+    _sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe *>(map(_sqes_size, IORING_OFF_SQES));
+    if (_sqes == nullptr) {
+      return false;
+    }
+    auto sq = static_cast<uint8_t *>(_sq_ptr);
+    _sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    _sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    _sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    auto cq = static_cast<uint8_t *>(_cq_ptr);
+    _cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    _cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+
+    _reaper = std::thread(&UringIO::reap, this);
+    return true;
+  }
+
+  void *map(size_t size, uint64_t offset) {
+    auto result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       _fd, offset);
+    return result == MAP_FAILED ? nullptr : result;
+  }
+
+  /// requests in flight are limited by size of submission queue. completion queue is
+  /// bigger, so it never overflows.
+  void push(std::unique_lock<std::mutex> &lg, const io_uring_sqe &sqe) {
+    if (_in_flight == _sq_entries) {
+      enter_pending();
+      _cond.wait(lg, [this]() { return _in_flight < _sq_entries; });
+    }
+    auto tail = *_sq_tail;
+    auto index = tail & *_sq_mask;
+    _sqes[index] = sqe;
+    _sq_array[index] = index;
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    _in_flight++;
+    _pending++;
+  }
+
+  void enter_pending() {
+    while (_pending != 0) {
+      auto res = syscall(__NR_io_uring_enter, _fd, _pending, 0, 0, nullptr, 0);
+      if (res < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+          continue;
+        }
+        THROW_EXCEPTION("aio: io_uring_enter error - ", errno);
+      }
+      _pending -= unsigned(res);
+    }
+  }
+
+  void complete(Slot *slot, int res) {
+    auto &r = (*slot->batch->requests)[slot->index];
+    r.result = res;
+    if (res >= 0 && size_t(res) < r.size) {
+      // short transfer is finished synchronously.
+      IORequest rest = r;
+      rest.offset += size_t(res);
+      rest.buffer += size_t(res);
+      rest.size -= size_t(res);
+      do_request(rest);
+      r.result = rest.result < 0 ? rest.result : res + rest.result;
+    }
+    slot->batch->complete_one();
+  }
+
+  void reap() {
+    bool stop = false;
+    while (!stop) {
+      auto head = *_cq_head;
+      auto tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+      if (head == tail) {
+        syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        continue;
+      }
+      unsigned done = 0;
+      for (; head != tail; ++head, ++done) {
+        auto &cqe = _cqes[head & *_cq_mask];
+        if (cqe.user_data == 0) {
+          stop = true;
+        } else {
+          complete(reinterpret_cast<Slot *>(cqe.user_data), cqe.res);
+        }
+      }
+      __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+      {
+        std::lock_guard<std::mutex> lg(_mutex);
+        _in_flight -= done;
+      }
+      _cond.notify_all();
+    }
+  }
+
+  int _fd = -1;
+  unsigned _sq_entries = 0;
+  size_t _sq_size = 0;
+  size_t _cq_size = 0;
+  size_t _sqes_size = 0;
+  void *_sq_ptr = nullptr;
+  void *_cq_ptr = nullptr;
+  io_uring_sqe *_sqes = nullptr;
+  unsigned *_sq_tail = nullptr;
+  unsigned *_sq_mask = nullptr;
+  unsigned *_sq_array = nullptr;
+  unsigned *_cq_head = nullptr;
+  unsigned *_cq_tail = nullptr;
+  unsigned *_cq_mask = nullptr;
+  io_uring_cqe *_cqes = nullptr;
+
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  unsigned _in_flight = 0; /// submitted and not reaped.
+  unsigned _pending = 0;   /// pushed to queue and not entered.
+  std::thread _reaper;
+};
+#endif
+}
+#endif
+
+AsyncIO_Ptr AsyncIO::create(AIO_BACKEND backend, size_t queue_depth) {
+#ifdef UNIX_OS
+  switch (backend) {
+  case AIO_BACKEND::SYNC:
+    return std::make_shared<SyncIO>();
+  case AIO_BACKEND::URING: {
+#ifdef HAVE_IO_URING
+    auto result = UringIO::create(queue_depth);
+    if (result != nullptr) {
+      return result;
+    }
+#endif
+    logger_info("engine: io_uring is not available, aio uses threads.");
+  }
+  // fallthrough
+  case AIO_BACKEND::THREADS:
+    return std::make_shared<ThreadsIO>(std::min(std::max(queue_depth, size_t(1)),
+                                                size_t(16)));
+  }
+  return nullptr;
+#else
+  logger_info("engine: aio is not supported, pages are read through mapping.");
+  return nullptr;
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <libdariadb/utils/async/thread_pool.h>
+#include <libdariadb/utils/utils.h>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace dariadb {
+namespace utils {
+namespace async {
+/**
+backend of asynchronous disk io:
+SYNC - requests are done by calling thread, pages are read through mapping.
+THREADS - requests of batch are done in parallel by own pool of io threads.
+URING - batch is submitted to io_uring at once (linux only). THREADS is used,
+        when io_uring is not available.
+*/
+enum class AIO_BACKEND : uint8_t { SYNC = 0, THREADS, URING };
+
+EXPORT std::istream &operator>>(std::istream &in, AIO_BACKEND &backend);
+EXPORT std::ostream &operator<<(std::ostream &stream, const AIO_BACKEND &backend);
+
+EXPORT std::string to_string(const AIO_BACKEND &backend);
+
+struct IORequest {
+  int fd;
+  bool is_write;
+  uint64_t offset;
+  uint8_t *buffer;
+  size_t size;
+  int64_t result; /// count of transferred bytes or -errno.
+};
+
+/// called, when all requests of batch are done. before result is unlocked.
+using IOCallback = std::function<void(std::vector<IORequest> &)>;
+
+class AsyncIO;
+using AsyncIO_Ptr = std::shared_ptr<AsyncIO>;
+
+class AsyncIO : public utils::NonCopy {
+public:
+  /// 'queue_depth' - max count of requests in flight.
+  EXPORT static AsyncIO_Ptr create(AIO_BACKEND backend, size_t queue_depth);
+  EXPORT virtual ~AsyncIO();
+
+  /// used backend. may differ from requested, if io_uring is not available.
+  AIO_BACKEND backend() const { return _backend; }
+
+  /// submit requests as one batch. 'requests' must be alive, until result is unlocked.
+  virtual TaskResult_Ptr submit(std::vector<IORequest> &requests,
+                                IOCallback callback = nullptr) = 0;
+
+protected:
+  AsyncIO(AIO_BACKEND backend) : _backend(backend) {}
+
+  AIO_BACKEND _backend;
+};
+}
+}
+}
@@ -0,0 +1,30 @@
+#include <libdariadb/utils/async/rate_limiter.h>
+#include <thread>
+
+using namespace dariadb::utils::async;
+
+/// budget is not accumulated for longer, than this period of idle.
+const auto MAX_BURST = std::chrono::seconds(1);
+
+RateLimiter::RateLimiter(uint64_t bytes_per_second)
+    : _bytes_per_second(bytes_per_second), _start(clock::now()), _consumed(0) {}
+
+void RateLimiter::consume(uint64_t bytes) {
+  if (_bytes_per_second == 0) {
+    return;
+  }
+  clock::time_point wake_up;
+  {
+    std::lock_guard<std::mutex> lg(_locker);
+    auto now = clock::now();
+    auto spent = std::chrono::duration<double>(double(_consumed) / _bytes_per_second);
+    if (now - _start > MAX_BURST + spent) { // was idle
+      _start = now - MAX_BURST;
+      _consumed = 0;
+    }
+    _consumed += bytes;
+    spent = std::chrono::duration<double>(double(_consumed) / _bytes_per_second);
+    wake_up = _start + std::chrono::duration_cast<clock::duration>(spent);
+  }
+  std::this_thread::sleep_until(wake_up);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <libdariadb/st_exports.h>
+#include <libdariadb/utils/utils.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace dariadb {
+namespace utils {
+namespace async {
+/**
+limits throughput of background io.
+consume() sleeps, while consumed bytes are ahead of 'bytes_per_second' budget.
+zero limit - no limit.
+*/
+class RateLimiter : public utils::NonCopy {
+public:
+  EXPORT RateLimiter(uint64_t bytes_per_second);
+  EXPORT void consume(uint64_t bytes);
+  uint64_t limit() const { return _bytes_per_second; }
+
+protected:
+  using clock = std::chrono::steady_clock;
+
+  uint64_t _bytes_per_second;
+  clock::time_point _start;
+  uint64_t _consumed;
+  std::mutex _locker;
+};
+}
+}
+}
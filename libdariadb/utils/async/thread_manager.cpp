@@ -24,6 +24,9 @@ ThreadManager::ThreadManager(const ThreadManager::Params &params) : _params(para
   for (auto kv : _params.pools) {
     _pools[kv.kind] = std::make_shared<ThreadPool>(kv);
   }
+  if (_params.aio != AIO_BACKEND::SYNC) {
+    _aio = AsyncIO::create(_params.aio, _params.aio_queue_depth);
+  }
   _stoped = false;
 }
 
@@ -43,6 +46,7 @@ TaskResult_Ptr ThreadManager::post(const ThreadKind kind, const AsyncTaskWrap_Pt
 
 ThreadManager::~ThreadManager() {
   if (!_stoped) {
+    _aio = nullptr;
     for (auto &kv : _pools) {
       kv.second->stop();
     }
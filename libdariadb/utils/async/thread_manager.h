@@ -1,6 +1,7 @@
 #pragma once
 
 #include <libdariadb/st_exports.h>
+#include <libdariadb/utils/async/aio.h>
 #include <libdariadb/utils/async/thread_pool.h>
 #include <libdariadb/utils/utils.h>
 #include <unordered_map>
@@ -14,7 +15,13 @@ class ThreadManager : public utils::NonCopy {
 public:
   struct Params {
     std::vector<ThreadPool::Params> pools;
-    Params(std::vector<ThreadPool::Params> _pools) { pools = _pools; }
+    AIO_BACKEND aio;
+    size_t aio_queue_depth;
+    Params(std::vector<ThreadPool::Params> _pools) {
+      pools = _pools;
+      aio = AIO_BACKEND::SYNC;
+      aio_queue_depth = 64;
+    }
   };
   EXPORT static void start(const Params &params);
   EXPORT static void stop();
@@ -28,6 +35,11 @@ public:
   }
   EXPORT TaskResult_Ptr post(const ThreadKind kind, const AsyncTaskWrap_Ptr &task);
 
+  /// backend of batched disk io. nullptr if SYNC is used.
+  AsyncIO *aio() const { return _aio.get(); }
+  /// max count of requests of aio batch.
+  size_t aio_queue_depth() const { return _params.aio_queue_depth; }
+
   size_t active_works() {
     size_t res = 0;
     for (auto &kv : _pools) {
@@ -44,6 +56,7 @@ private:
   bool _stoped;
   Params _params;
   std::unordered_map<ThreadKind, std::shared_ptr<ThreadPool>> _pools;
+  AsyncIO_Ptr _aio;
 };
 }
 }
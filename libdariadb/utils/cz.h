@@ -28,6 +28,10 @@ uint8_t __inline clz(uint64_t value) {
     return uint8_t(64);
   }
 }
+
+uint64_t __inline bswap64(uint64_t value) {
+  return _byteswap_uint64(value);
+}
 #elif defined(GNU_CPP) || defined(CLANG_CPP)
 inline uint8_t clz(uint64_t x) {
   return static_cast<uint8_t>(__builtin_clzll(x));
@@ -35,6 +39,9 @@ inline uint8_t clz(uint64_t x) {
 inline uint8_t ctz(uint64_t x) {
   return static_cast<uint8_t>(__builtin_ctzll(x));
 }
+inline uint64_t bswap64(uint64_t x) {
+  return __builtin_bswap64(x);
+}
 #endif
 }
 }
@@ -2,6 +2,8 @@
 #include <libdariadb/utils/exception.h>
 #include <libdariadb/utils/fs.h>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <fstream>
 #include <iterator>
 
@@ -109,6 +111,14 @@ bool file_exists(const std::string &fname) {
   }
 }
 
+size_t file_size(const std::string &fname) {
+  return static_cast<size_t>(boost::filesystem::file_size(fname));
+}
+
+void resize_file(const std::string &fname, size_t new_size) {
+  boost::filesystem::resize_file(fname, new_size);
+}
+
 bool path_exists(const std::string &path) {
   return boost::filesystem::exists(path);
 }
@@ -134,6 +144,48 @@ std::string read_file(const std::string &fname) {
   fs.close();
   return ss.str();
 }
+
+class MappedFile::Private {
+public:
+  Private(const std::string &fname) {
+    namespace bi = boost::interprocess;
+    auto file_size = boost::filesystem::file_size(fname);
+    if (file_size != 0) { // empty file can not be mapped.
+      bi::file_mapping mapping(fname.c_str(), bi::read_only);
+      _region = bi::mapped_region(mapping, bi::read_only);
+    }
+  }
+
+  const uint8_t *data() const {
+    return static_cast<const uint8_t *>(_region.get_address());
+  }
+
+  size_t size() const { return _region.get_size(); }
+
+  boost::interprocess::mapped_region _region;
+};
+
+MappedFile_Ptr MappedFile::open(const std::string &fname) {
+  return MappedFile_Ptr{new MappedFile(fname)};
+}
+
+MappedFile::MappedFile(const std::string &fname) {
+  try {
+    _Impl = std::unique_ptr<Private>{new Private(fname)};
+  } catch (std::exception &ex) {
+    THROW_EXCEPTION("MappedFile: can`t map ", fname, " - ", ex.what());
+  }
+}
+
+MappedFile::~MappedFile() {}
+
+const uint8_t *MappedFile::data() const {
+  return _Impl->data();
+}
+
+size_t MappedFile::size() const {
+  return _Impl->size();
+}
+}
 }
 }
-}
\ No newline at end of file
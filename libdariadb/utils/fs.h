@@ -23,10 +23,29 @@ EXPORT std::string append_path(const std::string &p1, const std::string &p2);
 
 EXPORT bool path_exists(const std::string &path);
 EXPORT bool file_exists(const std::string &fname);
+EXPORT size_t file_size(const std::string &fname);
+EXPORT void resize_file(const std::string &fname, size_t new_size);
 
 EXPORT void mkdir(const std::string &path);
 
 EXPORT std::string read_file(const std::string &fname);
+
+class MappedFile;
+using MappedFile_Ptr = std::shared_ptr<MappedFile>;
+/// read-only memory mapped file.
+class MappedFile {
+public:
+  EXPORT static MappedFile_Ptr open(const std::string &fname);
+  EXPORT ~MappedFile();
+  EXPORT const uint8_t *data() const;
+  EXPORT size_t size() const;
+
+protected:
+  MappedFile(const std::string &fname);
+
+  class Private;
+  std::unique_ptr<Private> _Impl;
+};
 }
 }
 }
@@ -314,6 +314,8 @@ public:
     p_header->flag = qi.flag;
     p_header->from = qi.from;
     p_header->to = qi.to;
+    p_header->step = qi.step;
+    p_header->aggregation = static_cast<uint8_t>(qi.aggregation);
 
     auto id_size = sizeof(Id) * qi.ids.size();
     if ((id_size + nd->size) > NetData::MAX_MESSAGE_SIZE) {
@@ -379,9 +379,16 @@ void IOClient::readInterval(const NetData_ptr &d) {
 
   if (query_hdr->from >= query_hdr->to) {
     sendError(query_num, ERRORS::WRONG_QUERY_PARAM_FROM_GE_TO);
+  } else if (query_hdr->aggregation > static_cast<uint8_t>(Aggregation::LAST)) {
+    sendError(query_num, ERRORS::WRONG_QUERY_PARAM_AGGREGATION);
   } else {
 
-    auto qi = new QueryInterval{all_ids, query_hdr->flag, query_hdr->from, query_hdr->to};
+    auto qi = new QueryInterval{all_ids,
+                                query_hdr->flag,
+                                query_hdr->from,
+                                query_hdr->to,
+                                query_hdr->step,
+                                static_cast<Aggregation>(query_hdr->aggregation)};
 
     auto cdr = new ClientDataReader(this, query_num);
     this->readerAdd(ReaderCallback_ptr(cdr), qi);
@@ -6,12 +6,16 @@
 #include <libdariadb/compression/compression.h>
 #include <libdariadb/compression/delta.h>
 #include <libdariadb/compression/flag.h>
+#include <libdariadb/compression/lz.h>
 #include <libdariadb/compression/xor.h>
 #include <libdariadb/timeutil.h>
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <iterator>
+#include <vector>
 
 using dariadb::compression::ByteBuffer;
 using dariadb::compression::ByteBuffer_Ptr;
@@ -495,3 +499,291 @@ BOOST_AUTO_TEST_CASE(CompressedBlockV2Test) {
     BOOST_CHECK(m.value == r_m.value);
   }
 }
+
+BOOST_AUTO_TEST_CASE(CompressedBatchReadTest) {
+  const size_t test_buffer_size = 4096;
+
+  uint8_t b_begin[test_buffer_size];
+  auto b_end = std::end(b_begin);
+
+  std::fill(b_begin, b_end, 0);
+  dariadb::compression::Range rng{b_begin, b_end};
+
+  using dariadb::compression::CopmressedWriter;
+  using dariadb::compression::CopmressedReader;
+
+  auto bw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+
+  CopmressedWriter cwr(bw);
+
+  std::vector<dariadb::Time> deltas{1, 1, 50, 3000, 100000, 10, 5000000000};
+  std::vector<dariadb::Meas> meases{};
+  dariadb::Time t = dariadb::timeutil::current_time();
+  dariadb::Value v = 1.0;
+  for (int i = 0;; i++) {
+    auto m = dariadb::Meas(1);
+    t += deltas[i % deltas.size()];
+    m.time = t;
+    m.flag = dariadb::Flag(i % 3 == 0 ? i * 1000 : 1);
+    if (i % 5 != 0) {
+      v = v * 1.3 + i;
+    }
+    m.value = v;
+    if (!cwr.append(m)) {
+      break;
+    }
+    meases.push_back(m);
+  }
+  BOOST_CHECK_GT(meases.size(), size_t(10));
+
+  auto rbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+  CopmressedReader crr(rbw, meases.front());
+
+  auto n = meases.size() - 1;
+  auto first_part = n / 3;
+  std::vector<dariadb::Meas> readed(n);
+  // read, readBatch and readBatch to columns must give the same values.
+  for (size_t i = 0; i < 3; ++i) {
+    readed[i] = crr.read();
+  }
+  crr.readBatch(readed.data() + 3, first_part - 3);
+
+  std::vector<dariadb::Time> times(n - first_part);
+  std::vector<dariadb::Value> values(n - first_part);
+  std::vector<dariadb::Flag> flags(n - first_part);
+  crr.readBatch(n - first_part, times.data(), values.data(), flags.data());
+  for (size_t i = 0; i < times.size(); ++i) {
+    auto &m = readed[first_part + i];
+    m.id = 1;
+    m.time = times[i];
+    m.value = values[i];
+    m.flag = flags[i];
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    auto &m = meases[i + 1];
+    auto &r_m = readed[i];
+    BOOST_CHECK_EQUAL(m.flag, r_m.flag);
+    BOOST_CHECK_EQUAL(m.id, r_m.id);
+    BOOST_CHECK_EQUAL(m.time, r_m.time);
+    BOOST_CHECK_EQUAL(m.value, r_m.value);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GorillaCompressorTest) {
+  const size_t test_buffer_size = 1024;
+
+  uint8_t b_begin[test_buffer_size];
+  auto b_end = std::end(b_begin);
+
+  std::fill(b_begin, b_end, 0);
+  dariadb::compression::Range rng{b_begin, b_end};
+
+  using dariadb::compression::CODEC;
+  using dariadb::compression::CopmressedWriter;
+  using dariadb::compression::CopmressedReader;
+
+  auto bw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+
+  CopmressedWriter cwr(bw, CODEC::GORILLA);
+
+  // regular steps, jitter, steps back and big jumps.
+  std::vector<int64_t> deltas{1000, 1000, 1001, 999, 1000, 70,  -5,
+                              300,  5000, 1000, 1000, 1000, 1000, 5000000000};
+  std::vector<dariadb::Meas> meases{};
+  dariadb::Time t = dariadb::timeutil::current_time();
+  dariadb::Value v = 10.0;
+  for (int i = 0;; i++) {
+    auto m = dariadb::Meas(2);
+    t += deltas[i % deltas.size()];
+    m.time = t;
+    m.flag = dariadb::Flag(i % 10 == 0 ? (i % 20 == 0 ? 100000 + i : 7) : 0);
+    if (i % 4 == 1) {
+      v += 0.5;
+    } else if (i % 4 == 3) {
+      v = -v * 3.7;
+    }
+    m.value = v;
+    if (!cwr.append(m)) {
+      BOOST_CHECK(cwr.isFull());
+      break;
+    }
+    meases.push_back(m);
+  }
+  BOOST_CHECK_LE(cwr.usedSpace(), test_buffer_size);
+  BOOST_CHECK_GT(meases.size(), size_t(100));
+
+  auto rbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+  CopmressedReader crr(rbw, meases.front(), CODEC::GORILLA);
+
+  for (size_t i = 1; i < meases.size(); ++i) {
+    auto &m = meases[i];
+    auto r_m = crr.read();
+    BOOST_CHECK_EQUAL(m.flag, r_m.flag);
+    BOOST_CHECK_EQUAL(m.id, r_m.id);
+    BOOST_CHECK_EQUAL(m.time, r_m.time);
+    BOOST_CHECK_EQUAL(m.value, r_m.value);
+  }
+
+  // regular series is packed denser than by byte aligned codec.
+  size_t used_space[2];
+  CODEC codecs[2] = {CODEC::DELTA_XOR, CODEC::GORILLA};
+  for (size_t i = 0; i < 2; ++i) {
+    std::fill(b_begin, b_end, 0);
+    auto cbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+    CopmressedWriter writer(cbw, codecs[i]);
+    auto m = dariadb::Meas(1);
+    for (size_t j = 0; j < 100; ++j) {
+      m.time += 1000;
+      m.value = dariadb::Value(j % 3);
+      BOOST_CHECK(writer.append(m));
+    }
+    used_space[i] = writer.usedSpace();
+  }
+  BOOST_CHECK_LT(used_space[1], used_space[0]);
+}
+
+BOOST_AUTO_TEST_CASE(SealedCodecsTest) {
+  using dariadb::compression::CODEC;
+
+  const size_t count = 300;
+  auto make_series = [count](std::function<void(size_t, dariadb::Meas &)> f) {
+    dariadb::MeasArray result(count);
+    for (size_t i = 0; i < count; ++i) {
+      result[i].id = 5;
+      result[i].time = 1000 + i * 10;
+      f(i, result[i]);
+    }
+    return result;
+  };
+
+  std::vector<dariadb::MeasArray> series{
+      // constant
+      make_series([](size_t, dariadb::Meas &m) { m.value = 3.5; }),
+      // runs of equal values
+      make_series([](size_t i, dariadb::Meas &m) { m.value = dariadb::Value(i / 50); }),
+      // counter with jitter of time
+      make_series([](size_t i, dariadb::Meas &m) {
+        m.value = dariadb::Value(i * 3 + (i % 2));
+        m.time += i % 3;
+      }),
+      // few levels
+      make_series([](size_t i, dariadb::Meas &m) {
+        m.value = (i % 4) * 0.1;
+        m.flag = i % 7 == 0 ? 1 : 0;
+      }),
+      // not regular
+      make_series([](size_t i, dariadb::Meas &m) { m.value = std::sin(i * 0.37) * 100; }),
+      // one value
+      dariadb::MeasArray{dariadb::Meas(5)},
+      // all columns are not constant, read from own positions.
+      make_series([](size_t i, dariadb::Meas &m) {
+        m.value = std::sin(i * 0.37) * 100;
+        m.time += i % 3;
+        m.flag = i % 5 == 0 ? 1 : 0;
+      }),
+  };
+
+  for (auto &values : series) {
+    auto sealed = dariadb::compression::sealed_size(values.data(), values.size());
+    std::vector<uint8_t> buffer(sealed.bytes + 1);
+    dariadb::compression::Range rng{buffer.data(), buffer.data() + buffer.size()};
+    auto bw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+    dariadb::compression::sealed_encode(values.data(), values.size(), sealed.codec, bw);
+    BOOST_CHECK_EQUAL(bw->pos(), uint32_t(0));
+
+    auto rbw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+    dariadb::compression::CopmressedReader rdr(rbw, values.front(), values.back(),
+                                               values.size(), sealed.codec);
+    // first half by one value, rest by batch.
+    auto half = values.size() / 2;
+    dariadb::MeasArray readed(values.size());
+    for (size_t i = 1; i < half; ++i) {
+      readed[i] = rdr.read();
+    }
+    if (values.size() > 1) {
+      rdr.readBatch(readed.data() + std::max(half, size_t(1)),
+                    values.size() - std::max(half, size_t(1)));
+    }
+    for (size_t i = 1; i < values.size(); ++i) {
+      BOOST_CHECK_EQUAL(readed[i].id, values[i].id);
+      BOOST_CHECK_EQUAL(readed[i].time, values[i].time);
+      BOOST_CHECK_EQUAL(readed[i].value, values[i].value);
+      BOOST_CHECK_EQUAL(readed[i].flag, values[i].flag);
+    }
+  }
+
+  auto constant = dariadb::compression::sealed_size(series[0].data(), count);
+  BOOST_CHECK(constant.codec == CODEC::CONSTANT);
+  BOOST_CHECK_EQUAL(constant.bytes, size_t(0));
+  // regular series are smaller, than in gorilla codec.
+  for (size_t i = 1; i < 4; ++i) {
+    auto sealed = dariadb::compression::sealed_size(series[i].data(), count);
+    BOOST_CHECK(sealed.codec == CODEC::COLUMNS);
+
+    std::vector<uint8_t> buffer(count * sizeof(dariadb::Meas));
+    dariadb::compression::Range rng{buffer.data(), buffer.data() + buffer.size()};
+    auto bw = std::make_shared<dariadb::compression::ByteBuffer>(rng);
+    dariadb::compression::CopmressedWriter cwr(bw, CODEC::GORILLA);
+    for (auto &m : series[i]) {
+      BOOST_CHECK(cwr.append(m));
+    }
+    BOOST_CHECK_LT(sealed.bytes, cwr.usedSpace());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LzBlockTest) {
+  using dariadb::compression::BLOCK_COMPRESSION;
+
+  std::vector<std::vector<uint8_t>> inputs;
+  inputs.push_back({});
+  inputs.push_back({1, 2, 3});
+  inputs.push_back(std::vector<uint8_t>(100000, 7));
+  std::vector<uint8_t> text;
+  for (size_t i = 0; i < 20000; ++i) {
+    text.push_back(uint8_t("dariadb time series"[i % 19]));
+    text.push_back(uint8_t(i % 13));
+  }
+  inputs.push_back(text);
+  std::vector<uint8_t> noise(5000);
+  uint32_t seed = 1;
+  for (auto &b : noise) {
+    seed = seed * 1103515245 + 12345;
+    b = uint8_t(seed >> 24);
+  }
+  inputs.push_back(noise);
+
+  for (auto &input : inputs) {
+    size_t packed_sizes[2];
+    size_t i = 0;
+    for (auto method : {BLOCK_COMPRESSION::FAST, BLOCK_COMPRESSION::HIGH}) {
+      std::vector<uint8_t> packed(dariadb::compression::lz_bound(input.size()));
+      auto packed_size = dariadb::compression::lz_compress(
+          input.data(), input.size(), packed.data(), packed.size(), method);
+      BOOST_CHECK_GT(packed_size, size_t(0));
+      packed_sizes[i++] = packed_size;
+
+      std::vector<uint8_t> unpacked(input.size());
+      BOOST_CHECK(dariadb::compression::lz_decompress(packed.data(), packed_size,
+                                                      unpacked.data(), unpacked.size()));
+      BOOST_CHECK(unpacked == input);
+
+      if (input.size() > 1000) {
+        // small output buffer and broken input are detected.
+        BOOST_CHECK_EQUAL(dariadb::compression::lz_compress(input.data(), input.size(),
+                                                            packed.data(), 8, method),
+                          size_t(0));
+        BOOST_CHECK(!dariadb::compression::lz_decompress(
+            packed.data(), packed_size / 2, unpacked.data(), unpacked.size()));
+      }
+    }
+    BOOST_CHECK_LE(packed_sizes[1], packed_sizes[0]);
+  }
+
+  BOOST_CHECK(dariadb::compression::block_compression_for("", 3) ==
+              BLOCK_COMPRESSION::NONE);
+  BOOST_CHECK(dariadb::compression::block_compression_for("none,fast,high", 1) ==
+              BLOCK_COMPRESSION::FAST);
+  BOOST_CHECK(dariadb::compression::block_compression_for("none,fast,high", 10) ==
+              BLOCK_COMPRESSION::HIGH);
+}
@@ -71,6 +71,28 @@ BOOST_AUTO_TEST_CASE(Engine_common_test) {
     auto values = ms->readInterval(QueryInterval({dariadb::Id(0)}, 0, from, to));
     BOOST_CHECK_EQUAL(values.size(), dariadb_test::copies_count);
 
+    auto aggregated = ms->readInterval(
+        QueryInterval({dariadb::Id(0)}, 0, from, to, to - from + 1, Aggregation::COUNT));
+    BOOST_CHECK_EQUAL(aggregated.size(), size_t(1));
+    BOOST_CHECK_EQUAL(aggregated.front().time, from);
+    BOOST_CHECK_EQUAL(aggregated.front().value, Value(values.size()));
+
+    // few buckets - from statistics, many buckets - from values.
+    auto sum_of = [](const MeasList &ml) {
+      Value result = 0;
+      for (auto &m : ml) {
+        result += m.value;
+      }
+      return result;
+    };
+    auto expected_sum = sum_of(values);
+    auto from_stat = ms->readInterval(
+        QueryInterval({dariadb::Id(0)}, 0, from, to, (to - from) / 4, Aggregation::SUM));
+    auto from_values = ms->readInterval(
+        QueryInterval({dariadb::Id(0)}, 0, from, to, 1, Aggregation::SUM));
+    BOOST_CHECK(areSame(sum_of(from_stat), expected_sum));
+    BOOST_CHECK(areSame(sum_of(from_values), expected_sum));
+
     auto current = ms->currentValue(dariadb::IdArray{}, 0);
     BOOST_CHECK(current.size() != size_t(0));
   }
@@ -121,6 +143,231 @@ BOOST_AUTO_TEST_CASE(Engine_compress_all_test) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(Engine_AggregateOverwritten_test) {
+  const std::string storage_path = "testStorage";
+  const size_t total_count = 1000;
+  const size_t overwritten = 100;
+
+  using namespace dariadb;
+  using namespace dariadb::storage;
+
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(STRATEGY::WAL);
+    settings->chunk_size.setValue(128);
+    settings->wal_file_size.setValue(total_count * 2);
+    std::unique_ptr<Engine> ms{new Engine(settings)};
+
+    auto write = [&ms](size_t count) {
+      MeasArray ma(count);
+      for (size_t i = 0; i < count; ++i) {
+        ma[i].id = Id(0);
+        ma[i].time = Time(i);
+        ma[i].value = Value(1);
+      }
+      ms->append(ma);
+    };
+    // few buckets - from statistics, many buckets - from values.
+    // values with the same time must be counted once in both.
+    auto check = [&ms]() {
+      for (Time step : {Time(total_count / 4), Time(1)}) {
+        auto out = ms->readInterval(
+            QueryInterval({Id(0)}, 0, 0, total_count - 1, step, Aggregation::COUNT));
+        Value count = 0;
+        for (auto &m : out) {
+          count += m.value;
+        }
+        BOOST_CHECK_EQUAL(count, Value(total_count));
+      }
+    };
+
+    write(total_count);
+    ms->compress_all();
+    check();
+    // overwritten values are in wal and in page.
+    write(overwritten);
+    check();
+    // overwritten values are in two overlapped pages.
+    ms->compress_all();
+    check();
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Engine_rollup_test) {
+  const std::string storage_path = "testStorage";
+  using namespace dariadb;
+  using namespace dariadb::storage;
+  {
+    std::cout << "Engine_rollup_test\n";
+    if (dariadb::utils::fs::path_exists(storage_path)) {
+      dariadb::utils::fs::rm(storage_path);
+    }
+
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::WAL);
+    settings->wal_file_size.setValue(500);
+    settings->wal_cache_size.setValue(100);
+    // 10 - erased with raw values, 100 - retention is longer than time since 1970.
+    settings->rollup_tiers.setValue("10:0,100:1000000000000000");
+    std::unique_ptr<Engine> ms{new Engine(settings)};
+
+    auto write = [&ms](Time from, Time to) {
+      for (Time t = from; t < to; ++t) {
+        Meas m(1);
+        m.time = t;
+        m.value = Value(1);
+        ms->append(m);
+      }
+    };
+    auto count_of = [](const MeasList &ml) {
+      Value result = 0;
+      for (auto &m : ml) {
+        result += m.value;
+      }
+      return result;
+    };
+
+    write(0, 1000);
+    ms->compress_all();
+    // values in wal are read without rollups.
+    write(1000, 1050);
+
+    auto by_100 =
+        ms->readInterval(QueryInterval({1}, 0, 0, 1099, 100, Aggregation::COUNT));
+    BOOST_CHECK_EQUAL(by_100.size(), size_t(11));
+    BOOST_CHECK(areSame(count_of(by_100), Value(1050)));
+    BOOST_CHECK(areSame(by_100.front().value, Value(100)));
+
+    // last bucket of tier is cut by 'to'.
+    auto cut = ms->readInterval(QueryInterval({1}, 0, 0, 549, 100, Aggregation::SUM));
+    BOOST_CHECK_EQUAL(cut.size(), size_t(6));
+    BOOST_CHECK(areSame(cut.back().value, Value(50)));
+
+    ms->eraseOld(500);
+    by_100 = ms->readInterval(QueryInterval({1}, 0, 0, 1099, 100, Aggregation::COUNT));
+    BOOST_CHECK(areSame(count_of(by_100), Value(1050)));
+    auto by_10 = ms->readInterval(QueryInterval({1}, 0, 0, 1099, 10, Aggregation::COUNT));
+    BOOST_CHECK(areSame(count_of(by_10), Value(550)));
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Engine_rollup_overwrite_test) {
+  const std::string storage_path = "testStorage";
+  using namespace dariadb;
+  using namespace dariadb::storage;
+  std::cout << "Engine_rollup_overwrite_test\n";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  auto open = [&storage_path]() {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::WAL);
+    settings->wal_file_size.setValue(500);
+    settings->wal_cache_size.setValue(100);
+    settings->rollup_tiers.setValue("100:0");
+    return std::make_unique<Engine>(settings);
+  };
+  auto write = [](Engine *ms, Time from, Time to, Value v) {
+    for (Time t = from; t < to; ++t) {
+      Meas m(1);
+      m.time = t;
+      m.value = v;
+      ms->append(m);
+    }
+  };
+  auto check = [](Engine *ms) {
+    auto count =
+        ms->readInterval(QueryInterval({1}, 0, 0, 999, 100, Aggregation::COUNT));
+    BOOST_CHECK_EQUAL(count.size(), size_t(10));
+    for (auto &m : count) {
+      BOOST_CHECK(areSame(m.value, Value(100)));
+    }
+    auto sum = ms->readInterval(QueryInterval({1}, 0, 0, 999, 100, Aggregation::SUM));
+    BOOST_CHECK_EQUAL(sum.size(), size_t(10));
+    for (auto &m : sum) {
+      BOOST_CHECK(areSame(m.value, Value(100)));
+    }
+  };
+  {
+    auto ms = open();
+    write(ms.get(), 0, 1000, Value(1));
+    ms->compress_all();
+    // values in pages are overwritten by new page.
+    write(ms.get(), 200, 300, Value(1));
+    ms->compress_all();
+    check(ms.get());
+    // values in pages are overwritten by values in wal.
+    write(ms.get(), 500, 550, Value(1));
+    check(ms.get());
+  }
+  {
+    // overwritten buckets are known after reopen.
+    auto ms = open();
+    check(ms.get());
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Engine_rollup_backfill_test) {
+  const std::string storage_path = "testStorage";
+  using namespace dariadb;
+  using namespace dariadb::storage;
+  std::cout << "Engine_rollup_backfill_test\n";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  auto open = [&storage_path](const std::string &tiers) {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::WAL);
+    settings->wal_file_size.setValue(500);
+    settings->wal_cache_size.setValue(100);
+    settings->rollup_tiers.setValue(tiers);
+    return std::make_unique<Engine>(settings);
+  };
+  auto check = [](Engine *ms) {
+    auto by_100 =
+        ms->readInterval(QueryInterval({1}, 0, 0, 999, 100, Aggregation::COUNT));
+    BOOST_CHECK_EQUAL(by_100.size(), size_t(10));
+    for (auto &m : by_100) {
+      BOOST_CHECK(areSame(m.value, Value(100)));
+    }
+  };
+  {
+    // pages are written before tier is configured.
+    auto ms = open("");
+    for (Time t = 0; t < 1000; ++t) {
+      Meas m(1);
+      m.time = t;
+      m.value = Value(1);
+      ms->append(m);
+    }
+    ms->compress_all();
+  }
+  {
+    auto ms = open("100:0");
+    check(ms.get());
+  }
+  {
+    // tier is back-filled once.
+    auto ms = open("100:0");
+    check(ms.get());
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
 class Moc_SubscribeClbk : public dariadb::IReadCallback {
 public:
   std::list<dariadb::Meas> values;
@@ -220,6 +467,146 @@ BOOST_AUTO_TEST_CASE(Engine_MemStorage_common_test) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(Engine_BatchAppend_test) {
+  const std::string storage_path = "testStorage";
+  const size_t id_count = 7;
+  const size_t total_count = 5000;
+
+  using namespace dariadb;
+  using namespace dariadb::storage;
+
+  for (auto strategy : {STRATEGY::MEMORY, STRATEGY::WAL}) {
+    std::cout << "Engine_BatchAppend_test " << strategy << std::endl;
+    if (dariadb::utils::fs::path_exists(storage_path)) {
+      dariadb::utils::fs::rm(storage_path);
+    }
+    {
+      auto settings = dariadb::storage::Settings::create(storage_path);
+      settings->strategy.setValue(strategy);
+      settings->chunk_size.setValue(128);
+      settings->memory_limit.setValue(50 * 1024);
+      settings->wal_file_size.setValue(2000);
+      std::unique_ptr<Engine> ms{new Engine(settings)};
+
+      auto clbk = std::make_shared<Moc_SubscribeClbk>();
+      ms->subscribe(IdArray{}, 0, clbk);
+
+      // ids are interleaved, so each batch touches every track.
+      MeasArray ma(total_count);
+      for (size_t i = 0; i < total_count; ++i) {
+        ma[i].id = Id(i % id_count);
+        ma[i].time = Time(i);
+        ma[i].value = Value(i);
+      }
+      auto status = ms->append(ma);
+      BOOST_CHECK_EQUAL(status.writed, total_count);
+      BOOST_CHECK_EQUAL(status.ignored, size_t(0));
+      BOOST_CHECK_EQUAL(clbk->values.size(), total_count);
+
+      IdArray ids(id_count);
+      for (size_t i = 0; i < id_count; ++i) {
+        ids[i] = Id(i);
+      }
+      auto current = ms->currentValue(ids, 0);
+      BOOST_CHECK_EQUAL(current.size(), id_count);
+      for (auto &kv : current) {
+        auto expected = (total_count - 1 - kv.first) / id_count * id_count + kv.first;
+        BOOST_CHECK_EQUAL(kv.second.time, Time(expected));
+      }
+
+      ms->flush();
+      auto values = ms->readInterval(QueryInterval(ids, 0, 0, total_count));
+      BOOST_CHECK_EQUAL(values.size(), total_count);
+    }
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Engine_StatWhileDrop_test) {
+  const std::string storage_path = "testStorage";
+  const size_t total_count = 20000;
+
+  using namespace dariadb;
+  using namespace dariadb::storage;
+
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(STRATEGY::WAL);
+    settings->chunk_size.setValue(128);
+    settings->wal_file_size.setValue(500);
+    settings->wal_cache_size.setValue(100);
+    std::unique_ptr<Engine> ms{new Engine(settings)};
+
+    MeasArray ma(total_count);
+    for (size_t i = 0; i < total_count; ++i) {
+      ma[i].id = Id(0);
+      ma[i].time = Time(i);
+      ma[i].value = Value(1);
+    }
+    ms->append(ma);
+    ms->drop_part_wals(total_count);
+
+    // wal files are moved to pages meanwhile, value must be counted once.
+    for (size_t i = 0; i < 200; ++i) {
+      auto st = ms->stat(Id(0), 0, total_count);
+      BOOST_CHECK_EQUAL(st.count, uint32_t(total_count));
+      BOOST_CHECK_EQUAL(st.sum, Value(total_count));
+    }
+    ms->flush();
+    auto st = ms->stat(Id(0), 0, total_count);
+    BOOST_CHECK_EQUAL(st.count, uint32_t(total_count));
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Engine_StatWhileMemoryDrop_test) {
+  const std::string storage_path = "testStorage";
+  const size_t total_count = 20000;
+
+  using namespace dariadb;
+  using namespace dariadb::storage;
+
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(STRATEGY::MEMORY);
+    settings->chunk_size.setValue(128);
+    settings->memory_limit.setValue(50 * 1024);
+    std::unique_ptr<Engine> ms{new Engine(settings)};
+
+    MeasArray ma(total_count);
+    for (size_t i = 0; i < total_count; ++i) {
+      ma[i].id = Id(0);
+      ma[i].time = Time(i);
+      ma[i].value = Value(1);
+    }
+    ms->append(ma);
+
+    // chunks are moved to pages meanwhile, value must be seen once.
+    for (size_t i = 0; i < 200; ++i) {
+      auto st = ms->stat(Id(0), 0, total_count);
+      BOOST_CHECK_EQUAL(st.count, uint32_t(total_count));
+      BOOST_CHECK_EQUAL(st.sum, Value(total_count));
+      if (i % 20 == 0) {
+        auto values = ms->readInterval(QueryInterval({Id(0)}, 0, 0, total_count));
+        BOOST_CHECK_EQUAL(values.size(), total_count);
+      }
+    }
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(Engine_Cache_common_test) {
   const std::string storage_path = "testStorage";
 
@@ -5,25 +5,36 @@
 #include <libdariadb/storage/callbacks.h>
 #include <libdariadb/storage/engine_environment.h>
 #include <libdariadb/storage/memstorage/memstorage.h>
+#include <libdariadb/storage/memstorage/trackmap.h>
 #include <libdariadb/storage/settings.h>
 #include <libdariadb/utils/async/thread_manager.h>
 #include <libdariadb/utils/fs.h>
 #include <boost/test/unit_test.hpp>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <atomic>
+#include <set>
+#include <thread>
 
 #include "test_common.h"
 
 struct MokChunkWriter : public dariadb::ChunkContainer {
   size_t droped;
+  size_t droped_values;
 
-  MokChunkWriter() { droped = 0; }
+  MokChunkWriter() {
+    droped = 0;
+    droped_values = 0;
+  }
   ~MokChunkWriter() {}
   using ChunkContainer::foreach;
 
   void appendChunks(const std::vector<dariadb::storage::Chunk *> &a,
                     size_t count) override {
     droped += count;
+    for (size_t i = 0; i < count; ++i) {
+      droped_values += a[i]->header->stat.count;
+    }
   }
 
   bool minMaxTime(dariadb::Id id, dariadb::Time *minResult,
@@ -87,6 +98,117 @@ BOOST_AUTO_TEST_CASE(MemChunkAllocatorTest) {
   BOOST_CHECK_EQUAL(new_obj.position, last.position);
 }
 
+BOOST_AUTO_TEST_CASE(MemChunkAllocatorThreadsTest) {
+  std::cout << "MemChunkAllocatorThreadsTest" << std::endl;
+  const size_t buffer_size = 256;
+  const size_t max_size = 4 * 1024 * 1024;
+  const size_t threads_count = 4;
+  using dariadb::storage::HUGE_PAGES;
+  using dariadb::storage::MemChunkAllocator;
+
+  for (auto pages : {HUGE_PAGES::NONE, HUGE_PAGES::TRANSPARENT, HUGE_PAGES::EXPLICIT}) {
+    MemChunkAllocator allocator(max_size, buffer_size, pages);
+    BOOST_CHECK_GE(allocator.nodes(), size_t(1));
+    std::vector<std::atomic_bool> used(allocator._capacity);
+    for (auto &u : used) {
+      u = false;
+    }
+    std::atomic_size_t errors{0};
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threads_count; ++t) {
+      threads.emplace_back([&]() {
+        std::vector<MemChunkAllocator::AllocatedData> mine;
+        for (size_t round = 0; round < 20; ++round) {
+          for (size_t i = 0; i < 100; ++i) {
+            auto d = allocator.allocate();
+            if (d.header == nullptr) {
+              break;
+            }
+            if (used[d.position].exchange(true) || d.buffer[0] != 0) {
+              errors++;
+            }
+            d.buffer[0] = 1;
+            mine.push_back(d);
+          }
+          for (auto &d : mine) {
+            used[d.position] = false;
+            allocator.free(d);
+          }
+          mine.clear();
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    BOOST_CHECK_EQUAL(errors.load(), size_t(0));
+    BOOST_CHECK_EQUAL(allocator._allocated.load(), size_t(0));
+
+    // all positions are available, even if they are cached by other cpus.
+    std::set<size_t> positions;
+    while (true) {
+      auto d = allocator.allocate();
+      if (d.header == nullptr) {
+        break;
+      }
+      positions.insert(d.position);
+    }
+    BOOST_CHECK_EQUAL(positions.size(), allocator._capacity);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MemChunkAllocatorResizeTest) {
+  std::cout << "MemChunkAllocatorResizeTest" << std::endl;
+  const size_t buffer_size = 1024;
+  const size_t mb = 1024 * 1024;
+  using dariadb::storage::MemChunkAllocator;
+  MemChunkAllocator allocator(10 * mb, buffer_size);
+
+  auto allocate_all = [&allocator]() {
+    std::vector<MemChunkAllocator::AllocatedData> result;
+    while (true) {
+      auto d = allocator.allocate();
+      if (d.header == nullptr) {
+        break;
+      }
+      result.push_back(d);
+    }
+    return result;
+  };
+
+  auto used = allocate_all();
+  BOOST_CHECK_EQUAL(used.size(), allocator._capacity.load());
+  auto segments = allocator.segments();
+  BOOST_CHECK_GE(segments, size_t(2));
+
+  // grow: new chunks are available at once.
+  allocator.resize(20 * mb);
+  BOOST_CHECK_GT(allocator.segments(), segments);
+  auto more = allocate_all();
+  BOOST_CHECK_EQUAL(used.size() + more.size(), allocator._capacity.load());
+  used.insert(used.end(), more.begin(), more.end());
+
+  // shrink: used chunks stay valid, memory is unmapped, when they are freed.
+  allocator.resize(4 * mb);
+  BOOST_CHECK(allocator.allocate().header == nullptr);
+  BOOST_CHECK_GT(allocator.segments(), size_t(2));
+  for (auto &d : used) {
+    allocator.free(d);
+  }
+  BOOST_CHECK_EQUAL(allocator._allocated.load(), size_t(0));
+  BOOST_CHECK_LE(allocator.segments(), size_t(2));
+  auto rest = allocate_all();
+  BOOST_CHECK_EQUAL(rest.size(), allocator._capacity.load());
+  BOOST_CHECK_LT(rest.size(), used.size());
+  std::set<size_t> positions;
+  for (auto &d : rest) {
+    BOOST_CHECK_LT(d.position, allocator._capacity.load());
+    positions.insert(d.position);
+  }
+  BOOST_CHECK_EQUAL(positions.size(), rest.size());
+}
+
 BOOST_AUTO_TEST_CASE(MemStorageCommonTest) {
   std::cout << "MemStorageCommonTest" << std::endl;
   auto storage_path = "testMemoryStorage";
@@ -150,6 +272,97 @@ BOOST_AUTO_TEST_CASE(MemStorageDropByLimitTest) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(TrackMapTest) {
+  std::cout << "TrackMapTest" << std::endl;
+  const size_t threads_count = 8;
+  const dariadb::Id ids_count = 5000;
+  dariadb::storage::TrackMap map(size_t(0));
+  std::atomic_size_t created{0};
+  std::vector<std::vector<dariadb::storage::TimeTrack *>> results(threads_count);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&, t]() {
+      for (dariadb::Id i = 0; i < ids_count; ++i) {
+        // threads insert same ids in different order.
+        auto id = t % 2 == 0 ? i : ids_count - i - 1;
+        auto track = map.find_or_insert(id, [&created, id]() {
+          created++;
+          return std::make_shared<dariadb::storage::TimeTrack>(
+              nullptr, dariadb::Time(0), id, nullptr,
+              dariadb::compression::CODEC::DELTA_XOR, size_t(1));
+        });
+        BOOST_CHECK_EQUAL(track->_meas_id, id);
+        results[t].push_back(map.find(id));
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  BOOST_CHECK_EQUAL(created.load(), size_t(ids_count));
+  BOOST_CHECK_EQUAL(map.size(), size_t(ids_count));
+  for (dariadb::Id i = 0; i < ids_count; ++i) {
+    auto track = map.find(i);
+    BOOST_CHECK(track != nullptr);
+    BOOST_CHECK_EQUAL(results[0][i], track);
+    BOOST_CHECK_EQUAL(results[1][ids_count - i - 1], track);
+  }
+  BOOST_CHECK(map.find(ids_count) == nullptr);
+  map.clear();
+  BOOST_CHECK_EQUAL(map.size(), size_t(0));
+  BOOST_CHECK(map.find(0) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(MemStorageConcurrentWritersTest) {
+  std::cout << "MemStorageConcurrentWritersTest" << std::endl;
+  auto storage_path = "testMemoryStorage";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  const size_t writers_count = 8;
+  const size_t ids_per_writer = 20;
+  const size_t values_per_writer = 20000;
+  MokChunkWriter *cw = new MokChunkWriter;
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::MEMORY);
+    // memory is small: writers wait for dropping.
+    settings->memory_limit.setValue(64 * 1024);
+    settings->chunk_size.setValue(128);
+    auto _engine_env = dariadb::storage::EngineEnvironment::create();
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                             settings.get());
+    dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+    auto ms = dariadb::storage::MemStorage::create(_engine_env, size_t(0));
+    ms->setDownLevel(cw);
+
+    std::vector<std::thread> writers;
+    for (size_t w = 0; w < writers_count; ++w) {
+      writers.emplace_back([&ms, w]() {
+        dariadb::Meas m;
+        for (size_t i = 0; i < values_per_writer; ++i) {
+          m.id = dariadb::Id(w * ids_per_writer + i % ids_per_writer);
+          m.time = dariadb::Time(i);
+          ms->append(m);
+        }
+      });
+    }
+    for (auto &w : writers) {
+      w.join();
+    }
+    BOOST_CHECK_EQUAL(ms->getSyncMap().size(), writers_count * ids_per_writer);
+    BOOST_CHECK(cw->droped != 0);
+    ms->stop();
+  }
+  delete cw;
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(MemStorageCacheTest) {
   std::cout << "MemStorageCacheTest" << std::endl;
   auto storage_path = "testMemoryStorage";
@@ -230,4 +443,184 @@ BOOST_AUTO_TEST_CASE(MemStorageWriteToPastTest) {
   if (dariadb::utils::fs::path_exists(storage_path)) {
     dariadb::utils::fs::rm(storage_path);
   }
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(MemStorageOutOfOrderBufferTest) {
+  std::cout << "MemStorageOutOfOrderBufferTest" << std::endl;
+  auto storage_path = "testMemoryStorage";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::MEMORY);
+    settings->chunk_size.setValue(128);
+    settings->ooo_buffer_size.setValue(64);
+    auto _engine_env = dariadb::storage::EngineEnvironment::create();
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                             settings.get());
+    dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+    auto ms = dariadb::storage::MemStorage::create(_engine_env, size_t(0));
+
+    // even times in order, then odd times late.
+    const dariadb::Time max_time = 1000;
+    auto meas = dariadb::Meas();
+    for (dariadb::Time t = 0; t < max_time; t += 2) {
+      meas.time = t;
+      meas.value = dariadb::Value(t);
+      BOOST_CHECK_EQUAL(ms->append(meas).writed, size_t(1));
+    }
+    auto check_all = [&ms, max_time](size_t expected) {
+      dariadb::QueryInterval qi({0}, dariadb::Flag(0), 0, max_time);
+      auto values = ms->readInterval(qi);
+      BOOST_CHECK_EQUAL(values.size(), expected);
+      for (size_t i = 1; i < values.size(); ++i) {
+        BOOST_CHECK_LT(values[i - 1].time, values[i].time);
+      }
+      for (auto &v : values) {
+        BOOST_CHECK(dariadb::areSame(v.value, dariadb::Value(v.time)));
+      }
+    };
+
+    // less than buffer: values are visible before merge.
+    for (dariadb::Time t = 1; t < 100; t += 2) {
+      meas.time = t;
+      meas.value = dariadb::Value(t);
+      BOOST_CHECK_EQUAL(ms->append(meas).writed, size_t(1));
+    }
+    check_all(size_t(max_time / 2 + 50));
+    auto stat = ms->stat(0, 0, 9);
+    BOOST_CHECK_EQUAL(stat.count, uint32_t(10));
+
+    // late value replaces value of chunk with equal time.
+    meas.time = 10;
+    meas.value = 100;
+    ms->append(meas);
+    auto tp = ms->readTimePoint(dariadb::QueryTimePoint({0}, dariadb::Flag(0), 10));
+    BOOST_CHECK(dariadb::areSame(tp[0].value, dariadb::Value(100)));
+    meas.value = dariadb::Value(10);
+    ms->append(meas);
+
+    // buffer is merged to chunks, when it is full.
+    for (dariadb::Time t = 101; t < max_time; t += 2) {
+      meas.time = t;
+      meas.value = dariadb::Value(t);
+      BOOST_CHECK_EQUAL(ms->append(meas).writed, size_t(1));
+    }
+    check_all(size_t(max_time));
+    stat = ms->stat(0, 0, max_time);
+    BOOST_CHECK_EQUAL(stat.count, uint32_t(max_time));
+  }
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MemStorageLateValuesDropTest) {
+  std::cout << "MemStorageLateValuesDropTest" << std::endl;
+  auto storage_path = "testMemoryStorage";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  MokChunkWriter *cw = new MokChunkWriter;
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::MEMORY);
+    settings->chunk_size.setValue(128);
+    settings->ooo_buffer_size.setValue(4);
+    auto _engine_env = dariadb::storage::EngineEnvironment::create();
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                             settings.get());
+    dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+    auto ms = dariadb::storage::MemStorage::create(_engine_env, size_t(0));
+    ms->setDownLevel(cw);
+
+    // even times in order, then odd times late: chunks are merged many times.
+    const dariadb::Time max_time = 2000;
+    auto meas = dariadb::Meas();
+    for (dariadb::Time t = 0; t < max_time; t += 2) {
+      meas.time = t;
+      ms->append(meas);
+    }
+    for (dariadb::Time t = 1; t < max_time; t += 2) {
+      meas.time = t;
+      ms->append(meas);
+    }
+    ms->stop();
+    BOOST_CHECK_EQUAL(cw->droped_values, size_t(max_time));
+    // merged chunks are taken from pool and returned to it.
+    BOOST_CHECK_EQUAL(ms->description().allocated, size_t(0));
+  }
+  delete cw;
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MemStorageMemoryLimitChangeTest) {
+  std::cout << "MemStorageMemoryLimitChangeTest" << std::endl;
+  auto storage_path = "testMemoryStorage";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  MokChunkWriter *cw = new MokChunkWriter;
+  {
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->strategy.setValue(dariadb::STRATEGY::MEMORY);
+    settings->memory_limit.setValue(256 * 1024);
+    settings->chunk_size.setValue(128);
+    auto _engine_env = dariadb::storage::EngineEnvironment::create();
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                             settings.get());
+    dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+    auto ms = dariadb::storage::MemStorage::create(_engine_env, size_t(0));
+    ms->setDownLevel(cw);
+    auto capacity = ms->description().allocator_capacity;
+
+    auto wait_for_capacity = [&ms](auto pred) {
+      for (size_t i = 0; i < 100 && !pred(ms->description().allocator_capacity); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+    };
+
+    settings->memory_limit.setValue(1024 * 1024);
+    wait_for_capacity([capacity](size_t c) { return c > capacity; });
+    BOOST_CHECK_GT(ms->description().allocator_capacity, capacity * 3);
+
+    dariadb::Meas m;
+    for (size_t i = 0; i < 20000; ++i) {
+      m.id = dariadb::Id(i % 100);
+      m.time = dariadb::Time(i);
+      ms->append(m);
+    }
+
+    // chunks over new limit are dropped.
+    settings->memory_limit.setValue(128 * 1024);
+    wait_for_capacity([capacity](size_t c) { return c < capacity; });
+    auto description = ms->description();
+    BOOST_CHECK_LT(description.allocator_capacity, capacity);
+    for (size_t i = 0; i < 100 && description.allocated > description.allocator_capacity;
+         ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      description = ms->description();
+    }
+    BOOST_CHECK_LE(description.allocated, description.allocator_capacity);
+    BOOST_CHECK(cw->droped != 0);
+
+    for (size_t i = 20000; i < 30000; ++i) {
+      m.id = dariadb::Id(i % 100);
+      m.time = dariadb::Time(i);
+      BOOST_CHECK_EQUAL(ms->append(m).writed, size_t(1));
+    }
+    ms->stop();
+  }
+  delete cw;
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
@@ -2,6 +2,8 @@
 #define BOOST_TEST_MODULE Main
 #include <boost/test/unit_test.hpp>
 #include <algorithm>
+#include <map>
+#include <random>
 
 #include <libdariadb/flags.h>
 #include <libdariadb/storage/bloom_filter.h>
@@ -10,6 +12,7 @@
 #include <libdariadb/storage/engine_environment.h>
 #include <libdariadb/storage/manifest.h>
 #include <libdariadb/storage/pages/page.h>
+#include <libdariadb/storage/pages/page_catalog.h>
 #include <libdariadb/storage/pages/page_manager.h>
 #include <libdariadb/storage/settings.h>
 #include <libdariadb/utils/async/thread_manager.h>
@@ -70,8 +73,10 @@ BOOST_AUTO_TEST_CASE(PageManagerReadWriteWithContinue) {
   auto header = dariadb::storage::Page::readFooter(fname);
   BOOST_CHECK(header.addeded_chunks != size_t(0));
 
+  BOOST_CHECK_EQUAL(header.stat.count, uint32_t(addeded.size()));
+
   auto iheader = dariadb::storage::Page::readIndexFooter(fname + "i");
-  BOOST_CHECK(iheader.stat.count != 0);
+  BOOST_CHECK_EQUAL(iheader.stat.count, uint32_t(addeded.size()));
 
   pm = dariadb::storage::PageManager::create(_engine_env);
 
@@ -100,6 +105,500 @@ BOOST_AUTO_TEST_CASE(PageManagerReadWriteWithContinue) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(PageManagerMixedCodecs) {
+  const std::string storagePath = "testStorage";
+  const size_t chunks_size = 256;
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+
+  auto settings = dariadb::storage::Settings::create(storagePath);
+  settings->chunk_size.setValue(chunks_size);
+
+  auto manifest = dariadb::storage::Manifest::create(settings);
+
+  auto _engine_env = dariadb::storage::EngineEnvironment::create();
+  _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                           settings.get());
+  _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::MANIFEST,
+                           manifest.get());
+
+  dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+  {
+    auto pm = dariadb::storage::PageManager::create(_engine_env);
+    // first page in old format, second - in gorilla.
+    dariadb::compression::CODEC codecs[2] = {dariadb::compression::CODEC::DELTA_XOR,
+                                             dariadb::compression::CODEC::GORILLA};
+    dariadb::Time t = 0;
+    const size_t count = chunks_size * 3;
+    for (size_t p = 0; p < 2; ++p) {
+      settings->chunk_codec.setValue(codecs[p]);
+      dariadb::MeasArray ma(count);
+      for (size_t i = 0; i < count; ++i, t += 10) {
+        ma[i].id = 1;
+        ma[i].time = t;
+        ma[i].value = dariadb::Value(i % 7);
+      }
+      pm->append("page" + std::to_string(p), ma);
+    }
+
+    dariadb::storage::MList_ReaderClb clb;
+    pm->foreach (dariadb::QueryInterval({1}, 0, 0, t), &clb);
+    BOOST_CHECK_EQUAL(clb.mlist.size(), count * 2);
+    dariadb::Time expected = 0;
+    for (auto &m : clb.mlist) {
+      BOOST_CHECK_EQUAL(m.time, expected);
+      expected += 10;
+    }
+  }
+  manifest = nullptr;
+  dariadb::utils::async::ThreadManager::stop();
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PageIndexSortedTest) {
+  const std::string storagePath = "testStorage";
+  const size_t chunks_size = 64;
+  const dariadb::Id ids_count = 5;
+  const size_t values_per_id = 200;
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+
+  auto settings = dariadb::storage::Settings::create(storagePath);
+  dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+  // ids are interleaved in page.
+  dariadb::MeasArray ma;
+  for (size_t i = 0; i < values_per_id; ++i) {
+    for (dariadb::Id id = 0; id < ids_count; ++id) {
+      auto m = dariadb::Meas(id);
+      m.time = i * 10 + id;
+      m.value = dariadb::Value(i);
+      ma.push_back(m);
+    }
+  }
+  auto fname = dariadb::utils::fs::append_path(settings->raw_path.value(), "sorted.page");
+  auto ifname = dariadb::storage::PageIndex::index_name_from_page_name(fname);
+
+  auto check = [&]() {
+    auto index = dariadb::storage::PageIndex::open(ifname);
+    BOOST_CHECK(index->iheader.is_sorted);
+    BOOST_CHECK_EQUAL(index->iheader.ids_count, ids_count);
+
+    auto reccords = index->readReccords();
+    BOOST_CHECK_EQUAL(reccords.size(), index->iheader.recs_count);
+    BOOST_CHECK_GT(reccords.size(), size_t(ids_count));
+    BOOST_CHECK(std::is_sorted(reccords.begin(), reccords.end(),
+                               [](const dariadb::storage::IndexReccord &l,
+                                  const dariadb::storage::IndexReccord &r) {
+                                 return l.meas_id < r.meas_id ||
+                                        (l.meas_id == r.meas_id &&
+                                         l.stat.minTime < r.stat.minTime);
+                               }));
+
+    for (dariadb::Id id = 0; id < ids_count; ++id) {
+      auto all_links =
+          index->get_chunks_links({}, dariadb::MIN_TIME, dariadb::MAX_TIME, 0);
+      auto id_links =
+          index->get_chunks_links({id}, dariadb::MIN_TIME, dariadb::MAX_TIME, 0);
+      auto expected = std::count_if(
+          all_links.begin(), all_links.end(),
+          [id](const dariadb::ChunkLink &cl) { return cl.meas_id == id; });
+      BOOST_CHECK_EQUAL(id_links.size(), size_t(expected));
+      for (auto &cl : id_links) {
+        BOOST_CHECK_EQUAL(cl.meas_id, id);
+      }
+      auto part_links = index->get_chunks_links({id, id}, 0, 100, 0);
+      BOOST_CHECK_GE(part_links.size(), size_t(1));
+      BOOST_CHECK_LT(part_links.size(), id_links.size());
+    }
+    BOOST_CHECK(index->get_chunks_links({ids_count}, dariadb::MIN_TIME,
+                                        dariadb::MAX_TIME, 0)
+                    .empty());
+
+    auto p = dariadb::storage::Page::open(fname);
+    dariadb::IdArray all_ids;
+    for (dariadb::Id id = 0; id < ids_count; ++id) {
+      all_ids.push_back(id);
+    }
+    auto tp_result = p->valuesBeforeTimePoint(dariadb::QueryTimePoint(all_ids, 0, 1000));
+    BOOST_CHECK_EQUAL(tp_result.size(), size_t(ids_count));
+    for (auto &kv : tp_result) {
+      BOOST_CHECK_EQUAL(kv.second.id, kv.first);
+      auto expected_time =
+          kv.first == 0 ? dariadb::Time(1000) : dariadb::Time(990 + kv.first);
+      BOOST_CHECK_EQUAL(kv.second.time, expected_time);
+    }
+  };
+
+  dariadb::storage::Page::create(fname, 0, 0, chunks_size, ma);
+  check();
+
+  // index restored from page must have the same layout.
+  dariadb::utils::fs::rm(ifname);
+  dariadb::storage::Page::restoreIndexFile(fname);
+  check();
+
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PageBlockCompressionTest) {
+  using dariadb::compression::BLOCK_COMPRESSION;
+  const std::string storagePath = "testStorage";
+  const size_t chunks_size = 256;
+  const dariadb::Id ids_count = 5;
+  const size_t values_per_id = 2000;
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+
+  auto settings = dariadb::storage::Settings::create(storagePath);
+  dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+  dariadb::MeasArray ma;
+  for (size_t i = 0; i < values_per_id; ++i) {
+    for (dariadb::Id id = 0; id < ids_count; ++id) {
+      auto m = dariadb::Meas(id);
+      m.time = i * 10 + id;
+      m.value = dariadb::Value(i % 17) + dariadb::Value(0.5) * id;
+      ma.push_back(m);
+    }
+  }
+  auto page_path = [&](const std::string &name) {
+    return dariadb::utils::fs::append_path(settings->raw_path.value(), name);
+  };
+  dariadb::QueryInterval qi({}, 0, dariadb::MIN_TIME, dariadb::MAX_TIME);
+  for (dariadb::Id id = 0; id < ids_count; ++id) {
+    qi.ids.push_back(id);
+  }
+  auto check = [&](const std::string &fname, size_t expected_count) {
+    auto p = dariadb::storage::Page::open(fname);
+    BOOST_CHECK(p->checksum());
+    dariadb::storage::MList_ReaderClb clb;
+    for (auto &kv : p->intervalReader(qi)) {
+      kv.second->apply(&clb);
+    }
+    BOOST_CHECK_EQUAL(clb.mlist.size(), expected_count);
+    for (auto &m : clb.mlist) {
+      BOOST_CHECK_EQUAL(m.value, dariadb::Value((m.time / 10) % 17) +
+                                     dariadb::Value(0.5) * m.id);
+    }
+    auto tp_result = p->valuesBeforeTimePoint(dariadb::QueryTimePoint(qi.ids, 0, 1000));
+    BOOST_CHECK_EQUAL(tp_result.size(), size_t(ids_count));
+    auto st = p->stat(1, 15, 1000);
+    BOOST_CHECK_EQUAL(st.count, uint32_t(98));
+  };
+
+  auto plain = page_path("plain.page");
+  dariadb::storage::Page::create(plain, 0, 0, chunks_size, ma);
+  auto plain_size = dariadb::utils::fs::file_size(plain);
+  check(plain, ma.size());
+
+  for (auto method : {BLOCK_COMPRESSION::FAST, BLOCK_COMPRESSION::HIGH}) {
+    auto fname = page_path(dariadb::compression::to_string(method) + ".page");
+    auto ifname = dariadb::storage::PageIndex::index_name_from_page_name(fname);
+    dariadb::storage::Page::create(fname, 0, 0, chunks_size, ma,
+                                   dariadb::compression::CODEC::DELTA_XOR, method);
+    BOOST_CHECK_EQUAL(dariadb::storage::Page::readIndexFooter(ifname).block_compression,
+                      uint8_t(method));
+    BOOST_CHECK_LT(dariadb::utils::fs::file_size(fname), plain_size);
+    check(fname, ma.size());
+
+    dariadb::utils::fs::rm(ifname);
+    dariadb::storage::Page::restoreIndexFile(fname);
+    BOOST_CHECK_EQUAL(dariadb::storage::Page::readIndexFooter(ifname).block_compression,
+                      uint8_t(method));
+    check(fname, ma.size());
+  }
+
+  // blocks are unpacked and written to page with other compression.
+  auto repacked = page_path("repacked.page");
+  dariadb::storage::Page::repackTo(repacked, 1, 0, chunks_size,
+                                   {page_path("FAST.page"), plain}, nullptr,
+                                   dariadb::compression::CODEC::DELTA_XOR,
+                                   BLOCK_COMPRESSION::HIGH);
+  check(repacked, ma.size());
+
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PageMappedChunksTest) {
+  const std::string storagePath = "testStorage";
+  const size_t chunks_size = 128;
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+
+  auto settings = dariadb::storage::Settings::create(storagePath);
+  dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+  dariadb::MeasArray ma(1000);
+  for (size_t i = 0; i < ma.size(); ++i) {
+    ma[i].id = i % 2;
+    ma[i].time = i;
+    ma[i].value = dariadb::Value(i);
+  }
+  for (auto blocks : {dariadb::compression::BLOCK_COMPRESSION::NONE,
+                      dariadb::compression::BLOCK_COMPRESSION::FAST}) {
+    auto fname = dariadb::utils::fs::append_path(
+        settings->raw_path.value(), dariadb::compression::to_string(blocks) + ".page");
+    dariadb::storage::Page::create(fname, 0, 0, chunks_size, ma,
+                                   dariadb::compression::CODEC::DELTA_XOR, blocks);
+
+    dariadb::Id2Cursor cursors;
+    {
+      auto p = dariadb::storage::Page::open(fname);
+      cursors = p->intervalReader(
+          dariadb::QueryInterval({0, 1}, 0, dariadb::MIN_TIME, dariadb::MAX_TIME));
+    }
+#ifndef MSVC
+    // cursors keep mapping after page is closed and erased.
+    dariadb::utils::fs::rm(fname);
+#endif
+    dariadb::storage::MList_ReaderClb clb;
+    for (auto &kv : cursors) {
+      kv.second->apply(&clb);
+    }
+    BOOST_CHECK_EQUAL(clb.mlist.size(), ma.size());
+    for (auto &m : clb.mlist) {
+      BOOST_CHECK_EQUAL(m.value, dariadb::Value(m.time));
+    }
+  }
+
+  dariadb::utils::async::ThreadManager::stop();
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PageAioReadTest) {
+  using dariadb::utils::async::AIO_BACKEND;
+  const std::string storagePath = "testStorage";
+  const size_t chunks_size = 128;
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+
+  auto settings = dariadb::storage::Settings::create(storagePath);
+
+  dariadb::MeasArray ma(5000);
+  for (size_t i = 0; i < ma.size(); ++i) {
+    ma[i].id = i % 3;
+    ma[i].time = i;
+    ma[i].value = dariadb::Value(i);
+  }
+  for (auto backend : {AIO_BACKEND::THREADS, AIO_BACKEND::URING}) {
+    dariadb::utils::async::ThreadManager::Params tpm_params(
+        settings->thread_pools_params());
+    tpm_params.aio = backend;
+    tpm_params.aio_queue_depth = 4;
+    dariadb::utils::async::ThreadManager::start(tpm_params);
+    BOOST_CHECK(dariadb::utils::async::ThreadManager::instance()->aio() != nullptr);
+
+    for (auto blocks : {dariadb::compression::BLOCK_COMPRESSION::NONE,
+                        dariadb::compression::BLOCK_COMPRESSION::FAST}) {
+      auto fname = dariadb::utils::fs::append_path(
+          settings->raw_path.value(), dariadb::compression::to_string(blocks) + ".page");
+      dariadb::storage::Page::create(fname, 0, 0, chunks_size, ma,
+                                     dariadb::compression::CODEC::DELTA_XOR, blocks);
+      auto p = dariadb::storage::Page::open(fname);
+      dariadb::storage::MList_ReaderClb clb;
+      auto qi =
+          dariadb::QueryInterval({0, 1, 2}, 0, dariadb::MIN_TIME, dariadb::MAX_TIME);
+      for (auto &kv : p->intervalReader(qi)) {
+        kv.second->apply(&clb);
+      }
+      BOOST_CHECK_EQUAL(clb.mlist.size(), ma.size());
+      for (auto &m : clb.mlist) {
+        BOOST_CHECK_EQUAL(m.value, dariadb::Value(m.time));
+        BOOST_CHECK_EQUAL(m.id, m.time % 3);
+      }
+      // chunks on the interval boundaries are read.
+      auto st = p->stat(1, 1001, 3998);
+      dariadb::Statistic expected;
+      for (auto &m : ma) {
+        if (m.id == 1 && m.time >= 1001 && m.time <= 3998) {
+          expected.update(m);
+        }
+      }
+      BOOST_CHECK_EQUAL(st.count, expected.count);
+      BOOST_CHECK_EQUAL(st.minTime, expected.minTime);
+      BOOST_CHECK_EQUAL(st.maxTime, expected.maxTime);
+      BOOST_CHECK(dariadb::areSame(st.sum, expected.sum));
+      p = nullptr;
+      dariadb::utils::fs::rm(fname);
+      dariadb::utils::fs::rm(
+          dariadb::storage::PageIndex::index_name_from_page_name(fname));
+    }
+    dariadb::utils::async::ThreadManager::stop();
+  }
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PageCatalogTest) {
+  dariadb::storage::PageCatalog catalog;
+  const auto all = dariadb::storage::PageCatalog::ALL_VERSIONS;
+  BOOST_CHECK_EQUAL(catalog.size(), size_t(0));
+  BOOST_CHECK(catalog.find(dariadb::IdArray{}, 0, 100, all).empty());
+
+  // page i: ids {i, i+1}, time [i*10, i*10+15]
+  const size_t pages_count = 10;
+  for (size_t i = 0; i < pages_count; ++i) {
+    dariadb::storage::IndexFooter hdr;
+    hdr.stat.minTime = i * 10;
+    hdr.stat.maxTime = i * 10 + 15;
+    std::vector<dariadb::Id> ids{dariadb::Id(i), dariadb::Id(i + 1)};
+    dariadb::storage::BloomFilter bloom(ids.size());
+    for (auto id : ids) {
+      bloom.add(id);
+      hdr.id_bloom = dariadb::storage::bloom_add(hdr.id_bloom, id);
+    }
+    auto name = std::to_string(i) + ".page";
+    catalog.insert(name, "raw/" + name, hdr, bloom, ids);
+  }
+  BOOST_CHECK_EQUAL(catalog.size(), pages_count);
+  BOOST_CHECK_EQUAL(catalog.minTime(), dariadb::Time(0));
+  BOOST_CHECK_EQUAL(catalog.maxTime(), dariadb::Time(105));
+
+  // interval only: [22, 33] intersects pages 1,2,3.
+  auto by_time = catalog.find(dariadb::IdArray{}, 22, 33, all);
+  std::list<std::string> expected{"raw/1.page", "raw/2.page", "raw/3.page"};
+  BOOST_CHECK(by_time == expected);
+
+  // id 3 is in pages 2,3; only page 3 intersects [36, 100].
+  auto by_id = catalog.find(dariadb::IdArray{3}, 36, 100, all);
+  BOOST_CHECK(by_id == std::list<std::string>{"raw/3.page"});
+
+  by_id = catalog.find(dariadb::IdArray{3, 7}, 0, 100, all);
+  expected = std::list<std::string>{"raw/2.page", "raw/3.page", "raw/6.page",
+                                    "raw/7.page"};
+  BOOST_CHECK(by_id == expected);
+
+  BOOST_CHECK(catalog.find(dariadb::IdArray{100}, 0, 100, all).empty());
+
+  auto by_level = catalog.find(
+      [](const dariadb::storage::IndexFooter &hdr) { return hdr.stat.minTime >= 80; });
+  expected = std::list<std::string>{"raw/8.page", "raw/9.page"};
+  BOOST_CHECK(by_level == expected);
+
+  catalog.erase("3.page");
+  by_id = catalog.find(dariadb::IdArray{3}, 0, 100, all);
+  BOOST_CHECK(by_id == std::list<std::string>{"raw/2.page"});
+  BOOST_CHECK_EQUAL(catalog.size(), pages_count - 1);
+
+  catalog.erase("9.page");
+  BOOST_CHECK_EQUAL(catalog.maxTime(), dariadb::Time(95));
+
+  {
+    // page with one id, which lies inside interval, is answered by footer.
+    dariadb::storage::IndexFooter hdr;
+    hdr.stat.minTime = 200;
+    hdr.stat.maxTime = 210;
+    hdr.stat.count = 5;
+    hdr.stat.sum = 10;
+    std::vector<dariadb::Id> ids{dariadb::Id(50)};
+    dariadb::storage::BloomFilter bloom(ids.size());
+    bloom.add(ids.front());
+    catalog.insert("single.page", "raw/single.page", hdr, bloom, ids);
+
+    std::list<std::string> to_read;
+    auto st = catalog.stat(50, 0, 300, all, &to_read);
+    BOOST_CHECK(to_read.empty());
+    BOOST_CHECK_EQUAL(st.count, uint32_t(5));
+    BOOST_CHECK_EQUAL(st.sum, dariadb::Value(10));
+
+    st = catalog.stat(50, 205, 300, all, &to_read);
+    BOOST_CHECK_EQUAL(st.count, uint32_t(0));
+    BOOST_CHECK(to_read == std::list<std::string>{"raw/single.page"});
+
+    // page with two ids must be read.
+    to_read.clear();
+    st = catalog.stat(7, 0, 300, all, &to_read);
+    BOOST_CHECK_EQUAL(st.count, uint32_t(0));
+    expected = std::list<std::string>{"raw/6.page", "raw/7.page"};
+    to_read.sort();
+    BOOST_CHECK(to_read == expected);
+  }
+  {
+    // published page is hidden from readers of older versions, until it is settled.
+    dariadb::storage::IndexFooter hdr;
+    hdr.stat.minTime = 300;
+    hdr.stat.maxTime = 310;
+    std::vector<dariadb::Id> ids{dariadb::Id(60)};
+    dariadb::storage::BloomFilter bloom(ids.size());
+    bloom.add(ids.front());
+    catalog.insert("new.page", "raw/new.page", hdr, bloom, ids, 5);
+
+    BOOST_CHECK(catalog.find(dariadb::IdArray{60}, 0, 400, 4).empty());
+    BOOST_CHECK_EQUAL(catalog.find(dariadb::IdArray{60}, 0, 400, 5).size(), size_t(1));
+    BOOST_CHECK(catalog.find(nullptr, 0).size() + 1 == catalog.size());
+    catalog.settle("new.page");
+    BOOST_CHECK_EQUAL(catalog.find(dariadb::IdArray{60}, 0, 400, 0).size(), size_t(1));
+  }
+
+  catalog.clear();
+  BOOST_CHECK_EQUAL(catalog.size(), size_t(0));
+  BOOST_CHECK(catalog.find(dariadb::IdArray{3}, 0, 100, all).empty());
+}
+
+BOOST_AUTO_TEST_CASE(PageCatalogIntervalTest) {
+  // catalog changed by inserts and erases must answer as full scan.
+  const auto all = dariadb::storage::PageCatalog::ALL_VERSIONS;
+  dariadb::storage::PageCatalog catalog;
+  std::map<std::string, std::pair<dariadb::Time, dariadb::Time>> pages;
+  std::mt19937 rnd(42);
+  for (size_t step = 0; step < 2000; ++step) {
+    auto name = std::to_string(rnd() % 300);
+    if (rnd() % 3 == 0) {
+      catalog.erase(name);
+      pages.erase(name);
+    } else {
+      dariadb::storage::IndexFooter hdr;
+      hdr.stat.minTime = rnd() % 1000;
+      hdr.stat.maxTime = hdr.stat.minTime + rnd() % 100;
+      catalog.insert(name, name, hdr, dariadb::storage::BloomFilter(1),
+                     std::vector<dariadb::Id>{});
+      pages[name] = std::make_pair(hdr.stat.minTime, hdr.stat.maxTime);
+    }
+
+    dariadb::Time from = rnd() % 1100;
+    dariadb::Time to = from + rnd() % 50;
+    std::vector<std::pair<dariadb::Time, std::string>> expected;
+    for (auto &kv : pages) {
+      if (kv.second.first <= to && kv.second.second >= from) {
+        expected.emplace_back(kv.second.first, kv.first);
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+    auto found = catalog.find(dariadb::IdArray{}, from, to, all);
+    BOOST_REQUIRE_EQUAL(found.size(), expected.size());
+    BOOST_CHECK(std::equal(found.begin(), found.end(), expected.begin(),
+                           [](const std::string &l,
+                              const std::pair<dariadb::Time, std::string> &r) {
+                             return l == r.second;
+                           }));
+    BOOST_CHECK_EQUAL(catalog.size(), pages.size());
+  }
+}
+
 BOOST_AUTO_TEST_CASE(PageManagerMultiPageRead) {
   const std::string storagePath = "testStorage";
   const size_t chunks_size = 200;
@@ -112,6 +611,7 @@ BOOST_AUTO_TEST_CASE(PageManagerMultiPageRead) {
 
   auto settings = dariadb::storage::Settings::create(storagePath);
   settings->chunk_size.setValue(chunks_size);
+  settings->threads_in_diskio.setValue(3);
 
   auto manifest = dariadb::storage::Manifest::create(settings);
 
@@ -167,6 +667,21 @@ BOOST_AUTO_TEST_CASE(PageManagerMultiPageRead) {
   size_t readed = clb->mlist.size();
 
   BOOST_CHECK_EQUAL(readed, writed);
+  // pages are readed in parallel, but result must be ordered.
+  BOOST_CHECK(std::equal(addeded.begin(), addeded.end(), clb->mlist.begin(),
+                         [](const dariadb::Meas &l, const dariadb::Meas &r) {
+                           return l.time == r.time && l.value == r.value;
+                         }));
+
+  // second read must use cached indexes.
+  auto descr_before = pm->description();
+  BOOST_CHECK_GT(descr_before.index_cache_size, size_t(0));
+  clb->mlist.clear();
+  pm->foreach (qi, clb.get());
+  BOOST_CHECK_EQUAL(clb->mlist.size(), writed);
+  auto descr_after = pm->description();
+  BOOST_CHECK_GT(descr_after.index_cache_hits, descr_before.index_cache_hits);
+  BOOST_CHECK_EQUAL(descr_after.index_cache_misses, descr_before.index_cache_misses);
 
   auto id2meas = pm->valuesBeforeTimePoint(qt);
 
@@ -206,6 +721,53 @@ BOOST_AUTO_TEST_CASE(PageManagerMultiPageRead) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(PageManagerTimePointOverlapTest) {
+  const std::string storagePath = "testStorage";
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+
+  auto settings = dariadb::storage::Settings::create(storagePath);
+  settings->chunk_size.setValue(200);
+
+  auto manifest = dariadb::storage::Manifest::create(settings);
+
+  auto _engine_env = dariadb::storage::EngineEnvironment::create();
+  _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                           settings.get());
+  _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::MANIFEST,
+                           manifest.get());
+
+  dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+  {
+    auto pm = dariadb::storage::PageManager::create(_engine_env);
+    // wide page [0, 100] starts before narrow page [10, 20], but holds newer value.
+    auto make_page = [](dariadb::Time from, dariadb::Time to, dariadb::Time step) {
+      dariadb::MeasArray ma;
+      for (auto t = from; t <= to; t += step) {
+        auto m = dariadb::Meas(1);
+        m.time = t;
+        m.value = dariadb::Value(t);
+        ma.push_back(m);
+      }
+      return ma;
+    };
+    pm->append("wide", make_page(0, 100, 10));
+    pm->append("narrow", make_page(10, 20, 1));
+
+    auto result = pm->valuesBeforeTimePoint(dariadb::QueryTimePoint({1}, 0, 1000));
+    BOOST_CHECK_EQUAL(result[1].time, dariadb::Time(100));
+    result = pm->valuesBeforeTimePoint(dariadb::QueryTimePoint({1}, 0, 25));
+    BOOST_CHECK_EQUAL(result[1].time, dariadb::Time(20));
+  }
+  manifest = nullptr;
+  dariadb::utils::async::ThreadManager::stop();
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(PageManagerBulkWrite) {
   const std::string storagePath = "testStorage";
   const size_t chunks_size = 256;
@@ -417,3 +979,98 @@ BOOST_AUTO_TEST_CASE(PageManagerRepack) {
     dariadb::utils::fs::rm(storagePath);
   }
 }
+
+BOOST_AUTO_TEST_CASE(PageManagerCompaction) {
+  const std::string storagePath = "testStorage";
+  const size_t chunks_size = 256;
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+  auto settings = dariadb::storage::Settings::create(storagePath);
+  settings->chunk_size.setValue(chunks_size);
+  settings->max_pages_in_level.setValue(2);
+  settings->compaction_period.setValue(10);
+  auto manifest = dariadb::storage::Manifest::create(settings);
+
+  auto _engine_env = dariadb::storage::EngineEnvironment::create();
+  _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                           settings.get());
+  _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::MANIFEST,
+                           manifest.get());
+
+  dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+  auto pm = dariadb::storage::PageManager::create(_engine_env);
+
+  auto append_page = [&pm](const std::string &prefix, dariadb::Time from,
+                           dariadb::Time to, dariadb::Value value) {
+    dariadb::MeasArray a;
+    auto e = dariadb::Meas();
+    for (auto t = from; t <= to; ++t) {
+      e.time = t;
+      e.value = value;
+      a.push_back(e);
+    }
+    pm->append(prefix, a);
+  };
+  auto read_all = [&pm]() {
+    dariadb::QueryInterval qi({0}, 0, 0, dariadb::MAX_TIME);
+    dariadb::storage::MList_ReaderClb clb;
+    pm->foreach (qi, &clb);
+    return clb.mlist;
+  };
+
+  append_page("page_a", 1, 100, 1);
+  append_page("page_b", 101, 200, 2);
+  append_page("page_c", 201, 300, 3);
+  append_page("page_d", 150, 160, 4); // newer values, overlaps page_b.
+
+  // b and d have overlap, so they are compacted first.
+  BOOST_CHECK(pm->compactOnce());
+  BOOST_CHECK(!pm->compactOnce());
+  BOOST_CHECK_EQUAL(pm->files_count(), size_t(3));
+  BOOST_CHECK_EQUAL(pm->description().compactions, size_t(1));
+  auto raw_path = settings->raw_path.value();
+  BOOST_CHECK(!dariadb::utils::fs::file_exists(
+      dariadb::utils::fs::append_path(raw_path, "page_b.page")));
+  BOOST_CHECK(!dariadb::utils::fs::file_exists(
+      dariadb::utils::fs::append_path(raw_path, "page_d.page")));
+  BOOST_CHECK(dariadb::utils::fs::file_exists(
+      dariadb::utils::fs::append_path(raw_path, "page_a.page")));
+
+  auto values = read_all();
+  BOOST_CHECK_EQUAL(values.size(), size_t(300));
+  for (auto &v : values) {
+    if (v.time >= 150 && v.time <= 160) {
+      BOOST_CHECK_EQUAL(v.value, dariadb::Value(4));
+    }
+  }
+
+  // background compaction must not break readers.
+  for (int i = 0; i < 6; ++i) {
+    auto from = dariadb::Time(301 + i * 100);
+    append_page("page_" + std::to_string(i), from, from + 99, 5);
+  }
+  pm->startCompaction();
+  for (size_t i = 0; i < 100; ++i) {
+    BOOST_CHECK_EQUAL(read_all().size(), size_t(900));
+    if (pm->description().compactions > 1 && pm->compactOnce() == false) {
+      break;
+    }
+  }
+  pm->stopCompaction();
+  while (pm->compactOnce()) {
+  }
+  BOOST_CHECK_GT(pm->description().compactions, size_t(1));
+  BOOST_CHECK_EQUAL(read_all().size(), size_t(900));
+  BOOST_CHECK_EQUAL(dariadb::utils::fs::ls(raw_path, ".page").size(), pm->files_count());
+
+  pm = nullptr;
+  manifest = nullptr;
+  dariadb::utils::async::ThreadManager::stop();
+
+  if (dariadb::utils::fs::path_exists(storagePath)) {
+    dariadb::utils::fs::rm(storagePath);
+  }
+}
@@ -8,9 +8,12 @@
 #include <libdariadb/storage/chunk.h>
 #include <libdariadb/storage/cursors.h>
 #include <libdariadb/storage/manifest.h>
+#include <libdariadb/storage/rollup.h>
+#include <libdariadb/storage/snapshot.h>
 #include <libdariadb/utils/fs.h>
 
 #include <iostream>
+#include <thread>
 
 BOOST_AUTO_TEST_CASE(MeasTest) {
   dariadb::Meas m;
@@ -46,6 +49,33 @@ BOOST_AUTO_TEST_CASE(BloomTest) {
   BOOST_CHECK(dariadb::storage::bloom_check(super_fltr, uint8_t{4}));
 }
 
+BOOST_AUTO_TEST_CASE(BloomFilterTest) {
+  dariadb::storage::BloomFilter unknown;
+  BOOST_CHECK(unknown.check(1));
+
+  const dariadb::Id ids_count = 1000;
+  dariadb::storage::BloomFilter fltr(ids_count);
+  BOOST_CHECK(!fltr.check(1));
+  BOOST_CHECK_GT(fltr.hashes(), uint8_t(1));
+  for (dariadb::Id i = 0; i < ids_count; ++i) {
+    fltr.add(i);
+  }
+  for (dariadb::Id i = 0; i < ids_count; ++i) {
+    BOOST_CHECK(fltr.check(i));
+  }
+
+  size_t false_positives = 0;
+  for (dariadb::Id i = ids_count; i < ids_count * 11; ++i) {
+    if (fltr.check(i)) {
+      false_positives++;
+    }
+  }
+  BOOST_CHECK_LT(false_positives, size_t(ids_count * 10 / 20));
+
+  dariadb::storage::BloomFilter copy(fltr.bits(), fltr.hashes());
+  BOOST_CHECK(copy.check(ids_count / 2));
+}
+
 BOOST_AUTO_TEST_CASE(inFilter) {
   {
     auto m = dariadb::Meas();
@@ -193,6 +223,71 @@ BOOST_AUTO_TEST_CASE(SettingsInstance) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(SnapshotTest) {
+  dariadb::storage::SnapshotManager snapshots;
+  std::vector<int> runned;
+
+  auto first = snapshots.pin();
+  BOOST_CHECK_EQUAL(first->number(), uint64_t(0));
+  snapshots.defer([&runned]() { runned.push_back(1); });
+  BOOST_CHECK_EQUAL(snapshots.version(), uint64_t(1));
+
+  auto second = snapshots.pin();
+  snapshots.defer([&runned]() { runned.push_back(2); });
+  BOOST_CHECK(runned.empty());
+
+  // older snapshot is still pinned.
+  second = nullptr;
+  BOOST_CHECK(runned.empty());
+
+  first = nullptr;
+  BOOST_CHECK_EQUAL(runned.size(), size_t(2));
+  BOOST_CHECK_EQUAL(runned[0], 1);
+  BOOST_CHECK_EQUAL(runned[1], 2);
+
+  // without readers action is run at once.
+  snapshots.defer([&runned]() { runned.push_back(3); });
+  BOOST_CHECK_EQUAL(runned.size(), size_t(3));
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotPublicationTest) {
+  dariadb::storage::SnapshotManager snapshots;
+  std::vector<uint64_t> applied;
+  bool freed = false;
+
+  auto reader = snapshots.pin();
+  {
+    dariadb::storage::Publication publication(&snapshots);
+    snapshots.publish([&applied](uint64_t v) { applied.push_back(v); }, nullptr);
+    snapshots.publish([&applied](uint64_t v) { applied.push_back(v); },
+                      [&freed]() { freed = true; });
+    // changes are not seen, until publication is ended.
+    BOOST_CHECK(applied.empty());
+    BOOST_CHECK_EQUAL(snapshots.version(), uint64_t(0));
+  }
+  BOOST_CHECK_EQUAL(snapshots.version(), uint64_t(1));
+  BOOST_CHECK_EQUAL(applied.size(), size_t(2));
+  BOOST_CHECK_EQUAL(applied[0], uint64_t(1));
+  BOOST_CHECK_EQUAL(applied[1], uint64_t(1));
+  BOOST_CHECK(!freed);
+  reader = nullptr;
+  BOOST_CHECK(freed);
+
+  // thread sees pinned version, while it is pinned.
+  {
+    dariadb::storage::PinnedSnapshot pin(&snapshots);
+    snapshots.defer(nullptr);
+    BOOST_CHECK_EQUAL(snapshots.version(), uint64_t(2));
+    BOOST_CHECK_EQUAL(snapshots.pin()->number(), uint64_t(1));
+    uint64_t other_version = 0;
+    std::thread other(
+        [&snapshots, &other_version]() { other_version = snapshots.pin()->number(); });
+    other.join();
+    BOOST_CHECK_EQUAL(other_version, uint64_t(2));
+  }
+  BOOST_CHECK_EQUAL(snapshots.pin()->number(), uint64_t(2));
+}
+
 BOOST_AUTO_TEST_CASE(ChunkTest) {
   {
     dariadb::storage::ChunkHeader hdr;
@@ -241,6 +336,74 @@ BOOST_AUTO_TEST_CASE(ChunkTest) {
 
     delete[] buff;
   }
+  { // sealed chunk is encoded by smaller codec.
+    dariadb::storage::ChunkHeader hdr;
+    uint8_t *buff = new uint8_t[1024];
+    std::fill_n(buff, 1024, uint8_t(0));
+    auto m = dariadb::Meas(4);
+    m.value = 1;
+    auto ch = dariadb::storage::Chunk::create(&hdr, buff, 1024, m);
+    for (size_t i = 0; i < 100; ++i) {
+      m.time += 1000;
+      m.value = dariadb::Value(i / 10);
+      BOOST_CHECK(ch->append(m));
+    }
+    ch->close();
+    auto old_size = hdr.size - hdr.bw_pos + 1;
+
+    std::vector<uint8_t> sealed;
+    BOOST_CHECK(dariadb::storage::Chunk::seal(&hdr, buff, sealed));
+    BOOST_CHECK_EQUAL(hdr.codec, uint8_t(dariadb::compression::CODEC::COLUMNS));
+    BOOST_CHECK_EQUAL(hdr.size, uint32_t(sealed.size()));
+    BOOST_CHECK_LT(hdr.size, old_size);
+    BOOST_CHECK_EQUAL(dariadb::storage::Chunk::compact(&hdr), uint32_t(0));
+    // sealed chunk is not sealed again.
+    std::vector<uint8_t> sealed2;
+    BOOST_CHECK(!dariadb::storage::Chunk::seal(&hdr, sealed.data(), sealed2));
+
+    auto ch2 = dariadb::storage::Chunk::open(&hdr, sealed.data());
+    auto rdr = ch2->getReader();
+    BOOST_CHECK_EQUAL(rdr->readNext().value, dariadb::Value(1));
+    for (size_t i = 0; i < 100; ++i) {
+      auto v = rdr->readNext();
+      BOOST_CHECK_EQUAL(v.id, dariadb::Id(4));
+      BOOST_CHECK_EQUAL(v.time, dariadb::Time(1000 * (i + 1)));
+      BOOST_CHECK_EQUAL(v.value, dariadb::Value(i / 10));
+    }
+    BOOST_CHECK(rdr->is_end());
+    delete[] buff;
+  }
+  { // gorilla codec is stored in header.
+    dariadb::storage::ChunkHeader hdr;
+    uint8_t *buff = new uint8_t[1024];
+    std::fill_n(buff, 1024, uint8_t(0));
+    auto m = dariadb::Meas(3);
+    m.time = 100;
+    auto ch = dariadb::storage::Chunk::create(&hdr, buff, 1024, m,
+                                              dariadb::compression::CODEC::GORILLA);
+    dariadb::MeasArray writed{m};
+    while (!ch->isFull()) {
+      m.time += 10 + m.time % 3;
+      m.value += 0.25;
+      if (ch->append(m)) {
+        writed.push_back(m);
+      }
+    }
+    BOOST_CHECK_EQUAL(hdr.codec, uint8_t(dariadb::compression::CODEC::GORILLA));
+    BOOST_CHECK_EQUAL(hdr.is_sorted, uint8_t(1));
+    auto skip_size = dariadb::storage::Chunk::compact(&hdr);
+    auto ch2 = dariadb::storage::Chunk::open(&hdr, buff + skip_size);
+    auto rdr = ch2->getReader();
+    size_t readed = 0;
+    while (!rdr->is_end()) {
+      auto v = rdr->readNext();
+      BOOST_CHECK_EQUAL(v.time, writed[readed].time);
+      BOOST_CHECK_EQUAL(v.value, writed[readed].value);
+      readed++;
+    }
+    BOOST_CHECK_EQUAL(readed, writed.size());
+    delete[] buff;
+  }
 }
 
 BOOST_AUTO_TEST_CASE(LinearReaderTest) {
@@ -331,6 +494,90 @@ BOOST_AUTO_TEST_CASE(MergeSortReaderTest) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(MergeSortReaderBatchTest) {
+  using namespace dariadb::storage;
+  using namespace dariadb;
+  // reader i: times i, i+k, i+2k... and time 0 with value=i.
+  const size_t k = 50;
+  const size_t values_in_reader = 20;
+  CursorsList readers;
+  for (size_t i = 0; i < k; ++i) {
+    MeasArray ma;
+    Meas zero;
+    zero.time = 0;
+    zero.value = Value(i);
+    ma.push_back(zero);
+    for (size_t j = 0; j < values_in_reader; ++j) {
+      Meas m;
+      m.time = 1 + i + j * k;
+      ma.push_back(m);
+    }
+    readers.push_back(Cursor_Ptr{new FullCursor(ma)});
+  }
+
+  MergeSortCursor msr{readers};
+  MeasArray result(k * values_in_reader + 10);
+  size_t readed = 0;
+  while (!msr.is_end()) {
+    readed += msr.readBatch(result.data() + readed, 7);
+  }
+  BOOST_CHECK_EQUAL(readed, k * values_in_reader + 1);
+  // value with equal time from first reader.
+  BOOST_CHECK_EQUAL(result[0].time, Time(0));
+  BOOST_CHECK_EQUAL(result[0].value, Value(0));
+  for (size_t i = 1; i < readed; ++i) {
+    BOOST_CHECK_EQUAL(result[i].time, Time(i));
+  }
+
+  // batch of linear cursor crosses readers.
+  MeasArray ma1(3);
+  MeasArray ma2(3);
+  for (size_t i = 0; i < 3; ++i) {
+    ma1[i].time = i;
+    ma2[i].time = i + 3;
+  }
+  LinearCursor lc{CursorsList{Cursor_Ptr{new FullCursor(ma1)},
+                              Cursor_Ptr{new FullCursor(ma2)}}};
+  MeasArray lresult(10);
+  BOOST_CHECK_EQUAL(lc.readBatch(lresult.data(), 10), size_t(6));
+  BOOST_CHECK(lc.is_end());
+  BOOST_CHECK_EQUAL(lresult[5].time, Time(5));
+
+  // long runs are merged from buffers, same values as readNext returns.
+  auto create_overlapped = []() {
+    MeasArray ma1(1000);
+    MeasArray ma2(1000);
+    for (size_t i = 0; i < ma1.size(); ++i) {
+      ma1[i].time = i / 2;
+      ma1[i].value = Value(1);
+      ma2[i].time = 400 + i;
+      ma2[i].value = Value(2);
+    }
+    return CursorsList{Cursor_Ptr{new FullCursor(ma1)}, Cursor_Ptr{new FullCursor(ma2)}};
+  };
+  MergeSortCursor by_next{create_overlapped()};
+  MeasArray expected;
+  while (!by_next.is_end()) {
+    expected.push_back(by_next.readNext());
+  }
+  BOOST_CHECK_EQUAL(expected.size(), size_t(1400));
+
+  auto by_batch = std::make_shared<MergeSortCursor>(create_overlapped());
+  MeasArray batched(expected.size());
+  readed = by_batch->readBatch(batched.data(), 10);
+  // merge with buffered values is not unpacked to sub readers.
+  MergeSortCursor outer{CursorsList{by_batch}};
+  BOOST_CHECK_EQUAL(outer._readers.size(), size_t(1));
+  while (!outer.is_end()) {
+    readed += outer.readBatch(batched.data() + readed, 333);
+  }
+  BOOST_CHECK_EQUAL(readed, expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    BOOST_CHECK_EQUAL(batched[i].time, expected[i].time);
+    BOOST_CHECK_EQUAL(batched[i].value, expected[i].value);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(ReaderColapseTest) {
   using namespace dariadb::storage;
   using namespace dariadb;
@@ -370,3 +617,221 @@ BOOST_AUTO_TEST_CASE(ReaderColapseTest) {
     }
   }
 }
+
+BOOST_AUTO_TEST_CASE(ReaderColapseChainTest) {
+  using namespace dariadb::storage;
+  using namespace dariadb;
+  // readers [t*10, t*10+15] are overlapped with neighbours only: the chain is one
+  // group, and every reader is merged once.
+  auto create_readers = []() {
+    CursorsList readers;
+    for (Time t = 0; t < 5; ++t) {
+      MeasArray ma;
+      for (Time i = t * 10; i <= t * 10 + 15; i += 5) {
+        Meas m;
+        m.time = i;
+        ma.push_back(m);
+      }
+      readers.push_back(Cursor_Ptr{new FullCursor(ma)});
+    }
+    // other reader, which is not overlapped.
+    MeasArray tail(1);
+    tail[0].time = 100;
+    readers.push_back(Cursor_Ptr{new FullCursor(tail)});
+    return readers;
+  };
+
+  for (auto order : {0, 1}) {
+    auto rs = create_readers();
+    if (order == 1) { // middle of chain is first.
+      std::swap(rs.front(), *std::next(rs.begin(), 2));
+    }
+    auto lsr = CursorWrapperFactory::colapseCursors(rs);
+    auto top_reader = dynamic_cast<LinearCursor *>(lsr.get());
+    BOOST_CHECK_EQUAL(top_reader->_readers.size(), size_t(2));
+    MeasArray result(100);
+    auto readed = lsr->readBatch(result.data(), result.size());
+    // 0..55 by 5 and 100.
+    BOOST_CHECK_EQUAL(readed, size_t(13));
+    for (size_t i = 0; i + 1 < readed; ++i) {
+      BOOST_CHECK_EQUAL(result[i].time, Time(i * 5));
+    }
+    BOOST_CHECK_EQUAL(result[readed - 1].time, Time(100));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AggregatingCursorTest) {
+  using namespace dariadb::storage;
+  using namespace dariadb;
+  MeasArray ma(10);
+  for (size_t i = 0; i < ma.size(); ++i) {
+    ma[i].id = 1;
+    ma[i].time = i + 1;
+    ma[i].value = Value(i + 1);
+  }
+
+  auto check = [&ma](Aggregation a, const std::vector<Value> &expected) {
+    auto src = Cursor_Ptr{new FullCursor(ma)};
+    // [2,5), [5,8), [8,9]
+    QueryInterval qi(IdArray{1}, 0, 2, 9, 3, a);
+    AggregatingCursor ac(src, qi);
+    BOOST_CHECK_EQUAL(ac.minTime(), Time(2));
+    BOOST_CHECK_EQUAL(ac.maxTime(), Time(8));
+    std::vector<Meas> result;
+    while (!ac.is_end()) {
+      result.push_back(ac.readNext());
+    }
+    BOOST_CHECK_EQUAL(result.size(), expected.size());
+    for (size_t i = 0; i < std::min(result.size(), expected.size()); ++i) {
+      BOOST_CHECK_EQUAL(result[i].id, Id(1));
+      BOOST_CHECK_EQUAL(result[i].time, Time(2 + i * 3));
+      BOOST_CHECK(areSame(result[i].value, expected[i]));
+    }
+  };
+  check(Aggregation::MIN, {2, 5, 8});
+  check(Aggregation::MAX, {4, 7, 9});
+  check(Aggregation::SUM, {9, 18, 17});
+  check(Aggregation::AVG, {3, 6, 8.5});
+  check(Aggregation::COUNT, {3, 3, 2});
+  check(Aggregation::FIRST, {2, 5, 8});
+  check(Aggregation::LAST, {4, 7, 9});
+
+  BOOST_CHECK_EQUAL(to_string(Aggregation::AVG), "AVG");
+  std::stringstream ss;
+  ss << "last";
+  Aggregation parsed = Aggregation::NONE;
+  ss >> parsed;
+  BOOST_CHECK(parsed == Aggregation::LAST);
+}
+
+BOOST_AUTO_TEST_CASE(RollupTest) {
+  using namespace dariadb;
+  using namespace dariadb::storage;
+  const std::string storage_path = "testStorage";
+  if (utils::fs::path_exists(storage_path)) {
+    utils::fs::rm(storage_path);
+  }
+
+  auto tiers = parse_rollup_tiers("100:0,10:5000");
+  BOOST_CHECK_EQUAL(tiers.size(), size_t(2));
+  BOOST_CHECK_EQUAL(tiers.front().step, Time(10));
+  BOOST_CHECK_EQUAL(tiers.front().retention, Time(5000));
+  BOOST_CHECK_THROW(parse_rollup_tiers("100"), std::exception);
+
+  {
+    auto settings = Settings::create(storage_path);
+    settings->rollup_tiers.setValue("10:0,100:0");
+    auto env = EngineEnvironment::create();
+    env->addResource(EngineEnvironment::Resource::SETTINGS, settings.get());
+    auto rollups = RollupManager::create(env);
+
+    RollupTier tier;
+    BOOST_CHECK(rollups->tier_for(0, 300, &tier));
+    BOOST_CHECK_EQUAL(tier.step, Time(100));
+    BOOST_CHECK(rollups->tier_for(20, 30, &tier));
+    BOOST_CHECK_EQUAL(tier.step, Time(10));
+    BOOST_CHECK(!rollups->tier_for(0, 15, &tier));
+
+    // every append writes new files, which are merged.
+    for (Time part = 0; part < 10; ++part) {
+      MeasArray ma;
+      for (Time t = part * 100; t < (part + 1) * 100; ++t) {
+        for (Id id = 0; id < 2; ++id) {
+          Meas m(id);
+          m.time = t;
+          m.value = Value(1);
+          ma.push_back(m);
+        }
+      }
+      rollups->append(ma);
+    }
+    BOOST_CHECK_LE(rollups->files_count(), size_t(2 * 5));
+
+    auto by_10 = rollups->read(tiers.front(), 1, 0, 999);
+    BOOST_CHECK_EQUAL(by_10.size(), size_t(100));
+    for (auto &kv : by_10) {
+      BOOST_CHECK_EQUAL(kv.second.count, uint32_t(10));
+      BOOST_CHECK(areSame(kv.second.sum, Value(10)));
+    }
+    RollupTier tier100{100, 0};
+    auto by_100 = rollups->read(tier100, 0, 150, 450);
+    BOOST_CHECK_EQUAL(by_100.size(), size_t(4));
+    BOOST_CHECK_EQUAL(by_100.begin()->first, Time(100));
+    BOOST_CHECK_EQUAL(by_100.begin()->second.count, uint32_t(100));
+
+    rollups->eraseOld(500);
+    by_100 = rollups->read(tier100, 0, 0, 999);
+    BOOST_CHECK_EQUAL(by_100.size(), size_t(5));
+    BOOST_CHECK_EQUAL(by_100.begin()->first, Time(500));
+  }
+  {
+    // reopen
+    auto settings = Settings::create(storage_path);
+    settings->rollup_tiers.setValue("10:0,100:0");
+    auto env = EngineEnvironment::create();
+    env->addResource(EngineEnvironment::Resource::SETTINGS, settings.get());
+    auto rollups = RollupManager::create(env);
+    auto by_10 = rollups->read(RollupTier{10, 0}, 1, 0, 999);
+    BOOST_CHECK_EQUAL(by_10.size(), size_t(50));
+  }
+  if (utils::fs::path_exists(storage_path)) {
+    utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(RollupBackfillResumeTest) {
+  using namespace dariadb;
+  using namespace dariadb::storage;
+  const std::string storage_path = "testStorage";
+  if (utils::fs::path_exists(storage_path)) {
+    utils::fs::rm(storage_path);
+  }
+  auto settings = Settings::create(storage_path);
+  settings->rollup_tiers.setValue("100:0");
+  auto manifest = Manifest::create(settings);
+  manifest->page_append("a.page");
+  auto env = EngineEnvironment::create();
+  env->addResource(EngineEnvironment::Resource::SETTINGS, settings.get());
+  env->addResource(EngineEnvironment::Resource::MANIFEST, manifest.get());
+
+  ChunkHeader hdr;
+  uint8_t *buff = new uint8_t[1024];
+  std::fill_n(buff, 1024, uint8_t(0));
+  Meas m(1);
+  m.value = Value(1);
+  auto ch = Chunk::create(&hdr, buff, 1024, m);
+  for (m.time = 1; m.time < 100; ++m.time) {
+    ch->append(m);
+  }
+  std::vector<Chunk *> a{ch.get()};
+  RollupTier tier;
+  {
+    auto rollups = RollupManager::create(env);
+    BOOST_CHECK(rollups->need_backfill());
+    BOOST_CHECK(rollups->need_backfill("a.page"));
+    // tier is not used, while it is back-filled.
+    BOOST_CHECK(!rollups->tier_for(0, 100, &tier));
+    rollups->backfill(a, a.size(), "a.page");
+    BOOST_CHECK(!rollups->need_backfill("a.page"));
+  }
+  {
+    // back-fill is interrupted, filled page is not counted again.
+    auto rollups = RollupManager::create(env);
+    BOOST_CHECK(rollups->need_backfill());
+    BOOST_CHECK(!rollups->need_backfill("a.page"));
+    rollups->backfill(a, a.size(), "a.page");
+    rollups->backfill_done();
+    BOOST_CHECK(rollups->tier_for(0, 100, &tier));
+  }
+  {
+    auto rollups = RollupManager::create(env);
+    BOOST_CHECK(!rollups->need_backfill());
+    auto by_100 = rollups->read(RollupTier{100, 0}, 1, 0, 99);
+    BOOST_CHECK_EQUAL(by_100.size(), size_t(1));
+    BOOST_CHECK_EQUAL(by_100.begin()->second.count, uint32_t(100));
+  }
+  delete[] buff;
+  if (utils::fs::path_exists(storage_path)) {
+    utils::fs::rm(storage_path);
+  }
+}
@@ -1,6 +1,7 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE Main
 #include <libdariadb/timeutil.h>
+#include <libdariadb/utils/async/aio.h>
 #include <libdariadb/utils/async/thread_manager.h>
 #include <libdariadb/utils/async/thread_pool.h>
 #include <libdariadb/utils/bitoperations.h>
@@ -17,6 +18,11 @@
 #include <iostream>
 #include <thread>
 
+#ifdef UNIX_OS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 BOOST_AUTO_TEST_CASE(TimeToString) {
   auto ct = dariadb::timeutil::current_time();
   BOOST_CHECK(ct != dariadb::Time(0));
@@ -235,6 +241,69 @@ BOOST_AUTO_TEST_CASE(ThreadsManager) {
   }
 }
 
+#ifdef UNIX_OS
+BOOST_AUTO_TEST_CASE(AsyncIOTest) {
+  using namespace dariadb::utils::async;
+  const std::string fname = "aio_test.bin";
+  const size_t blocks = 100;
+  const size_t block_size = 4096;
+
+  for (auto b : {AIO_BACKEND::SYNC, AIO_BACKEND::THREADS, AIO_BACKEND::URING}) {
+    BOOST_TEST_MESSAGE("aio " << to_string(b));
+    // queue is less than batch, submit waits for free places.
+    auto aio = AsyncIO::create(b, 8);
+    BOOST_CHECK(aio != nullptr);
+    if (b != AIO_BACKEND::URING) {
+      BOOST_CHECK(aio->backend() == b);
+    }
+
+    int fd = open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    BOOST_CHECK(fd >= 0);
+
+    std::vector<uint8_t> data(blocks * block_size);
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = uint8_t(i * 7 + i / block_size);
+    }
+    std::vector<IORequest> writes(blocks);
+    for (size_t i = 0; i < blocks; ++i) {
+      auto buffer = data.data() + i * block_size;
+      writes[i] = IORequest{fd, true, i * block_size, buffer, block_size, 0};
+    }
+    bool callback_called = false;
+    aio->submit(writes, [&callback_called](std::vector<IORequest> &requests) {
+         for (auto &r : requests) {
+           BOOST_CHECK_EQUAL(r.result, int64_t(r.size));
+         }
+         callback_called = true;
+       })->wait();
+    BOOST_CHECK(callback_called);
+
+    // in reverse order, last request is after end of file.
+    std::vector<uint8_t> readed(data.size(), 0);
+    std::vector<IORequest> reads(blocks + 1);
+    for (size_t i = 0; i < blocks; ++i) {
+      auto block = blocks - i - 1;
+      auto buffer = readed.data() + block * block_size;
+      reads[i] = IORequest{fd, false, block * block_size, buffer, block_size, 0};
+    }
+    uint8_t tail[16];
+    reads[blocks] = IORequest{fd, false, data.size(), tail, sizeof(tail), -1};
+    aio->submit(reads)->wait();
+    for (size_t i = 0; i < blocks; ++i) {
+      BOOST_CHECK_EQUAL(reads[i].result, int64_t(block_size));
+    }
+    BOOST_CHECK_EQUAL(reads[blocks].result, int64_t(0));
+    BOOST_CHECK(readed == data);
+
+    std::vector<IORequest> empty;
+    aio->submit(empty)->wait();
+
+    close(fd);
+    std::remove(fname.c_str());
+  }
+}
+#endif
+
 BOOST_AUTO_TEST_CASE(SplitString) {
   std::string str = "1 2 3 4 5 6 7 8";
   auto splitted = dariadb::utils::strings::tokens(str);
@@ -3,10 +3,12 @@
 #include <boost/test/unit_test.hpp>
 #include <atomic>
 #include <cassert>
+#include <fstream>
 #include <map>
 #include <thread>
 
 #include "test_common.h"
+#include <libdariadb/flags.h>
 #include <libdariadb/storage/engine_environment.h>
 #include <libdariadb/storage/manifest.h>
 #include <libdariadb/storage/settings.h>
@@ -242,3 +244,294 @@ BOOST_AUTO_TEST_CASE(WalManager_CommonTest) {
     dariadb::utils::fs::rm(storagePath);
   }
 }
+
+BOOST_AUTO_TEST_CASE(WALFileSummaryTest) {
+  const size_t block_size = 1000;
+  auto storage_path = "testStorage";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  {
+    dariadb::utils::fs::mkdir(storage_path);
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->wal_cache_size.setValue(block_size);
+    settings->wal_file_size.setValue(block_size);
+
+    auto manifest = dariadb::storage::Manifest::create(settings);
+
+    auto _engine_env = dariadb::storage::EngineEnvironment::create();
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                             settings.get());
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::MANIFEST,
+                             manifest.get());
+
+    auto wal = dariadb::storage::WALFile::create(_engine_env);
+    // id 0 in [0,99], id 1 in [100,199]; id 2 is unsorted.
+    dariadb::MeasArray ma;
+    for (size_t i = 0; i < 100; ++i) {
+      auto e = dariadb::Meas(0);
+      e.time = i;
+      e.value = dariadb::Value(i);
+      ma.push_back(e);
+    }
+    for (size_t i = 100; i < 200; ++i) {
+      auto e = dariadb::Meas(1);
+      e.time = i;
+      e.value = dariadb::Value(i);
+      ma.push_back(e);
+    }
+    for (size_t i = 0; i < 10; ++i) {
+      auto e = dariadb::Meas(2);
+      e.time = 50 - i;
+      e.value = dariadb::Value(i);
+      ma.push_back(e);
+    }
+    wal->append(ma.begin(), ma.end());
+    auto fname = wal->filename();
+
+    auto check = [](dariadb::storage::WALFile_Ptr w) {
+      BOOST_CHECK_EQUAL(w->minTime(), dariadb::Time(0));
+      BOOST_CHECK_EQUAL(w->maxTime(), dariadb::Time(199));
+
+      dariadb::Time mn, mx;
+      BOOST_CHECK(w->minMaxTime(1, &mn, &mx));
+      BOOST_CHECK_EQUAL(mn, dariadb::Time(100));
+      BOOST_CHECK_EQUAL(mx, dariadb::Time(199));
+      BOOST_CHECK(w->minMaxTime(2, &mn, &mx));
+      BOOST_CHECK_EQUAL(mn, dariadb::Time(41));
+      BOOST_CHECK_EQUAL(mx, dariadb::Time(50));
+      BOOST_CHECK(!w->minMaxTime(3, &mn, &mx));
+
+      auto out = w->readInterval(dariadb::QueryInterval({1}, 0, 0, 99));
+      BOOST_CHECK_EQUAL(out.size(), size_t(0));
+      out = w->readInterval(dariadb::QueryInterval({0, 1}, 0, 90, 109));
+      BOOST_CHECK_EQUAL(out.size(), size_t(20));
+
+      auto tp = w->readTimePoint(dariadb::QueryTimePoint({0, 2, 3}, 0, 45));
+      BOOST_CHECK_EQUAL(tp[0].time, dariadb::Time(45));
+      BOOST_CHECK_EQUAL(tp[2].time, dariadb::Time(45));
+      BOOST_CHECK_EQUAL(tp[3].flag, dariadb::FLAGS::_NO_DATA);
+
+      auto cur = w->currentValue({0, 2}, 0);
+      BOOST_CHECK_EQUAL(cur[0].time, dariadb::Time(99));
+      BOOST_CHECK_EQUAL(cur[2].time, dariadb::Time(50));
+
+      auto st = w->stat(1, 150, 1000);
+      BOOST_CHECK_EQUAL(st.count, uint32_t(50));
+      BOOST_CHECK_EQUAL(st.minTime, dariadb::Time(150));
+
+      auto mm = w->loadMinMax();
+      BOOST_CHECK_EQUAL(mm.size(), size_t(3));
+      BOOST_CHECK_EQUAL(mm[2].min.time, dariadb::Time(41));
+      BOOST_CHECK_EQUAL(mm[2].max.time, dariadb::Time(50));
+    };
+    check(wal);
+    BOOST_CHECK_EQUAL(wal->readAll()->size(), ma.size());
+    wal = nullptr;
+
+    auto readonly_wal = dariadb::storage::WALFile::open(_engine_env, fname, true);
+    check(readonly_wal);
+    BOOST_CHECK_EQUAL(readonly_wal->readAll()->size(), ma.size());
+    manifest = nullptr;
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WALFileCompressionTest) {
+  const size_t block_size = 10000;
+  auto storage_path = "testStorage";
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+  {
+    dariadb::utils::fs::mkdir(storage_path);
+    auto settings = dariadb::storage::Settings::create(storage_path);
+    settings->wal_cache_size.setValue(block_size);
+    settings->wal_file_size.setValue(block_size);
+    settings->wal_compression.setValue(true);
+
+    auto manifest = dariadb::storage::Manifest::create(settings);
+
+    auto _engine_env = dariadb::storage::EngineEnvironment::create();
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                             settings.get());
+    _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::MANIFEST,
+                             manifest.get());
+
+    auto wal = dariadb::storage::WALFile::create(_engine_env);
+    auto fname = wal->filename();
+    BOOST_CHECK(dariadb::storage::WALFile::is_compressed(fname));
+
+    // ids are interleaved in each batch.
+    dariadb::MeasArray ma;
+    const size_t batches = 10;
+    const size_t ids = 4;
+    for (size_t b = 0; b < batches; ++b) {
+      dariadb::MeasArray batch;
+      for (size_t i = 0; i < 50; ++i) {
+        for (dariadb::Id id = 0; id < ids; ++id) {
+          auto e = dariadb::Meas(id);
+          e.time = b * 50 + i;
+          e.value = dariadb::Value(id) * 0.5 + i;
+          e.flag = dariadb::Flag(i % 2);
+          batch.push_back(e);
+        }
+      }
+      auto st = wal->append(batch.begin(), batch.end());
+      BOOST_CHECK_EQUAL(st.writed, batch.size());
+      ma.insert(ma.end(), batch.begin(), batch.end());
+    }
+    wal->append(dariadb::Meas(ids));
+    ma.push_back(dariadb::Meas(ids));
+
+    BOOST_CHECK_EQUAL(dariadb::storage::WALFile::writed(fname), ma.size());
+    BOOST_CHECK_LT(dariadb::utils::fs::file_size(fname), ma.size() * sizeof(dariadb::Meas));
+
+    auto check = [&ma](dariadb::storage::WALFile_Ptr w) {
+      auto all = w->readAll();
+      BOOST_CHECK_EQUAL(all->size(), ma.size());
+      for (dariadb::Id id = 0; id <= ids; ++id) {
+        dariadb::MeasArray expected, readed;
+        std::copy_if(ma.begin(), ma.end(), std::back_inserter(expected),
+                     [id](const dariadb::Meas &m) { return m.id == id; });
+        std::copy_if(all->begin(), all->end(), std::back_inserter(readed),
+                     [id](const dariadb::Meas &m) { return m.id == id; });
+        BOOST_CHECK_EQUAL(expected.size(), readed.size());
+        for (size_t i = 0; i < std::min(expected.size(), readed.size()); ++i) {
+          BOOST_CHECK_EQUAL(expected[i].time, readed[i].time);
+          BOOST_CHECK_EQUAL(expected[i].value, readed[i].value);
+          BOOST_CHECK_EQUAL(expected[i].flag, readed[i].flag);
+        }
+      }
+      auto out = w->readInterval(dariadb::QueryInterval({1}, 0, 100, 199));
+      BOOST_CHECK_EQUAL(out.size(), size_t(100));
+    };
+    check(wal);
+    wal = nullptr;
+
+    auto readonly_wal = dariadb::storage::WALFile::open(_engine_env, fname, true);
+    check(readonly_wal);
+    readonly_wal = nullptr;
+
+    // damaged tail must be ignored and removed on next append.
+    auto size_before = dariadb::utils::fs::file_size(fname);
+    {
+      std::ofstream ofs(fname, std::ios::binary | std::ios::app);
+      std::string garbage(100, 'x');
+      ofs.write(garbage.data(), garbage.size());
+    }
+    BOOST_CHECK_EQUAL(dariadb::storage::WALFile::writed(fname), ma.size());
+    readonly_wal = dariadb::storage::WALFile::open(_engine_env, fname, true);
+    check(readonly_wal);
+    readonly_wal = nullptr;
+
+    wal = dariadb::storage::WALFile::open(_engine_env, fname, false);
+    BOOST_CHECK_EQUAL(dariadb::utils::fs::file_size(fname), size_before);
+    wal->append(dariadb::Meas(ids));
+    ma.push_back(dariadb::Meas(ids));
+    check(wal);
+    wal = nullptr;
+
+    auto file_size = dariadb::utils::fs::file_size(fname);
+    dariadb::utils::fs::resize_file(fname, file_size - 1);
+    BOOST_CHECK_EQUAL(dariadb::storage::WALFile::writed(fname), ma.size() - 1);
+
+    wal = dariadb::storage::WALFile::create(_engine_env);
+    dariadb_test::storage_test_check(wal.get(), 0, 100, 1, false);
+    wal = nullptr;
+
+    // one value per id: block must not be bigger than raw values.
+    wal = dariadb::storage::WALFile::create(_engine_env);
+    fname = wal->filename();
+    dariadb::MeasArray sparse;
+    for (dariadb::Id id = 0; id < 100; ++id) {
+      auto e = dariadb::Meas(id * 7919);
+      e.time = id * 104729;
+      e.value = dariadb::Value(id) / 3.0;
+      sparse.push_back(e);
+    }
+    wal->append(sparse.begin(), sparse.end());
+    BOOST_CHECK_LT(dariadb::utils::fs::file_size(fname),
+                   (sparse.size() + 1) * sizeof(dariadb::Meas));
+    auto sparse_readed = wal->readAll();
+    BOOST_CHECK_EQUAL(sparse_readed->size(), sparse.size());
+    for (size_t i = 0; i < std::min(sparse.size(), sparse_readed->size()); ++i) {
+      BOOST_CHECK_EQUAL(sparse[i].id, sparse_readed->at(i).id);
+      BOOST_CHECK_EQUAL(sparse[i].time, sparse_readed->at(i).time);
+    }
+    wal = nullptr;
+    manifest = nullptr;
+  }
+  if (dariadb::utils::fs::path_exists(storage_path)) {
+    dariadb::utils::fs::rm(storage_path);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WalManager_GroupCommitTest) {
+  const std::string storagePath = "testStorage";
+  const size_t writers_count = 4;
+  const size_t values_per_writer = 500;
+
+  for (auto policy : {dariadb::storage::WAL_SYNC::BATCH,
+                      dariadb::storage::WAL_SYNC::PERIODIC,
+                      dariadb::storage::WAL_SYNC::OS}) {
+    if (dariadb::utils::fs::path_exists(storagePath)) {
+      dariadb::utils::fs::rm(storagePath);
+    }
+    dariadb::utils::fs::mkdir(storagePath);
+    {
+      auto settings = dariadb::storage::Settings::create(storagePath);
+      settings->wal_file_size.setValue(700);
+      settings->wal_cache_size.setValue(100);
+      settings->wal_sync.setValue(policy);
+      // period 0 - writer wakes up only when buffer is full or flushed.
+      settings->wal_sync_period.setValue(
+          policy == dariadb::storage::WAL_SYNC::OS ? uint32_t(0) : uint32_t(10));
+
+      auto manifest = dariadb::storage::Manifest::create(settings);
+
+      auto _engine_env = dariadb::storage::EngineEnvironment::create();
+      _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::SETTINGS,
+                               settings.get());
+      _engine_env->addResource(dariadb::storage::EngineEnvironment::Resource::MANIFEST,
+                               manifest.get());
+
+      dariadb::utils::async::ThreadManager::start(settings->thread_pools_params());
+
+      auto am = dariadb::storage::WALManager::create(_engine_env);
+
+      std::vector<std::thread> writers(writers_count);
+      for (size_t w = 0; w < writers_count; ++w) {
+        writers[w] = std::thread([&am, w]() {
+          uint64_t last_seq = 0;
+          for (size_t i = 0; i < values_per_writer; ++i) {
+            auto m = dariadb::Meas(dariadb::Id(w));
+            m.time = i;
+            auto seq = am->sequencedAppend(m);
+            BOOST_CHECK_GT(seq, last_seq);
+            last_seq = seq;
+          }
+          am->waitDurable(last_seq);
+          BOOST_CHECK_GE(am->durableSequence(), last_seq);
+        });
+      }
+      for (auto &t : writers) {
+        t.join();
+      }
+      BOOST_CHECK_EQUAL(am->durableSequence(), writers_count * values_per_writer);
+
+      dariadb::IdArray all_ids{0, 1, 2, 3};
+      dariadb::QueryInterval qi(all_ids, dariadb::Flag(), 0, values_per_writer);
+      auto out = am->readInterval(qi);
+      BOOST_CHECK_EQUAL(out.size(), writers_count * values_per_writer);
+
+      am = nullptr;
+      dariadb::utils::async::ThreadManager::stop();
+    }
+    if (dariadb::utils::fs::path_exists(storagePath)) {
+      dariadb::utils::fs::rm(storagePath);
+    }
+  }
+}